@@ -28,6 +28,10 @@
 #define SPARX64_NUM_STEPS            8
 #define SPARX64_NUM_ROUNDS_PER_STEP  3
 #define SPARX64_NUM_BRANCHES         2
+#define SPARX64_NUM_ROUNDS           (SPARX64_NUM_STEPS*SPARX64_NUM_ROUNDS_PER_STEP)
+
+// Number of states that are processed at once by the batched functions
+#define SPARX64_BATCH_SIZE          64
 
 // ---------------------------------------------------------
 // Types
@@ -37,6 +41,40 @@ typedef struct {
     uint16_t subkeys[17][2 * 3];
 } sparx64_context_t;
 
+// ---------------------------------------------------------
+
+/**
+ * SPARX64_BATCH_SIZE states in structure-of-arrays layout: words[i][j] is 
+ * the i-th 16-bit word of the j-th state. Processing the same word of all 
+ * states at once allows the compiler to vectorize the rounds.
+ */
+typedef struct {
+    uint16_t words[SPARX64_NUM_STATE_WORDS][SPARX64_BATCH_SIZE];
+} sparx64_batch_t;
+
+// ---------------------------------------------------------
+// ARX-box
+// ---------------------------------------------------------
+
+#define ROTL16(x, n) ((uint16_t)(((x) << (n)) | ((x) >> (16 - (n)))))
+#define ROTR16(x, n) ((uint16_t)(((x) >> (n)) | ((x) << (16 - (n)))))
+
+/**
+ * The ARX-box A, i.e., a round of SPECKEY-32 without the key addition. Is
+ * inline, s.t. loops over batches can still be vectorized.
+ */
+static inline void sparx_A(uint16_t* l, uint16_t* r) {
+    *l = (uint16_t)(ROTR16(*l, 7) + *r);
+    *r = ROTL16(*r, 2) ^ *l;
+}
+
+// ---------------------------------------------------------
+
+static inline void sparx_A_inverse(uint16_t* l, uint16_t* r) {
+    *r = ROTR16((uint16_t)(*r ^ *l), 2);
+    *l = ROTL16((uint16_t)(*l - *r), 7);
+}
+
 // ---------------------------------------------------------
 // API
 // ---------------------------------------------------------
@@ -51,6 +89,27 @@ void sparx_key_schedule(sparx64_context_t* ctx,
 
 // ---------------------------------------------------------
 
+/**
+ * Stores into key_state the 128-bit state of the key schedule from which 
+ * the given row of ctx->subkeys was taken: the six words of the row and the 
+ * two words that are not used in it. row must be in [0, 16].
+ */
+void sparx_get_key_state(const sparx64_context_t* ctx, 
+                         const size_t row, 
+                         uint16_t key_state[SPARX64_NUM_KEY_WORDS]);
+
+// ---------------------------------------------------------
+
+/**
+ * Inverts the key schedule, i.e., computes the master key from the state of 
+ * the key schedule at the given row of the subkeys.
+ */
+void sparx_invert_key_schedule(const uint16_t key_state[SPARX64_NUM_KEY_WORDS], 
+                               const size_t row, 
+                               uint16_t master_key[SPARX64_NUM_KEY_WORDS]);
+
+// ---------------------------------------------------------
+
 void sparx_linear_layer(const uint8_t p[SPARX64_STATE_LENGTH], 
                         uint8_t c[SPARX64_STATE_LENGTH]);
 
@@ -61,6 +120,16 @@ void sparx_invert_linear_layer(const uint8_t c[SPARX64_STATE_LENGTH],
 
 // ---------------------------------------------------------
 
+void sparx_linear_layer(const uint16_t p[SPARX64_NUM_STATE_WORDS], 
+                        uint16_t c[SPARX64_NUM_STATE_WORDS]);
+
+// ---------------------------------------------------------
+
+void sparx_invert_linear_layer(const uint16_t c[SPARX64_NUM_STATE_WORDS], 
+                               uint16_t p[SPARX64_NUM_STATE_WORDS]);
+
+// ---------------------------------------------------------
+
 void sparx_encrypt_rounds(const sparx64_context_t* ctx, 
                           const uint16_t p[SPARX64_NUM_STATE_WORDS], 
                           uint16_t c[SPARX64_NUM_STATE_WORDS], 
@@ -200,3 +269,90 @@ void sparx_encrypt_steps_trail(const sparx64_context_t* ctx,
                                const uint8_t p1[SPARX64_STATE_LENGTH], 
                                const uint8_t p2[SPARX64_STATE_LENGTH], 
                                const size_t num_steps);
+
+// ---------------------------------------------------------
+// Batched API
+// ---------------------------------------------------------
+
+/**
+ * Loads SPARX64_BATCH_SIZE states into the batch. The 64-bit states are 
+ * interpreted in big-endian manner, i.e., the highest 16 bits form word 0.
+ */
+void sparx_load_batch(sparx64_batch_t* batch, 
+                      const uint64_t states[SPARX64_BATCH_SIZE]);
+
+// ---------------------------------------------------------
+
+void sparx_store_batch(const sparx64_batch_t* batch, 
+                       uint64_t states[SPARX64_BATCH_SIZE]);
+
+// ---------------------------------------------------------
+
+/**
+ * Encrypts all states in the batch over the given round, counted from 1 to 
+ * SPARX64_NUM_ROUNDS, i.e., adds the round key and applies A to both 
+ * branches. The linear layer is not applied.
+ */
+void sparx_encrypt_round_batch(const sparx64_context_t* ctx, 
+                               sparx64_batch_t* batch, 
+                               const size_t round);
+
+// ---------------------------------------------------------
+
+void sparx_linear_layer_batch(sparx64_batch_t* batch);
+
+// ---------------------------------------------------------
+
+void sparx_invert_linear_layer_batch(sparx64_batch_t* batch);
+
+// ---------------------------------------------------------
+
+void sparx_encrypt_steps_batch(const sparx64_context_t* ctx, 
+                               sparx64_batch_t* batch, 
+                               const size_t from_step, 
+                               const size_t to_step);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns a bitmask with bit b set iff branch b is zero in the given 64-bit 
+ * mask or difference, e.g., the fixed branch of a structure or the inactive 
+ * branch of alpha.
+ */
+size_t sparx_get_inactive_branches(const uint64_t mask);
+
+// ---------------------------------------------------------
+
+/**
+ * Same as sparx_encrypt_steps_batch for a batch from a structure whose 
+ * branches in the bitmask constant_branches hold the same value in all 
+ * states. Since the branches are independent until the linear layer, those 
+ * are computed only once for the first step.
+ */
+void sparx_encrypt_steps_structure_batch(const sparx64_context_t* ctx, 
+                                         sparx64_batch_t* batch, 
+                                         const size_t constant_branches, 
+                                         const size_t from_step, 
+                                         const size_t to_step);
+
+// ---------------------------------------------------------
+
+/**
+ * Encrypts pairs (P, P ^ alpha) in both batches as sparx_encrypt_steps_batch. 
+ * The branches in the bitmask inactive_branches must be equal in both 
+ * batches; in the first step, they are computed only for the first batch 
+ * and copied to the second.
+ */
+void sparx_encrypt_steps_pair_batch(const sparx64_context_t* ctx, 
+                                    sparx64_batch_t* batch, 
+                                    sparx64_batch_t* batch_, 
+                                    const size_t inactive_branches, 
+                                    const size_t from_step, 
+                                    const size_t to_step);
+
+// ---------------------------------------------------------
+
+void sparx_decrypt_steps_batch(const sparx64_context_t* ctx, 
+                               sparx64_batch_t* batch, 
+                               const size_t from_step, 
+                               const size_t to_step);
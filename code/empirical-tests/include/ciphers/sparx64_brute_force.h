@@ -0,0 +1,77 @@
+/**
+ * Exhaustive search over the unknown bits of the key of SPARX-64/128, e.g.,
+ * for the final stage of an attack that recovered some round-key words.
+ *
+ * The known bits are given as the 128-bit state of the key schedule at a
+ * row of the subkeys (see sparx_get_key_state). Every candidate for the
+ * unknown bits of that state is inverted to a master key, whose subkeys are
+ * derived while encrypting the first known plaintext. Candidates are
+ * processed in structure-of-arrays batches of SPARX64_BATCH_SIZE keys, s.t.
+ * the compiler can vectorize the key schedule and the rounds. Only the
+ * candidates that map the first plaintext to its ciphertext are checked
+ * against the remaining pairs.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define SPARX64_BRUTE_FORCE_MAX_NUM_UNKNOWN_BITS 56
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    // Row of the subkeys at which the key state is partially known
+    size_t   row = 0;
+
+    // The known bits of the key state; the unknown bits are ignored
+    uint16_t key_state[SPARX64_NUM_KEY_WORDS];
+    uint16_t unknown_mask[SPARX64_NUM_KEY_WORDS];
+
+    // Known pairs of 64-bit states, word 0 in the highest bits
+    std::vector<uint64_t> plaintexts;
+    std::vector<uint64_t> ciphertexts;
+} sparx64_brute_force_problem_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    uint16_t words[SPARX64_NUM_KEY_WORDS];
+} sparx64_master_key_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of unknown bits of the key state of problem.
+ */
+size_t sparx_get_num_unknown_bits(const sparx64_brute_force_problem_t* problem);
+
+// ---------------------------------------------------------
+
+/**
+ * Tests all candidates for the unknown bits of problem and stores the master
+ * keys that are consistent with all known pairs into keys. Returns the
+ * number of tested candidates. The problem needs at least one pair and at
+ * most SPARX64_BRUTE_FORCE_MAX_NUM_UNKNOWN_BITS unknown bits.
+ */
+uint64_t sparx_brute_force(const sparx64_brute_force_problem_t* problem,
+                           utils::ThreadPool& pool,
+                           std::vector<sparx64_master_key_t>& keys);
@@ -0,0 +1,74 @@
+/**
+ * Estimates the probability of a differential (alpha -> delta) of SPARX-64
+ * over a number of rounds by summing the probabilities of all of its
+ * characteristics up to a maximal weight, like the CryptoSMT runs in
+ * results/sparx64_differentials/sparx*rounddifferentials, but without
+ * enumerating the characteristics one by one.
+ *
+ * The rounds are split into steps. Within a step, the branches are
+ * independent, s.t. the characteristics of a branch over a step are
+ * enumerated only once per input difference and memoized. After each step,
+ * all partial characteristics that end in the same difference with the same
+ * weight are merged into a single state that counts them. The last step is
+ * enumerated backwards from delta and joined with the states before it;
+ * each of its branches is bounded by what the lightest characteristic of
+ * the steps before it and the lightest one of the other branch leave.
+ *
+ * Differences are 64-bit values with word X0 in the highest bits, as in the
+ * trail store. Weights are those of Lipmaa and Moriai, i.e., without the
+ * most significant bits.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_rounds = 0;
+    uint64_t alpha = 0;
+    uint64_t delta = 0;
+    int      max_weight = 0;
+} cluster_problem_t;
+
+// ---------------------------------------------------------
+
+/**
+ * num_trails[w] is the number of characteristics with weight w;
+ * num_states[s] the number of merged states before step s.
+ */
+typedef struct {
+    std::vector<double> num_trails;
+    std::vector<size_t> num_states;
+} cluster_result_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Counts all characteristics of the problem with a weight of at most
+ * problem.max_weight by their weights.
+ */
+void cluster_estimate(const cluster_problem_t& problem,
+                      utils::ThreadPool& pool,
+                      cluster_result_t* result);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the sum of the probabilities of all counted characteristics.
+ */
+double cluster_get_probability(const cluster_result_t& result);
@@ -0,0 +1,141 @@
+/**
+ * Generation of plaintext pairs that conform to the first one to three
+ * rounds of a differential characteristic of SPARX-64 under a known key.
+ *
+ * Per Lipmaa and Moriai, a pair (x, y), (x ^ alpha, y ^ beta) yields the
+ * sum difference gamma iff the carries of both additions differ exactly in
+ * the bits alpha ^ beta ^ gamma. Thus, the conforming values of the
+ * addition of an ARX box form a path through the two possible carries per
+ * bit. The generator counts the completions per bit and carry once, and
+ * samples uniformly from the conforming inputs of the first round of each
+ * active branch. Since the key is known, the inputs of the ARX box are
+ * mapped back to the plaintext. The later rounds of the first step are
+ * checked on the sampled values, and the branch is sampled again until it
+ * conforms. Both branches are independent in the first step, s.t. their
+ * costs add instead of multiply.
+ *
+ * The generator also estimates neutral bits: plaintext bits whose flip
+ * keeps a conforming pair conforming. Bits that are neutral for all keys
+ * allow key-free structures of conforming pairs: given one conforming
+ * plaintext, sparx_conforming_get_structure() expands it over the neutral
+ * bits without the key, s.t. all pairs of the structure conform as far as
+ * the bits are neutral.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define SPARX64_CONFORMING_MAX_NUM_ROUNDS SPARX64_NUM_ROUNDS_PER_STEP
+#define SPARX64_CONFORMING_WORD_SIZE 16
+
+// Samples of a branch per plaintext before the generator gives up, e.g.,
+// if the later rounds cannot be reached under the key
+#define SPARX64_CONFORMING_MAX_NUM_SAMPLES (1 << 24)
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    sparx64_context_t cipher_ctx;
+    size_t num_rounds;
+
+    // Differences before round r, and after the ARX boxes of the last round
+    // without the linear layer
+    uint16_t differences[SPARX64_CONFORMING_MAX_NUM_ROUNDS + 1]
+                        [SPARX64_NUM_STATE_WORDS];
+
+    // Weights of the first num_rounds rounds per branch
+    int weights[SPARX64_NUM_BRANCHES];
+
+    // num_completions[b][i][c]: number of conforming values of the bits
+    // i ... 15 of both addends in the first round of branch b, given the
+    // carry c into bit i
+    uint64_t num_completions[SPARX64_NUM_BRANCHES]
+                            [SPARX64_CONFORMING_WORD_SIZE + 1][2];
+
+    // Statistics over all generated pairs
+    uint64_t num_pairs = 0;
+    uint64_t num_samples[SPARX64_NUM_BRANCHES] = { 0, 0 };
+} sparx64_conforming_generator_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Initializes the generator for the first num_rounds rounds of the trail
+ * under the subkeys of ctx. Returns false if the trail has fewer rounds or
+ * if one of these rounds is impossible.
+ */
+bool sparx_conforming_init(sparx64_conforming_generator_t* generator,
+                           const sparx64_context_t* ctx,
+                           const sparx64_trail_t& trail,
+                           const size_t num_rounds);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores into p a plaintext P s.t. (P, P ^ alpha) conforms to the first
+ * rounds of the trail, from the random state at seed. Returns false if a
+ * branch did not conform after SPARX64_CONFORMING_MAX_NUM_SAMPLES samples.
+ */
+bool sparx_conforming_next(sparx64_conforming_generator_t* generator,
+                           uint64_t* seed,
+                           uint64_t* p);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns true if (p, p ^ alpha) conforms to the first rounds of the trail.
+ */
+bool sparx_conforming_check(const sparx64_conforming_generator_t* generator,
+                            const uint64_t p);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the difference alpha of the plaintexts.
+ */
+uint64_t sparx_conforming_get_alpha(
+    const sparx64_conforming_generator_t* generator);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores into probabilities[i] the fraction of num_samples conforming pairs
+ * that still conform after flipping bit i of both plaintexts. Returns false
+ * if a conforming pair could not be sampled.
+ */
+bool sparx_conforming_get_neutral_bits(
+    sparx64_conforming_generator_t* generator,
+    uint64_t* seed,
+    const size_t num_samples,
+    double probabilities[64]);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores into states the first num_states plaintexts p ^ d(i) of the
+ * structure of p, where d(i) deposits the bits of i into those of
+ * neutral_mask; num_states must be at most 2^{|neutral_mask|}. Needs no
+ * key, s.t. the pairs conform only as far as the bits are neutral, which
+ * sparx_conforming_check() can verify under the known key.
+ */
+void sparx_conforming_get_structure(const uint64_t p,
+                                    const uint64_t neutral_mask,
+                                    const size_t num_states,
+                                    uint64_t* states);
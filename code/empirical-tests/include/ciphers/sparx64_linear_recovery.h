@@ -0,0 +1,126 @@
+/**
+ * Key recovery for linear approximations of SPARX-64 over all guesses of
+ * the final-round key of a branch at once, with the fast Walsh-Hadamard
+ * transform.
+ *
+ * The approximation (u -> v) covers the steps up to the input of a step.
+ * The ciphertexts are taken after the first two rounds of that step. The
+ * A of the final round is inverted without a key to z; then, for a guess k
+ * of the final-round key of the branch, the parity of v is that of
+ * A^{-1}(z ^ k). This parity depends only on some active bits of z ^ k.
+ * Counting the signs (-1)^{<u, p>} of all texts per value of the active
+ * bits of z gives a vector of counts; its XOR-convolution with the signs
+ * (-1)^{<v, A^{-1}(w)>} yields the correlations for all guesses of the
+ * active key bits. The convolution is computed with three transforms in
+ * O(n 2^n) for n active bits, instead of O(2^n) per text.
+ *
+ * v is a 32-bit mask (x << 16) | y on the branch, like the differences in
+ * speckey32_trail.h; u is a 64-bit mask on the plaintext.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define SPARX64_LINEAR_RECOVERY_MAX_NUM_ACTIVE_BITS 24
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   branch = 0;
+    uint64_t input_mask = 0;
+    uint32_t output_mask = 0;
+
+    // Bits of z on which the parity of the output mask depends
+    uint32_t active_mask = 0;
+    size_t   num_active_bits = 0;
+
+    // Sum of the signs of the texts per value of the active bits
+    std::vector<int64_t> counts;
+} sparx64_linear_counter_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    // The active bits of the final-round key, compressed as by
+    // sparx_linear_compress
+    uint32_t guess;
+    double   correlation;
+} sparx64_linear_guess_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the bits of a 32-bit branch state w on which the parity
+ * <output_mask, A^{-1}(w)> depends.
+ */
+uint32_t sparx_linear_get_active_mask(const uint32_t output_mask);
+
+// ---------------------------------------------------------
+
+/**
+ * Initializes counter with zero counts. Returns false if the output mask
+ * has more than SPARX64_LINEAR_RECOVERY_MAX_NUM_ACTIVE_BITS active bits.
+ */
+bool sparx_linear_init_counter(sparx64_linear_counter_t* counter,
+                               const size_t branch,
+                               const uint64_t input_mask,
+                               const uint32_t output_mask);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the active bits of the 32-bit value, packed into the lowest bits.
+ */
+uint32_t sparx_linear_compress(const sparx64_linear_counter_t* counter,
+                               const uint32_t value);
+
+// ---------------------------------------------------------
+
+/**
+ * Adds the plaintexts and the batch of their ciphertexts, which were
+ * encrypted over the first two rounds of the step after the approximation,
+ * to the counts.
+ */
+void sparx_linear_add_batch(sparx64_linear_counter_t* counter,
+                            const uint64_t plaintexts[SPARX64_BATCH_SIZE],
+                            const sparx64_batch_t* ciphertexts,
+                            const size_t num_texts);
+
+// ---------------------------------------------------------
+
+/**
+ * Adds the counts of other, which must have the same masks.
+ */
+void sparx_linear_merge(sparx64_linear_counter_t* counter,
+                        const sparx64_linear_counter_t* other);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the correlations of all guesses of the active key bits into
+ * ranking, sorted by decreasing absolute correlation. num_texts is the
+ * number of texts that were counted.
+ */
+void sparx_linear_rank_guesses(const sparx64_linear_counter_t* counter,
+                               const uint64_t num_texts,
+                               utils::ThreadPool& pool,
+                               std::vector<sparx64_linear_guess_t>& ranking);
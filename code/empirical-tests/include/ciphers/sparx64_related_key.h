@@ -0,0 +1,53 @@
+/**
+ * Related keys for SPARX-64/128.
+ *
+ * A related key K ^ key_difference is expanded with the regular key
+ * schedule, s.t. the difference spreads through the permutation
+ * K_perm_64_128, including its ARX box and the addition of the round
+ * counter. The resulting differences of the subkeys depend on the key in
+ * general and are tracked per row of the subkeys, i.e., per step and
+ * branch.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ciphers/sparx64.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+// Rows of ctx->subkeys: two per step and the final whitening key
+#define SPARX64_NUM_SUBKEY_ROWS (SPARX64_NUM_BRANCHES * SPARX64_NUM_STEPS + 1)
+
+// 16-bit words per row: two per round of a step
+#define SPARX64_NUM_SUBKEY_WORDS (2 * SPARX64_NUM_ROUNDS_PER_STEP)
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Derives into related the subkeys of the master key key ^ key_difference.
+ */
+void sparx_related_key_schedule(
+    sparx64_context_t* related,
+    const uint16_t key[SPARX64_NUM_KEY_WORDS],
+    const uint16_t key_difference[SPARX64_NUM_KEY_WORDS]);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the XOR differences of all subkeys of a and b into differences.
+ */
+void sparx_get_subkey_differences(
+    const sparx64_context_t* a,
+    const sparx64_context_t* b,
+    uint16_t differences[SPARX64_NUM_SUBKEY_ROWS][SPARX64_NUM_SUBKEY_WORDS]);
@@ -0,0 +1,77 @@
+/**
+ * Rotational-XOR (RX) pairs for SPARX-64.
+ *
+ * An RX pair (x, x') has the RX-difference x' ^ rot(x), where rot rotates
+ * each 16-bit word to the left by gamma bits. The linear layer of SPARX-64
+ * consists of XORs and rotations of whole 16-bit words and commutes with
+ * rot; thus, RX-differences propagate through it like XOR differences,
+ * while the modular additions of the ARX boxes and the round-key additions
+ * are probabilistic or inject the RX-difference of the keys.
+ *
+ * The second context of a pair holds either the subkeys of a related master
+ * key rot(K) ^ key_offset, derived through the key schedule, whose round
+ * constants inject further RX-differences, or directly the rotated subkeys
+ * of the first context.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ciphers/sparx64.h"
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the 64-bit state with each 16-bit word rotated to the left by
+ * gamma bits.
+ */
+uint64_t sparx_rx_rotate(const uint64_t state, const size_t gamma);
+
+// ---------------------------------------------------------
+
+/**
+ * Rotates each 16-bit word of all states of the batch to the left by gamma
+ * bits.
+ */
+void sparx_rx_rotate_batch(sparx64_batch_t* batch, const size_t gamma);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the RX-differences b ^ rot(a) of all pairs of states of the
+ * batches into differences.
+ */
+void sparx_rx_get_differences_batch(const sparx64_batch_t* a,
+                                    const sparx64_batch_t* b,
+                                    const size_t gamma,
+                                    uint64_t differences[SPARX64_BATCH_SIZE]);
+
+// ---------------------------------------------------------
+
+/**
+ * Derives into related the subkeys of the master key
+ * rot(key) ^ key_offset.
+ */
+void sparx_rx_related_key_schedule(
+    sparx64_context_t* related,
+    const uint16_t key[SPARX64_NUM_KEY_WORDS],
+    const uint16_t key_offset[SPARX64_NUM_KEY_WORDS],
+    const size_t gamma);
+
+// ---------------------------------------------------------
+
+/**
+ * Stores into rotated all subkeys of ctx, each rotated to the left by gamma
+ * bits.
+ */
+void sparx_rx_rotate_subkeys(sparx64_context_t* rotated,
+                             const sparx64_context_t* ctx,
+                             const size_t gamma);
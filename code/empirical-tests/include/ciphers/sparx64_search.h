@@ -0,0 +1,151 @@
+/**
+ * A multithreaded branch-and-bound search for differential characteristics 
+ * of SPARX-64 (as in the sparxround model) and SPECKEY-32 (as in the speckey
+ * model) in the style of Matsui's algorithm.
+ *
+ * The search proceeds round by round from the input difference. In every 
+ * round, it enumerates the output differences of the modular additions in 
+ * the ARX-boxes bit by bit with the conditions of Lipmaa and Moriai, s.t. 
+ * only possible transitions within the remaining weight are visited. A 
+ * partial characteristic is discarded as soon as its weight plus a lower 
+ * bound for the remaining rounds exceeds the target weight. The bounds use 
+ * the minimal weights of SPARX-64 and SPECKEY-32 over fewer rounds, and that
+ * every active branch stays active until the end of its step.
+ *
+ * Words of any row can be fixed like the fixedVariables of CryptoSMT. The 
+ * search is fastest if the input difference is fixed. The subtrees of the 
+ * first rounds are distributed over the threads of a work-stealing pool.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <functional>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+#include "utils/WorkStealingPool.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define TRAIL_SEARCH_MAX_NUM_ROUNDS SPARX64_NUM_ROUNDS
+
+typedef enum {
+    TRAIL_SEARCH_SPARX64   = 0,
+    TRAIL_SEARCH_SPECKEY32 = 1
+} trail_search_cipher_t;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * fixed_masks[r][i] marks the bits of word i before round r that must be 
+ * equal to those of fixed_values[r][i]. SPECKEY-32 uses only words 0 and 1.
+ * The subtrees after the first num_split_rounds rounds are tasks of their 
+ * own that can be stolen by other threads.
+ */
+typedef struct {
+    trail_search_cipher_t cipher = TRAIL_SEARCH_SPARX64;
+    size_t   num_rounds = 0;
+    size_t   num_split_rounds = 2;
+    uint16_t fixed_masks[TRAIL_SEARCH_MAX_NUM_ROUNDS + 1][SPARX64_NUM_STATE_WORDS];
+    uint16_t fixed_values[TRAIL_SEARCH_MAX_NUM_ROUNDS + 1][SPARX64_NUM_STATE_WORDS];
+} trail_search_problem_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Is called for every characteristic that is found, possibly from several 
+ * threads at once. For SPECKEY-32, only words 0 and 1 and weights[0] of the
+ * rows are used. Returns false to stop the search.
+ */
+typedef std::function<bool(const sparx64_trail_t& trail)> 
+    trail_search_callback_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Is called for every characteristic of a single ARX-box branch with the
+ * difference at its other end and its weight.
+ */
+typedef std::function<void(const uint16_t difference[2], const int weight)>
+    trail_search_branch_callback_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Sets up a problem without fixed words.
+ */
+void trail_search_init(trail_search_problem_t* problem, 
+                       const trail_search_cipher_t cipher, 
+                       const size_t num_rounds);
+
+// ---------------------------------------------------------
+
+/**
+ * Fixes word i before round r to value.
+ */
+void trail_search_fix_word(trail_search_problem_t* problem, 
+                           const size_t r, 
+                           const size_t i, 
+                           const uint16_t value);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns a lower bound for the weight of any characteristic of the problem
+ * that starts at round r, where num_active_branches of the state before 
+ * round r are non-zero.
+ */
+int trail_search_get_lower_bound(const trail_search_problem_t& problem, 
+                                 const size_t r, 
+                                 const size_t num_active_branches);
+
+// ---------------------------------------------------------
+
+/**
+ * Searches all characteristics of the problem with the given weight and a 
+ * non-zero input difference, and calls callback for each of them. Returns 
+ * their number.
+ */
+size_t trail_search_run(const trail_search_problem_t& problem, 
+                        const int weight, 
+                        utils::WorkStealingPool& pool, 
+                        const trail_search_callback_t& callback);
+
+// ---------------------------------------------------------
+
+/**
+ * Enumerates all characteristics of a single branch, i.e., of SPECKEY-32, 
+ * over num_rounds rounds from the input difference in with a weight of at
+ * most max_weight, and calls callback with their output differences. 
+ * Characteristics that end in the same difference are reported separately.
+ */
+void trail_search_enumerate_branch(
+    const uint16_t in[2], 
+    const size_t num_rounds, 
+    const int max_weight, 
+    const trail_search_branch_callback_t& callback);
+
+// ---------------------------------------------------------
+
+/**
+ * Like trail_search_enumerate_branch, but in decryption direction from the
+ * output difference out; callback is called with the input differences.
+ */
+void trail_search_enumerate_branch_backwards(
+    const uint16_t out[2], 
+    const size_t num_rounds, 
+    const int max_weight, 
+    const trail_search_branch_callback_t& callback);
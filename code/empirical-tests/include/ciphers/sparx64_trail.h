@@ -0,0 +1,70 @@
+/**
+ * Differential characteristics of SPARX-64 as found by CryptoSMT with the 
+ * sparxround model, e.g., in results/sparx64_differentials/. A file may 
+ * contain many characteristics, each as a table
+ *
+ * Characteristic for sparxround - Rounds 6 - Wordsize 16 - Weight 13
+ * Rounds  X0      X1      Y0      Y1      X0L     X1L     wl      wr
+ * ---------------------------------------------------------------------
+ * 0       0x0000  0x0000  0x0211  0x0A04  none    none    -0      -4
+ * ...
+ * 6       0xAF1A  0xBF30  0x850A  0x9520  none    none    none    none
+ *
+ * where row i holds the difference before round i and the weights of the
+ * left and right ARX-boxes in round i. The linear layer is applied after 
+ * every third round; X0L, X1L hold the left branch after it.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+// Marks a weight that is "none" in the file
+#define SPARX64_TRAIL_NO_WEIGHT -1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    uint16_t difference[SPARX64_NUM_STATE_WORDS];
+    int      weights[SPARX64_NUM_BRANCHES];
+} sparx64_trail_row_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    int weight = SPARX64_TRAIL_NO_WEIGHT;
+    std::vector<sparx64_trail_row_t> rows;
+} sparx64_trail_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of rounds of the trail, i.e., one less than its rows.
+ */
+size_t sparx_get_num_trail_rounds(const sparx64_trail_t& trail);
+
+// ---------------------------------------------------------
+
+/**
+ * Reads all characteristics from the CryptoSMT output at path, in the order
+ * of the file. Returns false if the file could not be read or contains a
+ * malformed characteristic.
+ */
+bool sparx_read_trails(const char* path, std::vector<sparx64_trail_t>& trails);
@@ -0,0 +1,105 @@
+/**
+ * Exact XOR-differential probabilities of the modular addition and the 
+ * ARX-box A of SPARX-64 (and of SPECKEY-32, whose rounds are A-boxes with a 
+ * key addition after the modular addition) with the formulas of Lipmaa and 
+ * Moriai [Efficient Algorithms for Computing Differential Properties of 
+ * Addition, FSE 2001].
+ *
+ * Weights are -log2 of the probabilities, which are always powers of two.
+ * They can be used to verify the weights that CryptoSMT reports per round.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+#include "ciphers/speckey32_trail.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+// Weight of a transition with probability zero
+#define XDP_ADD_IMPOSSIBLE -1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * Some CryptoSMT result files also count the most significant bit in the 
+ * per-round weights, although its carry out is free; weights_with_msb holds 
+ * the weights as counted there.
+ */
+typedef struct {
+    int weights[SPARX64_NUM_BRANCHES];
+    int weights_with_msb[SPARX64_NUM_BRANCHES];
+} sparx64_xdp_round_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    int weight;
+    int weight_with_msb;
+} speckey32_xdp_round_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the weight of the differential (alpha, beta) -> gamma through the
+ * 16-bit modular addition, or XDP_ADD_IMPOSSIBLE.
+ */
+int xdp_add_weight(const uint16_t alpha, 
+                   const uint16_t beta, 
+                   const uint16_t gamma);
+
+// ---------------------------------------------------------
+
+/**
+ * As xdp_add_weight, but also counts the most significant bit if the 
+ * differences of alpha, beta, and gamma are not all equal there.
+ */
+int xdp_add_weight_with_msb(const uint16_t alpha, 
+                            const uint16_t beta, 
+                            const uint16_t gamma);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the weight of the differential (in[0], in[1]) -> (out[0], out[1])
+ * through A, or XDP_ADD_IMPOSSIBLE if it is impossible, e.g., also if the 
+ * right word of out does not follow from the others.
+ */
+int sparx_arx_box_weight(const uint16_t in[2], const uint16_t out[2]);
+
+// ---------------------------------------------------------
+
+/**
+ * Computes the exact weights of both ARX-boxes in every round of the trail 
+ * into rounds, propagating the differences through the linear layer after 
+ * every third round. The trail must start at the first round of a step.
+ * Returns the sum of all weights, or XDP_ADD_IMPOSSIBLE if any of the 
+ * transitions is impossible.
+ */
+int sparx_get_exact_trail_weights(const sparx64_trail_t& trail, 
+                                  std::vector<sparx64_xdp_round_t>& rounds);
+
+// ---------------------------------------------------------
+
+/**
+ * Computes the exact weight of every round of the trail into rounds.
+ * Returns their sum, or XDP_ADD_IMPOSSIBLE if any transition is impossible.
+ */
+int speckey_get_exact_trail_weights(const speckey32_trail_t& trail, 
+                                    std::vector<speckey32_xdp_round_t>& rounds);
@@ -0,0 +1,94 @@
+/**
+ * Exact evaluation of differentials and boomerang switches of a single
+ * branch of SPARX-64, i.e., of SPECKEY-32 with the round keys of SPARX-64,
+ * under a fixed key.
+ *
+ * A branch is a 32-bit permutation, s.t. a differential (alpha -> beta) over
+ * a few rounds can be evaluated exactly by encrypting all 2^32 inputs. Since
+ * x and x ^ alpha form the same pair, only the 2^31 inputs with the lowest
+ * active bit of alpha unset are encrypted, together with their partners.
+ * Texts are processed in structure-of-arrays blocks like the batched API of
+ * sparx64.h, s.t. the compiler can vectorize the rounds.
+ *
+ * Round r (counted from 0) of branch b uses the round keys of branch b in
+ * step r / 3. Differences are 32-bit values (x << 16) | y as in
+ * speckey32_trail.h. Counts are numbers of inputs x of all 2^32, i.e., the
+ * probability of a differential is count / 2^32.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define SPECKEY32_EXHAUSTIVE_NUM_TEXTS (1ULL << 32)
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    uint32_t difference;
+    uint64_t count;
+} speckey32_count_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of inputs x for which the first num_rounds rounds of
+ * branch of ctx map x and x ^ alpha to outputs with difference beta.
+ * alpha must not be zero.
+ */
+uint64_t speckey_count_differential(const sparx64_context_t* ctx,
+                                    const size_t branch,
+                                    const size_t num_rounds,
+                                    const uint32_t alpha,
+                                    const uint32_t beta,
+                                    utils::ThreadPool& pool);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of inputs x for which the quartet of the boomerang
+ * connectivity table returns over the first num_rounds rounds of branch of
+ * ctx: x and x ^ beta are encrypted, gamma is XORed to both outputs, and the
+ * results decrypt to a pair with difference beta again. beta is the upper,
+ * gamma the lower difference.
+ */
+uint64_t speckey_count_boomerang(const sparx64_context_t* ctx,
+                                 const size_t branch,
+                                 const size_t num_rounds,
+                                 const uint32_t beta,
+                                 const uint32_t gamma,
+                                 utils::ThreadPool& pool);
+
+// ---------------------------------------------------------
+
+/**
+ * Like speckey_count_differential, but counts all output differences from
+ * alpha. Stores those with a count of at least min_count into counts, sorted
+ * by difference. If the output differences do not fit into memory at once,
+ * they are counted in several passes over all inputs.
+ */
+void speckey_count_output_differences(const sparx64_context_t* ctx,
+                                      const size_t branch,
+                                      const size_t num_rounds,
+                                      const uint32_t alpha,
+                                      const uint64_t min_count,
+                                      utils::ThreadPool& pool,
+                                      std::vector<speckey32_count_t>& counts);
@@ -0,0 +1,71 @@
+/**
+ * Differential characteristics of SPECKEY-32, i.e., of a single branch of 
+ * SPARX-64, as found by CryptoSMT with the speckey model, e.g., in 
+ * results/speckey_differentials/. Each characteristic is a table
+ *
+ * Characteristic for speckey - Rounds 4 - Wordsize 16- Weight 5
+ * Rounds  x       y       whex
+ * -------------------------------
+ * 0       0x2800  0x0010  0x0050
+ * ...
+ * 4       0x8000  0x840A  none
+ *
+ * where row i holds the difference before round i. whex marks the bits that
+ * cost probability in the modular addition of round i; the most significant
+ * bit is free, s.t. the weight of the round is the number of the other bits.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define SPECKEY32_NUM_STATE_WORDS 2
+
+// Marks a weight that is "none" in the file
+#define SPECKEY32_TRAIL_NO_WEIGHT -1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    uint16_t difference[SPECKEY32_NUM_STATE_WORDS];
+    int      weight;
+} speckey32_trail_row_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    int weight = SPECKEY32_TRAIL_NO_WEIGHT;
+    std::vector<speckey32_trail_row_t> rows;
+} speckey32_trail_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of rounds of the trail, i.e., one less than its rows.
+ */
+size_t speckey_get_num_trail_rounds(const speckey32_trail_t& trail);
+
+// ---------------------------------------------------------
+
+/**
+ * Reads all characteristics from the CryptoSMT output at path, in the order
+ * of the file. Returns false if the file could not be read or contains a
+ * malformed characteristic.
+ */
+bool speckey_read_trails(const char* path, 
+                         std::vector<speckey32_trail_t>& trails);
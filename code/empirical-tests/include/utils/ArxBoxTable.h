@@ -0,0 +1,169 @@
+/**
+ * A precomputed table of the differential transitions of the ARX-box A of
+ * SPARX-64 (i.e., of SPECKEY-32) over 1, 2, and 3 rounds, the rounds of a
+ * branch in a step.
+ *
+ * ArxBoxTableBuilder enumerates, for a set of input differences, all
+ * characteristics up to a maximal weight and stores for every output
+ * difference the weight of the best characteristic and the sum of the
+ * probabilities of all of them. ArxBoxTable maps the written file into
+ * memory, s.t. searches can look up transitions without enumerating them.
+ *
+ * Layout of the file (all integers in host byte order):
+ *
+ * arx_box_table_header_t
+ * arx_box_table_input_t[num_inputs]             sorted by difference
+ * arx_box_table_transition_t[num_transitions]   for each input and number
+ *                                               of rounds, sorted by
+ *                                               output difference
+ *
+ * Differences are 32-bit values (x << 16) | y of the words x, y of a branch.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "utils/MappedFile.h"
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define ARX_BOX_TABLE_VERSION         1
+#define ARX_BOX_TABLE_MAX_NUM_ROUNDS  3
+#define ARX_BOX_TABLE_NO_WEIGHT      -1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    int32_t  max_weight;
+    uint64_t num_inputs;
+    uint64_t num_transitions;
+    uint64_t inputs_offset;
+    uint64_t transitions_offset;
+} arx_box_table_header_t;
+
+// ---------------------------------------------------------
+
+/**
+ * The transitions over r + 1 rounds from difference are those in
+ * [first_transitions[r], first_transitions[r + 1]); min_weights[r] is the
+ * minimal weight among them or ARX_BOX_TABLE_NO_WEIGHT if there is none.
+ */
+typedef struct {
+    uint32_t difference;
+    int16_t  min_weights[ARX_BOX_TABLE_MAX_NUM_ROUNDS];
+    int16_t  reserved;
+    uint64_t first_transitions[ARX_BOX_TABLE_MAX_NUM_ROUNDS + 1];
+} arx_box_table_input_t;
+
+// ---------------------------------------------------------
+
+/**
+ * weight is that of the best characteristic to difference, probability the
+ * sum over all characteristics up to the maximal weight of the table.
+ */
+typedef struct {
+    uint32_t difference;
+    int32_t  weight;
+    double   probability;
+} arx_box_table_transition_t;
+
+// ---------------------------------------------------------
+
+class ArxBoxTableBuilder {
+public:
+    explicit ArxBoxTableBuilder(const int max_weight)
+        : max_weight(max_weight) {}
+
+    /**
+     * Adds an input difference; duplicates are ignored.
+     */
+    void add_input(const uint32_t difference);
+
+    /**
+     * Enumerates the transitions of all inputs in parallel.
+     */
+    void compute(ThreadPool& pool);
+
+    /**
+     * Writes the computed table to path.
+     */
+    bool write(const char* path);
+
+    size_t get_num_inputs() const { return inputs.size(); }
+    size_t get_num_transitions() const;
+private:
+    int max_weight;
+    std::vector<arx_box_table_input_t> inputs;
+    std::vector<std::vector<arx_box_table_transition_t> > transitions;
+};
+
+// ---------------------------------------------------------
+
+class ArxBoxTable {
+public:
+    /**
+     * Maps the table at path. Returns false if it does not exist or is not
+     * a valid table, e.g., if its sections exceed the truncated file or
+     * its inputs are not sorted by difference.
+     */
+    bool open(const char* path);
+
+    int    get_max_weight() const { return header->max_weight; }
+    size_t get_num_inputs() const { return (size_t)header->num_inputs; }
+
+    const arx_box_table_input_t& get_input(const size_t index) const {
+        return inputs[index];
+    }
+
+    /**
+     * Returns the entry of the input difference or NULL if the table does
+     * not contain it.
+     */
+    const arx_box_table_input_t* find_input(const uint32_t difference) const;
+
+    /**
+     * Returns the transitions over num_rounds rounds from input and stores
+     * their number in num_transitions.
+     */
+    const arx_box_table_transition_t* get_transitions(
+        const arx_box_table_input_t& input,
+        const size_t num_rounds,
+        size_t* num_transitions) const;
+
+    /**
+     * Returns the transition over num_rounds rounds from input to the output
+     * difference or NULL if there is none up to the maximal weight.
+     */
+    const arx_box_table_transition_t* find_transition(
+        const arx_box_table_input_t& input,
+        const size_t num_rounds,
+        const uint32_t difference) const;
+private:
+    MappedFile file;
+    const arx_box_table_header_t*     header = NULL;
+    const arx_box_table_input_t*      inputs = NULL;
+    const arx_box_table_transition_t* transitions = NULL;
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,99 @@
+/**
+ * Collects per-bit and per-word statistics of 64-bit differences, e.g., of 
+ * the pairs of an experiment after each step, to find biased output bits 
+ * for truncated differentials.
+ *
+ * Differences are added in blocks of 64. A block is transposed as 64x64 bit
+ * matrix, s.t. the i-th row holds the i-th bit of all 64 differences; a
+ * single popcount per row then counts the ones of each bit. For the four 
+ * 16-bit words, the profile counts which of them are zero together, which 
+ * gives the exact probability of every word-level truncated difference.
+ *
+ * Bit 63 is the most significant bit of word 0, i.e., the differences are 
+ * interpreted in the same big-endian order as they are printed.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define BIAS_PROFILE_NUM_BITS      64
+#define BIAS_PROFILE_NUM_WORDS      4
+#define BIAS_PROFILE_NUM_PATTERNS  (1 << BIAS_PROFILE_NUM_WORDS)
+
+// ---------------------------------------------------------
+// Functions
+// ---------------------------------------------------------
+
+/**
+ * Transposes the 64x64 bit matrix in place, with bits counted from the most
+ * significant one: afterwards, bit j of matrix[i] is the former bit i of 
+ * matrix[j].
+ */
+void transpose_64x64(uint64_t matrix[64]);
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+class BiasProfile {
+public:
+    explicit BiasProfile(const size_t num_steps);
+
+    /**
+     * Adds num_differences <= 64 differences after step step_index, counted
+     * from 0.
+     */
+    void add(const size_t step_index, 
+             const uint64_t* differences, 
+             const size_t num_differences);
+
+    /**
+     * Adds the counts of other, which must have the same number of steps.
+     */
+    void merge(const BiasProfile& other);
+
+    /**
+     * Prints one line per step with one character per bit: '#' if the bit
+     * difference was constant, digit d if its correlation |2p - 1| was about
+     * 2^{-d}, '.' if it was not significant (below four standard deviations).
+     */
+    void print_heat_map() const;
+
+    /**
+     * Prints, for every step, the word-level truncated differences with the
+     * largest advantage over random, and bit-level masks from the bits whose
+     * difference was biased at least to the given thresholds.
+     */
+    void print_suggested_masks(const size_t num_masks) const;
+private:
+    typedef struct {
+        uint64_t num_differences = 0;
+        uint64_t num_ones[BIAS_PROFILE_NUM_BITS];
+        uint64_t num_zero_patterns[BIAS_PROFILE_NUM_PATTERNS];
+    } step_profile_t;
+
+    std::vector<step_profile_t> steps;
+
+    double get_probability_of_zero_words(const step_profile_t& step, 
+                                         const size_t word_mask) const;
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,76 @@
+/**
+ * A disk cache of boomerang connectivity table entries of a branch of
+ * SPARX-64, s.t. switches have to be evaluated only once.
+ *
+ * An entry accumulates, for a number of rounds and an upper and lower
+ * difference, the number of returning quartets over all 2^32 inputs of a
+ * branch and the number of keys over which they were counted. Entries are
+ * stored as JSON lines, like checkpoints, e.g.:
+ *
+ * {"num_rounds":1,"beta":"00400000","gamma":"80008000","num_keys":4,"count":17179869184}
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_rounds = 0;
+    uint32_t beta = 0;
+    uint32_t gamma = 0;
+    size_t   num_keys = 0;
+    uint64_t count = 0;
+} boomerang_cache_entry_t;
+
+// ---------------------------------------------------------
+
+class BoomerangCache {
+public:
+    /**
+     * Reads all entries from path. A missing file is an empty cache; returns
+     * false only if the file exists but could not be parsed.
+     */
+    bool read(const char* path);
+
+    /**
+     * Writes all entries atomically to path.
+     */
+    bool write(const char* path) const;
+
+    /**
+     * Returns the entry for the given rounds and differences, or NULL if
+     * there is none.
+     */
+    const boomerang_cache_entry_t* find(const size_t num_rounds,
+                                        const uint32_t beta,
+                                        const uint32_t gamma) const;
+
+    /**
+     * Adds the keys and count of entry to those of the cached entry with the
+     * same rounds and differences.
+     */
+    void add(const boomerang_cache_entry_t& entry);
+
+    size_t get_num_entries() const { return entries.size(); }
+private:
+    std::vector<boomerang_cache_entry_t> entries;
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,46 @@
+/**
+ * A read-only memory mapping of a file. Large binary tables can thus be
+ * used without reading them into memory first; the operating system loads
+ * only the pages that are actually accessed.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    /**
+     * Maps the file at path. Returns false if it does not exist, is empty,
+     * or could not be mapped.
+     */
+    bool           open(const char* path);
+    void           close();
+    bool           is_open() const { return data != NULL; }
+    const uint8_t* get_data() const { return data; }
+    size_t         get_size() const { return size; }
+private:
+    const uint8_t* data = NULL;
+    size_t         size = 0;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,99 @@
+/**
+ * Records right pairs or quartets of an experiment into a binary file
+ * without serializing the threads that find them.
+ *
+ * Every experiment thread owns a lock-free single-producer/single-consumer
+ * ring buffer. Threads only append records to their own buffer; a
+ * background thread drains all buffers asynchronously into the file. A
+ * producer only waits if its buffer is full, i.e., if right pairs are found
+ * faster than they can be written.
+ *
+ * The file starts with a header of 16 bytes:
+ *
+ * magic "SPXPAIRS" (8 bytes), version (uint32_t), record size (uint32_t),
+ *
+ * followed by the records as pair_record_t in host byte order (little endian
+ * on x86). Texts and differences are stored as byte arrays in the same
+ * big-endian order as printed by the tests.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <thread> // NOLINT(build/c++11)
+#include <vector>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define PAIR_RECORD_MAX_TEXTS       4
+#define PAIR_RECORD_MAX_DIFFERENCES 8
+#define PAIR_RECORD_STATE_LENGTH    8
+#define PAIR_RECORDER_VERSION       1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * A right pair (P, P', C, C') or quartet (P, P', Q, Q') together with the
+ * differences of (P, P') after each of the first num_differences steps.
+ */
+typedef struct {
+    uint32_t key_index;
+    uint16_t num_texts;
+    uint16_t num_differences;
+    uint8_t  texts[PAIR_RECORD_MAX_TEXTS][PAIR_RECORD_STATE_LENGTH];
+    uint8_t  differences[PAIR_RECORD_MAX_DIFFERENCES][PAIR_RECORD_STATE_LENGTH];
+} pair_record_t;
+
+// ---------------------------------------------------------
+
+class PairRecorder {
+public:
+    PairRecorder(const char* path, const size_t num_threads);
+    ~PairRecorder();
+    bool   is_open() const { return file != NULL; }
+    void   record(const size_t thread_index, const pair_record_t& record);
+    size_t get_num_records() const { return num_records; }
+private:
+    static const size_t BUFFER_CAPACITY = 1 << 12;
+
+    static const size_t CACHE_LINE_LENGTH = 64;
+
+    // head is only written by the producer, tail only by the writer; the 
+    // padding keeps both on separate cache lines
+    struct RingBuffer {
+        std::atomic<size_t> head;
+        uint8_t padding0[CACHE_LINE_LENGTH - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> tail;
+        uint8_t padding1[CACHE_LINE_LENGTH - sizeof(std::atomic<size_t>)];
+        pair_record_t records[BUFFER_CAPACITY];
+    };
+
+    FILE*                 file;
+    std::atomic<bool>     is_running;
+    std::thread           writer;
+    size_t                num_records = 0;
+    std::vector<std::unique_ptr<RingBuffer> > buffers;
+
+    size_t drain();
+    void   run_writer();
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
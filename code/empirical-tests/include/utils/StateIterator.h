@@ -1,15 +1,27 @@
 /**
  * Given a byte array as mask of n bytes, this class will allow to generate a
  * series of n-byte values when calling next which iterate over all possible
- * values where the mask has 1 bits. 
- * 
+ * values where the mask has 1 bits.
+ *
  * Example: mask = [10000000,01000001] will generate 2**3 = 8 outputs, namely
- * [00000000,00000000], [00000000,00000001], 
- * [00000000,01000000], [00000000,01000001], 
- * [10000000,00000000], [10000000,00000001], 
+ * [00000000,00000000], [00000000,00000001],
+ * [00000000,01000000], [00000000,01000001],
+ * [10000000,00000000], [10000000,00000001],
  * [10000000,01000000], [10000000,01000001]
  * in this sequence, one at a time, when calling next().
- * 
+ *
+ * The state at index i deposits the bits of i into the active bits of the
+ * mask, with a single PDEP where BMI2 is available, s.t. every state can be
+ * accessed directly with get_state(i) for i in [0, get_num_states()). In
+ * Gray-code mode, the index i is mapped to i ^ (i >> 1) first, s.t.
+ * consecutive states differ in a single active bit, which next() and
+ * next_batch() update incrementally. The same states are enumerated in both
+ * modes, only in a different order.
+ *
+ * An iterator can be restricted to an index range, e.g., one of the ranges
+ * of split() per thread, and emit whole batches of states for the batched
+ * encryption.
+ *
  * @author eik list
  * @copyright see license.txt
  * @last-modified 2018-04
@@ -32,19 +44,35 @@ namespace utils {
  */
 class StateIterator {
 public:
-    StateIterator(const uint8_t* states_mask, const size_t num_bytes);
+    StateIterator(const uint8_t* states_mask,
+                  const size_t num_bytes,
+                  const bool use_gray_code = false);
     ~StateIterator();
     void     reset();
+    void     seek(const size_t index);
+    void     set_range(const size_t from, const size_t to);
+    void     split(const size_t part, const size_t num_parts);
     bool     has_next();
     void     next(uint8_t* state);
     uint64_t next_as_uint64();
+    size_t   next_batch(uint64_t* states, const size_t max_num_states);
+    uint64_t get_state(const size_t index) const;
     size_t   get_num_states() const { return num_states; }
 private:
     size_t   current_state_index = 0;
+    size_t   range_from = 0;
+    size_t   range_to = 0;
     size_t   num_states;
     size_t   num_state_bytes;
     size_t   num_active_bits;
-    uint8_t* states_mask;
+    uint64_t mask = 0;
+    bool     use_gray_code;
+
+    // The previous state in Gray-code mode, if valid
+    uint64_t current_state = 0;
+    bool     is_current_state_valid = false;
+
+    std::vector<uint8_t> states_mask;
     std::vector<uint8_t> shift_indices;
 
     uint64_t internal_next_as_uint64();
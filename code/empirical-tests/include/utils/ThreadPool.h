@@ -0,0 +1,71 @@
+/**
+ * A fixed set of worker threads that process ranges of items in parallel.
+ *
+ * Unlike a static split into NUM_THREADS equal ranges, the items are claimed
+ * in chunks from a shared counter, s.t. threads that finish early take over
+ * the remaining work. The threads live as long as the pool, so experiments
+ * over many keys do not start new threads for every key.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable> // NOLINT(build/c++11)
+#include <functional>
+#include <mutex>              // NOLINT(build/c++11)
+#include <thread>             // NOLINT(build/c++11)
+#include <vector>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+
+class ThreadPool {
+public:
+    /**
+     * Is called with the index of the executing thread in 
+     * [0, get_num_threads()) and a range [from, to) of items.
+     */
+    typedef std::function<void(const size_t thread_index, 
+                               const size_t from, 
+                               const size_t to)> task_t;
+
+    explicit ThreadPool(const size_t num_threads);
+    ~ThreadPool();
+    size_t get_num_threads() const { return threads.size(); }
+
+    /**
+     * Calls task for all items in [0, num_items) in chunks of at most 
+     * chunk_size items. Returns when all items have been processed.
+     */
+    void parallel_for(const size_t num_items, 
+                      const size_t chunk_size, 
+                      const task_t& task);
+private:
+    std::vector<std::thread> threads;
+    std::mutex              mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    const task_t*           current_task = NULL;
+    size_t                  num_items = 0;
+    size_t                  chunk_size = 1;
+    std::atomic<size_t>     next_item;
+    size_t                  generation = 0;
+    size_t                  num_active_threads = 0;
+    bool                    is_stopping = false;
+
+    void run_worker(const size_t thread_index);
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,192 @@
+/**
+ * A compact binary store of the differential characteristics that CryptoSMT
+ * found for SPARX-64 (sparxround model) and SPECKEY-32 (speckey model).
+ *
+ * TrailStoreBuilder imports the text results, e.g., from results/, and
+ * writes them into a single file; TrailStore maps that file into memory and
+ * answers queries by input difference, output difference, and weight with
+ * binary searches, without parsing anything.
+ *
+ * Layout of the file (all integers in host byte order):
+ *
+ * trail_store_header_t
+ * trail_store_source_t[num_sources]  paths of the imported files
+ * trail_store_entry_t[num_trails]    sorted by (cipher, rounds, alpha,
+ *                                    weight, delta)
+ * trail_store_row_t[num_rows]        the rows of all trails, in the order
+ *                                    of the entries
+ * uint32_t[num_trails]               entry indices sorted by (cipher,
+ *                                    rounds, delta, weight)
+ * uint32_t[num_trails]               entry indices sorted by (cipher,
+ *                                    rounds, weight)
+ *
+ * Differences of SPARX-64 are stored as 64-bit values with word X0 in the
+ * highest bits, those of SPECKEY-32 as 32-bit values (x << 16) | y.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "utils/MappedFile.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define TRAIL_STORE_VERSION           1
+#define TRAIL_STORE_MAX_PATH_LENGTH 256
+#define TRAIL_STORE_NO_WEIGHT        -1
+
+typedef enum {
+    TRAIL_STORE_SPARX64   = 0,
+    TRAIL_STORE_SPECKEY32 = 1
+} trail_store_cipher_t;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_sources;
+    uint64_t num_trails;
+    uint64_t num_rows;
+    uint64_t sources_offset;
+    uint64_t trails_offset;
+    uint64_t rows_offset;
+    uint64_t delta_index_offset;
+    uint64_t weight_index_offset;
+} trail_store_header_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    char path[TRAIL_STORE_MAX_PATH_LENGTH];
+} trail_store_source_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    uint16_t cipher;
+    uint16_t num_rounds;
+    uint32_t weight;
+    uint32_t source_index;
+    // Index of the characteristic in its source file
+    uint32_t index_in_source;
+    uint64_t alpha;
+    uint64_t delta;
+    uint64_t first_row;
+} trail_store_entry_t;
+
+// ---------------------------------------------------------
+
+/**
+ * The difference before a round and the weights of its ARX-boxes; SPECKEY-32
+ * has only weights[0].
+ */
+typedef struct {
+    uint64_t difference;
+    int16_t  weights[2];
+    uint32_t reserved;
+} trail_store_row_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Conditions of a query; num_rounds = 0 matches any number of rounds.
+ */
+typedef struct {
+    trail_store_cipher_t cipher = TRAIL_STORE_SPARX64;
+    size_t   num_rounds = 0;
+    bool     has_alpha = false;
+    uint64_t alpha = 0;
+    bool     has_delta = false;
+    uint64_t delta = 0;
+    uint32_t min_weight = 0;
+    uint32_t max_weight = UINT32_MAX;
+} trail_query_t;
+
+// ---------------------------------------------------------
+
+class TrailStoreBuilder {
+public:
+    /**
+     * Imports all SPARX-64 and SPECKEY-32 characteristics from the CryptoSMT
+     * output at path and sets num_trails to their number. Returns false if
+     * the file could not be read or is malformed.
+     */
+    bool add_file(const char* path, size_t* num_trails);
+
+    /**
+     * Sorts and indexes all imported trails and writes them to path.
+     */
+    bool write(const char* path);
+
+    size_t get_num_trails() const { return entries.size(); }
+private:
+    std::vector<std::string>          sources;
+    std::vector<trail_store_entry_t>  entries;
+    std::vector<trail_store_row_t>    rows;
+};
+
+// ---------------------------------------------------------
+
+class TrailStore {
+public:
+    /**
+     * Maps the store at path. Returns false if it does not exist or is not
+     * a valid store.
+     */
+    bool open(const char* path);
+
+    size_t get_num_trails() const { return (size_t)header->num_trails; }
+    size_t get_num_sources() const { return header->num_sources; }
+
+    const trail_store_entry_t& get_trail(const size_t index) const {
+        return trails[index];
+    }
+
+    const trail_store_row_t* get_rows(const trail_store_entry_t& trail) const {
+        return rows + trail.first_row;
+    }
+
+    const char* get_source(const trail_store_entry_t& trail) const {
+        return sources[trail.source_index].path;
+    }
+
+    /**
+     * Stores the indices of all trails that match the query into results,
+     * sorted by rounds and then by the key of the index that was used.
+     */
+    void find(const trail_query_t& query, std::vector<size_t>& results) const;
+private:
+    MappedFile file;
+    const trail_store_header_t* header = NULL;
+    const trail_store_source_t* sources = NULL;
+    const trail_store_entry_t*  trails = NULL;
+    const trail_store_row_t*    rows = NULL;
+    const uint32_t*             delta_index = NULL;
+    const uint32_t*             weight_index = NULL;
+
+    void find_rounds(const trail_query_t& query,
+                     const size_t num_rounds,
+                     std::vector<size_t>& results) const;
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,46 @@
+/**
+ * In-place fast Walsh-Hadamard transform (FWHT) of vectors of 2^n values,
+ * e.g., to compute the correlations of a linear approximation for all key
+ * guesses at once from a vector of counts over the active ciphertext bits
+ * [Collard, Standaert, Quisquater: Improving the Time Complexity of
+ * Matsui's Linear Cryptanalysis, ICISC 2007].
+ *
+ * Afterwards, values[s] = sum_x values[x] * (-1)^{<s, x>}. Applying the
+ * transform twice multiplies all values by 2^n. The butterflies of the
+ * first stages are run in cache-sized blocks, and those of the later
+ * stages on ranges of the vector, on all threads of the pool. The inner
+ * loops are plain loops that the compiler can vectorize.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Functions
+// ---------------------------------------------------------
+
+void walsh_hadamard_transform(int64_t* values,
+                              const size_t num_bits,
+                              ThreadPool& pool);
+
+// ---------------------------------------------------------
+
+void walsh_hadamard_transform(double* values,
+                              const size_t num_bits,
+                              ThreadPool& pool);
+
+// ---------------------------------------------------------
+
+} // namespace utils
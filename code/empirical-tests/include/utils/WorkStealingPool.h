@@ -0,0 +1,83 @@
+/**
+ * A fixed set of worker threads that process a tree of tasks with work 
+ * stealing, e.g., the subtrees of a branch-and-bound search, whose sizes are
+ * not known in advance.
+ *
+ * Every thread owns a double-ended queue. Tasks may spawn further tasks into
+ * the queue of their thread; threads take their own tasks from the back, 
+ * i.e., depth first, and steal from the front of other queues when their own
+ * one is empty, i.e., the oldest and usually largest subtrees.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable> // NOLINT(build/c++11)
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>              // NOLINT(build/c++11)
+#include <thread>             // NOLINT(build/c++11)
+#include <vector>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+
+class WorkStealingPool {
+public:
+    /**
+     * Is called with the index of the executing thread in 
+     * [0, get_num_threads()).
+     */
+    typedef std::function<void(const size_t thread_index)> task_t;
+
+    explicit WorkStealingPool(const size_t num_threads);
+    ~WorkStealingPool();
+    size_t get_num_threads() const { return threads.size(); }
+
+    /**
+     * Runs task and all tasks that are spawned from it. Returns when all of 
+     * them have been processed.
+     */
+    void run(const task_t& task);
+
+    /**
+     * Adds a task to the queue of the thread thread_index. Must only be 
+     * called from tasks that are executed by this thread.
+     */
+    void spawn(const size_t thread_index, const task_t& task);
+private:
+    struct Queue {
+        std::mutex         mutex;
+        std::deque<task_t> tasks;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::mutex              mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    // Number of spawned tasks that have not finished yet
+    std::atomic<size_t>     num_pending_tasks;
+    size_t                  generation = 0;
+    size_t                  num_active_threads = 0;
+    bool                    is_stopping = false;
+
+    bool pop(const size_t thread_index, task_t* task);
+    bool steal(const size_t thread_index, task_t* task);
+    void run_worker(const size_t thread_index);
+};
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -342,6 +342,9 @@ public:
                                       .append(active_name),
                                   true);
                 active = arguments_[index_[el]];
+                // flags without inputs are marked as present
+                if (active.fixed && active.fixed_nargs == 0)
+                    variables_[index_[el]].castTo<String>() = "1";
                 // check if we've satisfied the required arguments
                 if (active.optional && nrequired > 0)
                     argumentError(String("encountered optional argument ")
@@ -408,6 +411,12 @@ public:
 
     // --------------------------------------------------------------------------
 
+    bool retrieveAsFlag(const String& name) {
+        return !retrieve<String>(name).empty();
+    }
+
+    // --------------------------------------------------------------------------
+
     /**
      * Given a little-endian uint32_t array [x0,x1,x2,x3], 
      * produces the expected [x3,x2,x1,x0] order.
@@ -0,0 +1,133 @@
+/**
+ * Checkpoints for long-running experiments.
+ *
+ * A checkpoint stores the state of an experiment over several keys: the
+ * master seed from which all keys and texts are derived, and for each key
+ * the key itself and the result of every chunk of texts that has been
+ * processed so far. Experiments that derive the texts of a chunk
+ * deterministically from (seed, key index, chunk index) can thus continue
+ * exactly where they stopped.
+ *
+ * Checkpoints are stored as JSON lines: a header line with the experiment
+ * parameters, followed by one line per key, e.g.:
+ *
+ * {"experiment":"sparx-64-truncated-diff-cpa","seed":"00112233deadbeef",...}
+ * {"key_index":0,"key":"00112233445566778899aabbccddeeff","counts":[3,-1,..]}
+ *
+ * where a count of -1 marks a chunk that has not been finished yet.
+ *
+ * Experiments that are split over several processes store their shard as
+ * "shard":"<index>/<num_shards>" in the header; each shard only processes
+ * its part of the (key, chunk) pairs, and merge_checkpoint() combines the
+ * partial results of all shards.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const int64_t CHECKPOINT_CHUNK_PENDING = -1;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t               key_index = 0;
+    std::vector<uint8_t> key;
+    std::vector<int64_t> chunk_counts;
+} checkpoint_key_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string experiment;
+    uint64_t    seed = 0;
+    size_t      num_keys = 0;
+    size_t      num_texts_per_key = 0;
+    size_t      num_chunks_per_key = 0;
+    size_t      shard_index = 0;
+    size_t      num_shards = 1;
+    std::vector<checkpoint_key_t> keys;
+} checkpoint_t;
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+/**
+ * Returns true if all chunks of the given key have been processed.
+ */
+bool is_finished(const checkpoint_key_t& key_state);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the sum of the counts over all finished chunks of the key.
+ */
+int64_t get_total_count(const checkpoint_key_t& key_state);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns true if chunk chunk_index of key key_index belongs to the shard
+ * of the checkpoint. The pairs (key, chunk) are distributed round-robin, s.t.
+ * all shards have about the same amount of work.
+ */
+bool is_in_shard(const checkpoint_t& checkpoint,
+                 const size_t key_index,
+                 const size_t chunk_index);
+
+// ---------------------------------------------------------
+
+/**
+ * Returns true if all chunks of the given key that belong to the shard of
+ * the checkpoint have been processed.
+ */
+bool is_shard_finished(const checkpoint_t& checkpoint, const size_t key_index);
+
+// ---------------------------------------------------------
+
+/**
+ * Merges the finished chunks of source into target. Both must stem from
+ * the same experiment, i.e., have equal seeds, parameters, and keys. Returns
+ * false if they differ or if a chunk has different counts in both.
+ */
+bool merge_checkpoint(checkpoint_t* target, const checkpoint_t& source);
+
+// ---------------------------------------------------------
+
+/**
+ * Reads a checkpoint from the file at path. Returns false if the file does
+ * not exist or could not be parsed.
+ */
+bool read_checkpoint(checkpoint_t* checkpoint, const char* path);
+
+// ---------------------------------------------------------
+
+/**
+ * Writes the checkpoint atomically to path, i.e., into a temporary file
+ * first that replaces the old checkpoint only after it has been completely
+ * written. Returns false on failure.
+ */
+bool write_checkpoint(const checkpoint_t* checkpoint, const char* path);
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -35,7 +35,7 @@ static bool precompute_parity(uint8_t value) {
 
 // ---------------------------------------------------------
 
-void precompute_parity_table() {
+inline void precompute_parity_table() {
     for (size_t i = 0; i < NUM_PARITY_ENTRIES; ++i) {
         PARITY_TABLE[i] = precompute_parity(i);
     }
@@ -43,9 +43,9 @@ void precompute_parity_table() {
 
 // ---------------------------------------------------------
 
-bool get_parity(const uint8_t* value, 
-                const uint8_t* mask, 
-                const size_t num_bytes) {
+inline bool get_parity(const uint8_t* value, 
+                       const uint8_t* mask, 
+                       const size_t num_bytes) {
     bool parity = 0;
 
     for (size_t i = 0; i < num_bytes; ++i) {
@@ -57,4 +57,14 @@ bool get_parity(const uint8_t* value,
 
 // ---------------------------------------------------------
 
+/**
+ * Returns the parity of the bits of value that are set in mask, with the 
+ * compiler's parity builtin instead of the table.
+ */
+inline bool get_parity(const uint64_t value, const uint64_t mask) {
+    return __builtin_parityll(value & mask);
+}
+
+// ---------------------------------------------------------
+
 } // namespace utils
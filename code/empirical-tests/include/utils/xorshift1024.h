@@ -79,6 +79,33 @@ void xorshift1024_init(xorshift_prng_ctx_t* ctx) {
 
 // ---------------------------------------------------------
 
+/**
+ * Finalizer of splitmix64. Maps a 64-bit input to a well-mixed 64-bit output;
+ * used to derive independent seeds from a single master seed.
+ */
+uint64_t splitmix64(uint64_t x) {
+    x += UINT64_C(0x9E3779B97F4A7C15);
+    x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Seeds the generator deterministically from a 64-bit seed by filling its
+ * state with a splitmix64 sequence, as suggested by the author.
+ */
+void xorshift1024_init(xorshift_prng_ctx_t* ctx, const uint64_t seed) {
+    for (size_t i = 0; i < 16; ++i) {
+        ctx->s[i] = splitmix64(seed + i * UINT64_C(0x9E3779B97F4A7C15));
+    }
+
+    ctx->p = 0;
+}
+
+// ---------------------------------------------------------
+
 uint64_t xorshift1024_next(xorshift_prng_ctx_t* ctx) {
     const uint64_t s0 = ctx->s[ctx->p];
     uint64_t s1 = ctx->s[ctx->p = (ctx->p + 1) & 15];
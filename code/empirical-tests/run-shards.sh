@@ -0,0 +1,39 @@
+#!/bin/bash
+# Runs an experiment in <num_shards> local processes with a common seed and
+# merges the partial results of all shards into the final statistics. The
+# partial results and outputs of the shards are stored in ${SHARDS_OUT_DIR}.
+#
+# The same can be done over several machines by running each shard with
+# --shard <i>/<num_shards> and the same --seed, and merging the files
+# with bin/sparx-64-merge-results.
+
+SHARDS_OUT_DIR=bin/shards
+MERGER=bin/sparx-64-merge-results
+
+function usage {
+    echo "Runs <executable> with <arguments> in <num_shards> local processes."
+    echo "usage: $0 <num_shards> <executable> <arguments>"
+}
+
+if [ "$#" -le 1 ]; then
+    usage
+    exit 1
+fi
+
+num_shards=$1
+program_path=$2
+shift 2
+
+seed=$(od -An -N8 -tx8 /dev/urandom | tr -d ' ')
+mkdir -p ${SHARDS_OUT_DIR}
+shard_files=()
+
+for ((i = 0; i < num_shards; i++)); do
+    shard_file=${SHARDS_OUT_DIR}/shard-${i}-of-${num_shards}.jsonl
+    shard_files+=(${shard_file})
+    ${program_path} "$@" --seed ${seed} --checkpoint ${shard_file} \
+        --shard ${i}/${num_shards} &> ${shard_file}.log &
+done
+
+wait
+${MERGER} --inputs "${shard_files[@]}"
@@ -22,8 +22,6 @@ using namespace utils;
 // Constants
 // ---------------------------------------------------------
 
-#define ROTL16(x, n) (((x) << n) | ((x) >> (16 - (n))))
-#define ROTR16(x, n) (((x) >> n) | ((x) << (16 - (n))))
 #define SWAP(x, y) tmp = x; x = y; y = tmp
 
 // SPARX versions
@@ -44,6 +42,7 @@ static const size_t NUM_BRANCHES = 2;
 #define SPARX_L               L2
 #define SPARX_L_INV           L2_inverse
 #define SPARX_KEY_PERMUTATION K_perm_64_128
+#define SPARX_KEY_PERMUTATION_INV K_perm_64_128_inverse
 
 #elif (SPARX_VERSION == SPARX_128_128)
 
@@ -95,25 +94,6 @@ static void print_difference(const uint16_t* state1,
 // Basic functions and their inverses
 // ---------------------------------------------------------
 
-static void A(uint16_t* l, uint16_t* r) {
-    (*l) = ROTR16((*l), 7);
-    (*l) += (*r);
-    (*r) = ROTL16((*r), 2);
-    (*r) ^= (*l);
-}
-
-// ---------------------------------------------------------
-
-static void A_inverse(uint16_t* l, uint16_t* r)
-{
-    (*r) ^= (*l);
-    (*r) = ROTR16((*r), 2);
-    (*l) -= (*r);
-    (*l) = ROTL16((*l), 7);
-}
-
-// ---------------------------------------------------------
-
 static void L2(uint16_t* state) {
     uint16_t tmp = state[0] ^ state[1];
     tmp = ROTL16(tmp, 8);
@@ -148,7 +128,7 @@ static void K_perm_64_128(uint16_t* key, const uint16_t round) {
     uint16_t i;
 
     // Misty-like transformation
-    A(key+0, key+1);
+    sparx_A(key+0, key+1);
     key[2] += key[0];
     key[3] += key[1];
     key[7] += round;
@@ -165,6 +145,31 @@ static void K_perm_64_128(uint16_t* key, const uint16_t round) {
     key[1] = tmp1;
 }
 
+// ---------------------------------------------------------
+
+static void K_perm_64_128_inverse(uint16_t* key, const uint16_t round) {
+    uint16_t tmp0;
+    uint16_t tmp1;
+    uint16_t i;
+
+    // Branch rotation
+    tmp0 = key[0];
+    tmp1 = key[1];
+
+    for (i = 2; i <= 7; i++) {
+        key[i-2] = key[i];
+    }
+
+    key[6] = tmp0;
+    key[7] = tmp1;
+
+    // Misty-like transformation
+    key[7] -= round;
+    key[3] -= key[1];
+    key[2] -= key[0];
+    sparx_A_inverse(key+0, key+1);
+}
+
 // ---------------------------------------------------------
 // Takes a 128-bit master key and turns it into 2*(NUM_STEPS+1) subkeys
 // of 96 bit.
@@ -201,6 +206,37 @@ void sparx_key_schedule(sparx64_context_t* ctx,
     sparx_key_schedule(ctx, key);
 }
 
+// ---------------------------------------------------------
+
+void sparx_get_key_state(const sparx64_context_t* ctx, 
+                         const size_t row, 
+                         uint16_t key_state[SPARX64_NUM_KEY_WORDS]) {
+    memcpy((uint8_t*)key_state, (uint8_t*)ctx->subkeys[row], 
+        2 * NUM_ROUNDS_PER_STEP * sizeof(uint16_t));
+
+    // The last two words are moved into the next row by the permutation, 
+    // or were the words 4 and 5 of the previous one
+    if (row == 0) {
+        key_state[6] = ctx->subkeys[1][0];
+        key_state[7] = (uint16_t)(ctx->subkeys[1][1] - 1);
+    } else {
+        key_state[6] = ctx->subkeys[row - 1][4];
+        key_state[7] = ctx->subkeys[row - 1][5];
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_invert_key_schedule(const uint16_t key_state[SPARX64_NUM_KEY_WORDS], 
+                               const size_t row, 
+                               uint16_t master_key[SPARX64_NUM_KEY_WORDS]) {
+    memcpy((uint8_t*)master_key, (uint8_t*)key_state, SPARX64_KEY_LENGTH);
+
+    for (size_t c = row; c > 0; c--) {
+        SPARX_KEY_PERMUTATION_INV(master_key, c);
+    }
+}
+
 // ---------------------------------------------------------
 // Encryption and Decryption Logic
 // ---------------------------------------------------------
@@ -220,7 +256,7 @@ static void sparx_encrypt_rounds(const sparx64_context_t* ctx,
         for (size_t r = from_round-1; r < to_round; ++r) {
             state[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
             state[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
-            A(state + 2 * b, state + 2 * b+1);
+            sparx_A(state + 2 * b, state + 2 * b+1);
 
 #ifdef DEBUG
             printf("Branch/round: %2zu/%2zu ", b, r);
@@ -248,7 +284,7 @@ static void sparx_decrypt_rounds(const sparx64_context_t* ctx,
     
     for (size_t b = 0; b < NUM_BRANCHES; ++b) {
         for (size_t r = to_round-1; r >= from_round-1; --r) {
-            A_inverse(state + 2 * b, state + 2 * b+1);
+            sparx_A_inverse(state + 2 * b, state + 2 * b+1);
             state[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
             state[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
         }
@@ -264,7 +300,7 @@ static void sparx_decrypt_rounds(const sparx64_context_t* ctx,
     
     for (size_t b = 0; b < NUM_BRANCHES; ++b) {
         for (int r = num_rounds-1; r >= 0; --r) {
-            A_inverse(state + 2 * b, state + 2 * b+1);
+            sparx_A_inverse(state + 2 * b, state + 2 * b+1);
             state[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
             state[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
         }
@@ -287,7 +323,7 @@ static void sparx_encrypt_steps(const sparx64_context_t* ctx,
             for (size_t r = 0; r < NUM_ROUNDS_PER_STEP; ++r) {
                 state[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
                 state[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
-                A(state + 2 * b, state + 2 * b+1);
+                sparx_A(state + 2 * b, state + 2 * b+1);
 
 #ifdef DEBUG
                 printf("Branch/round: %2zu/%2zu ", b, r);
@@ -332,7 +368,7 @@ static void sparx_decrypt_steps(const sparx64_context_t* ctx,
 
         for (size_t b = 0; b < NUM_BRANCHES; ++b) {
             for (int r = NUM_ROUNDS_PER_STEP - 1; r >= 0; --r) {
-                A_inverse(state + 2 * b, state + 2 * b+1);
+                sparx_A_inverse(state + 2 * b, state + 2 * b+1);
                 state[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
                 state[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
             }
@@ -356,11 +392,11 @@ static void internal_sparx_encrypt_steps_trail(
             for (size_t b = 0; b < NUM_BRANCHES; ++b) {
                 state1[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
                 state1[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
-                A(state1 + 2 * b, state1 + 2 * b+1);
+                sparx_A(state1 + 2 * b, state1 + 2 * b+1);
 
                 state2[2 * b]     ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r];
                 state2[2 * b + 1] ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * r + 1];
-                A(state2 + 2 * b, state2 + 2 * b+1);
+                sparx_A(state2 + 2 * b, state2 + 2 * b+1);
             }
 
             print_difference(state1, state2, delta);
@@ -409,6 +445,22 @@ void sparx_invert_linear_layer(const uint8_t c[SPARX64_STATE_LENGTH],
 
 // ---------------------------------------------------------
 
+void sparx_linear_layer(const uint16_t p[SPARX64_NUM_STATE_WORDS], 
+                        uint16_t c[SPARX64_NUM_STATE_WORDS]) {
+    memcpy(c, p, SPARX64_STATE_LENGTH);
+    SPARX_L(c);
+}
+
+// ---------------------------------------------------------
+
+void sparx_invert_linear_layer(const uint16_t c[SPARX64_NUM_STATE_WORDS], 
+                               uint16_t p[SPARX64_NUM_STATE_WORDS]) {
+    memcpy(p, c, SPARX64_STATE_LENGTH);
+    SPARX_L_INV(p);
+}
+
+// ---------------------------------------------------------
+
 void sparx_encrypt_rounds(const sparx64_context_t* ctx, 
                           const uint16_t p[SPARX64_NUM_STATE_WORDS], 
                           uint16_t c[SPARX64_NUM_STATE_WORDS], 
@@ -626,3 +678,295 @@ void sparx_encrypt_steps_trail(const sparx64_context_t* ctx,
     to_uint16(state2, p2, SPARX64_STATE_LENGTH);
     internal_sparx_encrypt_steps_trail(ctx, state1, state2, num_steps);
 }
+
+// ---------------------------------------------------------
+// Batched API
+// ---------------------------------------------------------
+
+void sparx_load_batch(sparx64_batch_t* batch, 
+                      const uint64_t states[SPARX64_BATCH_SIZE]) {
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        const size_t shift = 16 * (SPARX64_NUM_STATE_WORDS - 1 - i);
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            batch->words[i][j] = (uint16_t)(states[j] >> shift);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_store_batch(const sparx64_batch_t* batch, 
+                       uint64_t states[SPARX64_BATCH_SIZE]) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        states[j] = 0;
+    }
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        const size_t shift = 16 * (SPARX64_NUM_STATE_WORDS - 1 - i);
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            states[j] |= (uint64_t)batch->words[i][j] << shift;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Applies the given round of the given step, counted from 0, to branch b of 
+ * all states in the batch.
+ */
+static void sparx_encrypt_branch_round_batch(const sparx64_context_t* ctx, 
+                                             sparx64_batch_t* batch, 
+                                             const size_t s, 
+                                             const size_t i, 
+                                             const size_t b) {
+    const uint16_t k0 = ctx->subkeys[s * NUM_BRANCHES + b][2 * i];
+    const uint16_t k1 = ctx->subkeys[s * NUM_BRANCHES + b][2 * i + 1];
+    uint16_t* l = batch->words[2 * b];
+    uint16_t* r = batch->words[2 * b + 1];
+
+    // Same as A, but on plain loops the compiler can vectorize
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint16_t x = l[j] ^ k0;
+        uint16_t y = r[j] ^ k1;
+        x = (uint16_t)((uint16_t)((x >> 7) | (x << 9)) + y);
+        y = (uint16_t)((y << 2) | (y >> 14)) ^ x;
+        l[j] = x;
+        r[j] = y;
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Applies all rounds of the given step, counted from 0, to branch b of all 
+ * states in the batch.
+ */
+static void sparx_encrypt_branch_step_batch(const sparx64_context_t* ctx, 
+                                            sparx64_batch_t* batch, 
+                                            const size_t s, 
+                                            const size_t b) {
+    for (size_t i = 0; i < NUM_ROUNDS_PER_STEP; ++i) {
+        sparx_encrypt_branch_round_batch(ctx, batch, s, i, b);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Same as sparx_encrypt_branch_step_batch, for a branch that holds the same 
+ * value in all states: computes it once and copies it to all states.
+ */
+static void sparx_encrypt_constant_branch_step_batch(
+    const sparx64_context_t* ctx, 
+    sparx64_batch_t* batch, 
+    const size_t s, 
+    const size_t b) {
+    uint16_t* l = batch->words[2 * b];
+    uint16_t* r = batch->words[2 * b + 1];
+    uint16_t x = l[0];
+    uint16_t y = r[0];
+
+    for (size_t i = 0; i < NUM_ROUNDS_PER_STEP; ++i) {
+        x ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * i];
+        y ^= ctx->subkeys[s * NUM_BRANCHES + b][2 * i + 1];
+        sparx_A(&x, &y);
+    }
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        l[j] = x;
+        r[j] = y;
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_encrypt_round_batch(const sparx64_context_t* ctx, 
+                               sparx64_batch_t* batch, 
+                               const size_t round) {
+    const size_t s = (round - 1) / NUM_ROUNDS_PER_STEP;
+    const size_t i = (round - 1) % NUM_ROUNDS_PER_STEP;
+
+    for (size_t b = 0; b < NUM_BRANCHES; ++b) {
+        sparx_encrypt_branch_round_batch(ctx, batch, s, i, b);
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_linear_layer_batch(sparx64_batch_t* batch) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        const uint16_t x0 = batch->words[0][j];
+        const uint16_t x1 = batch->words[1][j];
+        uint16_t tmp = x0 ^ x1;
+        tmp = (uint16_t)((tmp << 8) | (tmp >> 8));
+
+        batch->words[0][j] = batch->words[2][j] ^ x0 ^ tmp;
+        batch->words[1][j] = batch->words[3][j] ^ x1 ^ tmp;
+        batch->words[2][j] = x0;
+        batch->words[3][j] = x1;
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_invert_linear_layer_batch(sparx64_batch_t* batch) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        const uint16_t x0 = batch->words[2][j];
+        const uint16_t x1 = batch->words[3][j];
+        uint16_t tmp = x0 ^ x1;
+        tmp = (uint16_t)((tmp << 8) | (tmp >> 8));
+
+        batch->words[2][j] = batch->words[0][j] ^ x0 ^ tmp;
+        batch->words[3][j] = batch->words[1][j] ^ x1 ^ tmp;
+        batch->words[0][j] = x0;
+        batch->words[1][j] = x1;
+    }
+}
+
+// ---------------------------------------------------------
+
+static void sparx_add_final_key_batch(const sparx64_context_t* ctx, 
+                                      sparx64_batch_t* batch) {
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        const uint16_t k = ctx->subkeys[NUM_BRANCHES * NUM_STEPS][i];
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            batch->words[i][j] ^= k;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_encrypt_steps_batch(const sparx64_context_t* ctx, 
+                               sparx64_batch_t* batch, 
+                               const size_t from_step, 
+                               const size_t to_step) {
+    for (size_t s = from_step - 1; s < to_step; ++s) {
+        for (size_t r = 1; r <= NUM_ROUNDS_PER_STEP; ++r) {
+            sparx_encrypt_round_batch(ctx, batch, s * NUM_ROUNDS_PER_STEP + r);
+        }
+
+        sparx_linear_layer_batch(batch);
+    }
+
+    if (to_step == SPARX64_NUM_STEPS) {
+        sparx_add_final_key_batch(ctx, batch);
+    }
+}
+
+// ---------------------------------------------------------
+
+size_t sparx_get_inactive_branches(const uint64_t mask) {
+    size_t branches = 0;
+
+    for (size_t b = 0; b < NUM_BRANCHES; ++b) {
+        const size_t shift = 32 * (NUM_BRANCHES - 1 - b);
+
+        if (((mask >> shift) & 0xFFFFFFFFULL) == 0) {
+            branches |= (size_t)1 << b;
+        }
+    }
+
+    return branches;
+}
+
+// ---------------------------------------------------------
+
+void sparx_encrypt_steps_structure_batch(const sparx64_context_t* ctx, 
+                                         sparx64_batch_t* batch, 
+                                         const size_t constant_branches, 
+                                         const size_t from_step, 
+                                         const size_t to_step) {
+    const size_t s = from_step - 1;
+
+    for (size_t b = 0; b < NUM_BRANCHES; ++b) {
+        if ((constant_branches >> b) & 1) {
+            sparx_encrypt_constant_branch_step_batch(ctx, batch, s, b);
+        } else {
+            sparx_encrypt_branch_step_batch(ctx, batch, s, b);
+        }
+    }
+
+    sparx_linear_layer_batch(batch);
+
+    if (from_step < to_step) {
+        sparx_encrypt_steps_batch(ctx, batch, from_step + 1, to_step);
+    } else if (to_step == SPARX64_NUM_STEPS) {
+        sparx_add_final_key_batch(ctx, batch);
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_encrypt_steps_pair_batch(const sparx64_context_t* ctx, 
+                                    sparx64_batch_t* batch, 
+                                    sparx64_batch_t* batch_, 
+                                    const size_t inactive_branches, 
+                                    const size_t from_step, 
+                                    const size_t to_step) {
+    const size_t s = from_step - 1;
+
+    for (size_t b = 0; b < NUM_BRANCHES; ++b) {
+        sparx_encrypt_branch_step_batch(ctx, batch, s, b);
+
+        if (((inactive_branches >> b) & 1) == 0) {
+            sparx_encrypt_branch_step_batch(ctx, batch_, s, b);
+            continue;
+        }
+
+        memcpy(batch_->words[2 * b], batch->words[2 * b], 
+            sizeof(batch->words[2 * b]));
+        memcpy(batch_->words[2 * b + 1], batch->words[2 * b + 1], 
+            sizeof(batch->words[2 * b + 1]));
+    }
+
+    sparx_linear_layer_batch(batch);
+    sparx_linear_layer_batch(batch_);
+
+    if (from_step < to_step) {
+        sparx_encrypt_steps_batch(ctx, batch, from_step + 1, to_step);
+        sparx_encrypt_steps_batch(ctx, batch_, from_step + 1, to_step);
+    } else if (to_step == SPARX64_NUM_STEPS) {
+        sparx_add_final_key_batch(ctx, batch);
+        sparx_add_final_key_batch(ctx, batch_);
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_decrypt_steps_batch(const sparx64_context_t* ctx, 
+                               sparx64_batch_t* batch, 
+                               const size_t from_step, 
+                               const size_t to_step) {
+    if (to_step == SPARX64_NUM_STEPS) {
+        sparx_add_final_key_batch(ctx, batch);
+    }
+
+    for (size_t s = to_step; s >= from_step; --s) {
+        sparx_invert_linear_layer_batch(batch);
+
+        for (size_t b = 0; b < NUM_BRANCHES; ++b) {
+            uint16_t* l = batch->words[2 * b];
+            uint16_t* r = batch->words[2 * b + 1];
+
+            for (int i = NUM_ROUNDS_PER_STEP - 1; i >= 0; --i) {
+                const uint16_t k0 = ctx->subkeys[(s-1) * NUM_BRANCHES + b][2*i];
+                const uint16_t k1 = ctx->subkeys[(s-1) * NUM_BRANCHES + b][2*i+1];
+
+                // Same as A_inverse
+                for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+                    uint16_t y = r[j] ^ l[j];
+                    y = (uint16_t)((y >> 2) | (y << 14));
+                    uint16_t x = (uint16_t)(l[j] - y);
+                    x = (uint16_t)((x << 7) | (x >> 9));
+                    l[j] = x ^ k0;
+                    r[j] = y ^ k1;
+                }
+            }
+        }
+    }
+}
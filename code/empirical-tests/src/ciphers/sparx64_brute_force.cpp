@@ -0,0 +1,351 @@
+/**
+ * Exhaustive search over the unknown bits of the key of SPARX-64/128.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_brute_force.h"
+#include "utils/ThreadPool.h"
+
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_LANE_BITS           6
+#define NUM_BATCHES_PER_CHUNK   256
+#define NUM_KEY_ROWS            (SPARX64_NUM_BRANCHES * SPARX64_NUM_STEPS)
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * SPARX64_BATCH_SIZE key states in structure-of-arrays layout like
+ * sparx64_batch_t.
+ */
+typedef struct {
+    uint16_t words[SPARX64_NUM_KEY_WORDS][SPARX64_BATCH_SIZE];
+} key_batch_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const sparx64_brute_force_problem_t* problem;
+
+    // Positions 16 * word + bit of the unknown bits; the first
+    // num_lane_bits of them enumerate the lanes of a batch
+    std::vector<size_t> positions;
+    size_t   num_lane_bits;
+    uint64_t lane_mask;
+    key_batch_t lane_bits;
+    uint16_t known_key_state[SPARX64_NUM_KEY_WORDS];
+} search_ctx_t;
+
+// ---------------------------------------------------------
+// Key schedule
+// ---------------------------------------------------------
+
+// Same as K_perm_64_128 on all keys of the batch
+static void permute_keys(key_batch_t* keys, const uint16_t round) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint16_t k0 = keys->words[0][j];
+        uint16_t k1 = keys->words[1][j];
+        sparx_A(&k0, &k1);
+        const uint16_t k2 = (uint16_t)(keys->words[2][j] + k0);
+        const uint16_t k3 = (uint16_t)(keys->words[3][j] + k1);
+        const uint16_t k6 = keys->words[6][j];
+        const uint16_t k7 = (uint16_t)(keys->words[7][j] + round);
+
+        keys->words[7][j] = keys->words[5][j];
+        keys->words[6][j] = keys->words[4][j];
+        keys->words[5][j] = k3;
+        keys->words[4][j] = k2;
+        keys->words[3][j] = k1;
+        keys->words[2][j] = k0;
+        keys->words[1][j] = k7;
+        keys->words[0][j] = k6;
+    }
+}
+
+// ---------------------------------------------------------
+
+// Same as K_perm_64_128_inverse on all keys of the batch
+static void invert_permute_keys(key_batch_t* keys, const uint16_t round) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        const uint16_t k6 = keys->words[0][j];
+        const uint16_t k7 = (uint16_t)(keys->words[1][j] - round);
+        const uint16_t k2 = (uint16_t)(keys->words[4][j] - keys->words[2][j]);
+        const uint16_t k3 = (uint16_t)(keys->words[5][j] - keys->words[3][j]);
+        uint16_t k0 = keys->words[2][j];
+        uint16_t k1 = keys->words[3][j];
+        sparx_A_inverse(&k0, &k1);
+
+        keys->words[0][j] = k0;
+        keys->words[1][j] = k1;
+        keys->words[2][j] = k2;
+        keys->words[3][j] = k3;
+        keys->words[4][j] = keys->words[6][j];
+        keys->words[5][j] = keys->words[7][j];
+        keys->words[6][j] = k6;
+        keys->words[7][j] = k7;
+    }
+}
+
+// ---------------------------------------------------------
+// Encryption
+// ---------------------------------------------------------
+
+/**
+ * Encrypts the same plaintext under all master keys of the batch and
+ * returns the mask of the keys that yield the ciphertext. Every row of the
+ * subkeys is used for the three rounds of one branch of one step, s.t. the
+ * schedule can be run along.
+ */
+static uint64_t encrypt_and_compare(const key_batch_t* master_keys,
+                                    const uint64_t plaintext,
+                                    const uint64_t ciphertext) {
+    key_batch_t keys = *master_keys;
+    sparx64_batch_t batch;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        const uint16_t word =
+            (uint16_t)(plaintext >> (16 * (SPARX64_NUM_STATE_WORDS - 1 - i)));
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            batch.words[i][j] = word;
+        }
+    }
+
+    for (size_t c = 0; c < NUM_KEY_ROWS; ++c) {
+        const size_t b = c % SPARX64_NUM_BRANCHES;
+        uint16_t* l = batch.words[2 * b];
+        uint16_t* r = batch.words[2 * b + 1];
+
+        for (size_t i = 0; i < SPARX64_NUM_ROUNDS_PER_STEP; ++i) {
+            const uint16_t* k0 = keys.words[2 * i];
+            const uint16_t* k1 = keys.words[2 * i + 1];
+
+            for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+                uint16_t x = l[j] ^ k0[j];
+                uint16_t y = r[j] ^ k1[j];
+                sparx_A(&x, &y);
+                l[j] = x;
+                r[j] = y;
+            }
+        }
+
+        if (b == SPARX64_NUM_BRANCHES - 1) {
+            sparx_linear_layer_batch(&batch);
+        }
+
+        permute_keys(&keys, (uint16_t)(c + 1));
+    }
+
+    uint8_t is_match[SPARX64_BATCH_SIZE];
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        is_match[j] = 1;
+    }
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        const uint16_t word =
+            (uint16_t)(ciphertext >> (16 * (SPARX64_NUM_STATE_WORDS - 1 - i)));
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            is_match[j] &= (batch.words[i][j] ^ keys.words[i][j]) == word;
+        }
+    }
+
+    uint64_t mask = 0;
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        mask |= (uint64_t)is_match[j] << j;
+    }
+
+    return mask;
+}
+
+// ---------------------------------------------------------
+
+static bool is_consistent(const sparx64_brute_force_problem_t* problem,
+                          const sparx64_master_key_t& key) {
+    sparx64_context_t ctx;
+    sparx_key_schedule(&ctx, key.words);
+
+    for (size_t i = 1; i < problem->plaintexts.size(); ++i) {
+        uint16_t plaintext[SPARX64_NUM_STATE_WORDS];
+        uint16_t ciphertext[SPARX64_NUM_STATE_WORDS];
+        uint64_t state = 0;
+
+        for (size_t w = 0; w < SPARX64_NUM_STATE_WORDS; ++w) {
+            plaintext[w] = (uint16_t)(problem->plaintexts[i]
+                >> (16 * (SPARX64_NUM_STATE_WORDS - 1 - w)));
+        }
+
+        sparx_encrypt(&ctx, plaintext, ciphertext);
+
+        for (size_t w = 0; w < SPARX64_NUM_STATE_WORDS; ++w) {
+            state = (state << 16) | ciphertext[w];
+        }
+
+        if (state != problem->ciphertexts[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+// Search
+// ---------------------------------------------------------
+
+static void initialize_search(search_ctx_t* search,
+                              const sparx64_brute_force_problem_t* problem) {
+    search->problem = problem;
+    search->positions.clear();
+
+    for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+        search->known_key_state[w] =
+            problem->key_state[w] & (uint16_t)~problem->unknown_mask[w];
+
+        for (size_t bit = 0; bit < 16; ++bit) {
+            if ((problem->unknown_mask[w] >> bit) & 1) {
+                search->positions.push_back(16 * w + bit);
+            }
+        }
+    }
+
+    search->num_lane_bits = search->positions.size() < NUM_LANE_BITS
+        ? search->positions.size() : NUM_LANE_BITS;
+    search->lane_mask = (search->num_lane_bits == NUM_LANE_BITS)
+        ? ~0ULL : ((1ULL << (1 << search->num_lane_bits)) - 1);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+            search->lane_bits.words[w][j] = 0;
+        }
+
+        for (size_t i = 0; i < search->num_lane_bits; ++i) {
+            const size_t position = search->positions[i];
+            search->lane_bits.words[position / 16][j] |=
+                (uint16_t)(((j >> i) & 1) << (position % 16));
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores into keys the master keys of the candidates of the given batch.
+ */
+static void load_candidates(const search_ctx_t* search,
+                            const uint64_t batch_index,
+                            key_batch_t* keys) {
+    uint16_t key_state[SPARX64_NUM_KEY_WORDS];
+
+    for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+        key_state[w] = search->known_key_state[w];
+    }
+
+    for (size_t i = search->num_lane_bits; i < search->positions.size(); ++i) {
+        const size_t position = search->positions[i];
+        key_state[position / 16] |= (uint16_t)(
+            ((batch_index >> (i - search->num_lane_bits)) & 1)
+            << (position % 16));
+    }
+
+    for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            keys->words[w][j] = key_state[w] | search->lane_bits.words[w][j];
+        }
+    }
+
+    for (size_t c = search->problem->row; c > 0; --c) {
+        invert_permute_keys(keys, (uint16_t)c);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void search_batches(const search_ctx_t* search,
+                           const uint64_t from,
+                           const uint64_t to,
+                           std::vector<sparx64_master_key_t>& keys) {
+    const sparx64_brute_force_problem_t* problem = search->problem;
+    key_batch_t candidates;
+
+    for (uint64_t batch_index = from; batch_index < to; ++batch_index) {
+        load_candidates(search, batch_index, &candidates);
+        uint64_t mask = encrypt_and_compare(&candidates,
+            problem->plaintexts[0], problem->ciphertexts[0])
+            & search->lane_mask;
+
+        // Only about 2^{-64} of the candidates survive the first pair
+        while (mask != 0) {
+            const size_t j = (size_t)__builtin_ctzll(mask);
+            mask &= mask - 1;
+
+            sparx64_master_key_t key;
+
+            for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+                key.words[w] = candidates.words[w][j];
+            }
+
+            if (is_consistent(problem, key)) {
+                keys.push_back(key);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+size_t sparx_get_num_unknown_bits(const sparx64_brute_force_problem_t* problem) {
+    size_t num_bits = 0;
+
+    for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+        num_bits += (size_t)__builtin_popcount(problem->unknown_mask[w]);
+    }
+
+    return num_bits;
+}
+
+// ---------------------------------------------------------
+
+uint64_t sparx_brute_force(const sparx64_brute_force_problem_t* problem,
+                           ThreadPool& pool,
+                           std::vector<sparx64_master_key_t>& keys) {
+    search_ctx_t search;
+    initialize_search(&search, problem);
+
+    const uint64_t num_batches =
+        1ULL << (search.positions.size() - search.num_lane_bits);
+    std::vector<std::vector<sparx64_master_key_t> > thread_keys(
+        pool.get_num_threads());
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            search_batches(&search, from, to, thread_keys[thread_index]);
+        });
+
+    keys.clear();
+
+    for (size_t t = 0; t < thread_keys.size(); ++t) {
+        keys.insert(keys.end(), thread_keys[t].begin(), thread_keys[t].end());
+    }
+
+    return 1ULL << search.positions.size();
+}
@@ -0,0 +1,668 @@
+/**
+ * Estimates the probability of a differential of SPARX-64 from the sum of
+ * the probabilities of its characteristics.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_cluster.h"
+#include "ciphers/sparx64_search.h"
+#include "utils/ThreadPool.h"
+
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+// Unmerged partial results are merged when they exceed this size
+static const size_t MAX_NUM_UNMERGED_STATES = 1 << 22;
+static const size_t CHUNK_SIZE = 64;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * num_trails partial characteristics that end in difference with weight.
+ */
+typedef struct {
+    uint64_t difference;
+    int      weight;
+    double   num_trails;
+} cluster_state_t;
+
+// ---------------------------------------------------------
+
+/**
+ * The same for a single branch over a step.
+ */
+typedef struct {
+    uint32_t difference;
+    int      weight;
+    double   num_trails;
+} cluster_branch_state_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Characteristics of a branch over a step from one difference, sorted by
+ * weight, by their input differences.
+ */
+typedef std::vector<cluster_branch_state_t> cluster_branch_list_t;
+typedef std::unordered_map<uint32_t, cluster_branch_list_t> cluster_cache_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Characteristics of both branches over the last step that end in delta,
+ * sorted by their input differences and weights.
+ */
+typedef struct {
+    std::vector<cluster_branch_state_t> left;
+    std::vector<cluster_branch_state_t> right;
+} cluster_last_step_t;
+
+// ---------------------------------------------------------
+// Conversion
+// ---------------------------------------------------------
+
+static void to_words(uint16_t words[SPARX64_NUM_STATE_WORDS],
+                     const uint64_t difference) {
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        words[i] = (uint16_t)(difference >> (48 - 16 * i));
+    }
+}
+
+// ---------------------------------------------------------
+
+static uint64_t from_words(const uint16_t words[SPARX64_NUM_STATE_WORDS]) {
+    uint64_t difference = 0;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        difference = (difference << 16) | words[i];
+    }
+
+    return difference;
+}
+
+// ---------------------------------------------------------
+// Merging
+// ---------------------------------------------------------
+
+template <typename T>
+static bool is_before(const T& a, const T& b) {
+    return (a.difference < b.difference)
+        || ((a.difference == b.difference) && (a.weight < b.weight));
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Sorts the states by difference and weight and merges equal ones.
+ */
+template <typename T>
+static void merge_states(std::vector<T>& states) {
+    if (states.empty()) {
+        return;
+    }
+
+    std::sort(states.begin(), states.end(), is_before<T>);
+    size_t num_merged_states = 0;
+
+    for (size_t i = 1; i < states.size(); ++i) {
+        T& last = states[num_merged_states];
+
+        if ((states[i].difference == last.difference)
+            && (states[i].weight == last.weight)) {
+            last.num_trails += states[i].num_trails;
+        } else {
+            states[++num_merged_states] = states[i];
+        }
+    }
+
+    states.resize(num_merged_states + 1);
+}
+
+// ---------------------------------------------------------
+
+template <typename T>
+static int get_min_weight(const std::vector<T>& states) {
+    int min_weight = INT32_MAX;
+
+    for (size_t i = 0; i < states.size(); ++i) {
+        min_weight = std::min(min_weight, states[i].weight);
+    }
+
+    return min_weight;
+}
+
+// ---------------------------------------------------------
+// Branches
+// ---------------------------------------------------------
+
+/**
+ * Counts the characteristics of a branch over num_rounds rounds from
+ * difference by their weights and the differences at their other ends.
+ * The result is sorted by difference and weight.
+ */
+static void count_branch_trails(const uint32_t difference,
+                                const size_t num_rounds,
+                                const int max_weight,
+                                const bool is_backwards,
+                                std::vector<cluster_branch_state_t>& states) {
+    const uint16_t words[2] = {
+        (uint16_t)(difference >> 16), (uint16_t)difference
+    };
+    size_t max_num_states = MAX_NUM_UNMERGED_STATES;
+
+    const trail_search_branch_callback_t on_trail =
+        [&](const uint16_t other[2], const int weight) {
+            cluster_branch_state_t state;
+            state.difference = ((uint32_t)other[0] << 16) | other[1];
+            state.weight = weight;
+            state.num_trails = 1;
+            states.push_back(state);
+
+            if (states.size() > max_num_states) {
+                merge_states(states);
+
+                // Does not merge again for every further characteristic
+                max_num_states = states.size() + MAX_NUM_UNMERGED_STATES;
+            }
+        };
+
+    states.clear();
+
+    if (is_backwards) {
+        trail_search_enumerate_branch_backwards(words, num_rounds, max_weight,
+            on_trail);
+    } else {
+        trail_search_enumerate_branch(words, num_rounds, max_weight, on_trail);
+    }
+
+    merge_states(states);
+    states.shrink_to_fit();
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the minimal weight of the characteristics of a branch over
+ * num_rounds rounds from difference, or -1 if it exceeds max_weight. The
+ * bound is raised by one until a characteristic is found, which is cheap
+ * compared to enumerating all of them up to max_weight.
+ */
+static int get_min_branch_weight(const uint32_t difference,
+                                 const size_t num_rounds,
+                                 const int max_weight,
+                                 const bool is_backwards) {
+    const uint16_t words[2] = {
+        (uint16_t)(difference >> 16), (uint16_t)difference
+    };
+    int min_weight = INT32_MAX;
+
+    const trail_search_branch_callback_t on_trail =
+        [&](const uint16_t other[2], const int weight) {
+            (void)other;
+            min_weight = std::min(min_weight, weight);
+        };
+
+    for (int weight = 0; weight <= max_weight; ++weight) {
+        if (is_backwards) {
+            trail_search_enumerate_branch_backwards(words, num_rounds, weight,
+                on_trail);
+        } else {
+            trail_search_enumerate_branch(words, num_rounds, weight,
+                on_trail);
+        }
+
+        if (min_weight != INT32_MAX) {
+            return min_weight;
+        }
+    }
+
+    return -1;
+}
+
+// ---------------------------------------------------------
+
+static const cluster_branch_list_t& get_branch_list(cluster_cache_t& cache,
+                                                    const uint32_t in,
+                                                    const size_t num_rounds,
+                                                    const int max_weight) {
+    const auto iterator = cache.find(in);
+
+    if (iterator != cache.end()) {
+        return iterator->second;
+    }
+
+    cluster_branch_list_t& list = cache[in];
+    count_branch_trails(in, num_rounds, max_weight, false, list);
+
+    std::sort(list.begin(), list.end(),
+        [](const cluster_branch_state_t& a, const cluster_branch_state_t& b) {
+            return (a.weight < b.weight)
+                || ((a.weight == b.weight) && (a.difference < b.difference));
+        });
+    return list;
+}
+
+// ---------------------------------------------------------
+
+typedef std::pair<const cluster_branch_state_t*, const cluster_branch_state_t*>
+    cluster_branch_range_t;
+
+/**
+ * Returns the characteristics of the last step from difference.
+ */
+static cluster_branch_range_t find_branch_states(
+    const std::vector<cluster_branch_state_t>& states,
+    const uint32_t difference) {
+    cluster_branch_state_t key;
+    key.difference = difference;
+    key.weight = 0;
+    key.num_trails = 0;
+
+    const cluster_branch_state_t* begin = states.data();
+    const cluster_branch_state_t* end = begin + states.size();
+    const cluster_branch_state_t* first = std::lower_bound(begin, end, key,
+        is_before<cluster_branch_state_t>);
+    const cluster_branch_state_t* last = first;
+
+    while ((last != end) && (last->difference == difference)) {
+        ++last;
+    }
+
+    return std::make_pair(first, last);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the minimal weight of the last step from difference, or -1 if
+ * delta cannot be reached from it.
+ */
+static int get_min_last_step_weight(const cluster_last_step_t& last_step,
+                                    const uint64_t difference) {
+    const cluster_branch_range_t left = find_branch_states(last_step.left,
+        (uint32_t)(difference >> 32));
+    const cluster_branch_range_t right = find_branch_states(last_step.right,
+        (uint32_t)difference);
+
+    if ((left.first == left.second) || (right.first == right.second)) {
+        return -1;
+    }
+
+    // Sorted by weight within a difference
+    return left.first->weight + right.first->weight;
+}
+
+// ---------------------------------------------------------
+// Steps
+// ---------------------------------------------------------
+
+/**
+ * Returns the indices of the first state of each difference.
+ */
+static std::vector<size_t> get_groups(
+    const std::vector<cluster_state_t>& states) {
+    std::vector<size_t> groups;
+
+    for (size_t i = 0; i < states.size(); ++i) {
+        if ((i == 0) || (states[i].difference != states[i - 1].difference)) {
+            groups.push_back(i);
+        }
+    }
+
+    groups.push_back(states.size());
+    return groups;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Propagates the states through a step of num_rounds rounds that is
+ * followed by at least min_remaining_weight. If the next step is the last
+ * one, only keeps states from which delta can be reached.
+ */
+static void search_step(const cluster_problem_t& problem,
+                        ThreadPool& pool,
+                        std::vector<cluster_state_t>& states,
+                        const size_t num_rounds,
+                        const int min_remaining_weight,
+                        const cluster_last_step_t* last_step) {
+    const bool has_linear_layer = (num_rounds == SPARX64_NUM_ROUNDS_PER_STEP);
+    const int max_weight = problem.max_weight - min_remaining_weight;
+    const int max_step_weight = max_weight - get_min_weight(states);
+    const std::vector<size_t> groups = get_groups(states);
+    const size_t num_threads = pool.get_num_threads();
+    std::vector<std::vector<cluster_state_t> > next_states(num_threads);
+    std::vector<cluster_cache_t> caches(num_threads);
+
+    // Unmerged states per thread that trigger the next merge
+    std::vector<size_t> max_num_states(num_threads, MAX_NUM_UNMERGED_STATES);
+
+    pool.parallel_for(groups.size() - 1, CHUNK_SIZE,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            std::vector<cluster_state_t>& next = next_states[thread_index];
+            cluster_cache_t& cache = caches[thread_index];
+
+            for (size_t g = from; g < to; ++g) {
+                const size_t first = groups[g];
+                const size_t last = groups[g + 1];
+                const uint64_t difference = states[first].difference;
+                const cluster_branch_list_t& left = get_branch_list(cache,
+                    (uint32_t)(difference >> 32), num_rounds, max_step_weight);
+                const cluster_branch_list_t& right = get_branch_list(cache,
+                    (uint32_t)difference, num_rounds, max_step_weight);
+                const int weight = states[first].weight;
+
+                for (const cluster_branch_state_t& l : left) {
+                    if (weight + l.weight > max_weight) {
+                        break;
+                    }
+
+                    for (const cluster_branch_state_t& r : right) {
+                        const int step_weight = l.weight + r.weight;
+
+                        if (weight + step_weight > max_weight) {
+                            break;
+                        }
+
+                        uint16_t words[SPARX64_NUM_STATE_WORDS] = {
+                            (uint16_t)(l.difference >> 16),
+                            (uint16_t)l.difference,
+                            (uint16_t)(r.difference >> 16),
+                            (uint16_t)r.difference
+                        };
+
+                        if (has_linear_layer) {
+                            uint16_t after[SPARX64_NUM_STATE_WORDS];
+                            sparx_linear_layer(words, after);
+                            memcpy(words, after, sizeof(words));
+                        }
+
+                        const uint64_t next_difference = from_words(words);
+                        int remaining_weight = 0;
+
+                        if (last_step != NULL) {
+                            remaining_weight = get_min_last_step_weight(
+                                *last_step, next_difference);
+
+                            if (remaining_weight < 0) {
+                                continue;
+                            }
+
+                            // Replaces the bound of the last step
+                            remaining_weight -= min_remaining_weight;
+                        }
+
+                        for (size_t i = first; i < last; ++i) {
+                            if (states[i].weight + step_weight
+                                + remaining_weight > max_weight) {
+                                break;
+                            }
+
+                            cluster_state_t state;
+                            state.difference = next_difference;
+                            state.weight = states[i].weight + step_weight;
+                            state.num_trails = states[i].num_trails
+                                * l.num_trails * r.num_trails;
+                            next.push_back(state);
+                        }
+                    }
+                }
+
+                if (next.size() > max_num_states[thread_index]) {
+                    merge_states(next);
+
+                    // Does not merge again after every further group
+                    max_num_states[thread_index] =
+                        next.size() + MAX_NUM_UNMERGED_STATES;
+                }
+            }
+        });
+
+    states.clear();
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        states.insert(states.end(), next_states[i].begin(),
+            next_states[i].end());
+        std::vector<cluster_state_t>().swap(next_states[i]);
+    }
+
+    merge_states(states);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Enumerates the last step of num_rounds rounds backwards from delta, both
+ * branches in parallel. Each branch is bounded by max_weight minus the
+ * minimal weight of the other one. Leaves both branches empty if delta
+ * cannot be reached with max_weight.
+ */
+static void search_last_step(const cluster_problem_t& problem,
+                             ThreadPool& pool,
+                             const size_t num_rounds,
+                             const int max_weight,
+                             cluster_last_step_t* last_step) {
+    uint16_t out[SPARX64_NUM_STATE_WORDS];
+    to_words(out, problem.delta);
+
+    if (num_rounds == SPARX64_NUM_ROUNDS_PER_STEP) {
+        uint16_t before[SPARX64_NUM_STATE_WORDS];
+        sparx_invert_linear_layer(out, before);
+        memcpy(out, before, sizeof(out));
+    }
+
+    std::vector<cluster_branch_state_t>* branches[2] = {
+        &(last_step->left), &(last_step->right)
+    };
+    int min_weights[2];
+
+    for (size_t b = 0; b < 2; ++b) {
+        const uint32_t difference =
+            ((uint32_t)out[2 * b] << 16) | out[2 * b + 1];
+        min_weights[b] = get_min_branch_weight(difference, num_rounds,
+            max_weight, true);
+
+        if (min_weights[b] < 0) {
+            return;
+        }
+    }
+
+    if (min_weights[0] + min_weights[1] > max_weight) {
+        return;
+    }
+
+    pool.parallel_for(2, 1,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            (void)thread_index;
+
+            for (size_t b = from; b < to; ++b) {
+                const uint32_t difference =
+                    ((uint32_t)out[2 * b] << 16) | out[2 * b + 1];
+                count_branch_trails(difference, num_rounds,
+                    max_weight - min_weights[1 - b], true, *(branches[b]));
+            }
+        });
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the minimal weight of the characteristics of the first
+ * num_rounds rounds from alpha, or -1 if it exceeds problem.max_weight. As
+ * for a branch, the bound is raised by one until a state remains.
+ */
+static int get_min_forward_weight(const cluster_problem_t& problem,
+                                  ThreadPool& pool,
+                                  const size_t num_rounds) {
+    if (num_rounds == 0) {
+        return 0;
+    }
+
+    trail_search_problem_t bounds;
+    trail_search_init(&bounds, TRAIL_SEARCH_SPARX64, num_rounds);
+    cluster_problem_t forward = problem;
+
+    for (forward.max_weight = trail_search_get_lower_bound(bounds, 0, 0);
+         forward.max_weight <= problem.max_weight; ++forward.max_weight) {
+        std::vector<cluster_state_t> states(1);
+        states[0].difference = problem.alpha;
+        states[0].weight = 0;
+        states[0].num_trails = 1;
+
+        for (size_t r = 0; (r < num_rounds) && !states.empty();
+             r += SPARX64_NUM_ROUNDS_PER_STEP) {
+            search_step(forward, pool, states, SPARX64_NUM_ROUNDS_PER_STEP,
+                trail_search_get_lower_bound(bounds,
+                    r + SPARX64_NUM_ROUNDS_PER_STEP, 0), NULL);
+        }
+
+        if (!states.empty()) {
+            return get_min_weight(states);
+        }
+    }
+
+    return -1;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Joins the states with the characteristics of the last step.
+ */
+static void join_last_step(const cluster_problem_t& problem,
+                           ThreadPool& pool,
+                           const std::vector<cluster_state_t>& states,
+                           const cluster_last_step_t& last_step,
+                           cluster_result_t* result) {
+    const size_t num_threads = pool.get_num_threads();
+    const size_t num_weights = problem.max_weight + 1;
+    std::vector<std::vector<double> > num_trails(num_threads,
+        std::vector<double>(num_weights, 0));
+
+    pool.parallel_for(states.size(), CHUNK_SIZE,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            std::vector<double>& counts = num_trails[thread_index];
+
+            for (size_t i = from; i < to; ++i) {
+                const cluster_state_t& state = states[i];
+                const cluster_branch_range_t left = find_branch_states(
+                    last_step.left, (uint32_t)(state.difference >> 32));
+                const cluster_branch_range_t right = find_branch_states(
+                    last_step.right, (uint32_t)state.difference);
+
+                for (auto l = left.first; l != left.second; ++l) {
+                    if (state.weight + l->weight > problem.max_weight) {
+                        break;
+                    }
+
+                    for (auto r = right.first; r != right.second; ++r) {
+                        const int weight = state.weight + l->weight + r->weight;
+
+                        if (weight > problem.max_weight) {
+                            break;
+                        }
+
+                        counts[weight] +=
+                            state.num_trails * l->num_trails * r->num_trails;
+                    }
+                }
+            }
+        });
+
+    for (size_t t = 0; t < num_threads; ++t) {
+        for (size_t w = 0; w < num_weights; ++w) {
+            result->num_trails[w] += num_trails[t][w];
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+void cluster_estimate(const cluster_problem_t& problem,
+                      ThreadPool& pool,
+                      cluster_result_t* result) {
+    result->num_trails.assign(problem.max_weight + 1, 0);
+    result->num_states.clear();
+
+    // The last step is enumerated backwards with the weight that the
+    // lightest characteristic of the steps before it leaves at most
+    const size_t last_step_start = ((problem.num_rounds - 1)
+        / SPARX64_NUM_ROUNDS_PER_STEP) * SPARX64_NUM_ROUNDS_PER_STEP;
+    trail_search_problem_t bounds;
+    trail_search_init(&bounds, TRAIL_SEARCH_SPARX64, problem.num_rounds);
+    const int min_forward_weight =
+        get_min_forward_weight(problem, pool, last_step_start);
+
+    if (min_forward_weight < 0) {
+        return;
+    }
+
+    cluster_last_step_t last_step;
+    search_last_step(problem, pool, problem.num_rounds - last_step_start,
+        problem.max_weight - min_forward_weight, &last_step);
+
+    if (last_step.left.empty() || last_step.right.empty()) {
+        return;
+    }
+
+    const int min_last_step_weight = get_min_weight(last_step.left)
+        + get_min_weight(last_step.right);
+
+    std::vector<cluster_state_t> states(1);
+    states[0].difference = problem.alpha;
+    states[0].weight = 0;
+    states[0].num_trails = 1;
+
+    for (size_t r = 0; r < last_step_start;
+         r += SPARX64_NUM_ROUNDS_PER_STEP) {
+        const size_t next_r = r + SPARX64_NUM_ROUNDS_PER_STEP;
+        const bool is_last_step_next = (next_r == last_step_start);
+        const int min_remaining_weight = is_last_step_next
+            ? min_last_step_weight
+            : trail_search_get_lower_bound(bounds, next_r, 0);
+
+        result->num_states.push_back(states.size());
+        search_step(problem, pool, states, SPARX64_NUM_ROUNDS_PER_STEP,
+            min_remaining_weight, is_last_step_next ? &last_step : NULL);
+
+        if (states.empty()) {
+            return;
+        }
+    }
+
+    result->num_states.push_back(states.size());
+    join_last_step(problem, pool, states, last_step, result);
+}
+
+// ---------------------------------------------------------
+
+double cluster_get_probability(const cluster_result_t& result) {
+    double probability = 0;
+
+    for (size_t w = 0; w < result.num_trails.size(); ++w) {
+        probability += result.num_trails[w] * pow(2, -(double)w);
+    }
+
+    return probability;
+}
@@ -0,0 +1,388 @@
+/**
+ * Generation of plaintext pairs that conform to the first rounds of a
+ * differential characteristic of SPARX-64 under a known key.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_conforming.h"
+#include "ciphers/sparx64_trail.h"
+#include "ciphers/sparx64_xdp.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+/**
+ * Steps the splitmix64 sequence at seed.
+ */
+static uint64_t next_random(uint64_t* seed) {
+    uint64_t x = (*seed += UINT64_C(0x9E3779B97F4A7C15));
+    x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns a random number in [0, n).
+ */
+static uint64_t next_random_below(uint64_t* seed, const uint64_t n) {
+    const uint64_t limit = UINT64_MAX - (UINT64_MAX % n);
+    uint64_t x;
+
+    do {
+        x = next_random(seed);
+    } while (x >= limit);
+
+    return x % n;
+}
+
+// ---------------------------------------------------------
+
+static void arx_box(const uint16_t key[2], uint16_t* l, uint16_t* r) {
+    *l ^= key[0];
+    *r ^= key[1];
+    sparx_A(l, r);
+}
+
+// ---------------------------------------------------------
+
+static uint64_t get_word(const uint64_t state, const size_t i) {
+    return (state >> (48 - 16 * i)) & 0xFFFF;
+}
+
+// ---------------------------------------------------------
+
+static uint64_t set_branch(const uint64_t state,
+                           const size_t branch,
+                           const uint16_t l,
+                           const uint16_t r) {
+    const size_t shift = 32 - 32 * branch;
+    const uint64_t value = ((uint64_t)l << 16) | r;
+    return (state & ~(0xFFFFFFFFULL << shift)) | (value << shift);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns true if the branch of (p, p ^ alpha) conforms to the first
+ * rounds.
+ */
+static bool is_branch_conforming(
+    const sparx64_conforming_generator_t* generator,
+    const size_t branch,
+    const uint64_t p) {
+    const uint64_t alpha = sparx_conforming_get_alpha(generator);
+    uint16_t l = (uint16_t)get_word(p, 2 * branch);
+    uint16_t r = (uint16_t)get_word(p, 2 * branch + 1);
+    uint16_t l_ = (uint16_t)get_word(p ^ alpha, 2 * branch);
+    uint16_t r_ = (uint16_t)get_word(p ^ alpha, 2 * branch + 1);
+
+    for (size_t round = 0; round < generator->num_rounds; ++round) {
+        const uint16_t* key = generator->cipher_ctx.subkeys[branch]
+            + 2 * round;
+        const uint16_t* after = generator->differences[round + 1]
+            + 2 * branch;
+        arx_box(key, &l, &r);
+        arx_box(key, &l_, &r_);
+
+        if (((uint16_t)(l ^ l_) != after[0])
+            || ((uint16_t)(r ^ r_) != after[1])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Deposits the least significant bits of index into the set bits of mask.
+ */
+static uint64_t deposit(uint64_t index, uint64_t mask) {
+    uint64_t result = 0;
+
+    while ((mask != 0) && (index != 0)) {
+        const uint64_t lowest_bit = mask & (~mask + 1);
+
+        if (index & 1) {
+            result |= lowest_bit;
+        }
+
+        mask ^= lowest_bit;
+        index >>= 1;
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Counts the conforming completions per bit and carry of the addition
+ * (a, b) -> g. The carries of both additions into bit i must differ in
+ * a_i ^ b_i ^ g_i; the carry out of the most significant bit is free.
+ */
+static void count_completions(const uint16_t a,
+                              const uint16_t b,
+                              const uint16_t g,
+                              uint64_t num_completions[][2]) {
+    const uint16_t d = a ^ b ^ g;
+
+    for (size_t c = 0; c < 2; ++c) {
+        num_completions[SPARX64_CONFORMING_WORD_SIZE][c] = 1;
+    }
+
+    for (int i = SPARX64_CONFORMING_WORD_SIZE - 1; i >= 0; --i) {
+        for (size_t c = 0; c < 2; ++c) {
+            const size_t c_ = c ^ ((d >> i) & 1);
+            uint64_t count = 0;
+
+            for (size_t x = 0; x < 2; ++x) {
+                for (size_t y = 0; y < 2; ++y) {
+                    if (i == SPARX64_CONFORMING_WORD_SIZE - 1) {
+                        count++;
+                        continue;
+                    }
+
+                    const size_t x_ = x ^ ((a >> i) & 1);
+                    const size_t y_ = y ^ ((b >> i) & 1);
+                    const size_t carry = (x & y) | (x & c) | (y & c);
+                    const size_t carry_ = (x_ & y_) | (x_ & c_) | (y_ & c_);
+
+                    if ((carry ^ carry_) == (size_t)((d >> (i + 1)) & 1)) {
+                        count += num_completions[i + 1][carry];
+                    }
+                }
+            }
+
+            num_completions[i][c] = count;
+        }
+    }
+
+    // Both carries into bit 0 are zero
+    if ((d & 1) != 0) {
+        num_completions[0][0] = 0;
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Samples addends (x, y) uniformly from the conforming values.
+ */
+static void sample_addends(const uint16_t a,
+                           const uint16_t b,
+                           const uint16_t g,
+                           const uint64_t num_completions[][2],
+                           uint64_t* seed,
+                           uint16_t* x,
+                           uint16_t* y) {
+    const uint16_t d = a ^ b ^ g;
+    size_t c = 0;
+    *x = 0;
+    *y = 0;
+
+    for (size_t i = 0; i < SPARX64_CONFORMING_WORD_SIZE; ++i) {
+        const size_t c_ = c ^ ((d >> i) & 1);
+        uint64_t choice = next_random_below(seed, num_completions[i][c]);
+
+        for (size_t value = 0; value < 4; ++value) {
+            const size_t xi = value & 1;
+            const size_t yi = value >> 1;
+            const size_t carry = (xi & yi) | (xi & c) | (yi & c);
+            uint64_t count = 0;
+
+            if (i == SPARX64_CONFORMING_WORD_SIZE - 1) {
+                count = 1;
+            } else {
+                const size_t x_ = xi ^ ((a >> i) & 1);
+                const size_t y_ = yi ^ ((b >> i) & 1);
+                const size_t carry_ = (x_ & y_) | (x_ & c_) | (y_ & c_);
+
+                if ((carry ^ carry_) == (size_t)((d >> (i + 1)) & 1)) {
+                    count = num_completions[i + 1][carry];
+                }
+            }
+
+            if (choice < count) {
+                *x |= (uint16_t)(xi << i);
+                *y |= (uint16_t)(yi << i);
+                c = carry;
+                break;
+            }
+
+            choice -= count;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+bool sparx_conforming_init(sparx64_conforming_generator_t* generator,
+                           const sparx64_context_t* ctx,
+                           const sparx64_trail_t& trail,
+                           const size_t num_rounds) {
+    if ((num_rounds == 0)
+        || (num_rounds > SPARX64_CONFORMING_MAX_NUM_ROUNDS)
+        || (sparx_get_num_trail_rounds(trail) < num_rounds)) {
+        return false;
+    }
+
+    memcpy(&generator->cipher_ctx, ctx, sizeof(sparx64_context_t));
+    generator->num_rounds = num_rounds;
+    generator->num_pairs = 0;
+
+    for (size_t r = 0; r <= num_rounds; ++r) {
+        memcpy(generator->differences[r], trail.rows[r].difference,
+            sizeof(generator->differences[r]));
+    }
+
+    // The trail holds the difference after the linear layer of the step
+    if (num_rounds == SPARX64_NUM_ROUNDS_PER_STEP) {
+        sparx_invert_linear_layer(trail.rows[num_rounds].difference,
+            generator->differences[num_rounds]);
+    }
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        generator->weights[b] = 0;
+        generator->num_samples[b] = 0;
+
+        for (size_t r = 0; r < num_rounds; ++r) {
+            const int weight = sparx_arx_box_weight(
+                generator->differences[r] + 2 * b,
+                generator->differences[r + 1] + 2 * b);
+
+            if (weight == XDP_ADD_IMPOSSIBLE) {
+                return false;
+            }
+
+            generator->weights[b] += weight;
+        }
+
+        const uint16_t* before = generator->differences[0] + 2 * b;
+        const uint16_t* after = generator->differences[1] + 2 * b;
+        count_completions(ROTR16(before[0], 7), before[1], after[0],
+            generator->num_completions[b]);
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+bool sparx_conforming_next(sparx64_conforming_generator_t* generator,
+                           uint64_t* seed,
+                           uint64_t* p) {
+    *p = next_random(seed);
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        const uint16_t* before = generator->differences[0] + 2 * b;
+        const uint16_t* after = generator->differences[1] + 2 * b;
+        const uint16_t* key = generator->cipher_ctx.subkeys[b];
+        size_t num_samples = 0;
+
+        do {
+            if (num_samples == SPARX64_CONFORMING_MAX_NUM_SAMPLES) {
+                return false;
+            }
+
+            uint16_t x;
+            uint16_t y;
+            sample_addends(ROTR16(before[0], 7), before[1], after[0],
+                generator->num_completions[b], seed, &x, &y);
+
+            // Inverts the rotation and the key addition of the first round
+            *p = set_branch(*p, b, (uint16_t)(ROTL16(x, 7) ^ key[0]),
+                (uint16_t)(y ^ key[1]));
+            generator->num_samples[b]++;
+            num_samples++;
+        } while (!is_branch_conforming(generator, b, *p));
+    }
+
+    generator->num_pairs++;
+    return true;
+}
+
+// ---------------------------------------------------------
+
+bool sparx_conforming_check(const sparx64_conforming_generator_t* generator,
+                            const uint64_t p) {
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        if (!is_branch_conforming(generator, b, p)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+uint64_t sparx_conforming_get_alpha(
+    const sparx64_conforming_generator_t* generator) {
+    uint64_t alpha = 0;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        alpha = (alpha << 16) | generator->differences[0][i];
+    }
+
+    return alpha;
+}
+
+// ---------------------------------------------------------
+
+bool sparx_conforming_get_neutral_bits(
+    sparx64_conforming_generator_t* generator,
+    uint64_t* seed,
+    const size_t num_samples,
+    double probabilities[64]) {
+    uint64_t num_neutral[64] = { 0 };
+
+    for (size_t n = 0; n < num_samples; ++n) {
+        uint64_t p;
+
+        if (!sparx_conforming_next(generator, seed, &p)) {
+            return false;
+        }
+
+        for (size_t i = 0; i < 64; ++i) {
+            num_neutral[i] += sparx_conforming_check(generator,
+                p ^ (1ULL << i));
+        }
+    }
+
+    for (size_t i = 0; i < 64; ++i) {
+        probabilities[i] = (double)num_neutral[i] / num_samples;
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+void sparx_conforming_get_structure(const uint64_t p,
+                                    const uint64_t neutral_mask,
+                                    const size_t num_states,
+                                    uint64_t* states) {
+    for (size_t i = 0; i < num_states; ++i) {
+        states[i] = p ^ deposit(i, neutral_mask);
+    }
+}
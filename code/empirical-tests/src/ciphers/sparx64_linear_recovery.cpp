@@ -0,0 +1,234 @@
+/**
+ * Key recovery for linear approximations of SPARX-64 with the fast
+ * Walsh-Hadamard transform.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_linear_recovery.h"
+#include "utils/ThreadPool.h"
+#include "utils/WalshHadamard.h"
+
+using utils::ThreadPool;
+using utils::walsh_hadamard_transform;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint32_t A_inverse(const uint32_t w) {
+    uint16_t x = (uint16_t)(w >> 16);
+    uint16_t y = (uint16_t)w;
+    sparx_A_inverse(&x, &y);
+    return ((uint32_t)x << 16) | y;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the bits of w on which bit i of the 16-bit y = (l ^ r) >>> 2 of
+ * A^{-1} depends.
+ */
+static uint32_t get_y_bit_dependencies(const size_t i) {
+    const size_t position = (i + 2) % 16;
+    return (1UL << (16 + position)) | (1UL << position);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Inverse of sparx_linear_compress.
+ */
+static uint32_t decompress(const sparx64_linear_counter_t* counter,
+                           const uint32_t value) {
+#ifdef __BMI2__
+    return _pdep_u32(value, counter->active_mask);
+#else
+    uint32_t result = 0;
+    uint32_t mask = counter->active_mask;
+
+    for (uint32_t bit = 1; mask != 0; bit <<= 1) {
+        const uint32_t lowest = mask & (~mask + 1);
+
+        if (value & bit) {
+            result |= lowest;
+        }
+
+        mask ^= lowest;
+    }
+
+    return result;
+#endif
+}
+
+// ---------------------------------------------------------
+
+static bool is_stronger(const sparx64_linear_guess_t& a,
+                        const sparx64_linear_guess_t& b) {
+    return fabs(a.correlation) > fabs(b.correlation);
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+uint32_t sparx_linear_get_active_mask(const uint32_t output_mask) {
+    uint32_t active_mask = 0;
+
+    for (size_t i = 0; i < 16; ++i) {
+        if ((output_mask >> i) & 1) {
+            active_mask |= get_y_bit_dependencies(i);
+        }
+
+        // Bit i of x = (l - y) <<< 7 is bit i - 7 of the difference, which
+        // depends on all lower bits of l and y
+        if ((output_mask >> (16 + i)) & 1) {
+            const size_t j = (i + 9) % 16;
+
+            for (size_t m = 0; m <= j; ++m) {
+                active_mask |= (1UL << (16 + m)) | get_y_bit_dependencies(m);
+            }
+        }
+    }
+
+    return active_mask;
+}
+
+// ---------------------------------------------------------
+
+bool sparx_linear_init_counter(sparx64_linear_counter_t* counter,
+                               const size_t branch,
+                               const uint64_t input_mask,
+                               const uint32_t output_mask) {
+    counter->branch = branch;
+    counter->input_mask = input_mask;
+    counter->output_mask = output_mask;
+    counter->active_mask = sparx_linear_get_active_mask(output_mask);
+    counter->num_active_bits =
+        (size_t)__builtin_popcount(counter->active_mask);
+
+    if (counter->num_active_bits > SPARX64_LINEAR_RECOVERY_MAX_NUM_ACTIVE_BITS) {
+        counter->counts.clear();
+        return false;
+    }
+
+    counter->counts.assign((size_t)1 << counter->num_active_bits, 0);
+    return true;
+}
+
+// ---------------------------------------------------------
+
+uint32_t sparx_linear_compress(const sparx64_linear_counter_t* counter,
+                               const uint32_t value) {
+#ifdef __BMI2__
+    return _pext_u32(value, counter->active_mask);
+#else
+    uint32_t result = 0;
+    uint32_t mask = counter->active_mask;
+
+    for (uint32_t bit = 1; mask != 0; bit <<= 1) {
+        const uint32_t lowest = mask & (~mask + 1);
+
+        if (value & lowest) {
+            result |= bit;
+        }
+
+        mask ^= lowest;
+    }
+
+    return result;
+#endif
+}
+
+// ---------------------------------------------------------
+
+void sparx_linear_add_batch(sparx64_linear_counter_t* counter,
+                            const uint64_t plaintexts[SPARX64_BATCH_SIZE],
+                            const sparx64_batch_t* ciphertexts,
+                            const size_t num_texts) {
+    const uint16_t* l = ciphertexts->words[2 * counter->branch];
+    const uint16_t* r = ciphertexts->words[2 * counter->branch + 1];
+    uint32_t z[SPARX64_BATCH_SIZE];
+
+    // Inverts A of the final round; the key was added before A
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint16_t x = l[j];
+        uint16_t y = r[j];
+        sparx_A_inverse(&x, &y);
+        z[j] = ((uint32_t)x << 16) | y;
+    }
+
+    for (size_t j = 0; j < num_texts; ++j) {
+        const int64_t sign =
+            1 - 2 * (int64_t)__builtin_parityll(plaintexts[j]
+                & counter->input_mask);
+        counter->counts[sparx_linear_compress(counter, z[j])] += sign;
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_linear_merge(sparx64_linear_counter_t* counter,
+                        const sparx64_linear_counter_t* other) {
+    for (size_t i = 0; i < counter->counts.size(); ++i) {
+        counter->counts[i] += other->counts[i];
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_linear_rank_guesses(const sparx64_linear_counter_t* counter,
+                               const uint64_t num_texts,
+                               ThreadPool& pool,
+                               std::vector<sparx64_linear_guess_t>& ranking) {
+    const size_t num_bits = counter->num_active_bits;
+    const size_t num_values = counter->counts.size();
+    std::vector<double> counts(num_values);
+    std::vector<double> signs(num_values);
+
+    for (size_t w = 0; w < num_values; ++w) {
+        counts[w] = (double)counter->counts[w];
+        signs[w] = __builtin_parity(counter->output_mask
+            & A_inverse(decompress(counter, (uint32_t)w))) ? -1 : 1;
+    }
+
+    // correlation(k) = sum_z counts[z] * signs[z ^ k]; the convolution is
+    // the product in the Walsh-Hadamard domain
+    walsh_hadamard_transform(counts.data(), num_bits, pool);
+    walsh_hadamard_transform(signs.data(), num_bits, pool);
+
+    for (size_t s = 0; s < num_values; ++s) {
+        counts[s] *= signs[s];
+    }
+
+    walsh_hadamard_transform(counts.data(), num_bits, pool);
+
+    const double scale = (double)num_values * (double)num_texts;
+    ranking.resize(num_values);
+
+    for (size_t k = 0; k < num_values; ++k) {
+        ranking[k].guess = (uint32_t)k;
+        ranking[k].correlation = counts[k] / scale;
+    }
+
+    std::sort(ranking.begin(), ranking.end(), is_stronger);
+}
@@ -0,0 +1,39 @@
+/**
+ * Related keys for SPARX-64/128.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_related_key.h"
+#include "ciphers/sparx64_rx.h"
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+void sparx_related_key_schedule(
+    sparx64_context_t* related,
+    const uint16_t key[SPARX64_NUM_KEY_WORDS],
+    const uint16_t key_difference[SPARX64_NUM_KEY_WORDS]) {
+    // An RX-related key without rotation
+    sparx_rx_related_key_schedule(related, key, key_difference, 0);
+}
+
+// ---------------------------------------------------------
+
+void sparx_get_subkey_differences(
+    const sparx64_context_t* a,
+    const sparx64_context_t* b,
+    uint16_t differences[SPARX64_NUM_SUBKEY_ROWS][SPARX64_NUM_SUBKEY_WORDS]) {
+    for (size_t row = 0; row < SPARX64_NUM_SUBKEY_ROWS; ++row) {
+        for (size_t i = 0; i < SPARX64_NUM_SUBKEY_WORDS; ++i) {
+            differences[row][i] = a->subkeys[row][i] ^ b->subkeys[row][i];
+        }
+    }
+}
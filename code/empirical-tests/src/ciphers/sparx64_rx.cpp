@@ -0,0 +1,100 @@
+/**
+ * Rotational-XOR (RX) pairs for SPARX-64.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_rx.h"
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint16_t rotate(const uint16_t x, const size_t gamma) {
+    return (uint16_t)((x << (gamma & 15)) | (x >> ((16 - gamma) & 15)));
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+uint64_t sparx_rx_rotate(const uint64_t state, const size_t gamma) {
+    uint64_t result = 0;
+
+    for (size_t w = 0; w < SPARX64_NUM_STATE_WORDS; ++w) {
+        const uint16_t word = (uint16_t)(state >> (48 - 16 * w));
+        result = (result << 16) | rotate(word, gamma);
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------
+
+void sparx_rx_rotate_batch(sparx64_batch_t* batch, const size_t gamma) {
+    for (size_t w = 0; w < SPARX64_NUM_STATE_WORDS; ++w) {
+        uint16_t* words = batch->words[w];
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            words[j] = rotate(words[j], gamma);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_rx_get_differences_batch(const sparx64_batch_t* a,
+                                    const sparx64_batch_t* b,
+                                    const size_t gamma,
+                                    uint64_t differences[SPARX64_BATCH_SIZE]) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        differences[j] = 0;
+    }
+
+    for (size_t w = 0; w < SPARX64_NUM_STATE_WORDS; ++w) {
+        const uint16_t* a_words = a->words[w];
+        const uint16_t* b_words = b->words[w];
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            differences[j] = (differences[j] << 16)
+                | (uint16_t)(b_words[j] ^ rotate(a_words[j], gamma));
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+void sparx_rx_related_key_schedule(
+    sparx64_context_t* related,
+    const uint16_t key[SPARX64_NUM_KEY_WORDS],
+    const uint16_t key_offset[SPARX64_NUM_KEY_WORDS],
+    const size_t gamma) {
+    uint16_t related_key[SPARX64_NUM_KEY_WORDS];
+
+    for (size_t i = 0; i < SPARX64_NUM_KEY_WORDS; ++i) {
+        related_key[i] = rotate(key[i], gamma) ^ key_offset[i];
+    }
+
+    sparx_key_schedule(related, related_key);
+}
+
+// ---------------------------------------------------------
+
+void sparx_rx_rotate_subkeys(sparx64_context_t* rotated,
+                             const sparx64_context_t* ctx,
+                             const size_t gamma) {
+    const size_t num_rows = sizeof(ctx->subkeys) / sizeof(ctx->subkeys[0]);
+    const size_t num_columns = sizeof(ctx->subkeys[0]) / sizeof(uint16_t);
+
+    for (size_t row = 0; row < num_rows; ++row) {
+        for (size_t i = 0; i < num_columns; ++i) {
+            rotated->subkeys[row][i] = rotate(ctx->subkeys[row][i], gamma);
+        }
+    }
+}
@@ -0,0 +1,706 @@
+/**
+ * A multithreaded branch-and-bound search for differential characteristics
+ * of SPARX-64 and SPECKEY-32.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_search.h"
+#include "ciphers/sparx64_trail.h"
+#include "utils/WorkStealingPool.h"
+
+using utils::WorkStealingPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define ROTL(x, n) ((uint16_t)(((x) << n) | ((x) >> (16 - (n)))))
+#define ROTR(x, n) ((uint16_t)(((x) >> n) | ((x) << (16 - (n)))))
+
+static const size_t WORD_LENGTH = 16;
+
+/**
+ * Minimal weights of characteristics over 0, 1, ... rounds, as found by
+ * CryptoSMT in sparx64_trails_minweight.txt and speckey32_trails_minweight.txt
+ * (one round of SPECKEY-32 has weight 0 when the MSB is free). The rounds of
+ * SPARX-64 start at the beginning of a step.
+ */
+static const int SPARX64_MIN_WEIGHTS[] = {
+    0, 0, 1, 3, 5, 9, 13, 24, 29, 35, 42
+};
+static const size_t SPARX64_NUM_MIN_WEIGHTS =
+    sizeof(SPARX64_MIN_WEIGHTS) / sizeof(SPARX64_MIN_WEIGHTS[0]);
+
+static const int SPECKEY32_MIN_WEIGHTS[] = {
+    0, 0, 1, 3, 5, 9, 13
+};
+static const size_t SPECKEY32_NUM_MIN_WEIGHTS =
+    sizeof(SPECKEY32_MIN_WEIGHTS) / sizeof(SPECKEY32_MIN_WEIGHTS[0]);
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * Fixed bits of the inputs alpha, beta and the output gamma of a modular
+ * addition.
+ */
+typedef struct {
+    uint16_t values[3];
+    uint16_t masks[3];
+} addition_constraint_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    sparx64_trail_row_t rows[TRAIL_SEARCH_MAX_NUM_ROUNDS + 1];
+} partial_trail_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const trail_search_problem_t*  problem;
+    const trail_search_callback_t* callback;
+    WorkStealingPool*   pool;
+    int                 weight;
+    size_t              num_branches;
+    std::atomic<size_t> num_trails;
+    std::atomic<bool>   is_stopped;
+} trail_search_ctx_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Bounds for the weight of a round and the rest of its step.
+ */
+typedef struct {
+    int branch_bound;
+    int max_step_weight;
+    int left_bound;
+    int right_bound;
+} round_bounds_t;
+
+// ---------------------------------------------------------
+// Lower bounds
+// ---------------------------------------------------------
+
+/**
+ * Longer characteristics are split into parts whose bounds are known.
+ */
+static int get_speckey_min_weight(const size_t num_rounds) {
+    const size_t max_num_rounds = SPECKEY32_NUM_MIN_WEIGHTS - 1;
+
+    if (num_rounds <= max_num_rounds) {
+        return SPECKEY32_MIN_WEIGHTS[num_rounds];
+    }
+
+    return SPECKEY32_MIN_WEIGHTS[max_num_rounds]
+        + get_speckey_min_weight(num_rounds - max_num_rounds);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Parts of SPARX-64 must also start at the beginning of a step.
+ */
+static int get_sparx_min_weight(const size_t num_rounds) {
+    const size_t max_num_rounds = SPARX64_NUM_MIN_WEIGHTS - 1
+        - ((SPARX64_NUM_MIN_WEIGHTS - 1) % SPARX64_NUM_ROUNDS_PER_STEP);
+
+    if (num_rounds < SPARX64_NUM_MIN_WEIGHTS) {
+        return SPARX64_MIN_WEIGHTS[num_rounds];
+    }
+
+    return SPARX64_MIN_WEIGHTS[max_num_rounds]
+        + get_sparx_min_weight(num_rounds - max_num_rounds);
+}
+
+// ---------------------------------------------------------
+// Enumeration of modular additions
+// ---------------------------------------------------------
+
+/**
+ * Enumerates all differentials (alpha, beta) -> gamma of the modular
+ * addition that satisfy the constraint and have weight at most max_weight,
+ * bit by bit from the least significant one. Bit i of gamma is determined
+ * if all differences were equal in bit i - 1; otherwise, both values are
+ * possible and cost one bit of weight, except for the most significant bit.
+ */
+template <typename F>
+static void enumerate_additions(const addition_constraint_t& constraint,
+                                const size_t bit,
+                                const uint16_t alpha,
+                                const uint16_t beta,
+                                const uint16_t gamma,
+                                const bool were_equal,
+                                const int weight,
+                                const int max_weight,
+                                F& on_addition) {
+    const int previous_beta = (bit == 0) ? 0 : (beta >> (bit - 1)) & 1;
+
+    for (int v = 0; v < 8; ++v) {
+        const int bits[3] = { v & 1, (v >> 1) & 1, (v >> 2) & 1 };
+        bool is_valid = true;
+
+        for (size_t i = 0; i < 3; ++i) {
+            if (((constraint.masks[i] >> bit) & 1)
+                && (((constraint.values[i] >> bit) & 1) != bits[i])) {
+                is_valid = false;
+            }
+        }
+
+        if (!is_valid
+            || (were_equal
+                && ((bits[0] ^ bits[1] ^ bits[2] ^ previous_beta) != 0))) {
+            continue;
+        }
+
+        const bool are_equal = (bits[0] == bits[1]) && (bits[1] == bits[2]);
+        const int next_weight =
+            weight + ((!are_equal && (bit < WORD_LENGTH - 1)) ? 1 : 0);
+
+        if (next_weight > max_weight) {
+            continue;
+        }
+
+        const uint16_t next_alpha = (uint16_t)(alpha | (bits[0] << bit));
+        const uint16_t next_beta = (uint16_t)(beta | (bits[1] << bit));
+        const uint16_t next_gamma = (uint16_t)(gamma | (bits[2] << bit));
+
+        if (bit == WORD_LENGTH - 1) {
+            on_addition(next_alpha, next_beta, next_gamma, next_weight);
+        } else {
+            enumerate_additions(constraint, bit + 1, next_alpha, next_beta,
+                next_gamma, are_equal, next_weight, max_weight, on_addition);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Enumerates the transitions of the ARX-box with the words (x, y) before and
+ * (x', y') after it, where x' = (x >>> 7) + y and y' = (y <<< 2) ^ x'. Bits
+ * of x, y, x', y' are fixed by the masks, whereby bits of y' only restrict
+ * x' where the corresponding bits of y are fixed, and y where those of x'
+ * are fixed.
+ */
+template <typename F>
+static void enumerate_arx_box(const uint16_t in[2],
+                              const uint16_t in_masks[2],
+                              const uint16_t out[2],
+                              const uint16_t out_masks[2],
+                              const int max_weight,
+                              F& on_transition) {
+    addition_constraint_t constraint;
+    constraint.values[0] = ROTR(in[0], 7);
+    constraint.masks[0] = ROTR(in_masks[0], 7);
+
+    const uint16_t beta_mask = ROTR(out_masks[0] & out_masks[1], 2);
+    const uint16_t beta = ROTR(out[0] ^ out[1], 2) & beta_mask;
+
+    if (((beta ^ in[1]) & beta_mask & in_masks[1]) != 0) {
+        return;
+    }
+
+    constraint.values[1] = (in[1] & in_masks[1]) | beta;
+    constraint.masks[1] = in_masks[1] | beta_mask;
+
+    const uint16_t gamma_mask = out_masks[1] & ROTL(in_masks[1], 2);
+    const uint16_t gamma = (out[1] ^ ROTL(in[1], 2)) & gamma_mask;
+
+    if (((gamma ^ out[0]) & gamma_mask & out_masks[0]) != 0) {
+        return;
+    }
+
+    constraint.values[2] = (out[0] & out_masks[0]) | gamma;
+    constraint.masks[2] = out_masks[0] | gamma_mask;
+
+    auto on_addition = [&](const uint16_t alpha, const uint16_t beta,
+                           const uint16_t gamma, const int weight) {
+        const uint16_t x[2] = { ROTL(alpha, 7), beta };
+        const uint16_t y[2] = { gamma, (uint16_t)(ROTL(beta, 2) ^ gamma) };
+        on_transition(x, y, weight);
+    };
+
+    enumerate_additions(constraint, 0, 0, 0, 0, true, 0, max_weight,
+        on_addition);
+}
+
+// ---------------------------------------------------------
+// Search
+// ---------------------------------------------------------
+
+static bool is_linear_layer_round(const trail_search_ctx_t* ctx, const size_t r) {
+    return (ctx->problem->cipher == TRAIL_SEARCH_SPARX64)
+        && (((r + 1) % SPARX64_NUM_ROUNDS_PER_STEP) == 0);
+}
+
+// ---------------------------------------------------------
+
+static bool is_active(const uint16_t branch[2]) {
+    return (branch[0] | branch[1]) != 0;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of rounds after round r until the end of its step or
+ * of the characteristic.
+ */
+static size_t get_num_remaining_step_rounds(const trail_search_ctx_t* ctx,
+                                            const size_t r) {
+    const size_t num_rounds = ctx->problem->num_rounds - r - 1;
+
+    if (ctx->problem->cipher == TRAIL_SEARCH_SPECKEY32) {
+        return num_rounds;
+    }
+
+    const size_t num_step_rounds = SPARX64_NUM_ROUNDS_PER_STEP - 1
+        - (r % SPARX64_NUM_ROUNDS_PER_STEP);
+    return (num_rounds < num_step_rounds) ? num_rounds : num_step_rounds;
+}
+
+// ---------------------------------------------------------
+
+static bool matches_fixed_words(const trail_search_ctx_t* ctx,
+                                const size_t r,
+                                const uint16_t* state) {
+    const uint16_t* masks = ctx->problem->fixed_masks[r];
+    const uint16_t* values = ctx->problem->fixed_values[r];
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        if (((state[i] ^ values[i]) & masks[i]) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+static void report_trail(trail_search_ctx_t* ctx, const partial_trail_t* partial) {
+    const size_t num_rounds = ctx->problem->num_rounds;
+    sparx64_trail_t trail;
+    trail.weight = ctx->weight;
+    trail.rows.assign(partial->rows, partial->rows + num_rounds + 1);
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        trail.rows[num_rounds].weights[b] = SPARX64_TRAIL_NO_WEIGHT;
+    }
+
+    ctx->num_trails++;
+
+    if (!(*(ctx->callback))(trail)) {
+        ctx->is_stopped = true;
+    }
+}
+
+// ---------------------------------------------------------
+
+static void search_round(trail_search_ctx_t* ctx,
+                         partial_trail_t* partial,
+                         const size_t r,
+                         const int weight,
+                         const size_t thread_index);
+
+// ---------------------------------------------------------
+
+/**
+ * Continues with the next round, in a task of its own in the first rounds.
+ */
+static void search_next_round(trail_search_ctx_t* ctx,
+                              partial_trail_t* partial,
+                              const size_t r,
+                              const int weight,
+                              const size_t thread_index) {
+    if (r >= ctx->problem->num_split_rounds) {
+        search_round(ctx, partial, r + 1, weight, thread_index);
+        return;
+    }
+
+    const partial_trail_t child = *partial;
+
+    ctx->pool->spawn(thread_index, [ctx, child, r, weight](const size_t i) {
+        partial_trail_t partial = child;
+        search_round(ctx, &partial, r + 1, weight, i);
+    });
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Every active branch costs at least the minimal weight of SPECKEY-32 over
+ * the remaining rounds of its step; the later steps are bounded as a whole.
+ * SPECKEY-32 consists of a single step. Before the first round, the activity
+ * of the branches is not known yet.
+ */
+static round_bounds_t get_round_bounds(const trail_search_ctx_t* ctx,
+                                       const partial_trail_t* partial,
+                                       const size_t r,
+                                       const int weight) {
+    const size_t num_step_rounds = get_num_remaining_step_rounds(ctx, r);
+    const uint16_t* in = partial->rows[r].difference;
+    round_bounds_t bounds;
+    bounds.branch_bound = get_speckey_min_weight(num_step_rounds);
+    bounds.max_step_weight = ctx->weight - weight
+        - trail_search_get_lower_bound(*(ctx->problem),
+            r + 1 + num_step_rounds, 0);
+    bounds.left_bound = ((r > 0) && is_active(in)) ? bounds.branch_bound : 0;
+    bounds.right_bound =
+        ((r > 0) && is_active(in + 2)) ? bounds.branch_bound : 0;
+    return bounds;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Enumerates the right ARX-box of round r after the left one has been fixed
+ * in partial with left_cost = its weight plus its bound.
+ */
+static void search_right_box(trail_search_ctx_t* ctx,
+                             partial_trail_t* partial,
+                             const size_t r,
+                             const int weight,
+                             const int left_cost,
+                             const size_t thread_index) {
+    const trail_search_problem_t* problem = ctx->problem;
+    const round_bounds_t bounds = get_round_bounds(ctx, partial, r, weight);
+    const bool is_first_round = (r == 0);
+    const bool is_linear_layer_next = is_linear_layer_round(ctx, r);
+    sparx64_trail_row_t* row = &(partial->rows[r]);
+    sparx64_trail_row_t* next_row = &(partial->rows[r + 1]);
+    // The linear layer overwrites the output of the left ARX-box in next_row
+    const uint16_t left_out[2] = {
+        next_row->difference[0], next_row->difference[1]
+    };
+
+    auto on_transition = [&](const uint16_t* x,
+                             const uint16_t* y,
+                             const int right_weight) {
+        const bool is_right_active = is_active(x);
+
+        if (is_first_round && !is_right_active && !is_active(row->difference)) {
+            return;
+        }
+
+        if (left_cost + right_weight
+            + (is_right_active ? bounds.branch_bound : 0)
+            > bounds.max_step_weight) {
+            return;
+        }
+
+        row->difference[2] = x[0];
+        row->difference[3] = x[1];
+        row->weights[1] = (ctx->num_branches == 1)
+            ? SPARX64_TRAIL_NO_WEIGHT : right_weight;
+        uint16_t after[SPARX64_NUM_STATE_WORDS] = {
+            left_out[0], left_out[1], y[0], y[1]
+        };
+
+        if (is_linear_layer_next) {
+            sparx_linear_layer(after, next_row->difference);
+        } else {
+            memcpy(next_row->difference, after, sizeof(after));
+        }
+
+        if (!matches_fixed_words(ctx, r + 1, next_row->difference)) {
+            return;
+        }
+
+        search_next_round(ctx, partial, r,
+            weight + row->weights[0] + right_weight, thread_index);
+    };
+
+    if (ctx->num_branches == 1) {
+        const uint16_t zero[2] = { 0, 0 };
+        on_transition(zero, zero, 0);
+        return;
+    }
+
+    // Before a linear layer, the fixed words after it do not restrict the
+    // ARX-boxes directly
+    const uint16_t full_masks[2] = { 0xFFFF, 0xFFFF };
+    const uint16_t no_masks[2] = { 0, 0 };
+    const uint16_t* in_masks = is_first_round
+        ? problem->fixed_masks[0] + 2 : full_masks;
+    const uint16_t* out_masks = is_linear_layer_next
+        ? no_masks : problem->fixed_masks[r + 1] + 2;
+
+    enumerate_arx_box(row->difference + 2, in_masks,
+        problem->fixed_values[r + 1] + 2, out_masks,
+        bounds.max_step_weight - left_cost - bounds.right_bound,
+        on_transition);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Enumerates the left ARX-box of round r. In the first rounds, the right
+ * ARX-box is enumerated in a task of its own for every left transition, 
+ * since the product of both can be large if the input is not fixed.
+ */
+static void search_round(trail_search_ctx_t* ctx,
+                         partial_trail_t* partial,
+                         const size_t r,
+                         const int weight,
+                         const size_t thread_index) {
+    const trail_search_problem_t* problem = ctx->problem;
+
+    if (ctx->is_stopped) {
+        return;
+    }
+
+    if (r == problem->num_rounds) {
+        if (weight == ctx->weight) {
+            report_trail(ctx, partial);
+        }
+
+        return;
+    }
+
+    const round_bounds_t bounds = get_round_bounds(ctx, partial, r, weight);
+
+    if (bounds.max_step_weight - bounds.left_bound - bounds.right_bound < 0) {
+        return;
+    }
+
+    // The state before the first round may be partially unknown
+    const bool is_first_round = (r == 0);
+    const bool is_linear_layer_next = is_linear_layer_round(ctx, r);
+    const uint16_t full_masks[2] = { 0xFFFF, 0xFFFF };
+    const uint16_t no_masks[2] = { 0, 0 };
+    const uint16_t* in_masks = is_first_round
+        ? problem->fixed_masks[0] : full_masks;
+    const uint16_t* out_masks = is_linear_layer_next
+        ? no_masks : problem->fixed_masks[r + 1];
+    sparx64_trail_row_t* row = &(partial->rows[r]);
+    sparx64_trail_row_t* next_row = &(partial->rows[r + 1]);
+    const uint16_t in[2] = { row->difference[0], row->difference[1] };
+
+    auto on_transition = [&](const uint16_t* x,
+                             const uint16_t* y,
+                             const int left_weight) {
+        const int left_cost =
+            left_weight + (is_active(x) ? bounds.branch_bound : 0);
+
+        if (left_cost + bounds.right_bound > bounds.max_step_weight) {
+            return;
+        }
+
+        row->difference[0] = x[0];
+        row->difference[1] = x[1];
+        row->weights[0] = left_weight;
+        next_row->difference[0] = y[0];
+        next_row->difference[1] = y[1];
+
+        if ((ctx->num_branches == 1) || (r >= problem->num_split_rounds)) {
+            search_right_box(ctx, partial, r, weight, left_cost, thread_index);
+            return;
+        }
+
+        const partial_trail_t child = *partial;
+
+        ctx->pool->spawn(thread_index,
+            [ctx, child, r, weight, left_cost](const size_t i) {
+                partial_trail_t partial = child;
+                search_right_box(ctx, &partial, r, weight, left_cost, i);
+            });
+    };
+
+    enumerate_arx_box(in, in_masks, problem->fixed_values[r + 1], out_masks,
+        bounds.max_step_weight - bounds.left_bound - bounds.right_bound,
+        on_transition);
+}
+
+// ---------------------------------------------------------
+// Single branches
+// ---------------------------------------------------------
+
+/**
+ * Every active branch has at least the minimal weight of SPECKEY-32 in the
+ * remaining rounds; an inactive one stays inactive.
+ */
+static void enumerate_branch(const uint16_t in[2],
+                             const size_t num_rounds,
+                             const int weight,
+                             const int max_weight,
+                             const trail_search_branch_callback_t& callback) {
+    if (num_rounds == 0) {
+        callback(in, weight);
+        return;
+    }
+
+    const uint16_t full_masks[2] = { 0xFFFF, 0xFFFF };
+    const uint16_t no_masks[2] = { 0, 0 };
+    const int bound = is_active(in) ? get_speckey_min_weight(num_rounds - 1) : 0;
+
+    auto on_transition = [&](const uint16_t* x,
+                             const uint16_t* y,
+                             const int round_weight) {
+        (void)x;
+        enumerate_branch(y, num_rounds - 1, weight + round_weight, max_weight,
+            callback);
+    };
+
+    enumerate_arx_box(in, full_masks, no_masks, no_masks,
+        max_weight - weight - bound, on_transition);
+}
+
+// ---------------------------------------------------------
+
+static void enumerate_branch_backwards(
+    const uint16_t out[2],
+    const size_t num_rounds,
+    const int weight,
+    const int max_weight,
+    const trail_search_branch_callback_t& callback) {
+    if (num_rounds == 0) {
+        callback(out, weight);
+        return;
+    }
+
+    const uint16_t full_masks[2] = { 0xFFFF, 0xFFFF };
+    const uint16_t no_masks[2] = { 0, 0 };
+    const int bound = is_active(out) ? get_speckey_min_weight(num_rounds - 1) : 0;
+
+    auto on_transition = [&](const uint16_t* x,
+                             const uint16_t* y,
+                             const int round_weight) {
+        (void)y;
+        enumerate_branch_backwards(x, num_rounds - 1, weight + round_weight,
+            max_weight, callback);
+    };
+
+    enumerate_arx_box(no_masks, no_masks, out, full_masks,
+        max_weight - weight - bound, on_transition);
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+void trail_search_init(trail_search_problem_t* problem,
+                       const trail_search_cipher_t cipher,
+                       const size_t num_rounds) {
+    problem->cipher = cipher;
+    problem->num_rounds = num_rounds;
+    memset(problem->fixed_masks, 0, sizeof(problem->fixed_masks));
+    memset(problem->fixed_values, 0, sizeof(problem->fixed_values));
+
+    // SPECKEY-32 has only one branch
+    if (cipher == TRAIL_SEARCH_SPECKEY32) {
+        for (size_t r = 0; r <= TRAIL_SEARCH_MAX_NUM_ROUNDS; ++r) {
+            problem->fixed_masks[r][2] = 0xFFFF;
+            problem->fixed_masks[r][3] = 0xFFFF;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+void trail_search_fix_word(trail_search_problem_t* problem,
+                           const size_t r,
+                           const size_t i,
+                           const uint16_t value) {
+    problem->fixed_masks[r][i] = 0xFFFF;
+    problem->fixed_values[r][i] = value;
+}
+
+// ---------------------------------------------------------
+
+int trail_search_get_lower_bound(const trail_search_problem_t& problem,
+                                 const size_t r,
+                                 const size_t num_active_branches) {
+    if (r >= problem.num_rounds) {
+        return 0;
+    }
+
+    const size_t num_rounds = problem.num_rounds - r;
+
+    if (problem.cipher == TRAIL_SEARCH_SPECKEY32) {
+        return get_speckey_min_weight(num_rounds);
+    }
+
+    // Until the end of the current step, every active branch stays active;
+    // at least one of them is
+    const size_t num_rounds_in_step = SPARX64_NUM_ROUNDS_PER_STEP
+        - (r % SPARX64_NUM_ROUNDS_PER_STEP);
+    const size_t num_first_rounds = (num_rounds < num_rounds_in_step)
+        ? num_rounds : num_rounds_in_step;
+    const size_t num_first_branches =
+        (num_active_branches == 0) ? 1 : num_active_branches;
+    const int bound = (int)num_first_branches
+        * get_speckey_min_weight(num_first_rounds)
+        + get_sparx_min_weight(num_rounds - num_first_rounds);
+
+    if ((r % SPARX64_NUM_ROUNDS_PER_STEP) != 0) {
+        return bound;
+    }
+
+    const int step_bound = get_sparx_min_weight(num_rounds);
+    return (step_bound > bound) ? step_bound : bound;
+}
+
+// ---------------------------------------------------------
+
+size_t trail_search_run(const trail_search_problem_t& problem,
+                        const int weight,
+                        WorkStealingPool& pool,
+                        const trail_search_callback_t& callback) {
+    trail_search_ctx_t ctx;
+    ctx.problem = &problem;
+    ctx.callback = &callback;
+    ctx.pool = &pool;
+    ctx.weight = weight;
+    ctx.num_branches = (problem.cipher == TRAIL_SEARCH_SPECKEY32)
+        ? 1 : SPARX64_NUM_BRANCHES;
+    ctx.num_trails = 0;
+    ctx.is_stopped = false;
+
+    if ((problem.num_rounds == 0)
+        || (problem.num_rounds > TRAIL_SEARCH_MAX_NUM_ROUNDS)) {
+        return 0;
+    }
+
+    pool.run([&](const size_t thread_index) {
+        partial_trail_t partial;
+        memset(&partial, 0, sizeof(partial));
+        memcpy(partial.rows[0].difference, problem.fixed_values[0],
+            sizeof(partial.rows[0].difference));
+        search_round(&ctx, &partial, 0, 0, thread_index);
+    });
+
+    return ctx.num_trails;
+}
+
+// ---------------------------------------------------------
+
+void trail_search_enumerate_branch(
+    const uint16_t in[2],
+    const size_t num_rounds,
+    const int max_weight,
+    const trail_search_branch_callback_t& callback) {
+    enumerate_branch(in, num_rounds, 0, max_weight, callback);
+}
+
+// ---------------------------------------------------------
+
+void trail_search_enumerate_branch_backwards(
+    const uint16_t out[2],
+    const size_t num_rounds,
+    const int max_weight,
+    const trail_search_branch_callback_t& callback) {
+    enumerate_branch_backwards(out, num_rounds, 0, max_weight, callback);
+}
@@ -0,0 +1,168 @@
+/**
+ * Differential characteristics of SPARX-64 as found by CryptoSMT.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const char* CHARACTERISTIC_PREFIX = "Characteristic for sparxround";
+static const char* WEIGHT_PREFIX = "Weight: ";
+// Some files have an additional column with the total weight of the round
+static const size_t NUM_COLUMNS = 9;
+
+// The carry out of the most significant bit is free
+static const uint16_t WEIGHT_MASK = 0x7FFF;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool starts_with(const std::string& line, const char* prefix) {
+    return line.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// ---------------------------------------------------------
+
+static bool parse_difference(const std::string& token, uint16_t* value) {
+    char* end;
+    const unsigned long parsed = strtoul(token.c_str(), &end, 16);
+    *value = (uint16_t)parsed;
+    return (*end == '\0') && (parsed <= 0xFFFF);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * CryptoSMT stores weights either as negative log2 probabilities, e.g. "-4",
+ * or as the vector of carries, e.g. "0x0050".
+ */
+static bool parse_weight(const std::string& token, int* weight) {
+    if (token == "none") {
+        *weight = SPARX64_TRAIL_NO_WEIGHT;
+        return true;
+    }
+
+    if (token.compare(0, 2, "0x") == 0) {
+        uint16_t weight_vector;
+
+        if (!parse_difference(token, &weight_vector)) {
+            return false;
+        }
+
+        *weight = __builtin_popcount(weight_vector & WEIGHT_MASK);
+        return true;
+    }
+
+    char* end;
+    *weight = abs((int)strtol(token.c_str(), &end, 10));
+    return *end == '\0';
+}
+
+// ---------------------------------------------------------
+
+static bool parse_row(const std::string& line, 
+                      const size_t expected_index, 
+                      sparx64_trail_row_t* row) {
+    std::istringstream stream(line);
+    std::vector<std::string> tokens;
+    std::string token;
+
+    while (stream >> token) {
+        tokens.push_back(token);
+    }
+
+    if ((tokens.size() < NUM_COLUMNS)
+        || (strtoul(tokens[0].c_str(), NULL, 10) != expected_index)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        if (!parse_difference(tokens[1 + i], &(row->difference[i]))) {
+            return false;
+        }
+    }
+
+    // Columns X0L, X1L are redundant since they follow from the next row
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        if (!parse_weight(tokens[7 + b], &(row->weights[b]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+size_t sparx_get_num_trail_rounds(const sparx64_trail_t& trail) {
+    return trail.rows.empty() ? 0 : trail.rows.size() - 1;
+}
+
+// ---------------------------------------------------------
+
+bool sparx_read_trails(const char* path, std::vector<sparx64_trail_t>& trails) {
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    std::vector<char> buffer(4096);
+    std::string line;
+    sparx64_trail_t* trail = NULL;
+    bool is_in_table = false;
+    bool is_valid = true;
+
+    while (is_valid && fgets(buffer.data(), buffer.size(), file)) {
+        line = buffer.data();
+
+        while (!line.empty() && ((line.back() == '\n') || (line.back() == '\r'))) {
+            line.pop_back();
+        }
+
+        if (starts_with(line, CHARACTERISTIC_PREFIX)) {
+            trails.push_back(sparx64_trail_t());
+            trail = &(trails.back());
+            is_in_table = false;
+        } else if (trail == NULL) {
+            continue;
+        } else if (starts_with(line, "Rounds\t") || starts_with(line, "---")) {
+            is_in_table = true;
+        } else if (starts_with(line, WEIGHT_PREFIX)) {
+            trail->weight = atoi(line.c_str() + strlen(WEIGHT_PREFIX));
+            trail = NULL;
+            is_in_table = false;
+        } else if (is_in_table) {
+            if (line.empty()) {
+                is_in_table = false;
+                continue;
+            }
+
+            sparx64_trail_row_t row;
+            is_valid = parse_row(line, trail->rows.size(), &row);
+            trail->rows.push_back(row);
+        }
+    }
+
+    fclose(file);
+    return is_valid;
+}
@@ -0,0 +1,169 @@
+/**
+ * Exact XOR-differential probabilities of the modular addition and the 
+ * ARX-box A of SPARX-64.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+#include "ciphers/sparx64_xdp.h"
+#include "ciphers/speckey32_trail.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define ROTL(x, n) (((x) << n) | ((x) >> (16 - (n))))
+#define ROTR(x, n) (((x) >> n) | ((x) << (16 - (n))))
+
+// All bits but the most significant one, whose carry out is free
+static const uint16_t WEIGHT_MASK = 0x7FFF;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+/**
+ * Bit i is set iff the i-th bits of alpha, beta, and gamma are equal.
+ */
+static inline uint16_t eq(const uint16_t alpha, 
+                          const uint16_t beta, 
+                          const uint16_t gamma) {
+    return (uint16_t)((~alpha ^ beta) & (~alpha ^ gamma));
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+int xdp_add_weight(const uint16_t alpha, 
+                   const uint16_t beta, 
+                   const uint16_t gamma) {
+    // Wherever all three differences are equal, the carry differences into 
+    // the next bit must be equal to the sum of the differences in this bit
+    const uint16_t equal_before = eq((uint16_t)(alpha << 1), 
+        (uint16_t)(beta << 1), (uint16_t)(gamma << 1));
+    const uint16_t sum = (uint16_t)(alpha ^ beta ^ gamma ^ (beta << 1));
+
+    if ((equal_before & sum) != 0) {
+        return XDP_ADD_IMPOSSIBLE;
+    }
+
+    return __builtin_popcount(~eq(alpha, beta, gamma) & WEIGHT_MASK);
+}
+
+// ---------------------------------------------------------
+
+int xdp_add_weight_with_msb(const uint16_t alpha, 
+                            const uint16_t beta, 
+                            const uint16_t gamma) {
+    const int weight = xdp_add_weight(alpha, beta, gamma);
+
+    if (weight == XDP_ADD_IMPOSSIBLE) {
+        return XDP_ADD_IMPOSSIBLE;
+    }
+
+    // Masks in 16 bits, since ~ promotes to int and sets the upper bits
+    const uint16_t msb_mask = (uint16_t)~WEIGHT_MASK;
+    return weight + ((((uint16_t)~eq(alpha, beta, gamma)) & msb_mask) != 0);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * The right word of out must be rotl2(in[1]) ^ out[0], which is free.
+ */
+static bool is_linear_part_valid(const uint16_t in[2], const uint16_t out[2]) {
+    return (uint16_t)(ROTL(in[1], 2) ^ out[0]) == out[1];
+}
+
+// ---------------------------------------------------------
+
+int sparx_arx_box_weight(const uint16_t in[2], const uint16_t out[2]) {
+    if (!is_linear_part_valid(in, out)) {
+        return XDP_ADD_IMPOSSIBLE;
+    }
+
+    return xdp_add_weight(ROTR(in[0], 7), in[1], out[0]);
+}
+
+// ---------------------------------------------------------
+
+static int sparx_arx_box_weight_with_msb(const uint16_t in[2], 
+                                         const uint16_t out[2]) {
+    if (!is_linear_part_valid(in, out)) {
+        return XDP_ADD_IMPOSSIBLE;
+    }
+
+    return xdp_add_weight_with_msb(ROTR(in[0], 7), in[1], out[0]);
+}
+
+// ---------------------------------------------------------
+
+static int add_weight(const int total_weight, const int weight) {
+    if ((weight == XDP_ADD_IMPOSSIBLE) 
+        || (total_weight == XDP_ADD_IMPOSSIBLE)) {
+        return XDP_ADD_IMPOSSIBLE;
+    }
+
+    return total_weight + weight;
+}
+
+// ---------------------------------------------------------
+
+int sparx_get_exact_trail_weights(const sparx64_trail_t& trail, 
+                                  std::vector<sparx64_xdp_round_t>& rounds) {
+    const size_t num_rounds = sparx_get_num_trail_rounds(trail);
+    int total_weight = 0;
+    rounds.resize(num_rounds);
+
+    for (size_t r = 0; r < num_rounds; ++r) {
+        const uint16_t* before = trail.rows[r].difference;
+        uint16_t after[SPARX64_NUM_STATE_WORDS];
+
+        if (((r + 1) % SPARX64_NUM_ROUNDS_PER_STEP) != 0) {
+            for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+                after[i] = trail.rows[r + 1].difference[i];
+            }
+        } else {
+            sparx_invert_linear_layer(trail.rows[r + 1].difference, after);
+        }
+
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            rounds[r].weights[b] = 
+                sparx_arx_box_weight(before + 2 * b, after + 2 * b);
+            rounds[r].weights_with_msb[b] = 
+                sparx_arx_box_weight_with_msb(before + 2 * b, after + 2 * b);
+            total_weight = add_weight(total_weight, rounds[r].weights[b]);
+        }
+    }
+
+    return total_weight;
+}
+
+// ---------------------------------------------------------
+
+int speckey_get_exact_trail_weights(const speckey32_trail_t& trail, 
+                                    std::vector<speckey32_xdp_round_t>& rounds) {
+    const size_t num_rounds = speckey_get_num_trail_rounds(trail);
+    int total_weight = 0;
+    rounds.resize(num_rounds);
+
+    for (size_t r = 0; r < num_rounds; ++r) {
+        const uint16_t* before = trail.rows[r].difference;
+        const uint16_t* after = trail.rows[r + 1].difference;
+        rounds[r].weight = sparx_arx_box_weight(before, after);
+        rounds[r].weight_with_msb = sparx_arx_box_weight_with_msb(before, after);
+        total_weight = add_weight(total_weight, rounds[r].weight);
+    }
+
+    return total_weight;
+}
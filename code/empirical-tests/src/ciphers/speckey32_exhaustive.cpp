@@ -0,0 +1,482 @@
+/**
+ * Exact evaluation of differentials and boomerang switches of a single
+ * branch of SPARX-64 under a fixed key.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/speckey32_exhaustive.h"
+#include "utils/ThreadPool.h"
+
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+// Number of pairs that are encrypted at once in structure-of-arrays layout
+#define BLOCK_SIZE              1024
+
+// Number of pairs per item of the thread pool
+#define NUM_PAIRS_PER_ITEM      (1UL << 16)
+#define NUM_ITEMS               ((1UL << 31) / NUM_PAIRS_PER_ITEM)
+#define NUM_ITEMS_PER_CHUNK     16
+
+// Number of entries of the table for the distribution; differences are
+// counted in partitions s.t. each fits into it with a load of at most 3/4
+#define COUNTS_TABLE_SIZE            (1UL << 26)
+#define COUNTS_TABLE_MAX_NUM_ENTRIES (COUNTS_TABLE_SIZE / 4 * 3)
+
+// Number of differences that a thread counts locally
+#define CACHE_SIZE                   (1UL << 12)
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    uint16_t keys[SPARX64_NUM_ROUNDS][2];
+    size_t   num_rounds;
+    uint32_t alpha;
+    // Inputs are the pair indices with a zero inserted at this bit
+    size_t   pivot;
+} exhaustive_problem_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Open-addressing hash table of (difference << 32) | number of pairs; the
+ * output difference of a pair is never zero, s.t. zero marks empty entries.
+ */
+typedef struct {
+    std::vector<std::atomic<uint64_t> > entries =
+        std::vector<std::atomic<uint64_t> >(COUNTS_TABLE_SIZE);
+    std::atomic<size_t> num_entries;
+} counts_table_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static void init_problem(exhaustive_problem_t* problem,
+                         const sparx64_context_t* ctx,
+                         const size_t branch,
+                         const size_t num_rounds,
+                         const uint32_t alpha) {
+    for (size_t r = 0; r < num_rounds; ++r) {
+        const size_t s = r / SPARX64_NUM_ROUNDS_PER_STEP;
+        const size_t i = r % SPARX64_NUM_ROUNDS_PER_STEP;
+        const uint16_t* subkeys =
+            ctx->subkeys[s * SPARX64_NUM_BRANCHES + branch];
+        problem->keys[r][0] = subkeys[2 * i];
+        problem->keys[r][1] = subkeys[2 * i + 1];
+    }
+
+    problem->num_rounds = num_rounds;
+    problem->alpha = alpha;
+    problem->pivot = 0;
+
+    while (((alpha >> problem->pivot) & 1) == 0) {
+        problem->pivot++;
+    }
+}
+
+// ---------------------------------------------------------
+
+static void encrypt_words(const exhaustive_problem_t* problem,
+                          uint16_t l[BLOCK_SIZE],
+                          uint16_t r[BLOCK_SIZE]) {
+    for (size_t i = 0; i < problem->num_rounds; ++i) {
+        const uint16_t k0 = problem->keys[i][0];
+        const uint16_t k1 = problem->keys[i][1];
+
+        // Same as A, but on plain loops the compiler can vectorize
+        for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+            uint16_t x = l[j] ^ k0;
+            uint16_t y = r[j] ^ k1;
+            x = (uint16_t)((uint16_t)((x >> 7) | (x << 9)) + y);
+            y = (uint16_t)((y << 2) | (y >> 14)) ^ x;
+            l[j] = x;
+            r[j] = y;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void decrypt_words(const exhaustive_problem_t* problem,
+                          uint16_t l[BLOCK_SIZE],
+                          uint16_t r[BLOCK_SIZE]) {
+    for (size_t i = problem->num_rounds; i > 0; --i) {
+        const uint16_t k0 = problem->keys[i - 1][0];
+        const uint16_t k1 = problem->keys[i - 1][1];
+
+        // Same as A_inverse
+        for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+            uint16_t x = l[j];
+            uint16_t y = r[j] ^ x;
+            y = (uint16_t)((y >> 2) | (y << 14));
+            x = (uint16_t)(x - y);
+            x = (uint16_t)((x << 7) | (x >> 9));
+            l[j] = x ^ k0;
+            r[j] = y ^ k1;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the BLOCK_SIZE pairs that start at pair index first.
+ */
+static void load_pairs(const exhaustive_problem_t* problem,
+                       const uint64_t first,
+                       uint16_t l1[BLOCK_SIZE],
+                       uint16_t r1[BLOCK_SIZE],
+                       uint16_t l2[BLOCK_SIZE],
+                       uint16_t r2[BLOCK_SIZE]) {
+    const uint64_t low_mask = (1ULL << problem->pivot) - 1;
+    const uint16_t alpha_l = (uint16_t)(problem->alpha >> 16);
+    const uint16_t alpha_r = (uint16_t)problem->alpha;
+
+    for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+        const uint64_t index = first + j;
+        const uint32_t x = (uint32_t)(((index & ~low_mask) << 1)
+            | (index & low_mask));
+        l1[j] = (uint16_t)(x >> 16);
+        r1[j] = (uint16_t)x;
+        l2[j] = l1[j] ^ alpha_l;
+        r2[j] = r1[j] ^ alpha_r;
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Encrypts the BLOCK_SIZE pairs that start at pair index first and stores
+ * their output differences.
+ */
+static void encrypt_block(const exhaustive_problem_t* problem,
+                          const uint64_t first,
+                          uint32_t differences[BLOCK_SIZE]) {
+    uint16_t l1[BLOCK_SIZE];
+    uint16_t r1[BLOCK_SIZE];
+    uint16_t l2[BLOCK_SIZE];
+    uint16_t r2[BLOCK_SIZE];
+
+    load_pairs(problem, first, l1, r1, l2, r2);
+    encrypt_words(problem, l1, r1);
+    encrypt_words(problem, l2, r2);
+
+    for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+        differences[j] = ((uint32_t)(l1[j] ^ l2[j]) << 16) | (r1[j] ^ r2[j]);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of the BLOCK_SIZE pairs that start at pair index first
+ * and return as pairs with difference alpha after XORing gamma to both
+ * outputs and decrypting them.
+ */
+static size_t count_returning_block(const exhaustive_problem_t* problem,
+                                    const uint64_t first,
+                                    const uint32_t gamma) {
+    uint16_t l1[BLOCK_SIZE];
+    uint16_t r1[BLOCK_SIZE];
+    uint16_t l2[BLOCK_SIZE];
+    uint16_t r2[BLOCK_SIZE];
+
+    load_pairs(problem, first, l1, r1, l2, r2);
+    encrypt_words(problem, l1, r1);
+    encrypt_words(problem, l2, r2);
+
+    const uint16_t gamma_l = (uint16_t)(gamma >> 16);
+    const uint16_t gamma_r = (uint16_t)gamma;
+
+    for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+        l1[j] ^= gamma_l;
+        r1[j] ^= gamma_r;
+        l2[j] ^= gamma_l;
+        r2[j] ^= gamma_r;
+    }
+
+    decrypt_words(problem, l1, r1);
+    decrypt_words(problem, l2, r2);
+
+    const uint16_t alpha_l = (uint16_t)(problem->alpha >> 16);
+    const uint16_t alpha_r = (uint16_t)problem->alpha;
+    size_t count = 0;
+
+    for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+        count += ((l1[j] ^ l2[j]) == alpha_l) && ((r1[j] ^ r2[j]) == alpha_r);
+    }
+
+    return count;
+}
+
+// ---------------------------------------------------------
+
+static bool is_before_by_difference(const speckey32_count_t& a,
+                                    const speckey32_count_t& b) {
+    return a.difference < b.difference;
+}
+
+// ---------------------------------------------------------
+
+static uint32_t get_partition(const uint32_t difference,
+                              const size_t num_partition_bits) {
+    if (num_partition_bits == 0) {
+        return 0;
+    }
+
+    return (uint32_t)(difference * 0x9E3779B1U) >> (32 - num_partition_bits);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Adds num_pairs to the number of pairs of difference; returns false if the
+ * table is full.
+ */
+static bool add_to_table(counts_table_t* table,
+                         const uint32_t difference,
+                         const uint32_t num_pairs) {
+    const uint64_t key = (uint64_t)difference << 32;
+    uint32_t hash = difference ^ (difference >> 16);
+    hash *= 0x45D9F3BU;
+    hash ^= hash >> 16;
+    size_t index = hash & (COUNTS_TABLE_SIZE - 1);
+
+    while (true) {
+        std::atomic<uint64_t>& entry = table->entries[index];
+        uint64_t value = entry.load(std::memory_order_relaxed);
+
+        if (value == 0) {
+            if (table->num_entries.load(std::memory_order_relaxed)
+                >= COUNTS_TABLE_MAX_NUM_ENTRIES) {
+                return false;
+            }
+
+            if (entry.compare_exchange_strong(value, key | num_pairs)) {
+                table->num_entries++;
+                return true;
+            }
+        }
+
+        if ((value >> 32) == difference) {
+            entry.fetch_add(num_pairs, std::memory_order_relaxed);
+            return true;
+        }
+
+        index = (index + 1) & (COUNTS_TABLE_SIZE - 1);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Counts the pairs of all output differences in the given partition into
+ * table. Returns false if the table overflows.
+ */
+static bool count_partition(const exhaustive_problem_t* problem,
+                            const size_t num_partition_bits,
+                            const size_t partition,
+                            ThreadPool& pool,
+                            counts_table_t* table) {
+    for (size_t i = 0; i < COUNTS_TABLE_SIZE; ++i) {
+        table->entries[i].store(0, std::memory_order_relaxed);
+    }
+
+    table->num_entries = 0;
+    std::atomic<bool> is_full(false);
+
+    pool.parallel_for(NUM_ITEMS, NUM_ITEMS_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            (void)thread_index;
+            uint32_t differences[BLOCK_SIZE];
+            // Frequent differences are counted locally and only added to
+            // the shared table when they are evicted
+            std::vector<uint32_t> cached_differences(CACHE_SIZE, 0);
+            std::vector<uint32_t> cached_counts(CACHE_SIZE, 0);
+
+            for (uint64_t first = from * NUM_PAIRS_PER_ITEM;
+                 (first < to * NUM_PAIRS_PER_ITEM) && !is_full;
+                 first += BLOCK_SIZE) {
+                encrypt_block(problem, first, differences);
+
+                for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+                    const uint32_t difference = differences[j];
+
+                    if (get_partition(difference, num_partition_bits)
+                        != partition) {
+                        continue;
+                    }
+
+                    const size_t index =
+                        (difference ^ (difference >> 13)) & (CACHE_SIZE - 1);
+
+                    if (cached_differences[index] == difference) {
+                        cached_counts[index]++;
+                        continue;
+                    }
+
+                    if ((cached_counts[index] > 0)
+                        && !add_to_table(table, cached_differences[index],
+                            cached_counts[index])) {
+                        is_full = true;
+                        break;
+                    }
+
+                    cached_differences[index] = difference;
+                    cached_counts[index] = 1;
+                }
+            }
+
+            for (size_t i = 0; (i < CACHE_SIZE) && !is_full; ++i) {
+                if ((cached_counts[i] > 0)
+                    && !add_to_table(table, cached_differences[i],
+                        cached_counts[i])) {
+                    is_full = true;
+                }
+            }
+        });
+
+    return !is_full;
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+uint64_t speckey_count_differential(const sparx64_context_t* ctx,
+                                    const size_t branch,
+                                    const size_t num_rounds,
+                                    const uint32_t alpha,
+                                    const uint32_t beta,
+                                    ThreadPool& pool) {
+    exhaustive_problem_t problem;
+    init_problem(&problem, ctx, branch, num_rounds, alpha);
+    std::vector<uint64_t> thread_counts(pool.get_num_threads(), 0);
+
+    pool.parallel_for(NUM_ITEMS, NUM_ITEMS_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            uint32_t differences[BLOCK_SIZE];
+            uint64_t count = 0;
+
+            for (uint64_t first = from * NUM_PAIRS_PER_ITEM;
+                 first < to * NUM_PAIRS_PER_ITEM;
+                 first += BLOCK_SIZE) {
+                encrypt_block(&problem, first, differences);
+
+                for (size_t j = 0; j < BLOCK_SIZE; ++j) {
+                    count += (differences[j] == beta);
+                }
+            }
+
+            thread_counts[thread_index] += count;
+        });
+
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < thread_counts.size(); ++i) {
+        count += thread_counts[i];
+    }
+
+    // Every pair stands for both of its inputs
+    return 2 * count;
+}
+
+// ---------------------------------------------------------
+
+uint64_t speckey_count_boomerang(const sparx64_context_t* ctx,
+                                 const size_t branch,
+                                 const size_t num_rounds,
+                                 const uint32_t beta,
+                                 const uint32_t gamma,
+                                 ThreadPool& pool) {
+    // With an inactive difference, every quartet returns
+    if ((beta == 0) || (gamma == 0)) {
+        return SPECKEY32_EXHAUSTIVE_NUM_TEXTS;
+    }
+
+    exhaustive_problem_t problem;
+    init_problem(&problem, ctx, branch, num_rounds, beta);
+    std::vector<uint64_t> thread_counts(pool.get_num_threads(), 0);
+
+    pool.parallel_for(NUM_ITEMS, NUM_ITEMS_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            uint64_t count = 0;
+
+            for (uint64_t first = from * NUM_PAIRS_PER_ITEM;
+                 first < to * NUM_PAIRS_PER_ITEM;
+                 first += BLOCK_SIZE) {
+                count += count_returning_block(&problem, first, gamma);
+            }
+
+            thread_counts[thread_index] += count;
+        });
+
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < thread_counts.size(); ++i) {
+        count += thread_counts[i];
+    }
+
+    // x and x ^ beta start the same quartet
+    return 2 * count;
+}
+
+// ---------------------------------------------------------
+
+void speckey_count_output_differences(const sparx64_context_t* ctx,
+                                      const size_t branch,
+                                      const size_t num_rounds,
+                                      const uint32_t alpha,
+                                      const uint64_t min_count,
+                                      ThreadPool& pool,
+                                      std::vector<speckey32_count_t>& counts) {
+    exhaustive_problem_t problem;
+    init_problem(&problem, ctx, branch, num_rounds, alpha);
+    counts_table_t table;
+    size_t num_partition_bits = 0;
+    size_t partition = 0;
+    counts.clear();
+
+    while (partition < ((size_t)1 << num_partition_bits)) {
+        if (!count_partition(&problem, num_partition_bits, partition,
+                pool, &table)) {
+            // Restarts with twice as many, but smaller, partitions
+            num_partition_bits++;
+            partition *= 2;
+            continue;
+        }
+
+        for (size_t i = 0; i < COUNTS_TABLE_SIZE; ++i) {
+            const uint64_t entry = table.entries[i].load();
+            // Every pair stands for both of its inputs
+            const speckey32_count_t count = {
+                (uint32_t)(entry >> 32), 2 * (entry & 0xFFFFFFFFULL)
+            };
+
+            if ((entry != 0) && (count.count >= min_count)) {
+                counts.push_back(count);
+            }
+        }
+
+        partition++;
+    }
+
+    std::sort(counts.begin(), counts.end(), is_before_by_difference);
+}
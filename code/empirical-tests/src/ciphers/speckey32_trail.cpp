@@ -0,0 +1,151 @@
+/**
+ * Differential characteristics of SPECKEY-32 as found by CryptoSMT.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ciphers/speckey32_trail.h"
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const char* CHARACTERISTIC_PREFIX = "Characteristic for speckey";
+static const char* WEIGHT_PREFIX = "Weight: ";
+static const size_t NUM_COLUMNS = 4;
+
+// The carry out of the most significant bit is free
+static const uint16_t WEIGHT_MASK = 0x7FFF;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool starts_with(const std::string& line, const char* prefix) {
+    return line.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// ---------------------------------------------------------
+
+static bool parse_word(const std::string& token, uint16_t* value) {
+    char* end;
+    const unsigned long parsed = strtoul(token.c_str(), &end, 16);
+    *value = (uint16_t)parsed;
+    return (*end == '\0') && (parsed <= 0xFFFF);
+}
+
+// ---------------------------------------------------------
+
+static bool parse_row(const std::string& line, 
+                      const size_t expected_index, 
+                      speckey32_trail_row_t* row) {
+    std::istringstream stream(line);
+    std::vector<std::string> tokens;
+    std::string token;
+
+    while (stream >> token) {
+        tokens.push_back(token);
+    }
+
+    if ((tokens.size() < NUM_COLUMNS)
+        || (strtoul(tokens[0].c_str(), NULL, 10) != expected_index)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < SPECKEY32_NUM_STATE_WORDS; ++i) {
+        if (!parse_word(tokens[1 + i], &(row->difference[i]))) {
+            return false;
+        }
+    }
+
+    if (tokens[3] == "none") {
+        row->weight = SPECKEY32_TRAIL_NO_WEIGHT;
+        return true;
+    }
+
+    // Some files store the weight as negative log2 probability, e.g. "-4"
+    if (tokens[3][0] == '-') {
+        char* end;
+        row->weight = abs((int)strtol(tokens[3].c_str(), &end, 10));
+        return *end == '\0';
+    }
+
+    uint16_t weight_vector;
+
+    if (!parse_word(tokens[3], &weight_vector)) {
+        return false;
+    }
+
+    row->weight = __builtin_popcount(weight_vector & WEIGHT_MASK);
+    return true;
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+size_t speckey_get_num_trail_rounds(const speckey32_trail_t& trail) {
+    return trail.rows.empty() ? 0 : trail.rows.size() - 1;
+}
+
+// ---------------------------------------------------------
+
+bool speckey_read_trails(const char* path, 
+                         std::vector<speckey32_trail_t>& trails) {
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    std::vector<char> buffer(4096);
+    std::string line;
+    speckey32_trail_t* trail = NULL;
+    bool is_in_table = false;
+    bool is_valid = true;
+
+    while (is_valid && fgets(buffer.data(), buffer.size(), file)) {
+        line = buffer.data();
+
+        while (!line.empty() && ((line.back() == '\n') || (line.back() == '\r'))) {
+            line.pop_back();
+        }
+
+        if (starts_with(line, CHARACTERISTIC_PREFIX)) {
+            trails.push_back(speckey32_trail_t());
+            trail = &(trails.back());
+            is_in_table = false;
+        } else if (trail == NULL) {
+            continue;
+        } else if (starts_with(line, "Rounds\t") || starts_with(line, "---")) {
+            is_in_table = true;
+        } else if (starts_with(line, WEIGHT_PREFIX)) {
+            trail->weight = atoi(line.c_str() + strlen(WEIGHT_PREFIX));
+            trail = NULL;
+            is_in_table = false;
+        } else if (is_in_table) {
+            if (line.empty()) {
+                is_in_table = false;
+                continue;
+            }
+
+            speckey32_trail_row_t row;
+            is_valid = parse_row(line, trail->rows.size(), &row);
+            trail->rows.push_back(row);
+        }
+    }
+
+    fclose(file);
+    return is_valid;
+}
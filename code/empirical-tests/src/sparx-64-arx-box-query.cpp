@@ -0,0 +1,184 @@
+/**
+ * Looks up the transitions of the ARX-box A of SPARX-64 from the input
+ * difference <d> over 1, 2, or 3 rounds in a table, as written by
+ * sparx-64-arx-box-table, and prints them sorted by their best weight.
+ * With --output_difference, prints only the transition to that difference.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "utils/argparse.h"
+#include "utils/ArxBoxTable.h"
+
+using utils::arx_box_table_input_t;
+using utils::arx_box_table_transition_t;
+using utils::ArxBoxTable;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string table_path;
+    uint32_t    difference = 0;
+    size_t      num_rounds = 0;
+    bool        has_output_difference = false;
+    uint32_t    output_difference = 0;
+    size_t      max_num_results = 20;
+} query_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool is_before_by_weight(const arx_box_table_transition_t* a,
+                                const arx_box_table_transition_t* b) {
+    if (a->weight != b->weight) {
+        return a->weight < b->weight;
+    }
+
+    return a->probability > b->probability;
+}
+
+// ---------------------------------------------------------
+
+static void print_transition(const size_t num_rounds,
+                             const arx_box_table_transition_t& transition) {
+    printf("%6zu %08x %6d  2^%-8.2f\n", num_rounds, transition.difference,
+        transition.weight, log2(transition.probability));
+}
+
+// ---------------------------------------------------------
+// Query
+// ---------------------------------------------------------
+
+static void query_rounds(const query_ctx_t* ctx,
+                         const ArxBoxTable& table,
+                         const arx_box_table_input_t& input,
+                         const size_t num_rounds) {
+    if (ctx->has_output_difference) {
+        const arx_box_table_transition_t* transition = table.find_transition(
+            input, num_rounds, ctx->output_difference);
+
+        if (transition != NULL) {
+            print_transition(num_rounds, *transition);
+        }
+
+        return;
+    }
+
+    size_t num_transitions;
+    const arx_box_table_transition_t* transitions =
+        table.get_transitions(input, num_rounds, &num_transitions);
+    std::vector<const arx_box_table_transition_t*> sorted(num_transitions);
+
+    for (size_t i = 0; i < num_transitions; ++i) {
+        sorted[i] = transitions + i;
+    }
+
+    const size_t num_results = std::min(num_transitions, ctx->max_num_results);
+    std::partial_sort(sorted.begin(), sorted.begin() + num_results,
+        sorted.end(), is_before_by_weight);
+
+    for (size_t i = 0; i < num_results; ++i) {
+        print_transition(num_rounds, *sorted[i]);
+    }
+
+    printf("%6zu rounds: %zu transitions, min. weight %d\n", num_rounds,
+        num_transitions, input.min_weights[num_rounds - 1]);
+}
+
+// ---------------------------------------------------------
+
+static void run_query(const query_ctx_t* ctx) {
+    ArxBoxTable table;
+
+    if (!table.open(ctx->table_path.c_str())) {
+        fprintf(stderr, "Could not open ARX-box table %s, or it is corrupt\n",
+            ctx->table_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    const arx_box_table_input_t* input = table.find_input(ctx->difference);
+
+    if (input == NULL) {
+        fprintf(stderr, "%08x is not among the %zu inputs of the table\n",
+            ctx->difference, table.get_num_inputs());
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Max. weight %d\n", table.get_max_weight());
+    printf("%6s %-8s %6s  %-s\n", "Rounds", "Output", "Weight", "Probability");
+
+    for (size_t r = 1; r <= ARX_BOX_TABLE_MAX_NUM_ROUNDS; ++r) {
+        if ((ctx->num_rounds == 0) || (ctx->num_rounds == r)) {
+            query_rounds(ctx, table, *input, r);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(query_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("ARX-Box-Query");
+    parser.helpString("Looks up the transitions of the ARX-box of SPARX-64 from an input difference in a precomputed table.");
+    parser.addArgument("-i", "--input", 1, false);
+    parser.addArgument("-d", "--difference", 1, false);
+    parser.addArgument("-r", "--num_rounds", 1);
+    parser.addArgument("-n", "--max_num_results", 1);
+    parser.addArgument("--output_difference", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->table_path = parser.retrieve<std::string>("input");
+        ctx->difference = (uint32_t)strtoul(
+            parser.retrieve<std::string>("difference").c_str(), NULL, 16);
+
+        if (parser.count("num_rounds")) {
+            ctx->num_rounds = parser.retrieveAsInt("num_rounds");
+        }
+
+        if (parser.count("max_num_results")) {
+            ctx->max_num_results = parser.retrieveAsInt("max_num_results");
+        }
+
+        if (parser.count("output_difference")) {
+            ctx->has_output_difference = true;
+            ctx->output_difference = (uint32_t)strtoul(
+                parser.retrieve<std::string>("output_difference").c_str(),
+                NULL, 16);
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_rounds > ARX_BOX_TABLE_MAX_NUM_ROUNDS) {
+        fprintf(stderr, "Number of rounds must be in [1, %d]\n",
+            ARX_BOX_TABLE_MAX_NUM_ROUNDS);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    query_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_query(&ctx);
+    return 0;
+}
@@ -0,0 +1,236 @@
+/**
+ * Precomputes the differential transitions of the ARX-box A of SPARX-64 over
+ * 1, 2, and 3 rounds up to a maximal weight <w> and writes them into a table
+ * that sparx-64-arx-box-query and the searches can map into memory.
+ *
+ * The input differences are the union of the given 32-bit differences, all
+ * non-zero differences with a Hamming weight of at most <h>, and the branch
+ * differences at the start of every step of the characteristics in a trail
+ * store, as written by sparx-64-trail-import.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/ArxBoxTable.h"
+#include "utils/ThreadPool.h"
+#include "utils/TrailStore.h"
+
+using utils::ArxBoxTableBuilder;
+using utils::ThreadPool;
+using utils::trail_store_entry_t;
+using utils::trail_store_row_t;
+using utils::TrailStore;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define MAX_WEIGHT 64
+#define MAX_HAMMING_WEIGHT 4
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string output_path;
+    int max_weight = 0;
+    std::vector<uint32_t> differences;
+    int max_hamming_weight = 0;
+    std::string store_path;
+} table_ctx_t;
+
+// ---------------------------------------------------------
+// Inputs
+// ---------------------------------------------------------
+
+static size_t add_low_weight_inputs(const table_ctx_t* ctx,
+                                    ArxBoxTableBuilder& builder) {
+    size_t num_inputs = 0;
+
+    for (int h = 1; h <= ctx->max_hamming_weight; ++h) {
+        // Iterates over all 32-bit values with h bits set in lexicographic
+        // order
+        uint64_t value = (1ULL << h) - 1;
+
+        while (value < (1ULL << 32)) {
+            builder.add_input((uint32_t)value);
+            num_inputs++;
+
+            const uint64_t lowest = value & (~value + 1);
+            const uint64_t ripple = value + lowest;
+            value = (((ripple ^ value) >> 2) / lowest) | ripple;
+        }
+    }
+
+    return num_inputs;
+}
+
+// ---------------------------------------------------------
+
+static size_t add_store_inputs(const table_ctx_t* ctx,
+                               ArxBoxTableBuilder& builder) {
+    TrailStore store;
+
+    if (!store.open(ctx->store_path.c_str())) {
+        fprintf(stderr, "Could not open trail store %s\n",
+            ctx->store_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    size_t num_inputs = 0;
+
+    for (size_t i = 0; i < store.get_num_trails(); ++i) {
+        const trail_store_entry_t& trail = store.get_trail(i);
+        const trail_store_row_t* rows = store.get_rows(trail);
+
+        for (size_t r = 0; r < trail.num_rounds; ++r) {
+            const uint64_t difference = rows[r].difference;
+
+            if (trail.cipher == utils::TRAIL_STORE_SPECKEY32) {
+                if (difference != 0) {
+                    builder.add_input((uint32_t)difference);
+                    num_inputs++;
+                }
+
+                continue;
+            }
+
+            if ((r % SPARX64_NUM_ROUNDS_PER_STEP) != 0) {
+                continue;
+            }
+
+            const uint32_t branches[2] = {
+                (uint32_t)(difference >> 32), (uint32_t)difference
+            };
+
+            for (size_t b = 0; b < 2; ++b) {
+                if (branches[b] != 0) {
+                    builder.add_input(branches[b]);
+                    num_inputs++;
+                }
+            }
+        }
+    }
+
+    return num_inputs;
+}
+
+// ---------------------------------------------------------
+// Build
+// ---------------------------------------------------------
+
+static void run_build(const table_ctx_t* ctx) {
+    ArxBoxTableBuilder builder(ctx->max_weight);
+
+    for (size_t i = 0; i < ctx->differences.size(); ++i) {
+        builder.add_input(ctx->differences[i]);
+    }
+
+    if (ctx->max_hamming_weight > 0) {
+        printf("%8zu inputs of Hamming weight <= %d\n",
+            add_low_weight_inputs(ctx, builder), ctx->max_hamming_weight);
+    }
+
+    if (!ctx->store_path.empty()) {
+        printf("%8zu inputs from %s\n",
+            add_store_inputs(ctx, builder), ctx->store_path.c_str());
+    }
+
+    if (builder.get_num_inputs() == 0) {
+        fprintf(stderr, "No input differences given\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ThreadPool pool(NUM_THREADS);
+    const auto start = std::chrono::steady_clock::now();
+    builder.compute(pool);
+    const auto end = std::chrono::steady_clock::now();
+
+    if (!builder.write(ctx->output_path.c_str())) {
+        fprintf(stderr, "Could not write %s\n", ctx->output_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Wrote %zu transitions of %zu inputs into %s in %.2f s\n",
+        builder.get_num_transitions(), builder.get_num_inputs(),
+        ctx->output_path.c_str(),
+        std::chrono::duration<double>(end - start).count());
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(table_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("ARX-Box-Table");
+    parser.helpString("Precomputes the 1-, 2-, and 3-round transitions of the ARX-box of SPARX-64 up to a maximal weight <w>.");
+    parser.addArgument("-o", "--output", 1, false);
+    parser.addArgument("-w", "--max_weight", 1, false);
+    parser.addArgument("-d", "--differences", '+');
+    parser.addArgument("--max_hamming_weight", 1);
+    parser.addArgument("-s", "--store", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->output_path = parser.retrieve<std::string>("output");
+        ctx->max_weight = parser.retrieveAsInt("max_weight");
+
+        if (parser.count("differences")) {
+            const std::vector<std::string> differences =
+                parser.retrieve<std::vector<std::string> >("differences");
+
+            for (size_t i = 0; i < differences.size(); ++i) {
+                ctx->differences.push_back(
+                    (uint32_t)strtoul(differences[i].c_str(), NULL, 16));
+            }
+        }
+
+        if (parser.count("max_hamming_weight")) {
+            ctx->max_hamming_weight =
+                parser.retrieveAsInt("max_hamming_weight");
+        }
+
+        if (parser.count("store")) {
+            ctx->store_path = parser.retrieve<std::string>("store");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->max_weight < 0) || (ctx->max_weight > MAX_WEIGHT)) {
+        fprintf(stderr, "Maximal weight must be in [0, %d]\n", MAX_WEIGHT);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->max_hamming_weight < 0)
+        || (ctx->max_hamming_weight > MAX_HAMMING_WEIGHT)) {
+        fprintf(stderr, "Maximal Hamming weight must be in [0, %d]\n",
+            MAX_HAMMING_WEIGHT);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    table_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_build(&ctx);
+    return 0;
+}
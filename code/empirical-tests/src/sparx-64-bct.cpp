@@ -0,0 +1,280 @@
+/**
+ * Computes entries of the boomerang connectivity table (BCT) of <r> rounds
+ * of a branch of SPARX-64 for all combinations of the upper differences <u>
+ * and lower differences <l>. Each entry is the fraction of all 2^32 inputs
+ * whose quartet returns, averaged over <#keys> random keys.
+ *
+ * With --state, <u> and <l> are 64-bit differences of SPARX-64 before and
+ * after <r> <= 3 rounds of a step. The branches are independent within a
+ * step, s.t. the entry of the state is the product of those of its branches.
+ *
+ * With --cache, computed entries are stored in and looked up from a file;
+ * only keys that are missing in the cache are evaluated.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/speckey32_exhaustive.h"
+#include "utils/argparse.h"
+#include "utils/BoomerangCache.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::boomerang_cache_entry_t;
+using utils::BoomerangCache;
+using utils::get_random;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t      num_rounds = 0;
+    size_t      num_keys = 0;
+    size_t      branch = 0;
+    bool        is_state = false;
+    std::vector<uint64_t> upper_differences;
+    std::vector<uint64_t> lower_differences;
+    std::string cache_path;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static void print_log2_probability(const double probability) {
+    if (probability == 0) {
+        printf(" %-9s", "0");
+    } else {
+        printf(" 2^%-7.2f", log2(probability));
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the probability of the BCT entry of branch over num_keys keys,
+ * evaluating only the keys that are missing in the cache.
+ */
+static double get_branch_probability(const experiment_ctx_t* ctx,
+                                     ThreadPool& pool,
+                                     BoomerangCache& cache,
+                                     const size_t branch,
+                                     const uint32_t beta,
+                                     const uint32_t gamma) {
+    // With an inactive difference, every quartet returns
+    if ((beta == 0) || (gamma == 0)) {
+        return 1;
+    }
+
+    const boomerang_cache_entry_t* cached =
+        cache.find(ctx->num_rounds, beta, gamma);
+    const size_t num_cached_keys = (cached == NULL) ? 0 : cached->num_keys;
+
+    if (num_cached_keys < ctx->num_keys) {
+        boomerang_cache_entry_t entry;
+        entry.num_rounds = ctx->num_rounds;
+        entry.beta = beta;
+        entry.gamma = gamma;
+        entry.num_keys = ctx->num_keys - num_cached_keys;
+
+        uint8_t key[SPARX64_KEY_LENGTH];
+        sparx64_context_t cipher_ctx;
+
+        for (size_t i = 0; i < entry.num_keys; ++i) {
+            get_random(key, SPARX64_KEY_LENGTH);
+            sparx_key_schedule(&cipher_ctx, key);
+            entry.count += speckey_count_boomerang(&cipher_ctx, branch,
+                ctx->num_rounds, beta, gamma, pool);
+        }
+
+        cache.add(entry);
+
+        // Keeps the entries computed so far if the run is aborted
+        if (!ctx->cache_path.empty()
+            && !cache.write(ctx->cache_path.c_str())) {
+            fprintf(stderr, "Could not write cache %s\n",
+                ctx->cache_path.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        cached = cache.find(ctx->num_rounds, beta, gamma);
+    }
+
+    return (double)cached->count
+        / ((double)cached->num_keys * SPECKEY32_EXHAUSTIVE_NUM_TEXTS);
+}
+
+// ---------------------------------------------------------
+
+static double get_probability(const experiment_ctx_t* ctx,
+                              ThreadPool& pool,
+                              BoomerangCache& cache,
+                              const uint64_t upper,
+                              const uint64_t lower) {
+    if (!ctx->is_state) {
+        return get_branch_probability(ctx, pool, cache, ctx->branch,
+            (uint32_t)upper, (uint32_t)lower);
+    }
+
+    double probability = 1;
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        const size_t shift = 32 * (SPARX64_NUM_BRANCHES - 1 - b);
+        probability *= get_branch_probability(ctx, pool, cache, b,
+            (uint32_t)(upper >> shift), (uint32_t)(lower >> shift));
+    }
+
+    return probability;
+}
+
+// ---------------------------------------------------------
+
+static void print_difference(const experiment_ctx_t* ctx,
+                             const uint64_t difference) {
+    if (ctx->is_state) {
+        printf("%016" PRIx64, difference);
+    } else {
+        printf("%08" PRIx64, difference);
+    }
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+static void run_experiment(const experiment_ctx_t* ctx) {
+    BoomerangCache cache;
+
+    if (!ctx->cache_path.empty() && !cache.read(ctx->cache_path.c_str())) {
+        fprintf(stderr, "Could not parse cache %s\n", ctx->cache_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    ThreadPool pool(NUM_THREADS);
+
+    printf("%-*s", ctx->is_state ? 16 : 8, "Upper");
+
+    for (size_t j = 0; j < ctx->lower_differences.size(); ++j) {
+        printf(" %-9zu", j);
+    }
+
+    printf("\n");
+
+    for (size_t i = 0; i < ctx->upper_differences.size(); ++i) {
+        print_difference(ctx, ctx->upper_differences[i]);
+
+        for (size_t j = 0; j < ctx->lower_differences.size(); ++j) {
+            print_log2_probability(get_probability(ctx, pool, cache,
+                ctx->upper_differences[i], ctx->lower_differences[j]));
+            fflush(stdout);
+        }
+
+        printf("\n");
+    }
+
+    for (size_t j = 0; j < ctx->lower_differences.size(); ++j) {
+        printf("Lower %zu: ", j);
+        print_difference(ctx, ctx->lower_differences[j]);
+        printf("\n");
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_differences(const std::vector<std::string>& values,
+                              std::vector<uint64_t>& differences) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        differences.push_back(strtoull(values[i].c_str(), NULL, 16));
+    }
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("BCT");
+    parser.helpString("Computes boomerang connectivity table entries of <r> rounds of a branch of SPARX-64 for upper differences <u> and lower differences <l>.");
+    parser.addArgument("-r", "--num_rounds", 1, false);
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-u", "--upper", '+', false);
+    parser.addArgument("-l", "--lower", '+', false);
+    parser.addArgument("-b", "--branch", 1);
+    parser.addArgument("-c", "--cache", 1);
+    parser.addArgument("--state", 0);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_rounds = parser.retrieveAsInt("num_rounds");
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->is_state = parser.retrieveAsFlag("state");
+        parse_differences(
+            parser.retrieve<std::vector<std::string> >("upper"),
+            ctx->upper_differences);
+        parse_differences(
+            parser.retrieve<std::vector<std::string> >("lower"),
+            ctx->lower_differences);
+
+        if (parser.count("branch")) {
+            ctx->branch = parser.retrieveAsInt("branch");
+        }
+
+        if (parser.count("cache")) {
+            ctx->cache_path = parser.retrieve<std::string>("cache");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_rounds == 0)
+        || (ctx->num_rounds > SPARX64_NUM_ROUNDS_PER_STEP)) {
+        fprintf(stderr, "Number of rounds must be in [1, %d]\n",
+            SPARX64_NUM_ROUNDS_PER_STEP);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->branch >= SPARX64_NUM_BRANCHES) {
+        fprintf(stderr, "Branch must be in [0, %d]\n",
+            SPARX64_NUM_BRANCHES - 1);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Rounds %8zu\n", ctx->num_rounds);
+    printf("#Keys   %8zu\n", ctx->num_keys);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiment(&ctx);
+    return 0;
+}
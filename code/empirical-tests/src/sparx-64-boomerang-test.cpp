@@ -13,12 +13,15 @@
 #include <string.h>
 
 #include <atomic> 
+#include <memory>
 #include <mutex>  // NOLINT(build/c++11)
+#include <string>
 #include <thread> // NOLINT(build/c++11)
 #include <vector> 
 
 #include "ciphers/sparx64.h"
 #include "utils/argparse.h"
+#include "utils/PairRecorder.h"
 #include "utils/printing.h"
 #include "utils/xorshift1024.h"
 #include "utils/xor.h"
@@ -26,7 +29,9 @@
 using utils::xorshift_prng_ctx_t;
 using utils::xor_difference;
 using utils::get_random;
+using utils::pair_record_t;
 using utils::print_hex;
+using utils::PairRecorder;
 
 // ---------------------------------------------------------
 // Constants
@@ -44,6 +49,9 @@ typedef struct {
     size_t  num_steps = 5;
     uint8_t alpha[8];
     uint8_t delta[8];
+    size_t  key_index = 0;
+    std::string capture_path;
+    PairRecorder* recorder = NULL;
 } experiment_ctx_t;
 
 // ---------------------------------------------------------
@@ -65,6 +73,47 @@ static void do_print_quartet(const uint8_t* p,
 }
 #endif
 
+// ---------------------------------------------------------
+
+/**
+ * Hands the right quartet (P, P', Q, Q') to the recorder of the thread,
+ * together with the differences of (P, P') after each step.
+ */
+static void record_quartet(const experiment_ctx_t* ctx, 
+                           const sparx64_context_t* sparx_ctx,
+                           const size_t thread_index,
+                           const uint8_t* p, 
+                           const uint8_t* p_, 
+                           const uint8_t* q, 
+                           const uint8_t* q_) {
+    pair_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.key_index = (uint32_t)ctx->key_index;
+    record.num_texts = 4;
+    memcpy(record.texts[0], p,  SPARX64_STATE_LENGTH);
+    memcpy(record.texts[1], p_, SPARX64_STATE_LENGTH);
+    memcpy(record.texts[2], q,  SPARX64_STATE_LENGTH);
+    memcpy(record.texts[3], q_, SPARX64_STATE_LENGTH);
+
+    uint8_t state[SPARX64_STATE_LENGTH];
+    uint8_t state_[SPARX64_STATE_LENGTH];
+    memcpy(state,  p,  SPARX64_STATE_LENGTH);
+    memcpy(state_, p_, SPARX64_STATE_LENGTH);
+
+    // Right quartets are rare, so re-encrypting them step by step is cheap
+    for (size_t s = 1; 
+         (s <= ctx->num_steps) && (s <= PAIR_RECORD_MAX_DIFFERENCES); 
+         ++s) {
+        sparx_encrypt_steps(sparx_ctx, state,  state,  s, s);
+        sparx_encrypt_steps(sparx_ctx, state_, state_, s, s);
+        xor_difference(record.differences[s-1], state, state_, 
+            SPARX64_STATE_LENGTH);
+        record.num_differences++;
+    }
+
+    ctx->recorder->record(thread_index, record);
+}
+
 // ---------------------------------------------------------
 // Experiment
 // ---------------------------------------------------------
@@ -75,6 +124,7 @@ static void experiment_thread(const experiment_ctx_t* ctx,
                               std::mutex& mutex, 
 #endif
                               std::atomic<size_t>& counter, 
+                              const size_t thread_index, 
                               const size_t from, 
                               const size_t to) {
     uint8_t p[SPARX64_STATE_LENGTH];
@@ -114,6 +164,10 @@ static void experiment_thread(const experiment_ctx_t* ctx,
 #ifdef DEBUG
             do_print_quartet(p, p_, q, q_, mutex);
 #endif
+            if (ctx->recorder != NULL) {
+                record_quartet(ctx, sparx_ctx, thread_index, p, p_, q, q_);
+            }
+
             counter++;
         }
     }
@@ -152,6 +206,7 @@ static void experiment_threading(const experiment_ctx_t* ctx,
             std::ref(mutex), 
 #endif
             std::ref(counter),
+            i, 
             from, 
             to
         );
@@ -187,9 +242,26 @@ static void run_experiment(experiment_ctx_t* ctx) {
 // ---------------------------------------------------------
 
 static void run_experiments(experiment_ctx_t* ctx) {
+    std::unique_ptr<PairRecorder> recorder;
+
+    if (!ctx->capture_path.empty()) {
+        recorder.reset(new PairRecorder(ctx->capture_path.c_str(), NUM_THREADS));
+
+        if (!recorder->is_open()) {
+            fprintf(stderr, "Could not open %s\n", ctx->capture_path.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        ctx->recorder = recorder.get();
+    }
+
     for (size_t i = 0; i < ctx->num_keys; ++i) {
+        ctx->key_index = i;
         run_experiment(ctx);
     }
+
+    ctx->recorder = NULL;
+    recorder.reset();
 }
 
 // ---------------------------------------------------------
@@ -205,6 +277,7 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
     parser.addArgument("-d", "--delta", 1, false);
     parser.addArgument("-s", "--num_steps", 1, false);
     parser.addArgument("-t", "--num_texts", 1, false);
+    parser.addArgument("--capture", 1);
 
     try {
         parser.parse(argc, argv);
@@ -215,6 +288,10 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
 
         parser.retrieveUint8ArrayFromHexString("a", ctx->alpha, 8);
         parser.retrieveUint8ArrayFromHexString("d", ctx->delta, 8);
+
+        if (parser.count("capture")) {
+            ctx->capture_path = parser.retrieve<std::string>("capture");
+        }
     } catch( ... ) { 
         fprintf(stderr, "%s\n", parser.usage().c_str());
         exit(EXIT_FAILURE);
@@ -0,0 +1,241 @@
+/**
+ * Measures the final stage of an attack on SPARX-64/128: the exhaustive
+ * search over the key bits that the attack did not recover.
+ *
+ * For each of <k> random keys, <u> random bits of the state of the key
+ * schedule at row <r> of the subkeys are treated as unknown; all other bits
+ * are known. All 2^u candidates are inverted to master keys and tested
+ * against <p> known plaintext/ciphertext pairs. The tool reports whether
+ * the search found exactly the correct key, and the throughput in tested
+ * keys per second, from which the time of searching more bits can be
+ * extrapolated.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_brute_force.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_KEY_BITS 128
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t num_keys = 0;
+    size_t num_unknown_bits = 0;
+    size_t row = 0;
+    size_t num_pairs = 2;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint64_t get_random_state() {
+    uint64_t state;
+    get_random((uint8_t*)&state, sizeof(state));
+    return state;
+}
+
+// ---------------------------------------------------------
+
+static uint64_t encrypt(const sparx64_context_t* ctx, const uint64_t state) {
+    uint16_t plaintext[SPARX64_NUM_STATE_WORDS];
+    uint16_t ciphertext[SPARX64_NUM_STATE_WORDS];
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        plaintext[i] =
+            (uint16_t)(state >> (16 * (SPARX64_NUM_STATE_WORDS - 1 - i)));
+    }
+
+    sparx_encrypt(ctx, plaintext, ciphertext);
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        result = (result << 16) | ciphertext[i];
+    }
+
+    return result;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Marks num_unknown_bits distinct random bits of the key state as unknown.
+ */
+static void choose_unknown_bits(const size_t num_unknown_bits,
+                                uint16_t unknown_mask[SPARX64_NUM_KEY_WORDS]) {
+    memset(unknown_mask, 0, SPARX64_KEY_LENGTH);
+    size_t num_chosen_bits = 0;
+
+    while (num_chosen_bits < num_unknown_bits) {
+        uint8_t position;
+        get_random(&position, 1);
+        position &= NUM_KEY_BITS - 1;
+
+        const uint16_t bit = (uint16_t)(1 << (position % 16));
+
+        if (!(unknown_mask[position / 16] & bit)) {
+            unknown_mask[position / 16] |= bit;
+            num_chosen_bits++;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+static double run_key(const experiment_ctx_t* ctx, ThreadPool& pool) {
+    uint16_t master_key[SPARX64_NUM_KEY_WORDS];
+    get_random((uint8_t*)master_key, SPARX64_KEY_LENGTH);
+
+    sparx64_context_t cipher_ctx;
+    sparx_key_schedule(&cipher_ctx, master_key);
+
+    sparx64_brute_force_problem_t problem;
+    problem.row = ctx->row;
+    sparx_get_key_state(&cipher_ctx, ctx->row, problem.key_state);
+    choose_unknown_bits(ctx->num_unknown_bits, problem.unknown_mask);
+
+    for (size_t i = 0; i < ctx->num_pairs; ++i) {
+        problem.plaintexts.push_back(get_random_state());
+        problem.ciphertexts.push_back(
+            encrypt(&cipher_ctx, problem.plaintexts.back()));
+    }
+
+    std::vector<sparx64_master_key_t> keys;
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t num_candidates = sparx_brute_force(&problem, pool, keys);
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    bool has_found_key = false;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        has_found_key |=
+            !memcmp(keys[i].words, master_key, SPARX64_KEY_LENGTH);
+    }
+
+    printf("%12" PRIu64 " candidates, %4zu consistent, %s in %8.2f s\n",
+        num_candidates, keys.size(),
+        has_found_key ? "found" : "missed", seconds);
+
+    if (!has_found_key) {
+        fprintf(stderr, "The correct key was not found\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return (double)num_candidates / seconds;
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    double sum_keys_per_second = 0;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        printf("Key %4zu: ", i);
+        sum_keys_per_second += run_key(ctx, pool);
+        fflush(stdout);
+    }
+
+    const double keys_per_second = sum_keys_per_second / ctx->num_keys;
+    printf("Throughput: %.0f keys/s (2^%.2f)\n",
+        keys_per_second, log2(keys_per_second));
+    printf("Time for 2^%zu keys: %.2f s\n", ctx->num_unknown_bits,
+        pow(2, ctx->num_unknown_bits) / keys_per_second);
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Brute Force");
+    parser.helpString("Searches <u> unknown bits of the key state at row <r> of the subkeys of SPARX-64/128 exhaustively with <p> known pairs for <k> keys and measures the throughput.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-u", "--num_unknown_bits", 1, false);
+    parser.addArgument("-r", "--row", 1);
+    parser.addArgument("-p", "--num_pairs", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->num_unknown_bits = parser.retrieveAsInt("num_unknown_bits");
+
+        if (parser.count("row")) {
+            ctx->row = parser.retrieveAsInt("row");
+        }
+
+        if (parser.count("num_pairs")) {
+            ctx->num_pairs = parser.retrieveAsInt("num_pairs");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_unknown_bits > SPARX64_BRUTE_FORCE_MAX_NUM_UNKNOWN_BITS) {
+        fprintf(stderr, "Number of unknown bits must be at most %d\n",
+            SPARX64_BRUTE_FORCE_MAX_NUM_UNKNOWN_BITS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->row > SPARX64_NUM_BRANCHES * SPARX64_NUM_STEPS) {
+        fprintf(stderr, "Row must be in [0, %d]\n",
+            SPARX64_NUM_BRANCHES * SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs == 0) {
+        fprintf(stderr, "Number of pairs must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys         %8zu\n", ctx->num_keys);
+    printf("#Unknown bits %8zu\n", ctx->num_unknown_bits);
+    printf("Row           %8zu\n", ctx->row);
+    printf("#Pairs        %8zu\n", ctx->num_pairs);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
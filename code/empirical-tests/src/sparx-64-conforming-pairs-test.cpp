@@ -0,0 +1,479 @@
+/**
+ * Counts right pairs of a CryptoSMT characteristic of SPARX-64 over <s>
+ * steps from pairs that conform to its first <r> rounds by construction.
+ *
+ * For each of <k> random keys, <t> plaintexts P are generated on all
+ * threads s.t. (P, P ^ alpha) follows the first <r> rounds (at most one
+ * step) of the trail under the known key (see sparx64_conforming.h). The
+ * pairs are encrypted in batches, and the tool counts those with the
+ * difference of the trail after <s> steps. Since the first rounds hold with
+ * probability one, the measured probability p' relates to that of random
+ * pairs by p = p' 2^{-w}, where w is the weight of the first rounds. This
+ * gain of 2^w in pairs costs only the sampling of the branches, whose
+ * average number is reported.
+ *
+ * With --num_neutral_samples, the tool further estimates for each
+ * plaintext bit the probability over all keys that flipping it keeps a
+ * conforming pair conforming. Bits that are neutral for all keys can build
+ * conforming structures without knowing the key.
+ *
+ * With --neutral_mask, the tool generates only one conforming plaintext per
+ * structure, and expands it over the (at most six) bits of the mask without
+ * the key. It reports the fraction of the pairs from these structures that
+ * conform, which is one if all bits are neutral for the key; otherwise, p
+ * cannot be derived from p' and is not printed.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_conforming.h"
+#include "ciphers/sparx64_trail.h"
+#include "ciphers/sparx64_xdp.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 256
+#define NEUTRAL_THRESHOLD 0.99
+
+// Structures must tile the batches of SPARX64_BATCH_SIZE = 2^6 plaintexts
+#define MAX_NUM_STRUCTURE_BITS 6
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string trail_path;
+    size_t   trail_index = 0;
+    sparx64_trail_t trail;
+    size_t   num_keys = 0;
+    size_t   num_pairs_per_key = 0;
+    size_t   num_rounds = SPARX64_CONFORMING_MAX_NUM_ROUNDS;
+    size_t   num_steps = 0;
+    size_t   num_neutral_samples = 0;
+    uint64_t neutral_mask = 0;
+    size_t   num_structure_states = 1;
+    uint64_t delta = 0;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint64_t to_state(const uint16_t words[SPARX64_NUM_STATE_WORDS]) {
+    uint64_t state = 0;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        state = (state << 16) | words[i];
+    }
+
+    return state;
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of right pairs among the pairs of the structures in
+ * batches [from, to), and adds the number of conforming pairs among them to
+ * num_conforming if there is a neutral mask. The generator holds the
+ * sampling statistics of the thread. Sets has_failed and stops if a
+ * conforming plaintext could not be sampled.
+ */
+static uint64_t count_right_pairs(const key_ctx_t* key_ctx,
+                                  sparx64_conforming_generator_t* generator,
+                                  const size_t from,
+                                  const size_t to,
+                                  uint64_t* num_conforming,
+                                  bool* has_failed) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    const uint64_t alpha = sparx_conforming_get_alpha(generator);
+    const size_t inactive_branches = sparx_get_inactive_branches(alpha);
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+    uint64_t count = 0;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_pairs = SPARX64_BATCH_SIZE;
+        uint64_t seed = splitmix64(key_ctx->seed + b);
+
+        if (first + num_pairs > ctx->num_pairs_per_key) {
+            num_pairs = ctx->num_pairs_per_key - first;
+        }
+
+        for (size_t j = 0; j < num_pairs; j += ctx->num_structure_states) {
+            uint64_t state;
+
+            if (!sparx_conforming_next(generator, &seed, &state)) {
+                *has_failed = true;
+                return count;
+            }
+
+            sparx_conforming_get_structure(state, ctx->neutral_mask,
+                ctx->num_structure_states, p + j);
+        }
+
+        // Fills the tail of the last batch, which is encrypted but not
+        // counted
+        for (size_t j = num_pairs; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = p[num_pairs - 1];
+        }
+
+        if (ctx->neutral_mask != 0) {
+            for (size_t j = 0; j < num_pairs; ++j) {
+                *num_conforming += sparx_conforming_check(generator, p[j]);
+            }
+        }
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p_[j] = p[j] ^ alpha;
+        }
+
+        sparx_load_batch(&batch,  p);
+        sparx_load_batch(&batch_, p_);
+        sparx_encrypt_steps_pair_batch(&key_ctx->cipher_ctx, &batch, &batch_,
+            inactive_branches, 1, ctx->num_steps);
+        sparx_store_batch(&batch,  p);
+        sparx_store_batch(&batch_, p_);
+
+        for (size_t j = 0; j < num_pairs; ++j) {
+            count += (p[j] ^ p_[j]) == ctx->delta;
+        }
+    }
+
+    return count;
+}
+
+// ---------------------------------------------------------
+
+static void exit_with_sampling_failure(const experiment_ctx_t* ctx,
+                                       const size_t key_index) {
+    fprintf(stderr, "Could not sample a pair that conforms to the first %zu "
+        "rounds within %d samples per branch for key %zu\n",
+        ctx->num_rounds, SPARX64_CONFORMING_MAX_NUM_SAMPLES, key_index);
+    exit(EXIT_FAILURE);
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    const size_t num_batches =
+        (ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    uint64_t sum_counts = 0;
+    uint64_t sum_conforming = 0;
+    uint64_t sum_samples[SPARX64_NUM_BRANCHES] = { 0, 0 };
+    double sum_neutral[64] = { 0 };
+    int weights[SPARX64_NUM_BRANCHES] = { 0, 0 };
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        key_ctx_t key_ctx;
+        key_ctx.ctx = ctx;
+
+        uint8_t key[SPARX64_KEY_LENGTH];
+        get_random(key, SPARX64_KEY_LENGTH);
+        sparx_key_schedule(&key_ctx.cipher_ctx, key);
+        get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+        std::vector<sparx64_conforming_generator_t> generators(
+            pool.get_num_threads());
+
+        for (size_t t = 0; t < generators.size(); ++t) {
+            sparx_conforming_init(&generators[t], &key_ctx.cipher_ctx,
+                ctx->trail, ctx->num_rounds);
+        }
+
+        weights[0] = generators[0].weights[0];
+        weights[1] = generators[0].weights[1];
+
+        std::vector<uint64_t> thread_counts(pool.get_num_threads(), 0);
+        std::vector<uint64_t> thread_conforming(pool.get_num_threads(), 0);
+        std::vector<uint8_t> thread_failures(pool.get_num_threads(), 0);
+        const auto start = std::chrono::steady_clock::now();
+
+        pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+            [&](const size_t thread_index, const size_t from, const size_t to) {
+                // Does not sample again after a failure
+                if (thread_failures[thread_index]) {
+                    return;
+                }
+
+                bool has_failed = false;
+                thread_counts[thread_index] += count_right_pairs(&key_ctx,
+                    &generators[thread_index], from, to,
+                    &thread_conforming[thread_index], &has_failed);
+                thread_failures[thread_index] = has_failed;
+            });
+
+        const auto end = std::chrono::steady_clock::now();
+        uint64_t count = 0;
+
+        for (size_t t = 0; t < generators.size(); ++t) {
+            if (thread_failures[t]) {
+                exit_with_sampling_failure(ctx, i);
+            }
+
+            count += thread_counts[t];
+            sum_conforming += thread_conforming[t];
+
+            for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+                sum_samples[b] += generators[t].num_samples[b];
+            }
+        }
+
+        sum_counts += count;
+        printf("Key %4zu: %10" PRIu64 " in %.2f s\n", i, count,
+            std::chrono::duration<double>(end - start).count());
+        fflush(stdout);
+
+        if (ctx->num_neutral_samples > 0) {
+            double probabilities[64];
+            uint64_t seed = splitmix64(key_ctx.seed + num_batches);
+            if (!sparx_conforming_get_neutral_bits(&generators[0], &seed,
+                    ctx->num_neutral_samples, probabilities)) {
+                exit_with_sampling_failure(ctx, i);
+            }
+
+            for (size_t bit = 0; bit < 64; ++bit) {
+                sum_neutral[bit] += probabilities[bit];
+            }
+        }
+    }
+
+    const double num_pairs = (double)ctx->num_keys * ctx->num_pairs_per_key;
+    const int gain = weights[0] + weights[1];
+
+    printf("Weight of rounds 1-%zu: %d + %d\n", ctx->num_rounds, weights[0],
+        weights[1]);
+    printf("Samples/pair:         %.2f + %.2f\n",
+        sum_samples[0] / num_pairs, sum_samples[1] / num_pairs);
+
+    // Without a neutral mask, all pairs conform by construction
+    const bool do_all_conform = (ctx->neutral_mask == 0)
+        || (sum_conforming == ctx->num_keys * ctx->num_pairs_per_key);
+
+    if (ctx->neutral_mask != 0) {
+        printf("Conforming pairs:     %.4f\n", sum_conforming / num_pairs);
+    }
+
+    if (sum_counts == 0) {
+        printf("log2(p'):             -inf\n");
+    } else {
+        const double log2_probability = log2(sum_counts / num_pairs);
+        printf("log2(p'):             %.2f\n", log2_probability);
+
+        // p' mixes conforming pairs with others of unknown probability
+        if (do_all_conform) {
+            printf("log2(p) = log2(p') - %d: %.2f\n", gain,
+                log2_probability - gain);
+        } else {
+            printf("log2(p):              n/a, not all pairs conform\n");
+        }
+    }
+
+    if (ctx->num_neutral_samples == 0) {
+        return;
+    }
+
+    uint64_t neutral_mask = 0;
+    printf("%3s %9s\n", "Bit", "Neutral");
+
+    for (size_t bit = 0; bit < 64; ++bit) {
+        const double probability = sum_neutral[bit] / ctx->num_keys;
+
+        if (probability >= NEUTRAL_THRESHOLD) {
+            neutral_mask |= 1ULL << bit;
+        }
+
+        if (probability < 1) {
+            printf("%3zu %9.4f\n", bit, probability);
+        }
+    }
+
+    printf("Neutral bits (>= %.2f): %016" PRIx64 " (%d)\n", NEUTRAL_THRESHOLD,
+        neutral_mask, __builtin_popcountll(neutral_mask));
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void load_trail(experiment_ctx_t* ctx) {
+    std::vector<sparx64_trail_t> trails;
+
+    if (!sparx_read_trails(ctx->trail_path.c_str(), trails)) {
+        fprintf(stderr, "Could not read trails from %s\n",
+            ctx->trail_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->trail_index >= trails.size()) {
+        fprintf(stderr, "%s contains only %zu trails\n",
+            ctx->trail_path.c_str(), trails.size());
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->trail = trails[ctx->trail_index];
+    const size_t num_trail_rounds = sparx_get_num_trail_rounds(ctx->trail);
+
+    if (ctx->num_steps == 0) {
+        ctx->num_steps = num_trail_rounds / SPARX64_NUM_ROUNDS_PER_STEP;
+    }
+
+    if ((ctx->num_steps == 0)
+        || (ctx->num_steps * SPARX64_NUM_ROUNDS_PER_STEP > num_trail_rounds)) {
+        fprintf(stderr, "Trail %zu has %zu rounds, too few for %zu steps\n",
+            ctx->trail_index, num_trail_rounds,
+            (ctx->num_steps == 0) ? (size_t)1 : ctx->num_steps);
+        exit(EXIT_FAILURE);
+    }
+
+    sparx64_conforming_generator_t generator;
+    sparx64_context_t cipher_ctx;
+    uint8_t key[SPARX64_KEY_LENGTH] = { 0 };
+    sparx_key_schedule(&cipher_ctx, key);
+
+    if (!sparx_conforming_init(&generator, &cipher_ctx, ctx->trail,
+                               ctx->num_rounds)) {
+        fprintf(stderr, "The first %zu rounds of trail %zu are invalid\n",
+            ctx->num_rounds, ctx->trail_index);
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->delta = to_state(
+        ctx->trail.rows[ctx->num_steps * SPARX64_NUM_ROUNDS_PER_STEP]
+            .difference);
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Conforming-Pairs Test");
+    parser.helpString("Counts for <k> random keys and <t> pairs that conform to the first <r> rounds of a CryptoSMT characteristic of SPARX-64/128 how many follow it over <s> steps.");
+    parser.addArgument("-i", "--input", 1, false);
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-t", "--num_pairs", 1, false);
+    parser.addArgument("-n", "--trail_index", 1);
+    parser.addArgument("-r", "--num_rounds", 1);
+    parser.addArgument("-s", "--num_steps", 1);
+    parser.addArgument("--num_neutral_samples", 1);
+    parser.addArgument("--neutral_mask", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->trail_path = parser.retrieve<std::string>("input");
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->num_pairs_per_key = parser.retrieveAsLong("num_pairs");
+
+        if (parser.count("trail_index")) {
+            ctx->trail_index = parser.retrieveAsInt("trail_index");
+        }
+
+        if (parser.count("num_rounds")) {
+            ctx->num_rounds = parser.retrieveAsInt("num_rounds");
+        }
+
+        if (parser.count("num_steps")) {
+            ctx->num_steps = parser.retrieveAsInt("num_steps");
+        }
+
+        if (parser.count("num_neutral_samples")) {
+            ctx->num_neutral_samples =
+                parser.retrieveAsLong("num_neutral_samples");
+        }
+
+        if (parser.count("neutral_mask")) {
+            ctx->neutral_mask = strtoull(
+                parser.retrieve<std::string>("neutral_mask").c_str(), NULL, 16);
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs_per_key == 0) {
+        fprintf(stderr, "Number of pairs must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_rounds == 0)
+        || (ctx->num_rounds > SPARX64_CONFORMING_MAX_NUM_ROUNDS)) {
+        fprintf(stderr, "Number of rounds must be in [1, %d]\n",
+            SPARX64_CONFORMING_MAX_NUM_ROUNDS);
+        exit(EXIT_FAILURE);
+    }
+
+    const int num_structure_bits = __builtin_popcountll(ctx->neutral_mask);
+
+    if (num_structure_bits > MAX_NUM_STRUCTURE_BITS) {
+        fprintf(stderr, "Neutral mask must have at most %d bits\n",
+            MAX_NUM_STRUCTURE_BITS);
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->num_structure_states = (size_t)1 << num_structure_bits;
+    load_trail(ctx);
+
+    printf("Trail      %s #%zu\n", ctx->trail_path.c_str(), ctx->trail_index);
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key %8zu\n", ctx->num_pairs_per_key);
+    printf("#Rounds    %8zu\n", ctx->num_rounds);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("Weight     %8d\n", ctx->trail.weight);
+    printf("Alpha      %016" PRIx64 "\n", to_state(ctx->trail.rows[0].difference));
+    printf("Delta      %016" PRIx64 "\n", ctx->delta);
+
+    if (ctx->neutral_mask != 0) {
+        printf("Neutral    %016" PRIx64 "\n", ctx->neutral_mask);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * Estimates the probability of a differential (<alpha> -> <delta>) of
+ * SPARX-64 over <r> rounds from the sum of the probabilities of all of its
+ * characteristics with a weight of at most <w>. Reports the number of
+ * characteristics and their contribution per weight.
+ *
+ * With --num_texts <t>, also reports the number of right pairs that
+ * sparx-64-multi-step-forwards-test should find for <k> keys and <t> pairs
+ * per key.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_cluster.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define MAX_WEIGHT 255
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    cluster_problem_t problem;
+    size_t num_keys = 1;
+    size_t num_texts_per_key = 0;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+// Printing
+// ---------------------------------------------------------
+
+static void print_log2(const double value) {
+    if (value == 0) {
+        printf("%-12s", "0");
+    } else {
+        printf("2^%-10.2f", log2(value));
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_result(const experiment_ctx_t* ctx,
+                         const cluster_result_t& result) {
+    printf("Weight  #Trails     Probability Total\n");
+    double total = 0;
+
+    for (size_t w = 0; w < result.num_trails.size(); ++w) {
+        if (result.num_trails[w] == 0) {
+            continue;
+        }
+
+        const double probability = result.num_trails[w] * pow(2, -(double)w);
+        total += probability;
+
+        printf("%-7zu %-11.0f ", w, result.num_trails[w]);
+        print_log2(probability);
+        print_log2(total);
+        printf("\n");
+    }
+
+    printf("Probability ");
+    print_log2(cluster_get_probability(result));
+    printf("\n");
+
+    if (ctx->num_texts_per_key > 0) {
+        const double num_texts =
+            (double)ctx->num_keys * (double)ctx->num_texts_per_key;
+        printf("Expected right pairs of %.0f: %.2f\n", num_texts,
+            num_texts * cluster_get_probability(result));
+    }
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+static void run_experiment(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    cluster_result_t result;
+
+    const auto start = std::chrono::steady_clock::now();
+    cluster_estimate(ctx->problem, pool, &result);
+    const auto end = std::chrono::steady_clock::now();
+
+    for (size_t s = 0; s < result.num_states.size(); ++s) {
+        printf("States before step %zu: %zu\n", s, result.num_states[s]);
+    }
+
+    print_result(ctx, result);
+    printf("Time: %.2f s\n",
+        std::chrono::duration<double>(end - start).count());
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Differential-Cluster");
+    parser.helpString("Estimates the probability of a differential (<alpha> -> <delta>) of SPARX-64 over <r> rounds from all characteristics with weight at most <w>.");
+    parser.addArgument("-r", "--num_rounds", 1, false);
+    parser.addArgument("-a", "--alpha", 1, false);
+    parser.addArgument("-d", "--delta", 1, false);
+    parser.addArgument("-w", "--max_weight", 1, false);
+    parser.addArgument("-k", "--num_keys", 1);
+    parser.addArgument("-t", "--num_texts", 1);
+
+    cluster_problem_t& problem = ctx->problem;
+
+    try {
+        parser.parse(argc, argv);
+
+        problem.num_rounds = parser.retrieveAsInt("num_rounds");
+        problem.max_weight = parser.retrieveAsInt("max_weight");
+        problem.alpha = strtoull(
+            parser.retrieve<std::string>("alpha").c_str(), NULL, 16);
+        problem.delta = strtoull(
+            parser.retrieve<std::string>("delta").c_str(), NULL, 16);
+
+        if (parser.count("num_keys")) {
+            ctx->num_keys = parser.retrieveAsInt("num_keys");
+        }
+
+        if (parser.count("num_texts")) {
+            ctx->num_texts_per_key = parser.retrieveAsInt("num_texts");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if ((problem.num_rounds == 0)
+        || (problem.num_rounds > SPARX64_NUM_ROUNDS)) {
+        fprintf(stderr, "Number of rounds must be in [1, %d]\n",
+            SPARX64_NUM_ROUNDS);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((problem.max_weight < 0) || (problem.max_weight > MAX_WEIGHT)) {
+        fprintf(stderr, "Maximal weight must be in [0, %d]\n", MAX_WEIGHT);
+        exit(EXIT_FAILURE);
+    }
+
+    if (problem.alpha == 0) {
+        fprintf(stderr, "Alpha must not be zero\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Rounds     %8zu\n", problem.num_rounds);
+    printf("Max. weight %8d\n", problem.max_weight);
+    printf("Alpha       %016" PRIx64 "\n", problem.alpha);
+    printf("Delta       %016" PRIx64 "\n", problem.delta);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiment(&ctx);
+    return 0;
+}
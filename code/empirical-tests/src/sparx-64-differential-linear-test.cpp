@@ -0,0 +1,311 @@
+/**
+ * Estimates the correlations of differential-linear approximations
+ * (alpha -> v) over <s> steps of SPARX-64 for <k> random keys from <t>
+ * random pairs (P, P ^ alpha) per key.
+ *
+ * Pairs are encrypted in batches on all threads as in the forwards test.
+ * Instead of comparing C ^ C' with an output difference, the parity of
+ * <v, C ^ C'> is accumulated for all output masks v given with -m on the
+ * same pairs, with the native popcount. The tool reports per key and mask
+ * the correlation with its 95% confidence interval 1.96 sqrt((1 - c^2)/t),
+ * and over all keys the average correlation with the 95% confidence
+ * interval of the mean over the keys, which includes the variation of the
+ * correlation between keys.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/convert.h"
+#include "utils/parity.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_parity;
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+using utils::to_uint64;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+
+// Quantile of the standard normal distribution for 95% confidence
+#define Z_95 1.96
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t num_keys = 0;
+    size_t num_steps = 0;
+    size_t num_pairs_per_key = 0;
+    uint8_t alpha[8];
+    std::vector<uint64_t> masks;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Adds to num_ones[m] the number of pairs in batches [from, to) for which
+ * the output mask m has parity one on the ciphertext difference.
+ */
+static void count_parities(const key_ctx_t* key_ctx,
+                           const size_t from,
+                           const size_t to,
+                           std::vector<uint64_t>& num_ones) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    const uint64_t alpha = to_uint64(ctx->alpha);
+    const size_t inactive_branches = sparx_get_inactive_branches(alpha);
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    uint64_t c[SPARX64_BATCH_SIZE];
+    uint64_t c_[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_pairs = SPARX64_BATCH_SIZE;
+
+        if (first + num_pairs > ctx->num_pairs_per_key) {
+            num_pairs = ctx->num_pairs_per_key - first;
+        }
+
+        // P = random, P' = P xor alpha
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = splitmix64(key_ctx->seed + first + j);
+            p_[j] = p[j] ^ alpha;
+        }
+
+        sparx_load_batch(&batch,  p);
+        sparx_load_batch(&batch_, p_);
+        sparx_encrypt_steps_pair_batch(&key_ctx->cipher_ctx, &batch, &batch_,
+            inactive_branches, 1, ctx->num_steps);
+        sparx_store_batch(&batch,  c);
+        sparx_store_batch(&batch_, c_);
+
+        for (size_t j = 0; j < num_pairs; ++j) {
+            c[j] ^= c_[j];
+        }
+
+        for (size_t m = 0; m < ctx->masks.size(); ++m) {
+            const uint64_t v = ctx->masks[m];
+            uint64_t count = 0;
+
+            for (size_t j = 0; j < num_pairs; ++j) {
+                count += get_parity(c[j], v);
+            }
+
+            num_ones[m] += count;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the correlation of every output mask under a random key into
+ * correlations.
+ */
+static void run_key(const experiment_ctx_t* ctx,
+                    ThreadPool& pool,
+                    std::vector<double>& correlations) {
+    key_ctx_t key_ctx;
+    key_ctx.ctx = ctx;
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    get_random(key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&key_ctx.cipher_ctx, key);
+    get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+    const size_t num_masks = ctx->masks.size();
+    const size_t num_batches =
+        (ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    std::vector<std::vector<uint64_t> > thread_num_ones(
+        pool.get_num_threads(), std::vector<uint64_t>(num_masks, 0));
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            count_parities(&key_ctx, from, to, thread_num_ones[thread_index]);
+        });
+
+    correlations.assign(num_masks, 0);
+
+    for (size_t m = 0; m < num_masks; ++m) {
+        uint64_t num_ones = 0;
+
+        for (size_t t = 0; t < thread_num_ones.size(); ++t) {
+            num_ones += thread_num_ones[t][m];
+        }
+
+        correlations[m] = 1.0 - 2.0 * (double)num_ones
+            / (double)ctx->num_pairs_per_key;
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_log2(const double value) {
+    if (value == 0) {
+        printf(" %9s", "-inf");
+    } else {
+        printf(" %9.2f", log2(value));
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    const size_t num_masks = ctx->masks.size();
+    const double num_pairs = (double)ctx->num_pairs_per_key;
+    std::vector<double> sum_correlations(num_masks, 0);
+    std::vector<double> sum_squared_correlations(num_masks, 0);
+    std::vector<double> correlations;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run_key(ctx, pool, correlations);
+        const auto end = std::chrono::steady_clock::now();
+
+        printf("Key %4zu:", i);
+
+        for (size_t m = 0; m < num_masks; ++m) {
+            const double c = correlations[m];
+            printf(" %+.6f +- %.6f", c, Z_95 * sqrt((1 - c * c) / num_pairs));
+            sum_correlations[m] += c;
+            sum_squared_correlations[m] += c * c;
+        }
+
+        printf(" in %.2f s\n",
+            std::chrono::duration<double>(end - start).count());
+        fflush(stdout);
+    }
+
+    printf("%-16s %9s %9s %9s\n", "Output mask", "Avg cor", "+- 95%",
+        "log2|cor|");
+
+    const double num_keys = (double)ctx->num_keys;
+
+    for (size_t m = 0; m < num_masks; ++m) {
+        const double correlation = sum_correlations[m] / num_keys;
+
+        // Without several keys, only the sampling error is known
+        double interval = Z_95 * sqrt(
+            (1 - correlation * correlation) / num_pairs);
+
+        if (ctx->num_keys > 1) {
+            const double variance = (sum_squared_correlations[m]
+                - num_keys * correlation * correlation) / (num_keys - 1);
+            interval = Z_95 * sqrt(fmax(variance, 0) / num_keys);
+        }
+
+        printf("%016" PRIx64 " %+9.6f %9.6f", ctx->masks[m], correlation,
+            interval);
+        print_log2(fabs(correlation));
+        printf("\n");
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_masks(const std::vector<std::string>& values,
+                        std::vector<uint64_t>& masks) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        uint64_t mask;
+
+        if (sscanf(values[i].c_str(), "%" SCNx64, &mask) != 1) {
+            throw std::invalid_argument("masks must be hexadecimal");
+        }
+
+        masks.push_back(mask);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Differential-Linear Test");
+    parser.helpString("Estimates the correlations of differential-linear approximations from <alpha> to output masks <v> of <s> steps of SPARX-64 from <t> plaintext pairs for each of <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-a", "--alpha", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_pairs", 1, false);
+    parser.addArgument("-m", "--masks", '+', false);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        parser.retrieveUint8ArrayFromHexString("a", ctx->alpha, 8);
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_pairs_per_key = parser.retrieveAsLong("num_pairs");
+        parse_masks(parser.retrieve<std::vector<std::string> >("masks"),
+            ctx->masks);
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs_per_key == 0) {
+        fprintf(stderr, "Number of pairs must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key %8zu\n", ctx->num_pairs_per_key);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("#Masks     %8zu\n", ctx->masks.size());
+    printf("Alpha      %016" PRIx64 "\n", to_uint64(ctx->alpha));
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
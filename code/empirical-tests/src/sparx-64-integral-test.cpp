@@ -0,0 +1,285 @@
+/**
+ * Searches for balanced bits after 1 to <s> steps of SPARX-64 with
+ * structures of chosen plaintexts, for integral and higher-order
+ * differential distinguishers.
+ *
+ * A structure takes all 2^d values in the d active bits of the mask <m>,
+ * with random constant values in all other bits. For each of <k> random
+ * keys, <n> structures are encrypted; the 2^d texts of a structure are
+ * enumerated in Gray-code order with utils::StateIterator, in index ranges
+ * of whole batches over all threads. The XOR of all ciphertexts of a
+ * structure, i.e., its d-th order derivative, is accumulated after every
+ * step directly on the words of the batches. A bit is balanced after a step
+ * if its sum is zero in all structures of all keys. For a random bit, this
+ * happens with probability 2^{-kn}.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/convert.h"
+#include "utils/StateIterator.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::StateIterator;
+using utils::ThreadPool;
+using utils::to_uint64;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+#define MAX_NUM_ACTIVE_BITS 40
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t  num_keys = 0;
+    size_t  num_steps = 0;
+    size_t  num_structures_per_key = 1;
+    uint8_t mask[SPARX64_STATE_LENGTH];
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t constant;
+    size_t num_texts;
+} structure_ctx_t;
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Returns the XOR of the states of the first num_texts lanes of the batch.
+ */
+static uint64_t sum_batch(const sparx64_batch_t* batch,
+                          const size_t num_texts) {
+    uint64_t sum = 0;
+
+    for (size_t w = 0; w < SPARX64_NUM_STATE_WORDS; ++w) {
+        uint16_t word_sum = 0;
+
+        for (size_t j = 0; j < num_texts; ++j) {
+            word_sum ^= batch->words[w][j];
+        }
+
+        sum = (sum << 16) | word_sum;
+    }
+
+    return sum;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * XORs the sums after each step of the texts in batches [from, to) of the
+ * structure into sums[0..s-1].
+ */
+static void sum_batches(const structure_ctx_t* structure_ctx,
+                        const size_t from,
+                        const size_t to,
+                        std::vector<uint64_t>& sums) {
+    const experiment_ctx_t* ctx = structure_ctx->ctx;
+    StateIterator iterator(ctx->mask, SPARX64_STATE_LENGTH, true);
+    iterator.set_range(from * SPARX64_BATCH_SIZE, to * SPARX64_BATCH_SIZE);
+
+    const size_t constant_branches =
+        sparx_get_inactive_branches(to_uint64(ctx->mask));
+    uint64_t plaintexts[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t num_texts =
+            iterator.next_batch(plaintexts, SPARX64_BATCH_SIZE);
+
+        for (size_t j = 0; j < num_texts; ++j) {
+            plaintexts[j] |= structure_ctx->constant;
+        }
+
+        for (size_t j = num_texts; j < SPARX64_BATCH_SIZE; ++j) {
+            plaintexts[j] = structure_ctx->constant;
+        }
+
+        sparx_load_batch(&batch, plaintexts);
+
+        // The inactive branches of the mask are constant in the first step
+        sparx_encrypt_steps_structure_batch(&structure_ctx->cipher_ctx, &batch,
+            constant_branches, 1, 1);
+        sums[0] ^= sum_batch(&batch, num_texts);
+
+        for (size_t s = 2; s <= ctx->num_steps; ++s) {
+            sparx_encrypt_steps_batch(&structure_ctx->cipher_ctx, &batch, s, s);
+            sums[s - 1] ^= sum_batch(&batch, num_texts);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the sums after each step of a structure with random constant bits
+ * under the given key into sums.
+ */
+static void run_structure(structure_ctx_t* structure_ctx,
+                          ThreadPool& pool,
+                          std::vector<uint64_t>& sums) {
+    const experiment_ctx_t* ctx = structure_ctx->ctx;
+    const uint64_t mask = to_uint64(ctx->mask);
+    get_random((uint8_t*)&structure_ctx->constant,
+        sizeof(structure_ctx->constant));
+    structure_ctx->constant &= ~mask;
+
+    const size_t num_batches =
+        (structure_ctx->num_texts + SPARX64_BATCH_SIZE - 1)
+        / SPARX64_BATCH_SIZE;
+    std::vector<std::vector<uint64_t> > thread_sums(
+        pool.get_num_threads(), std::vector<uint64_t>(ctx->num_steps, 0));
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            sum_batches(structure_ctx, from, to, thread_sums[thread_index]);
+        });
+
+    sums.assign(ctx->num_steps, 0);
+
+    for (size_t t = 0; t < thread_sums.size(); ++t) {
+        for (size_t s = 0; s < ctx->num_steps; ++s) {
+            sums[s] ^= thread_sums[t][s];
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    structure_ctx_t structure_ctx;
+    structure_ctx.ctx = ctx;
+    structure_ctx.num_texts =
+        StateIterator(ctx->mask, SPARX64_STATE_LENGTH).get_num_states();
+
+    // Bit i of balanced[s] is set while bit i of all sums after step s + 1
+    // was zero
+    std::vector<uint64_t> balanced(ctx->num_steps, ~0ULL);
+    std::vector<uint64_t> sums;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        uint8_t key[SPARX64_KEY_LENGTH];
+        get_random(key, SPARX64_KEY_LENGTH);
+        sparx_key_schedule(&structure_ctx.cipher_ctx, key);
+
+        for (size_t n = 0; n < ctx->num_structures_per_key; ++n) {
+            const auto start = std::chrono::steady_clock::now();
+            run_structure(&structure_ctx, pool, sums);
+            const auto end = std::chrono::steady_clock::now();
+
+            printf("Key %4zu structure %4zu:", i, n);
+
+            for (size_t s = 0; s < ctx->num_steps; ++s) {
+                printf(" %016" PRIx64, sums[s]);
+                balanced[s] &= ~sums[s];
+            }
+
+            printf(" in %.2f s\n",
+                std::chrono::duration<double>(end - start).count());
+            fflush(stdout);
+        }
+    }
+
+    printf("%5s %-16s %9s\n", "Steps", "Balanced bits", "#Balanced");
+
+    for (size_t s = 0; s < ctx->num_steps; ++s) {
+        printf("%5zu %016" PRIx64 " %9d\n", s + 1, balanced[s],
+            __builtin_popcountll(balanced[s]));
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Integral Test");
+    parser.helpString("Finds the bits that sum to zero after up to <s> steps of SPARX-64 over structures of all values in the active bits of the mask <m>, for <n> structures under each of <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-m", "--mask", 1, false);
+    parser.addArgument("-n", "--num_structures", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        parser.retrieveUint8ArrayFromHexString("m", ctx->mask,
+            SPARX64_STATE_LENGTH);
+
+        if (parser.count("num_structures")) {
+            ctx->num_structures_per_key =
+                parser.retrieveAsLong("num_structures");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_structures_per_key == 0) {
+        fprintf(stderr, "Number of structures must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const int num_active_bits = __builtin_popcountll(to_uint64(ctx->mask));
+
+    if ((num_active_bits == 0) || (num_active_bits > MAX_NUM_ACTIVE_BITS)) {
+        fprintf(stderr, "Mask must have between 1 and %d active bits\n",
+            MAX_NUM_ACTIVE_BITS);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys             %8zu\n", ctx->num_keys);
+    printf("#Structures/Key   %8zu\n", ctx->num_structures_per_key);
+    printf("#Steps            %8zu\n", ctx->num_steps);
+    printf("#Active bits      %8d\n", num_active_bits);
+    printf("Mask      %016" PRIx64 "\n", to_uint64(ctx->mask));
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
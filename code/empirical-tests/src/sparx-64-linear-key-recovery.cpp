@@ -0,0 +1,309 @@
+/**
+ * Key recovery with a linear approximation (u -> v) over <s> steps of
+ * SPARX-64, extended by two rounds of step <s> + 1.
+ *
+ * v is a 32-bit mask on branch <b> at the input of step <s> + 1. For each of
+ * <k> random keys, <t> random known plaintexts are encrypted in batches on
+ * all threads and counted per value of the bits that the guess of the
+ * final-round key of branch <b> affects. The correlations of all guesses
+ * are then computed at once with the fast Walsh-Hadamard transform (see
+ * sparx64_linear_recovery.h). The tool reports the rank of the correct
+ * guess by absolute correlation, the number of other guesses with the same
+ * absolute correlation, the number of distinct absolute correlations, and
+ * the times of the counting and of the transforms. A key counts as a
+ * success only if the correct guess is ranked first and its absolute
+ * correlation is not shared by all guesses, which happens if the parity of
+ * v is linear in the key bits.
+ *
+ * With <s> = 0, the approximation is the identity, s.t. the correct guess
+ * has correlation one; this checks the partial decryption.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_linear_recovery.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+#define NUM_ROUNDS_APPENDED 2
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_keys = 0;
+    size_t   num_steps = 0;
+    size_t   num_texts_per_key = 0;
+    size_t   branch = 0;
+    uint64_t input_mask = 0;
+    uint32_t output_mask = 0;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+static void count_batches(const key_ctx_t* key_ctx,
+                          const size_t from,
+                          const size_t to,
+                          sparx64_linear_counter_t* counter) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    uint64_t plaintexts[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_texts = SPARX64_BATCH_SIZE;
+
+        if (first + num_texts > ctx->num_texts_per_key) {
+            num_texts = ctx->num_texts_per_key - first;
+        }
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            plaintexts[j] = splitmix64(key_ctx->seed + first + j);
+        }
+
+        sparx_load_batch(&batch, plaintexts);
+
+        if (ctx->num_steps > 0) {
+            sparx_encrypt_steps_batch(&key_ctx->cipher_ctx, &batch, 1,
+                ctx->num_steps);
+        }
+
+        for (size_t r = 1; r <= NUM_ROUNDS_APPENDED; ++r) {
+            sparx_encrypt_round_batch(&key_ctx->cipher_ctx, &batch,
+                ctx->num_steps * SPARX64_NUM_ROUNDS_PER_STEP + r);
+        }
+
+        sparx_linear_add_batch(counter, plaintexts, &batch, num_texts);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the rank of the correct guess and stores the number of distinct
+ * absolute correlations of all guesses into num_classes.
+ */
+static size_t run_key(const experiment_ctx_t* ctx,
+                      ThreadPool& pool,
+                      std::vector<sparx64_linear_counter_t>& counters,
+                      size_t* num_classes) {
+    key_ctx_t key_ctx;
+    key_ctx.ctx = ctx;
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    get_random(key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&key_ctx.cipher_ctx, key);
+    get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+    for (size_t t = 0; t < counters.size(); ++t) {
+        sparx_linear_init_counter(&counters[t], ctx->branch, ctx->input_mask,
+            ctx->output_mask);
+    }
+
+    const size_t num_batches =
+        (ctx->num_texts_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    const auto start = std::chrono::steady_clock::now();
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            count_batches(&key_ctx, from, to, &counters[thread_index]);
+        });
+
+    for (size_t t = 1; t < counters.size(); ++t) {
+        sparx_linear_merge(&counters[0], &counters[t]);
+    }
+
+    const auto counted = std::chrono::steady_clock::now();
+    std::vector<sparx64_linear_guess_t> ranking;
+    sparx_linear_rank_guesses(&counters[0], ctx->num_texts_per_key, pool,
+        ranking);
+    const auto ranked = std::chrono::steady_clock::now();
+
+    const uint16_t* subkeys = key_ctx.cipher_ctx.subkeys[
+        ctx->num_steps * SPARX64_NUM_BRANCHES + ctx->branch];
+    const uint32_t final_key = ((uint32_t)subkeys[2] << 16) | subkeys[3];
+    const uint32_t correct_guess = sparx_linear_compress(&counters[0],
+        final_key);
+    double correct_correlation = 0;
+
+    for (size_t i = 0; i < ranking.size(); ++i) {
+        if (ranking[i].guess == correct_guess) {
+            correct_correlation = ranking[i].correlation;
+        }
+    }
+
+    // Guesses that differ from the correct one only in bits that cancel out
+    // in A^{-1}, or that flip only the sign, have the same absolute
+    // correlation; they are counted as ties and not ranked before
+    size_t rank = 1;
+    size_t num_ties = 0;
+    *num_classes = 0;
+
+    for (size_t i = 0; i < ranking.size(); ++i) {
+        // Sorted by decreasing absolute correlation
+        if ((i == 0) || (fabs(ranking[i].correlation)
+                         != fabs(ranking[i - 1].correlation))) {
+            (*num_classes)++;
+        }
+
+        if (fabs(ranking[i].correlation) > fabs(correct_correlation)) {
+            rank++;
+        } else if ((fabs(ranking[i].correlation) == fabs(correct_correlation))
+                   && (ranking[i].guess != correct_guess)) {
+            num_ties++;
+        }
+    }
+
+    printf("Correct %+.6f, best %+.6f, rank %8zu, ties %6zu, classes %8zu, "
+        "counting %.2f s, transforms %.2f s\n",
+        correct_correlation, ranking[0].correlation, rank, num_ties,
+        *num_classes,
+        std::chrono::duration<double>(counted - start).count(),
+        std::chrono::duration<double>(ranked - counted).count());
+    return rank;
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    std::vector<sparx64_linear_counter_t> counters(pool.get_num_threads());
+
+    if (!sparx_linear_init_counter(&counters[0], ctx->branch, ctx->input_mask,
+                                   ctx->output_mask)) {
+        fprintf(stderr, "The output mask has more than %d active key bits\n",
+            SPARX64_LINEAR_RECOVERY_MAX_NUM_ACTIVE_BITS);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Active bits %08" PRIx32 " (%zu)\n", counters[0].active_mask,
+        counters[0].num_active_bits);
+
+    size_t num_successes = 0;
+    double sum_log2_ranks = 0;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        printf("Key %4zu: ", i);
+        size_t num_classes;
+        const size_t rank = run_key(ctx, pool, counters, &num_classes);
+        fflush(stdout);
+
+        // If all guesses have the same absolute correlation, none is
+        // distinguished
+        num_successes += (rank == 1) && (num_classes > 1);
+        sum_log2_ranks += log2((double)rank);
+    }
+
+    printf("Success rate:   %.4f (%zu/%zu)\n",
+        (double)num_successes / ctx->num_keys, num_successes, ctx->num_keys);
+    printf("Avg log2(rank): %.2f of %zu bits\n",
+        sum_log2_ranks / ctx->num_keys, counters[0].num_active_bits);
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Linear Key Recovery");
+    parser.helpString("Ranks all guesses of the active bits of the final-round key of branch <b> with a linear approximation <u> -> <v> over <s> steps and two more rounds of SPARX-64 from <t> known plaintexts for <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_texts", 1, false);
+    parser.addArgument("-u", "--input_mask", 1, false);
+    parser.addArgument("-v", "--output_mask", 1, false);
+    parser.addArgument("-b", "--branch", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_texts_per_key = parser.retrieveAsLong("num_texts");
+        ctx->input_mask = strtoull(
+            parser.retrieve<std::string>("input_mask").c_str(), NULL, 16);
+        ctx->output_mask = (uint32_t)strtoul(
+            parser.retrieve<std::string>("output_mask").c_str(), NULL, 16);
+
+        if (parser.count("branch")) {
+            ctx->branch = parser.retrieveAsInt("branch");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Two rounds of the following step must remain
+    if (ctx->num_steps >= SPARX64_NUM_STEPS) {
+        fprintf(stderr, "Number of steps must be in [0, %d]\n",
+            SPARX64_NUM_STEPS - 1);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_texts_per_key == 0) {
+        fprintf(stderr, "Number of texts must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->branch >= SPARX64_NUM_BRANCHES) {
+        fprintf(stderr, "Branch must be in [0, %d]\n",
+            SPARX64_NUM_BRANCHES - 1);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys       %8zu\n", ctx->num_keys);
+    printf("#Texts/Key  %8zu\n", ctx->num_texts_per_key);
+    printf("#Steps      %8zu\n", ctx->num_steps);
+    printf("Branch      %8zu\n", ctx->branch);
+    printf("Input mask  %016" PRIx64 "\n", ctx->input_mask);
+    printf("Output mask %08" PRIx32 "\n", ctx->output_mask);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
@@ -0,0 +1,289 @@
+/**
+ * Estimates the correlations of linear approximations (u -> v) over <s>
+ * steps of SPARX-64 for <k> random keys from <t> random known plaintexts
+ * per key.
+ *
+ * All mask pairs given with -m are evaluated on the same texts, s.t. the
+ * encryption is shared among them. Texts are encrypted in batches, and the
+ * parities are computed with the native popcount over the 64-bit states.
+ * Per mask pair, the tool reports the average correlation over all keys and
+ * the average squared correlation, which estimates the expected linear
+ * potential (ELP) of the linear hull. Note that the squared correlation of
+ * t random texts has an expected value of about 1/t even for a random
+ * permutation.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/parity.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_parity;
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    uint64_t input_mask;
+    uint64_t output_mask;
+} linear_masks_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t num_keys = 0;
+    size_t num_steps = 0;
+    size_t num_texts_per_key = 0;
+    std::vector<linear_masks_t> masks;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Adds to num_ones[m] the number of texts in batches [from, to) for which
+ * the approximation m has parity one.
+ */
+static void count_parities(const key_ctx_t* key_ctx,
+                           const size_t from,
+                           const size_t to,
+                           std::vector<uint64_t>& num_ones) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    uint64_t plaintexts[SPARX64_BATCH_SIZE];
+    uint64_t ciphertexts[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_texts = SPARX64_BATCH_SIZE;
+
+        if (first + num_texts > ctx->num_texts_per_key) {
+            num_texts = ctx->num_texts_per_key - first;
+        }
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            plaintexts[j] = splitmix64(key_ctx->seed + first + j);
+        }
+
+        sparx_load_batch(&batch, plaintexts);
+        sparx_encrypt_steps_batch(&key_ctx->cipher_ctx, &batch, 1,
+            ctx->num_steps);
+        sparx_store_batch(&batch, ciphertexts);
+
+        for (size_t m = 0; m < ctx->masks.size(); ++m) {
+            const uint64_t u = ctx->masks[m].input_mask;
+            const uint64_t v = ctx->masks[m].output_mask;
+            uint64_t count = 0;
+
+            for (size_t j = 0; j < num_texts; ++j) {
+                count += get_parity(plaintexts[j], u)
+                    ^ get_parity(ciphertexts[j], v);
+            }
+
+            num_ones[m] += count;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the correlation of every mask pair under a random key into
+ * correlations.
+ */
+static void run_key(const experiment_ctx_t* ctx,
+                    ThreadPool& pool,
+                    std::vector<double>& correlations) {
+    key_ctx_t key_ctx;
+    key_ctx.ctx = ctx;
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    get_random(key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&key_ctx.cipher_ctx, key);
+    get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+    const size_t num_masks = ctx->masks.size();
+    const size_t num_batches =
+        (ctx->num_texts_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    std::vector<std::vector<uint64_t> > thread_num_ones(
+        pool.get_num_threads(), std::vector<uint64_t>(num_masks, 0));
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            count_parities(&key_ctx, from, to, thread_num_ones[thread_index]);
+        });
+
+    correlations.assign(num_masks, 0);
+
+    for (size_t m = 0; m < num_masks; ++m) {
+        uint64_t num_ones = 0;
+
+        for (size_t t = 0; t < thread_num_ones.size(); ++t) {
+            num_ones += thread_num_ones[t][m];
+        }
+
+        correlations[m] = 1.0 - 2.0 * (double)num_ones
+            / (double)ctx->num_texts_per_key;
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_log2(const double value) {
+    if (value == 0) {
+        printf(" %9s", "-inf");
+    } else {
+        printf(" %9.2f", log2(value));
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    const size_t num_masks = ctx->masks.size();
+    std::vector<double> sum_correlations(num_masks, 0);
+    std::vector<double> sum_squared_correlations(num_masks, 0);
+    std::vector<double> correlations;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run_key(ctx, pool, correlations);
+        const auto end = std::chrono::steady_clock::now();
+
+        printf("Key %4zu:", i);
+
+        for (size_t m = 0; m < num_masks; ++m) {
+            printf(" %+.6f", correlations[m]);
+            sum_correlations[m] += correlations[m];
+            sum_squared_correlations[m] += correlations[m] * correlations[m];
+        }
+
+        printf(" in %.2f s\n",
+            std::chrono::duration<double>(end - start).count());
+        fflush(stdout);
+    }
+
+    printf("%-16s %-16s %9s %9s %9s\n", "Input mask", "Output mask",
+        "Avg cor", "log2|cor|", "log2 ELP");
+
+    for (size_t m = 0; m < num_masks; ++m) {
+        const double correlation = sum_correlations[m] / ctx->num_keys;
+        const double potential = sum_squared_correlations[m] / ctx->num_keys;
+        printf("%016" PRIx64 " %016" PRIx64 " %+9.6f",
+            ctx->masks[m].input_mask, ctx->masks[m].output_mask, correlation);
+        print_log2(fabs(correlation));
+        print_log2(potential);
+        printf("\n");
+    }
+
+    printf("Sampling floor of the ELP: 2^%.2f\n",
+        -log2((double)ctx->num_texts_per_key));
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_masks(const std::vector<std::string>& values,
+                        std::vector<linear_masks_t>& masks) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        linear_masks_t pair;
+
+        if (sscanf(values[i].c_str(), "%" SCNx64 ":%" SCNx64,
+                   &pair.input_mask, &pair.output_mask) != 2) {
+            throw std::invalid_argument("masks must be <input>:<output>");
+        }
+
+        masks.push_back(pair);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Linear Test");
+    parser.helpString("Estimates the correlations of linear approximations <input>:<output> of <s> steps of SPARX-64 from <t> known plaintexts for each of <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_texts", 1, false);
+    parser.addArgument("-m", "--masks", '+', false);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_texts_per_key = parser.retrieveAsLong("num_texts");
+        parse_masks(parser.retrieve<std::vector<std::string> >("masks"),
+            ctx->masks);
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_texts_per_key == 0) {
+        fprintf(stderr, "Number of texts must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Texts/Key %8zu\n", ctx->num_texts_per_key);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("#Masks     %8zu\n", ctx->masks.size());
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * Merges the partial results of an experiment that has been split with
+ * --shard i/n over several processes or machines into the final statistics.
+ * Checks that all shards stem from the same experiment (seed, parameters,
+ * and keys) and that every chunk of every key has been processed by exactly
+ * one of them.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include "utils/argparse.h"
+#include "utils/checkpoint.h"
+#include "utils/printing.h"
+
+using utils::checkpoint_key_t;
+using utils::checkpoint_t;
+using utils::print_hex;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    std::vector<std::string> input_paths;
+    std::string  output_path;
+    checkpoint_t result;
+} merge_ctx_t;
+
+// ---------------------------------------------------------
+// Merging
+// ---------------------------------------------------------
+
+static void read_shards(merge_ctx_t* ctx) {
+    for (size_t i = 0; i < ctx->input_paths.size(); ++i) {
+        const char* path = ctx->input_paths[i].c_str();
+        checkpoint_t shard;
+
+        if (!utils::read_checkpoint(&shard, path)) {
+            fprintf(stderr, "Could not read %s\n", path);
+            exit(EXIT_FAILURE);
+        }
+
+        if (i == 0) {
+            ctx->result = shard;
+            continue;
+        }
+
+        if (!utils::merge_checkpoint(&(ctx->result), shard)) {
+            fprintf(stderr, "%s does not belong to the experiment of %s\n",
+                path, ctx->input_paths[0].c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ctx->result.shard_index = 0;
+    ctx->result.num_shards = 1;
+}
+
+// ---------------------------------------------------------
+
+static size_t print_results(const merge_ctx_t* ctx) {
+    const checkpoint_t& result = ctx->result;
+    size_t num_missing_chunks = 0;
+    int64_t num_collisions = 0;
+
+    printf("Experiment %s\n", result.experiment.c_str());
+    printf("Seed       %016" PRIx64 "\n", result.seed);
+    printf("#Shards    %8zu\n", ctx->input_paths.size());
+    printf("#Keys      %8zu\n", result.num_keys);
+    printf("#Texts/Key %8zu\n", result.num_texts_per_key);
+
+    for (size_t i = 0; i < result.keys.size(); ++i) {
+        const checkpoint_key_t& key_state = result.keys[i];
+        print_hex("key", key_state.key.data(), key_state.key.size());
+        printf("%" PRId64 "\n", utils::get_total_count(key_state));
+        num_collisions += utils::get_total_count(key_state);
+
+        for (size_t j = 0; j < key_state.chunk_counts.size(); ++j) {
+            if (key_state.chunk_counts[j] == utils::CHECKPOINT_CHUNK_PENDING) {
+                num_missing_chunks++;
+            }
+        }
+    }
+
+    const double average_num_collisions =
+        (double)num_collisions / result.num_keys;
+    printf("Avg #pairs: %4f\n", average_num_collisions);
+    return num_missing_chunks;
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(merge_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Merge-Results");
+    parser.helpString("Merges the partial results of the shards of an experiment into the final statistics.");
+    parser.addArgument("-i", "--inputs", '+', false);
+    parser.addArgument("-o", "--output", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->input_paths =
+            parser.retrieve<std::vector<std::string> >("inputs");
+
+        if (parser.count("output")) {
+            ctx->output_path = parser.retrieve<std::string>("output");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    merge_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    read_shards(&ctx);
+
+    const size_t num_missing_chunks = print_results(&ctx);
+
+    if (!ctx.output_path.empty()
+        && !utils::write_checkpoint(&(ctx.result), ctx.output_path.c_str())) {
+        fprintf(stderr, "Could not write %s\n", ctx.output_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (num_missing_chunks > 0) {
+        fprintf(stderr, "%zu chunks are missing in the shards\n",
+            num_missing_chunks);
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -11,6 +11,13 @@
  * Outputs the number of such pairs and repeats this experiment for <#keys> 
  * random keys.
  * 
+ * With --bias_profile, also collects the bit and word statistics of the 
+ * differences of all pairs after each decrypted step, where "step i" means
+ * after decrypting i steps, and prints a bias heat map and suggested 
+ * truncated masks.
+ * 
+ * Rotational-XOR pairs are tested by sparx-64-rx-test.
+ * 
  * @author eik list
  * @author ralph ankele
  * @copyright see license.txt
@@ -22,18 +29,22 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <memory>
 #include <vector>
 
 #include "ciphers/sparx64.h"
 #include "utils/argparse.h"
+#include "utils/BiasProfile.h"
 #include "utils/convert.h"
 #include "utils/printing.h"
 #include "utils/xorshift1024.h"
 #include "utils/xor.h"
 
+using utils::BiasProfile;
 using utils::xor_difference;
 using utils::get_random;
 using utils::print_hex;
+using utils::to_uint64;
 using utils::to_uint8;
 
 // ---------------------------------------------------------
@@ -46,8 +57,9 @@ typedef struct {
     size_t   num_keys = 0;
     size_t   num_texts_per_key = 1L << 32;
     uint64_t num_collisions = 0;
-    bool     use_rotated_differences = 0;
     size_t   num_steps = 1;
+    bool     use_bias_profile = false;
+    size_t   num_suggested_masks = 5;
 } experiment_ctx_t;
 
 // ---------------------------------------------------------
@@ -83,12 +95,12 @@ static bool check_difference(const uint64_t* c1,
                              const uint64_t* c2,
                              const uint32_t delta_l,
                              const uint32_t delta_r){
-    const uint32_t* c1_l = (uint32_t*) (*c1 & 0xFFFFFFFF);
-    const uint32_t* c1_h = (uint32_t*) ((*c1 >> 32) & 0xFFFFFFFF);
-    const uint32_t* c2_l = (uint32_t*) (*c2 & 0xFFFFFFFF);
-    const uint32_t* c2_h = (uint32_t*) ((*c2 >> 32) & 0xFFFFFFFF);
-    return (((*c1_l ^ *c2_l) == delta_r) 
-         && ((*c1_h ^ *c2_h) == delta_l));
+    const uint32_t c1_l = (uint32_t) (*c1 & 0xFFFFFFFF);
+    const uint32_t c1_h = (uint32_t) ((*c1 >> 32) & 0xFFFFFFFF);
+    const uint32_t c2_l = (uint32_t) (*c2 & 0xFFFFFFFF);
+    const uint32_t c2_h = (uint32_t) ((*c2 >> 32) & 0xFFFFFFFF);
+    return (((c1_l ^ c2_l) == delta_r) 
+         && ((c1_h ^ c2_h) == delta_l));
 }
 
 // ---------------------------------------------------------
@@ -104,6 +116,36 @@ static void store(std::vector<uint64_t>& table,
     table.push_back(value);
 }
 
+// ---------------------------------------------------------
+
+/**
+ * Decrypts the ciphertexts step by step and adds their differences to the
+ * base plaintexts after each step to the profile. base_states[i] is the 
+ * base ciphertext after decrypting i+1 steps.
+ */
+static void add_to_profile(const experiment_ctx_t* ctx, 
+                           const sparx64_context_t* sparx_ctx, 
+                           const uint64_t* base_states, 
+                           const uint64_t ciphertexts[SPARX64_BATCH_SIZE], 
+                           const size_t num_ciphertexts, 
+                           BiasProfile* profile) {
+    uint64_t states[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx_load_batch(&batch, ciphertexts);
+
+    for (size_t i = 0; i < ctx->num_steps; ++i) {
+        const size_t step = ctx->num_steps - i;
+        sparx_decrypt_steps_batch(sparx_ctx, &batch, step, step);
+        sparx_store_batch(&batch, states);
+
+        for (size_t j = 0; j < num_ciphertexts; ++j) {
+            states[j] ^= base_states[i];
+        }
+
+        profile->add(i, states, num_ciphertexts);
+    }
+}
+
 // ---------------------------------------------------------
 // Experiment
 // ---------------------------------------------------------
@@ -117,6 +159,15 @@ static void run_experiment(experiment_ctx_t* ctx) {
     ctx->num_collisions = 0;
     sparx64_context_t sparx_ctx;
 
+    std::unique_ptr<BiasProfile> profile;
+    std::vector<uint64_t> base_states(ctx->num_steps);
+    uint64_t ciphertexts[SPARX64_BATCH_SIZE];
+    size_t num_ciphertexts = 0;
+
+    if (ctx->use_bias_profile) {
+        profile.reset(new BiasProfile(ctx->num_steps));
+    }
+
     //puts("Iterations #Collisions");
 
     for (size_t i = 0; i < ctx->num_keys; ++i) {
@@ -155,9 +206,21 @@ static void run_experiment(experiment_ctx_t* ctx) {
         memset(plaintext, 0, SPARX64_STATE_LENGTH);
         memset(base_plaintext, 0, SPARX64_STATE_LENGTH);
 
+        if (profile) {
+            memcpy(base_plaintext, base_ciphertext, SPARX64_STATE_LENGTH);
+
+            for (size_t s = 0; s < ctx->num_steps; ++s) {
+                const size_t step = ctx->num_steps - s;
+                sparx_decrypt_steps(
+                    &sparx_ctx, base_plaintext, base_plaintext, step, step
+                );
+                base_states[s] = to_uint64(base_plaintext);
+            }
+        }
+
         for (size_t j = 0; j < ctx->num_texts_per_key; ++j) {
             memcpy(ciphertext, base_ciphertext, SPARX64_STATE_LENGTH);
-            to_uint8(index, j);
+            to_uint8(index, (uint32_t)j);
             xor_bytes(ciphertext, index, 4);
             linear_layer(index, ciphertext);
 
@@ -165,6 +228,22 @@ static void run_experiment(experiment_ctx_t* ctx) {
             store(table, plaintext);
             sparx_decrypt_steps(&sparx_ctx, base_ciphertext, base_plaintext, ctx->num_steps);
             store(table_base, base_plaintext);
+
+            if (profile) {
+                ciphertexts[num_ciphertexts++] = to_uint64(ciphertext);
+
+                if (num_ciphertexts == SPARX64_BATCH_SIZE) {
+                    add_to_profile(ctx, &sparx_ctx, base_states.data(), 
+                        ciphertexts, num_ciphertexts, profile.get());
+                    num_ciphertexts = 0;
+                }
+            }
+        }
+
+        if (profile && (num_ciphertexts > 0)) {
+            add_to_profile(ctx, &sparx_ctx, base_states.data(), 
+                ciphertexts, num_ciphertexts, profile.get());
+            num_ciphertexts = 0;
         }
 
         for (size_t j = 0; j < ctx->num_texts_per_key; ++j) {
@@ -184,6 +263,11 @@ static void run_experiment(experiment_ctx_t* ctx) {
 
     double average_num_collisions = (double)ctx->num_collisions / ctx->num_keys;
     printf("Avg #collisions: %4f\n", average_num_collisions);
+
+    if (profile) {
+        profile->print_heat_map();
+        profile->print_suggested_masks(ctx->num_suggested_masks);
+    }
 }
 
 // ---------------------------------------------------------
@@ -198,6 +282,9 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
     parser.addArgument("-l", "--delta_l", 1, false);
     parser.addArgument("-r", "--delta_r", 1, false);
     parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_texts", 1);
+    parser.addArgument("--bias_profile", 0);
+    parser.addArgument("--num_masks", 1);
 
     try {
         parser.parse(argc, argv);
@@ -206,12 +293,22 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
         ctx->num_steps = parser.retrieveAsInt("s");
         ctx->delta_l = parser.retrieveUint32FromHexString("l");
         ctx->delta_r = parser.retrieveUint32FromHexString("r");
+        ctx->use_bias_profile = parser.retrieveAsFlag("bias_profile");
+
+        if (parser.count("num_texts")) {
+            ctx->num_texts_per_key = parser.retrieveAsLong("num_texts");
+        }
+
+        if (parser.count("num_masks")) {
+            ctx->num_suggested_masks = parser.retrieveAsInt("num_masks");
+        }
     } catch( ... ) { 
         fprintf(stderr, "%s\n", parser.usage().c_str());
         exit(EXIT_FAILURE);
     }
 
     printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Texts/Key %8zu\n", ctx->num_texts_per_key);
     printf("#Steps     %8zu\n", ctx->num_steps);
 
     print_hex("Delta L  ", (uint8_t*)&(ctx->delta_l), 4);
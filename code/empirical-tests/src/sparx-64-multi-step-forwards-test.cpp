@@ -13,20 +13,29 @@
 #include <string.h>
 
 #include <atomic> 
+#include <memory>
 #include <mutex>   // NOLINT(build/c++11)
+#include <string>
 #include <thread>  // NOLINT(build/c++11) 
 #include <vector> 
 
 #include "ciphers/sparx64.h"
 #include "utils/argparse.h"
+#include "utils/BiasProfile.h"
 #include "utils/convert.h"
+#include "utils/PairRecorder.h"
 #include "utils/printing.h"
 #include "utils/xorshift1024.h"
 #include "utils/xor.h"
 
+using utils::BiasProfile;
 using utils::xor_difference;
 using utils::get_random;
+using utils::pair_record_t;
 using utils::print_hex;
+using utils::to_uint64;
+using utils::to_uint8;
+using utils::PairRecorder;
 using utils::xorshift_prng_ctx_t;
 
 // ---------------------------------------------------------
@@ -45,6 +54,12 @@ typedef struct {
     size_t  num_steps = 0;
     uint8_t alpha[8];
     uint8_t delta[8];
+    size_t  key_index = 0;
+    std::string capture_path;
+    PairRecorder* recorder = NULL;
+    bool    use_bias_profile = false;
+    BiasProfile*  bias_profile = NULL;
+    size_t  num_suggested_masks = 5;
 } experiment_ctx_t;
 
 // ---------------------------------------------------------
@@ -66,6 +81,47 @@ static void do_print_quartet(const uint8_t* p,
 }
 #endif
 
+// ---------------------------------------------------------
+
+/**
+ * Hands the right pair (P, P', C, C') to the recorder of the thread,
+ * together with the differences of (P, P') after each step.
+ */
+static void record_pair(const experiment_ctx_t* ctx, 
+                        const sparx64_context_t* sparx_ctx,
+                        const size_t thread_index,
+                        const uint8_t* p, 
+                        const uint8_t* p_, 
+                        const uint8_t* c, 
+                        const uint8_t* c_) {
+    pair_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.key_index = (uint32_t)ctx->key_index;
+    record.num_texts = 4;
+    memcpy(record.texts[0], p,  SPARX64_STATE_LENGTH);
+    memcpy(record.texts[1], p_, SPARX64_STATE_LENGTH);
+    memcpy(record.texts[2], c,  SPARX64_STATE_LENGTH);
+    memcpy(record.texts[3], c_, SPARX64_STATE_LENGTH);
+
+    uint8_t state[SPARX64_STATE_LENGTH];
+    uint8_t state_[SPARX64_STATE_LENGTH];
+    memcpy(state,  p,  SPARX64_STATE_LENGTH);
+    memcpy(state_, p_, SPARX64_STATE_LENGTH);
+
+    // Right pairs are rare, so re-encrypting them step by step is cheap
+    for (size_t s = 1; 
+         (s <= ctx->num_steps) && (s <= PAIR_RECORD_MAX_DIFFERENCES); 
+         ++s) {
+        sparx_encrypt_steps(sparx_ctx, state,  state,  s, s);
+        sparx_encrypt_steps(sparx_ctx, state_, state_, s, s);
+        xor_difference(record.differences[s-1], state, state_, 
+            SPARX64_STATE_LENGTH);
+        record.num_differences++;
+    }
+
+    ctx->recorder->record(thread_index, record);
+}
+
 // ---------------------------------------------------------
 // Experiment
 // ---------------------------------------------------------
@@ -76,6 +132,7 @@ static void experiment_thread(const experiment_ctx_t* ctx,
                               std::mutex& mutex, 
 #endif
                               std::atomic<size_t>& counter, 
+                              const size_t thread_index, 
                               const size_t from, 
                               const size_t to) {
     uint8_t p[SPARX64_STATE_LENGTH];
@@ -105,7 +162,91 @@ static void experiment_thread(const experiment_ctx_t* ctx,
 #ifdef DEBUG
             do_print_quartet(p, p_, c, c_, mutex);
 #endif
+            if (ctx->recorder != NULL) {
+                record_pair(ctx, sparx_ctx, thread_index, p, p_, c, c_);
+            }
+
+            counter++;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+
+/**
+ * Same as experiment_thread, but encrypts the pairs in batches step by step
+ * and adds the differences after every step to the given profile.
+ */
+static void bias_profile_thread(const experiment_ctx_t* ctx, 
+                                sparx64_context_t* sparx_ctx,
+                                std::atomic<size_t>& counter, 
+                                BiasProfile* profile, 
+                                const size_t thread_index, 
+                                const size_t from, 
+                                const size_t to) {
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    uint64_t c[SPARX64_BATCH_SIZE];
+    uint64_t c_[SPARX64_BATCH_SIZE];
+    uint64_t differences[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+
+    const uint64_t alpha = to_uint64(ctx->alpha);
+    const uint64_t delta = to_uint64(ctx->delta);
+    const size_t inactive_branches = sparx_get_inactive_branches(alpha);
+
+    xorshift_prng_ctx_t xorshift_ctx;
+    xorshift1024_init(&xorshift_ctx);
+
+    for (size_t i = from; i < to; i += SPARX64_BATCH_SIZE) {
+        const size_t num_pairs = 
+            (to - i < SPARX64_BATCH_SIZE) ? to - i : SPARX64_BATCH_SIZE;
+
+        // P = random, P' = P xor alpha
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = xorshift1024_next(&xorshift_ctx);
+            p_[j] = p[j] ^ alpha;
+        }
+
+        sparx_load_batch(&batch,  p);
+        sparx_load_batch(&batch_, p_);
+
+        for (size_t s = 1; s <= ctx->num_steps; ++s) {
+            if (s == 1) {
+                sparx_encrypt_steps_pair_batch(sparx_ctx, &batch, &batch_,
+                    inactive_branches, 1, 1);
+            } else {
+                sparx_encrypt_steps_batch(sparx_ctx, &batch,  s, s);
+                sparx_encrypt_steps_batch(sparx_ctx, &batch_, s, s);
+            }
+
+            sparx_store_batch(&batch,  c);
+            sparx_store_batch(&batch_, c_);
+
+            for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+                differences[j] = c[j] ^ c_[j];
+            }
+
+            profile->add(s - 1, differences, num_pairs);
+        }
+
+        for (size_t j = 0; j < num_pairs; ++j) {
+            if (differences[j] != delta) {
+                continue;
+            }
+
             counter++;
+
+            if (ctx->recorder != NULL) {
+                uint8_t pair[4][SPARX64_STATE_LENGTH];
+                to_uint8(pair[0], p[j]);
+                to_uint8(pair[1], p_[j]);
+                to_uint8(pair[2], c[j]);
+                to_uint8(pair[3], c_[j]);
+                record_pair(ctx, sparx_ctx, thread_index, 
+                    pair[0], pair[1], pair[2], pair[3]);
+            }
         }
     }
 }
@@ -125,6 +266,11 @@ static void experiment_threading(const experiment_ctx_t* ctx,
     std::vector<std::thread> threads;
     threads.reserve(NUM_THREADS);
     std::atomic<std::size_t> counter(0);
+    std::vector<BiasProfile> profiles;
+
+    if (ctx->bias_profile != NULL) {
+        profiles.assign(NUM_THREADS, BiasProfile(ctx->num_steps));
+    }
 
     const size_t offset = ctx->num_texts_per_key / NUM_THREADS;
 
@@ -136,6 +282,19 @@ static void experiment_threading(const experiment_ctx_t* ctx,
             to = ctx->num_texts_per_key;
         }
 
+        if (ctx->bias_profile != NULL) {
+            threads.emplace_back(bias_profile_thread, 
+                std::ref(ctx), 
+                std::ref(sparx_ctx), 
+                std::ref(counter),
+                &(profiles[i]), 
+                i, 
+                from, 
+                to
+            );
+            continue;
+        }
+
         threads.emplace_back(experiment_thread, 
             std::ref(ctx), 
             std::ref(sparx_ctx), 
@@ -143,6 +302,7 @@ static void experiment_threading(const experiment_ctx_t* ctx,
             std::ref(mutex), 
 #endif
             std::ref(counter),
+            i, 
             from, 
             to
         );
@@ -152,6 +312,12 @@ static void experiment_threading(const experiment_ctx_t* ctx,
         thread.join();
     }
 
+    if (ctx->bias_profile != NULL) {
+        for (auto& profile : profiles) {
+            ctx->bias_profile->merge(profile);
+        }
+    }
+
     printf("Counter: %zu\n", counter.load());
 }
 
@@ -178,9 +344,38 @@ static void run_experiment(experiment_ctx_t* ctx) {
 // ---------------------------------------------------------
 
 static void run_experiments(experiment_ctx_t* ctx) {
+    std::unique_ptr<PairRecorder> recorder;
+    std::unique_ptr<BiasProfile> bias_profile;
+
+    if (!ctx->capture_path.empty()) {
+        recorder.reset(new PairRecorder(ctx->capture_path.c_str(), NUM_THREADS));
+
+        if (!recorder->is_open()) {
+            fprintf(stderr, "Could not open %s\n", ctx->capture_path.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        ctx->recorder = recorder.get();
+    }
+
+    if (ctx->use_bias_profile) {
+        bias_profile.reset(new BiasProfile(ctx->num_steps));
+        ctx->bias_profile = bias_profile.get();
+    }
+
     for (size_t i = 0; i < ctx->num_keys; ++i) {
+        ctx->key_index = i;
         run_experiment(ctx);
     }
+
+    ctx->recorder = NULL;
+    recorder.reset();
+
+    if (ctx->bias_profile != NULL) {
+        ctx->bias_profile->print_heat_map();
+        ctx->bias_profile->print_suggested_masks(ctx->num_suggested_masks);
+        ctx->bias_profile = NULL;
+    }
 }
 
 // ---------------------------------------------------------
@@ -196,6 +391,9 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
     parser.addArgument("-d", "--delta", 1, false);
     parser.addArgument("-s", "--num_steps", 1, false);
     parser.addArgument("-t", "--num_texts", 1, false);
+    parser.addArgument("--capture", 1);
+    parser.addArgument("--bias_profile", 0);
+    parser.addArgument("--num_masks", 1);
 
     try {
         parser.parse(argc, argv);
@@ -206,6 +404,16 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
 
         parser.retrieveUint8ArrayFromHexString("a", ctx->alpha, 8);
         parser.retrieveUint8ArrayFromHexString("d", ctx->delta, 8);
+
+        ctx->use_bias_profile = parser.retrieveAsFlag("bias_profile");
+
+        if (parser.count("num_masks")) {
+            ctx->num_suggested_masks = parser.retrieveAsInt("num_masks");
+        }
+
+        if (parser.count("capture")) {
+            ctx->capture_path = parser.retrieve<std::string>("capture");
+        }
     } catch( ... ) { 
         fprintf(stderr, "%s\n", parser.usage().c_str());
         exit(EXIT_FAILURE);
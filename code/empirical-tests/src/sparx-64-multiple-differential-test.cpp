@@ -0,0 +1,582 @@
+/**
+ * Multiple-differential distinguisher over <s> steps of SPARX-64 for <k>
+ * random keys from <t> random pairs (P, P ^ alpha) per key.
+ *
+ * Instead of counting a single output difference, the output differences
+ * of all pairs are grouped into buckets, either
+ * - by their value in the bits of a truncated mask <m> (--mask), with one
+ *   bucket per value of the at most 24 masked bits, or
+ * - by a set of output differences (--deltas), with one bucket per
+ *   difference and one for all others.
+ * The pairs are encrypted in batches on all threads, which count the
+ * buckets in histograms per thread. Per key, the tool computes the
+ * log-likelihood ratio (LLR) statistic G = 2 sum_i O_i ln(O_i / E_i) of the
+ * empirical distribution against the uniform distribution of output
+ * differences.
+ *
+ * With a mask, it also computes Pearson's chi-square statistic. Under the
+ * uniform distribution, both follow a chi-square distribution with B - 1
+ * degrees of freedom for B buckets if every bucket expects at least
+ * MIN_EXPECTED_COUNT pairs, which the tool demands; it prints the normalized
+ * deviation (X - (B - 1)) / sqrt(2 (B - 1)) of both.
+ *
+ * A single difference expects only t 2^{-64} pairs, far from this bound.
+ * With --deltas, the tool therefore prints G and, instead of the chi-square
+ * test, the Poisson tail Pr[X >= H] of the number H of pairs in any of the
+ * d differences, for the mean lambda = t d 2^{-64} of random pairs.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/convert.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+using utils::to_uint64;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+#define MAX_NUM_MASK_BITS 24
+#define NUM_TOP_BUCKETS 10
+#define MIN_EXPECTED_COUNT 5
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_keys = 0;
+    size_t   num_steps = 0;
+    size_t   num_pairs_per_key = 0;
+    uint8_t  alpha[SPARX64_STATE_LENGTH];
+
+    // Either a truncated mask or a sorted set of differences
+    uint64_t mask = 0;
+    std::vector<uint64_t> deltas;
+
+    size_t   num_buckets = 0;
+
+    // Probability of each bucket under uniform output differences; with
+    // deltas, that of the last bucket is 1 - d 2^{-64}, which rounds to 1
+    std::vector<double> uniform_probabilities;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+// Buckets
+// ---------------------------------------------------------
+
+/**
+ * Returns the bits of value in the mask, packed into the lowest bits.
+ */
+static uint64_t compress(const uint64_t value, const uint64_t mask) {
+#ifdef __BMI2__
+    return _pext_u64(value, mask);
+#else
+    uint64_t result = 0;
+    uint64_t remaining = mask;
+
+    for (uint64_t bit = 1; remaining != 0; bit <<= 1) {
+        const uint64_t lowest = remaining & (~remaining + 1);
+
+        if (value & lowest) {
+            result |= bit;
+        }
+
+        remaining ^= lowest;
+    }
+
+    return result;
+#endif
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Inverse of compress.
+ */
+static uint64_t decompress(const uint64_t value, const uint64_t mask) {
+#ifdef __BMI2__
+    return _pdep_u64(value, mask);
+#else
+    uint64_t result = 0;
+    uint64_t remaining = mask;
+
+    for (uint64_t bit = 1; remaining != 0; bit <<= 1) {
+        const uint64_t lowest = remaining & (~remaining + 1);
+
+        if (value & bit) {
+            result |= lowest;
+        }
+
+        remaining ^= lowest;
+    }
+
+    return result;
+#endif
+}
+
+// ---------------------------------------------------------
+
+static size_t get_bucket(const experiment_ctx_t* ctx,
+                         const uint64_t difference) {
+    if (ctx->deltas.empty()) {
+        return (size_t)compress(difference, ctx->mask);
+    }
+
+    // The last bucket collects all other differences
+    const std::vector<uint64_t>::const_iterator it = std::lower_bound(
+        ctx->deltas.begin(), ctx->deltas.end(), difference);
+
+    if ((it != ctx->deltas.end()) && (*it == difference)) {
+        return (size_t)(it - ctx->deltas.begin());
+    }
+
+    return ctx->deltas.size();
+}
+
+// ---------------------------------------------------------
+
+static void print_bucket(const experiment_ctx_t* ctx, const size_t bucket) {
+    if (ctx->deltas.empty()) {
+        printf("%016" PRIx64, decompress(bucket, ctx->mask));
+    } else if (bucket < ctx->deltas.size()) {
+        printf("%016" PRIx64, ctx->deltas[bucket]);
+    } else {
+        printf("%-16s", "other");
+    }
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Adds the buckets of the pairs in batches [from, to) to the histogram.
+ */
+static void count_buckets(const key_ctx_t* key_ctx,
+                          const size_t from,
+                          const size_t to,
+                          std::vector<uint64_t>& histogram) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    const uint64_t alpha = to_uint64(ctx->alpha);
+    const size_t inactive_branches = sparx_get_inactive_branches(alpha);
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    uint64_t c[SPARX64_BATCH_SIZE];
+    uint64_t c_[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_pairs = SPARX64_BATCH_SIZE;
+
+        if (first + num_pairs > ctx->num_pairs_per_key) {
+            num_pairs = ctx->num_pairs_per_key - first;
+        }
+
+        // P = random, P' = P xor alpha
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = splitmix64(key_ctx->seed + first + j);
+            p_[j] = p[j] ^ alpha;
+        }
+
+        sparx_load_batch(&batch,  p);
+        sparx_load_batch(&batch_, p_);
+        sparx_encrypt_steps_pair_batch(&key_ctx->cipher_ctx, &batch, &batch_,
+            inactive_branches, 1, ctx->num_steps);
+        sparx_store_batch(&batch,  c);
+        sparx_store_batch(&batch_, c_);
+
+        for (size_t j = 0; j < num_pairs; ++j) {
+            histogram[get_bucket(ctx, c[j] ^ c_[j])]++;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the bucket frequencies under a random key into histogram.
+ */
+static void run_key(const experiment_ctx_t* ctx,
+                    ThreadPool& pool,
+                    std::vector<uint64_t>& histogram) {
+    key_ctx_t key_ctx;
+    key_ctx.ctx = ctx;
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    get_random(key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&key_ctx.cipher_ctx, key);
+    get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+    const size_t num_batches =
+        (ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    std::vector<std::vector<uint64_t> > thread_histograms(
+        pool.get_num_threads(), std::vector<uint64_t>(ctx->num_buckets, 0));
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            count_buckets(&key_ctx, from, to, thread_histograms[thread_index]);
+        });
+
+    histogram.assign(ctx->num_buckets, 0);
+
+    for (size_t t = 0; t < thread_histograms.size(); ++t) {
+        for (size_t i = 0; i < ctx->num_buckets; ++i) {
+            histogram[i] += thread_histograms[t][i];
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Computes the chi-square and the LLR statistic of the histogram of
+ * num_pairs pairs against the uniform distribution of the mask buckets.
+ */
+static void compute_statistics(const experiment_ctx_t* ctx,
+                               const std::vector<uint64_t>& histogram,
+                               const double num_pairs,
+                               double* chi_square,
+                               double* llr) {
+    *chi_square = 0;
+    *llr = 0;
+
+    for (size_t i = 0; i < ctx->num_buckets; ++i) {
+        const double expected = num_pairs * ctx->uniform_probabilities[i];
+        const double observed = (double)histogram[i];
+        *chi_square += (observed - expected) * (observed - expected)
+            / expected;
+
+        if (histogram[i] > 0) {
+            *llr += 2 * observed * log(observed / expected);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of pairs in the delta buckets of the histogram.
+ */
+static uint64_t get_num_hits(const experiment_ctx_t* ctx,
+                             const std::vector<uint64_t>& histogram) {
+    uint64_t num_hits = 0;
+
+    for (size_t i = 0; i < ctx->deltas.size(); ++i) {
+        num_hits += histogram[i];
+    }
+
+    return num_hits;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the LLR statistic of the histogram of num_pairs pairs over the
+ * delta buckets. The bucket of all other differences is evaluated with
+ * log1p, since its probability rounds to one.
+ */
+static double compute_delta_llr(const experiment_ctx_t* ctx,
+                                const std::vector<uint64_t>& histogram,
+                                const double num_pairs) {
+    const double p = ldexp(1.0, -64);
+    const double num_hits = (double)get_num_hits(ctx, histogram);
+    const double num_others = num_pairs - num_hits;
+    double llr = 0;
+
+    for (size_t i = 0; i < ctx->deltas.size(); ++i) {
+        if (histogram[i] > 0) {
+            const double observed = (double)histogram[i];
+            llr += 2 * observed * log(observed / (num_pairs * p));
+        }
+    }
+
+    if (num_others > 0) {
+        llr += 2 * num_others * (log1p(-num_hits / num_pairs)
+            - log1p(-(double)ctx->deltas.size() * p));
+    }
+
+    return llr;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns log2(Pr[X >= k]) for a Poisson variable X with mean lambda, for
+ * the small means of the delta buckets.
+ */
+static double log2_poisson_tail(const uint64_t k, const double lambda) {
+    if (k == 0) {
+        return 0;
+    }
+
+    // Pr[X = k] * (1 + lambda / (k + 1) + lambda^2 / ((k + 1) (k + 2)) ...)
+    const double log_first = -lambda + k * log(lambda) - lgamma(k + 1.0);
+    double sum = 1;
+    double term = 1;
+
+    for (uint64_t j = k + 1; j < k + 1000; ++j) {
+        term *= lambda / j;
+        sum += term;
+
+        if (term < 1e-17 * sum) {
+            break;
+        }
+    }
+
+    return (log_first + log(sum)) / log(2.0);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Prints the statistics of the histogram of num_pairs pairs after label.
+ */
+static void print_statistics(const experiment_ctx_t* ctx,
+                             const char* label,
+                             const std::vector<uint64_t>& histogram,
+                             const double num_pairs) {
+    if (!ctx->deltas.empty()) {
+        const uint64_t num_hits = get_num_hits(ctx, histogram);
+        const double lambda =
+            num_pairs * ldexp((double)ctx->deltas.size(), -64);
+        printf("%s %14" PRIu64 " %14.2f %14.2f", label, num_hits, log2(lambda),
+            compute_delta_llr(ctx, histogram, num_pairs));
+        printf(" %14.2f", log2_poisson_tail(num_hits, lambda));
+        return;
+    }
+
+    const double degrees = (double)(ctx->num_buckets - 1);
+    double chi_square;
+    double llr;
+    compute_statistics(ctx, histogram, num_pairs, &chi_square, &llr);
+    printf("%s %14.2f %9.2f %14.2f %9.2f", label,
+        chi_square, (chi_square - degrees) / sqrt(2 * degrees),
+        llr, (llr - degrees) / sqrt(2 * degrees));
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    std::vector<uint64_t> sum_histogram(ctx->num_buckets, 0);
+    std::vector<uint64_t> histogram;
+
+    if (ctx->deltas.empty()) {
+        printf("%-9s %14s %9s %14s %9s\n", "Key", "Chi-square", "z", "LLR",
+            "z");
+    } else {
+        printf("%-9s %14s %14s %14s %14s\n", "Key", "#Hits",
+            "log2(lambda)", "LLR", "log2(tail)");
+    }
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run_key(ctx, pool, histogram);
+        const auto end = std::chrono::steady_clock::now();
+
+        char label[32];
+        snprintf(label, sizeof(label), "Key %4zu:", i);
+        print_statistics(ctx, label, histogram,
+            (double)ctx->num_pairs_per_key);
+        printf(" in %.2f s\n",
+            std::chrono::duration<double>(end - start).count());
+        fflush(stdout);
+
+        for (size_t b = 0; b < ctx->num_buckets; ++b) {
+            sum_histogram[b] += histogram[b];
+        }
+    }
+
+    const double num_pairs = (double)ctx->num_keys * ctx->num_pairs_per_key;
+    print_statistics(ctx, "All keys:", sum_histogram, num_pairs);
+    printf("\n");
+
+    if (ctx->deltas.empty()) {
+        printf("Degrees of freedom: %zu\n", ctx->num_buckets - 1);
+    }
+
+    // Buckets with the highest frequencies over all keys
+    std::vector<size_t> buckets(ctx->num_buckets);
+
+    for (size_t b = 0; b < ctx->num_buckets; ++b) {
+        buckets[b] = b;
+    }
+
+    const size_t num_top = std::min((size_t)NUM_TOP_BUCKETS, ctx->num_buckets);
+    std::partial_sort(buckets.begin(), buckets.begin() + num_top,
+        buckets.end(), [&](const size_t a, const size_t b) {
+            return sum_histogram[a] > sum_histogram[b];
+        });
+
+    printf("%-16s %14s %9s %9s\n", "Bucket", "#Pairs", "log2(p)",
+        "Uniform");
+
+    for (size_t i = 0; i < num_top; ++i) {
+        const size_t b = buckets[i];
+        print_bucket(ctx, b);
+        printf(" %14" PRIu64, sum_histogram[b]);
+
+        if (sum_histogram[b] == 0) {
+            printf(" %9s", "-inf");
+        } else {
+            printf(" %9.2f", log2((double)sum_histogram[b] / num_pairs));
+        }
+
+        printf(" %9.2f\n", log2(ctx->uniform_probabilities[b]));
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_deltas(const std::vector<std::string>& values,
+                         std::vector<uint64_t>& deltas) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        uint64_t delta;
+
+        if (sscanf(values[i].c_str(), "%" SCNx64, &delta) != 1) {
+            throw std::invalid_argument("deltas must be hexadecimal");
+        }
+
+        deltas.push_back(delta);
+    }
+
+    std::sort(deltas.begin(), deltas.end());
+    deltas.erase(std::unique(deltas.begin(), deltas.end()), deltas.end());
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Multiple-Differential Test");
+    parser.helpString("Groups the output differences of <t> pairs (P, P ^ <alpha>) after <s> steps of SPARX-64 into buckets by a truncated mask <m> or a set of differences <d>, and tests their distribution against the uniform one for each of <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-a", "--alpha", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_pairs", 1, false);
+    parser.addArgument("-m", "--mask", 1);
+    parser.addArgument("-d", "--deltas", '+');
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        parser.retrieveUint8ArrayFromHexString("a", ctx->alpha,
+            SPARX64_STATE_LENGTH);
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_pairs_per_key = parser.retrieveAsLong("num_pairs");
+
+        if (parser.count("mask")) {
+            ctx->mask = strtoull(
+                parser.retrieve<std::string>("mask").c_str(), NULL, 16);
+        }
+
+        if (parser.count("deltas")) {
+            parse_deltas(parser.retrieve<std::vector<std::string> >("deltas"),
+                ctx->deltas);
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs_per_key == 0) {
+        fprintf(stderr, "Number of pairs must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->mask == 0) == ctx->deltas.empty()) {
+        fprintf(stderr, "Give either a mask or a set of differences\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const int num_mask_bits = __builtin_popcountll(ctx->mask);
+
+    if (num_mask_bits > MAX_NUM_MASK_BITS) {
+        fprintf(stderr, "Mask must have at most %d bits\n", MAX_NUM_MASK_BITS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->deltas.empty()) {
+        ctx->num_buckets = (size_t)1 << num_mask_bits;
+        ctx->uniform_probabilities.assign(ctx->num_buckets,
+            1.0 / ctx->num_buckets);
+
+        // The chi-square approximation needs enough pairs in every bucket
+        if (ctx->num_pairs_per_key
+            < (size_t)MIN_EXPECTED_COUNT * ctx->num_buckets) {
+            fprintf(stderr, "Number of pairs must be at least %d times the "
+                "%zu buckets\n", MIN_EXPECTED_COUNT, ctx->num_buckets);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        const double p = ldexp(1.0, -64);
+        ctx->num_buckets = ctx->deltas.size() + 1;
+        ctx->uniform_probabilities.assign(ctx->num_buckets, p);
+        ctx->uniform_probabilities.back() = 1;
+    }
+
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key %8zu\n", ctx->num_pairs_per_key);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("#Buckets   %8zu\n", ctx->num_buckets);
+    printf("Alpha      %016" PRIx64 "\n", to_uint64(ctx->alpha));
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
@@ -0,0 +1,422 @@
+/**
+ * Counts the right quartets of an <s>-step rectangle for SPARX-64 with start
+ * difference <alpha> and end difference <delta> under <k> random keys.
+ *
+ * Unlike sparx-64-boomerang-test, which decrypts adaptively chosen
+ * ciphertexts for every pair, this test uses chosen plaintexts only: it
+ * encrypts <t> random pairs (P, P ^ alpha) per key and searches all pairs of
+ * pairs ((C1, C2), (C3, C4)) with C1 ^ C3 = C2 ^ C4 = delta, or with C1 ^ C4 =
+ * C2 ^ C3 = delta.
+ *
+ * Quartets are found with a hash join instead of comparing all pairs of
+ * pairs. Every pair (C, C') yields two entries, (C, C') and (C', C). An
+ * entry (X, Y) is stored in the canonical form of {(X, Y), (X ^ delta, Y ^
+ * delta)} with the smaller first word, plus a flag telling which of both it
+ * was. Two pairs form a quartet iff their entries have the same canonical
+ * form and different flags; every quartet is found twice, once among the
+ * original and once among the swapped entries. The entries are sorted by
+ * their canonical form in buckets, in parallel. If they do not fit into
+ * <m> MB, they are split into partitions by a hash, and all texts are
+ * encrypted once per partition.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BUCKET_BITS 8
+#define NUM_BUCKETS (1 << NUM_BUCKET_BITS)
+#define NUM_BATCHES_PER_CHUNK 64
+#define DEFAULT_MAX_MEMORY_MB 1024
+
+// The entry was XORed with delta to become canonical
+#define ENTRY_FLAG_SHIFTED 1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_keys = 0;
+    size_t   num_steps = 0;
+    size_t   num_pairs_per_key = 0;
+    uint64_t alpha = 0;
+    uint64_t delta = 0;
+    size_t   max_memory_mb = DEFAULT_MAX_MEMORY_MB;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    uint64_t first;
+    uint64_t second;
+    uint32_t pair_index;
+    uint32_t flags;
+} quartet_entry_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+    size_t   num_partition_bits;
+    size_t   partition;
+} pass_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool is_before(const quartet_entry_t& a, const quartet_entry_t& b) {
+    if (a.first != b.first) {
+        return a.first < b.first;
+    }
+
+    return a.second < b.second;
+}
+
+// ---------------------------------------------------------
+
+static bool is_equal(const quartet_entry_t& a, const quartet_entry_t& b) {
+    return (a.first == b.first) && (a.second == b.second);
+}
+
+// ---------------------------------------------------------
+
+static quartet_entry_t get_canonical_entry(const uint64_t x,
+                                           const uint64_t y,
+                                           const uint64_t delta,
+                                           const size_t pair_index) {
+    quartet_entry_t entry;
+    entry.pair_index = (uint32_t)pair_index;
+
+    if (x < (x ^ delta)) {
+        entry.first = x;
+        entry.second = y;
+        entry.flags = 0;
+    } else {
+        entry.first = x ^ delta;
+        entry.second = y ^ delta;
+        entry.flags = ENTRY_FLAG_SHIFTED;
+    }
+
+    return entry;
+}
+
+// ---------------------------------------------------------
+
+static uint64_t hash_entry(const quartet_entry_t& entry) {
+    return splitmix64(entry.first ^ splitmix64(entry.second));
+}
+
+// ---------------------------------------------------------
+
+static size_t get_partition(const uint64_t hash,
+                            const size_t num_partition_bits) {
+    if (num_partition_bits == 0) {
+        return 0;
+    }
+
+    return (size_t)(hash >> (64 - num_partition_bits));
+}
+
+// ---------------------------------------------------------
+
+static size_t get_bucket(const uint64_t hash) {
+    return (size_t)(hash & (NUM_BUCKETS - 1));
+}
+
+// ---------------------------------------------------------
+// Quartet detection
+// ---------------------------------------------------------
+
+/**
+ * Encrypts the pairs of batches [from, to) and adds the entries of the
+ * current partition to the buckets of the thread.
+ */
+static void collect_entries(const pass_ctx_t* pass,
+                            const size_t from,
+                            const size_t to,
+                            std::vector<quartet_entry_t>* buckets) {
+    const experiment_ctx_t* ctx = pass->ctx;
+    uint64_t states[SPARX64_BATCH_SIZE];
+    uint64_t states_[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            states[j] = splitmix64(pass->seed + first + j);
+            states_[j] = states[j] ^ ctx->alpha;
+        }
+
+        sparx_load_batch(&batch, states);
+        sparx_encrypt_steps_batch(&pass->cipher_ctx, &batch, 1, ctx->num_steps);
+        sparx_store_batch(&batch, states);
+
+        sparx_load_batch(&batch, states_);
+        sparx_encrypt_steps_batch(&pass->cipher_ctx, &batch, 1, ctx->num_steps);
+        sparx_store_batch(&batch, states_);
+
+        for (size_t j = 0; (j < SPARX64_BATCH_SIZE)
+             && (first + j < ctx->num_pairs_per_key); ++j) {
+            const quartet_entry_t entries[2] = {
+                get_canonical_entry(states[j], states_[j], ctx->delta,
+                    first + j),
+                get_canonical_entry(states_[j], states[j], ctx->delta,
+                    first + j)
+            };
+
+            for (size_t e = 0; e < 2; ++e) {
+                const uint64_t hash = hash_entry(entries[e]);
+
+                if (get_partition(hash, pass->num_partition_bits)
+                    == pass->partition) {
+                    buckets[get_bucket(hash)].push_back(entries[e]);
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Sorts the entries and returns the number of pairs of entries with equal
+ * canonical forms, different flags, and different pairs.
+ */
+static uint64_t count_matches(std::vector<quartet_entry_t>& entries) {
+    std::sort(entries.begin(), entries.end(), is_before);
+    uint64_t num_matches = 0;
+    size_t begin = 0;
+
+    while (begin < entries.size()) {
+        size_t end = begin + 1;
+
+        while ((end < entries.size()) && is_equal(entries[begin], entries[end])) {
+            end++;
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            for (size_t j = i + 1; j < end; ++j) {
+                num_matches += (entries[i].flags != entries[j].flags)
+                    && (entries[i].pair_index != entries[j].pair_index);
+            }
+        }
+
+        begin = end;
+    }
+
+    return num_matches;
+}
+
+// ---------------------------------------------------------
+
+static uint64_t count_partition_matches(pass_ctx_t* pass, ThreadPool& pool) {
+    const size_t num_threads = pool.get_num_threads();
+    const size_t num_batches =
+        (pass->ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1)
+        / SPARX64_BATCH_SIZE;
+    std::vector<std::vector<quartet_entry_t> > thread_buckets(
+        num_threads * NUM_BUCKETS);
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            collect_entries(pass, from, to,
+                thread_buckets.data() + thread_index * NUM_BUCKETS);
+        });
+
+    std::vector<uint64_t> thread_matches(num_threads, 0);
+
+    pool.parallel_for(NUM_BUCKETS, 1,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            for (size_t b = from; b < to; ++b) {
+                std::vector<quartet_entry_t> entries;
+
+                for (size_t t = 0; t < num_threads; ++t) {
+                    std::vector<quartet_entry_t>& bucket =
+                        thread_buckets[t * NUM_BUCKETS + b];
+                    entries.insert(entries.end(), bucket.begin(),
+                        bucket.end());
+                    std::vector<quartet_entry_t>().swap(bucket);
+                }
+
+                thread_matches[thread_index] += count_matches(entries);
+            }
+        });
+
+    uint64_t num_matches = 0;
+
+    for (size_t t = 0; t < num_threads; ++t) {
+        num_matches += thread_matches[t];
+    }
+
+    return num_matches;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the smallest number of partition bits s.t. the entries of a
+ * partition fit into the memory limit, about twice over for the copies
+ * that are made for sorting.
+ */
+static size_t get_num_partition_bits(const experiment_ctx_t* ctx) {
+    const double num_entries = 2.0 * ctx->num_pairs_per_key;
+    const double max_num_entries = (double)ctx->max_memory_mb * (1 << 20)
+        / (2 * sizeof(quartet_entry_t));
+    size_t num_partition_bits = 0;
+
+    while (num_entries / (double)(1ULL << num_partition_bits)
+           > max_num_entries) {
+        num_partition_bits++;
+    }
+
+    return num_partition_bits;
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+static uint64_t run_key(const experiment_ctx_t* ctx, ThreadPool& pool) {
+    pass_ctx_t pass;
+    pass.ctx = ctx;
+    pass.num_partition_bits = get_num_partition_bits(ctx);
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    get_random(key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&pass.cipher_ctx, key);
+    get_random((uint8_t*)&pass.seed, sizeof(pass.seed));
+
+    uint64_t num_matches = 0;
+
+    for (pass.partition = 0;
+         pass.partition < ((size_t)1 << pass.num_partition_bits);
+         ++pass.partition) {
+        num_matches += count_partition_matches(&pass, pool);
+    }
+
+    // Every quartet is found among the original and the swapped entries
+    return num_matches / 2;
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    uint64_t num_quartets = 0;
+
+    printf("#Partitions %8zu\n", (size_t)1 << get_num_partition_bits(ctx));
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t num_key_quartets = run_key(ctx, pool);
+        const auto end = std::chrono::steady_clock::now();
+        num_quartets += num_key_quartets;
+
+        printf("Key %4zu: %8" PRIu64 " quartets in %.2f s\n", i,
+            num_key_quartets,
+            std::chrono::duration<double>(end - start).count());
+    }
+
+    printf("Quartets: %" PRIu64 " (%.2f per key)\n", num_quartets,
+        (double)num_quartets / ctx->num_keys);
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Rectangle Test");
+    parser.helpString("Counts the right quartets of an <s>-step rectangle for SPARX-64 among <t> chosen-plaintext pairs with difference <alpha> per key and end difference <delta>.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-a", "--alpha", 1, false);
+    parser.addArgument("-d", "--delta", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_texts", 1, false);
+    parser.addArgument("-m", "--max_memory", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_pairs_per_key = parser.retrieveAsLong("num_texts");
+        ctx->alpha = strtoull(
+            parser.retrieve<std::string>("alpha").c_str(), NULL, 16);
+        ctx->delta = strtoull(
+            parser.retrieve<std::string>("delta").c_str(), NULL, 16);
+
+        if (parser.count("max_memory")) {
+            ctx->max_memory_mb = parser.retrieveAsInt("max_memory");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->alpha == 0) || (ctx->delta == 0)) {
+        fprintf(stderr, "Alpha and delta must not be zero\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_pairs_per_key == 0)
+        || (ctx->num_pairs_per_key > UINT32_MAX)) {
+        fprintf(stderr, "Number of texts must be in [1, 2^32 - 1]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->max_memory_mb == 0) {
+        fprintf(stderr, "Memory limit must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys       %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key  %8zu\n", ctx->num_pairs_per_key);
+    printf("#Steps      %8zu\n", ctx->num_steps);
+    printf("Alpha       %016" PRIx64 "\n", ctx->alpha);
+    printf("Delta       %016" PRIx64 "\n", ctx->delta);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
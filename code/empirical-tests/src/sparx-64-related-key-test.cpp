@@ -0,0 +1,382 @@
+/**
+ * Computes related-key differentials and boomerangs over <s> steps of
+ * SPARX-64/128 for <k> random keys from <t> random pairs per key.
+ *
+ * In the differential mode, pairs (P, P ^ alpha) are encrypted under the
+ * keys (K, K ^ x) for a master-key difference x, and the tool counts the
+ * pairs with output difference delta. With --boomerang, the tool encrypts
+ * (P1, P2) = (P, P ^ alpha) under (K1, K2) = (K, K ^ x), XORs delta to both
+ * ciphertexts, decrypts them under (K3, K4) = (K1 ^ y, K2 ^ y) for a second
+ * master-key difference y, and counts the returning quartets with
+ * P3 ^ P4 = alpha. All keys are expanded with the regular key schedule, and
+ * the texts are encrypted in batches on all threads.
+ *
+ * For every master-key difference, the tool tracks the differences of the
+ * subkeys per row, i.e., per step and branch: the differences under the
+ * first key, their average Hamming weight, and the number of distinct
+ * differences over all keys, which shows how the difference spreads
+ * through the key schedule.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_related_key.h"
+#include "utils/argparse.h"
+#include "utils/convert.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+using utils::to_uint16;
+using utils::to_uint64;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_keys = 0;
+    size_t   num_steps = 0;
+    size_t   num_pairs_per_key = 0;
+    uint8_t  alpha[SPARX64_STATE_LENGTH];
+    uint8_t  delta[SPARX64_STATE_LENGTH];
+    uint16_t key_difference[SPARX64_NUM_KEY_WORDS] = { 0 };
+    uint16_t nabla_key_difference[SPARX64_NUM_KEY_WORDS] = { 0 };
+    bool     use_boomerang = false;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+
+    // The keys K1 ... K4; only K1 and K2 in the differential mode
+    sparx64_context_t cipher_ctx[4];
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+
+/**
+ * Subkey differences of one master-key difference over all keys.
+ */
+typedef struct {
+    uint16_t first[SPARX64_NUM_SUBKEY_ROWS][SPARX64_NUM_SUBKEY_WORDS];
+    uint64_t sum_weights[SPARX64_NUM_SUBKEY_ROWS] = { 0 };
+    std::set<std::pair<uint64_t, uint32_t> > distinct[SPARX64_NUM_SUBKEY_ROWS];
+} subkey_differences_t;
+
+// ---------------------------------------------------------
+// Subkey differences
+// ---------------------------------------------------------
+
+static void add_subkey_differences(subkey_differences_t* stats,
+                                   const sparx64_context_t* a,
+                                   const sparx64_context_t* b,
+                                   const bool is_first) {
+    uint16_t differences[SPARX64_NUM_SUBKEY_ROWS][SPARX64_NUM_SUBKEY_WORDS];
+    sparx_get_subkey_differences(a, b, differences);
+
+    for (size_t row = 0; row < SPARX64_NUM_SUBKEY_ROWS; ++row) {
+        const uint16_t* words = differences[row];
+        const uint64_t high = ((uint64_t)words[0] << 48)
+            | ((uint64_t)words[1] << 32) | ((uint64_t)words[2] << 16)
+            | words[3];
+        const uint32_t low = ((uint32_t)words[4] << 16) | words[5];
+
+        stats->sum_weights[row] +=
+            __builtin_popcountll(high) + __builtin_popcount(low);
+        stats->distinct[row].insert(std::make_pair(high, low));
+
+        if (is_first) {
+            for (size_t i = 0; i < SPARX64_NUM_SUBKEY_WORDS; ++i) {
+                stats->first[row][i] = words[i];
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_subkey_differences(const subkey_differences_t* stats,
+                                     const char* name,
+                                     const size_t num_keys) {
+    printf("Subkey differences of %s\n", name);
+    printf("%4s %4s %6s %-29s %7s %9s\n", "Row", "Step", "Branch",
+        "Difference (first key)", "Avg HW", "#Distinct");
+
+    for (size_t row = 0; row < SPARX64_NUM_SUBKEY_ROWS; ++row) {
+        const uint16_t* words = stats->first[row];
+
+        if (row < SPARX64_NUM_SUBKEY_ROWS - 1) {
+            printf("%4zu %4zu %6zu", row, row / SPARX64_NUM_BRANCHES + 1,
+                row % SPARX64_NUM_BRANCHES);
+        } else {
+            printf("%4zu %11s", row, "final");
+        }
+
+        printf(" %04x%04x %04x%04x %04x%04x %7.2f %9zu\n",
+            words[0], words[1], words[2], words[3], words[4], words[5],
+            (double)stats->sum_weights[row] / num_keys,
+            stats->distinct[row].size());
+    }
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Returns the number of pairs in batches [from, to) that follow the
+ * differential, or the number of returning quartets.
+ */
+static uint64_t count_pairs(const key_ctx_t* key_ctx,
+                            const size_t from,
+                            const size_t to) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    const uint64_t alpha = to_uint64(ctx->alpha);
+    const uint64_t delta = to_uint64(ctx->delta);
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    uint64_t c[SPARX64_BATCH_SIZE];
+    uint64_t c_[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+    uint64_t count = 0;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_pairs = SPARX64_BATCH_SIZE;
+
+        if (first + num_pairs > ctx->num_pairs_per_key) {
+            num_pairs = ctx->num_pairs_per_key - first;
+        }
+
+        // P = random, P' = P xor alpha
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = splitmix64(key_ctx->seed + first + j);
+            p_[j] = p[j] ^ alpha;
+        }
+
+        sparx_load_batch(&batch,  p);
+        sparx_load_batch(&batch_, p_);
+        sparx_encrypt_steps_batch(&key_ctx->cipher_ctx[0], &batch,  1,
+            ctx->num_steps);
+        sparx_encrypt_steps_batch(&key_ctx->cipher_ctx[1], &batch_, 1,
+            ctx->num_steps);
+        sparx_store_batch(&batch,  c);
+        sparx_store_batch(&batch_, c_);
+
+        if (!ctx->use_boomerang) {
+            for (size_t j = 0; j < num_pairs; ++j) {
+                count += (c[j] ^ c_[j]) == delta;
+            }
+
+            continue;
+        }
+
+        // Delta-Shift (C, C') -> (D, D'), decrypted under (K3, K4)
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            c[j] ^= delta;
+            c_[j] ^= delta;
+        }
+
+        sparx_load_batch(&batch,  c);
+        sparx_load_batch(&batch_, c_);
+        sparx_decrypt_steps_batch(&key_ctx->cipher_ctx[2], &batch,  1,
+            ctx->num_steps);
+        sparx_decrypt_steps_batch(&key_ctx->cipher_ctx[3], &batch_, 1,
+            ctx->num_steps);
+        sparx_store_batch(&batch,  p);
+        sparx_store_batch(&batch_, p_);
+
+        for (size_t j = 0; j < num_pairs; ++j) {
+            count += (p[j] ^ p_[j]) == alpha;
+        }
+    }
+
+    return count;
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    subkey_differences_t key_differences;
+    subkey_differences_t nabla_key_differences;
+    uint64_t sum_counts = 0;
+
+    const size_t num_batches =
+        (ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        key_ctx_t key_ctx;
+        key_ctx.ctx = ctx;
+
+        uint16_t key[SPARX64_NUM_KEY_WORDS];
+        get_random((uint8_t*)key, SPARX64_KEY_LENGTH);
+        get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+        sparx_key_schedule(&key_ctx.cipher_ctx[0], key);
+        sparx_related_key_schedule(&key_ctx.cipher_ctx[1], key,
+            ctx->key_difference);
+        add_subkey_differences(&key_differences, &key_ctx.cipher_ctx[0],
+            &key_ctx.cipher_ctx[1], i == 0);
+
+        if (ctx->use_boomerang) {
+            uint16_t key_2[SPARX64_NUM_KEY_WORDS];
+
+            for (size_t w = 0; w < SPARX64_NUM_KEY_WORDS; ++w) {
+                key_2[w] = key[w] ^ ctx->key_difference[w];
+            }
+
+            sparx_related_key_schedule(&key_ctx.cipher_ctx[2], key,
+                ctx->nabla_key_difference);
+            sparx_related_key_schedule(&key_ctx.cipher_ctx[3], key_2,
+                ctx->nabla_key_difference);
+            add_subkey_differences(&nabla_key_differences,
+                &key_ctx.cipher_ctx[0], &key_ctx.cipher_ctx[2], i == 0);
+        }
+
+        std::vector<uint64_t> thread_counts(pool.get_num_threads(), 0);
+        const auto start = std::chrono::steady_clock::now();
+
+        pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+            [&](const size_t thread_index, const size_t from, const size_t to) {
+                thread_counts[thread_index] += count_pairs(&key_ctx, from, to);
+            });
+
+        const auto end = std::chrono::steady_clock::now();
+        uint64_t count = 0;
+
+        for (size_t t = 0; t < thread_counts.size(); ++t) {
+            count += thread_counts[t];
+        }
+
+        sum_counts += count;
+        printf("Key %4zu: %10" PRIu64 " in %.2f s\n", i, count,
+            std::chrono::duration<double>(end - start).count());
+        fflush(stdout);
+    }
+
+    const double num_pairs = (double)ctx->num_keys * ctx->num_pairs_per_key;
+    printf("Avg #%s: %.2f\n", ctx->use_boomerang ? "quartets" : "pairs",
+        (double)sum_counts / ctx->num_keys);
+
+    if (sum_counts == 0) {
+        printf("log2(p): -inf\n");
+    } else {
+        printf("log2(p): %.2f\n", log2((double)sum_counts / num_pairs));
+    }
+
+    print_subkey_differences(&key_differences, "K ^ x", ctx->num_keys);
+
+    if (ctx->use_boomerang) {
+        print_subkey_differences(&nabla_key_differences, "K ^ y",
+            ctx->num_keys);
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_key_difference(ArgumentParser& parser,
+                                 const char* name,
+                                 uint16_t key_difference[SPARX64_NUM_KEY_WORDS]) {
+    uint8_t bytes[SPARX64_KEY_LENGTH];
+    parser.retrieveUint8ArrayFromHexString(name, bytes, SPARX64_KEY_LENGTH);
+    to_uint16(key_difference, bytes, SPARX64_KEY_LENGTH);
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Related-Key Test");
+    parser.helpString("Counts the pairs (P, P ^ <alpha>) under the keys (K, K ^ <x>) with output difference <delta> after <s> steps of SPARX-64/128, or with --boomerang the quartets that return under the keys (K ^ <y>, K ^ <x> ^ <y>), for <t> pairs under each of <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-a", "--alpha", 1, false);
+    parser.addArgument("-d", "--delta", 1, false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_pairs", 1, false);
+    parser.addArgument("-x", "--key_difference", 1, false);
+    parser.addArgument("-y", "--nabla_key_difference", 1);
+    parser.addArgument("--boomerang", 0);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        parser.retrieveUint8ArrayFromHexString("a", ctx->alpha,
+            SPARX64_STATE_LENGTH);
+        parser.retrieveUint8ArrayFromHexString("d", ctx->delta,
+            SPARX64_STATE_LENGTH);
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_pairs_per_key = parser.retrieveAsLong("num_pairs");
+        parse_key_difference(parser, "x", ctx->key_difference);
+
+        if (parser.count("nabla_key_difference")) {
+            parse_key_difference(parser, "y", ctx->nabla_key_difference);
+        }
+
+        ctx->use_boomerang = parser.count("boomerang") > 0;
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs_per_key == 0) {
+        fprintf(stderr, "Number of pairs must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key %8zu\n", ctx->num_pairs_per_key);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("Mode       %s\n", ctx->use_boomerang ? "boomerang" : "differential");
+    printf("Alpha      %016" PRIx64 "\n", to_uint64(ctx->alpha));
+    printf("Delta      %016" PRIx64 "\n", to_uint64(ctx->delta));
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/**
+ * Counts rotational-XOR (RX) pairs over <s> steps of SPARX-64 for <k>
+ * random keys from <t> random pairs (P, rot(P) ^ alpha) per key, where rot
+ * rotates each 16-bit word to the left by <gamma> bits (see sparx64_rx.h).
+ *
+ * The first text of a pair is encrypted under a random key K; the second
+ * under the related key rot(K) ^ <key_offset> through the key schedule, or,
+ * with --rotate_subkeys, under the rotated subkeys of K. Both texts are
+ * encrypted in batches on all threads. Given one RX-difference with -d, the
+ * tool counts the pairs with C' ^ rot(C) = delta after <s> steps; given <s>
+ * RX-differences, one per step, it counts after each step the pairs that
+ * followed all of them up to that step.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_rx.h"
+#include "utils/argparse.h"
+#include "utils/convert.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+using utils::to_uint16;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t   num_keys = 0;
+    size_t   num_steps = 0;
+    size_t   num_pairs_per_key = 0;
+    size_t   gamma = 1;
+    uint64_t alpha = 0;
+    uint16_t key_offset[SPARX64_NUM_KEY_WORDS] = { 0 };
+    bool     rotate_subkeys = false;
+
+    // Either a single RX-difference after the final step, or one per step
+    std::vector<uint64_t> deltas;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    sparx64_context_t related_cipher_ctx;
+    uint64_t seed;
+} key_ctx_t;
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Adds to counts[s - 1] the number of pairs in batches [from, to) that
+ * follow the RX-differences up to step s.
+ */
+static void count_pairs(const key_ctx_t* key_ctx,
+                        const size_t from,
+                        const size_t to,
+                        std::vector<uint64_t>& counts) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    const size_t first_checked_step =
+        (ctx->deltas.size() == 1) ? ctx->num_steps : 1;
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t differences[SPARX64_BATCH_SIZE];
+    bool is_valid[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+
+    for (size_t b = from; b < to; ++b) {
+        const size_t first = b * SPARX64_BATCH_SIZE;
+        size_t num_pairs = SPARX64_BATCH_SIZE;
+
+        if (first + num_pairs > ctx->num_pairs_per_key) {
+            num_pairs = ctx->num_pairs_per_key - first;
+        }
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = splitmix64(key_ctx->seed + first + j);
+            is_valid[j] = j < num_pairs;
+        }
+
+        // P' = rot(P) xor alpha
+        sparx_load_batch(&batch, p);
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = sparx_rx_rotate(p[j], ctx->gamma) ^ ctx->alpha;
+        }
+
+        sparx_load_batch(&batch_, p);
+
+        for (size_t s = 1; s <= ctx->num_steps; ++s) {
+            sparx_encrypt_steps_batch(&key_ctx->cipher_ctx, &batch, s, s);
+            sparx_encrypt_steps_batch(&key_ctx->related_cipher_ctx, &batch_,
+                s, s);
+
+            if (s < first_checked_step) {
+                continue;
+            }
+
+            const uint64_t delta = ctx->deltas[s - first_checked_step];
+            sparx_rx_get_differences_batch(&batch, &batch_, ctx->gamma,
+                differences);
+            uint64_t count = 0;
+
+            for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+                is_valid[j] &= differences[j] == delta;
+                count += is_valid[j];
+            }
+
+            counts[s - 1] += count;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores the counts after each step under a random key into counts.
+ */
+static void run_key(const experiment_ctx_t* ctx,
+                    ThreadPool& pool,
+                    std::vector<uint64_t>& counts) {
+    key_ctx_t key_ctx;
+    key_ctx.ctx = ctx;
+
+    uint16_t key[SPARX64_NUM_KEY_WORDS];
+    get_random((uint8_t*)key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&key_ctx.cipher_ctx, key);
+
+    if (ctx->rotate_subkeys) {
+        sparx_rx_rotate_subkeys(&key_ctx.related_cipher_ctx,
+            &key_ctx.cipher_ctx, ctx->gamma);
+    } else {
+        sparx_rx_related_key_schedule(&key_ctx.related_cipher_ctx, key,
+            ctx->key_offset, ctx->gamma);
+    }
+
+    get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+    const size_t num_batches =
+        (ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    std::vector<std::vector<uint64_t> > thread_counts(
+        pool.get_num_threads(), std::vector<uint64_t>(ctx->num_steps, 0));
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            count_pairs(&key_ctx, from, to, thread_counts[thread_index]);
+        });
+
+    counts.assign(ctx->num_steps, 0);
+
+    for (size_t t = 0; t < thread_counts.size(); ++t) {
+        for (size_t s = 0; s < ctx->num_steps; ++s) {
+            counts[s] += thread_counts[t][s];
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    const size_t first_checked_step =
+        (ctx->deltas.size() == 1) ? ctx->num_steps : 1;
+    std::vector<uint64_t> sum_counts(ctx->num_steps, 0);
+    std::vector<uint64_t> counts;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        run_key(ctx, pool, counts);
+        const auto end = std::chrono::steady_clock::now();
+
+        printf("Key %4zu:", i);
+
+        for (size_t s = first_checked_step; s <= ctx->num_steps; ++s) {
+            printf(" %10" PRIu64, counts[s - 1]);
+            sum_counts[s - 1] += counts[s - 1];
+        }
+
+        printf(" in %.2f s\n",
+            std::chrono::duration<double>(end - start).count());
+        fflush(stdout);
+    }
+
+    printf("%5s %-16s %12s %9s\n", "Steps", "RX-difference", "Avg #pairs",
+        "log2(p)");
+
+    const double num_pairs = (double)ctx->num_keys * ctx->num_pairs_per_key;
+
+    for (size_t s = first_checked_step; s <= ctx->num_steps; ++s) {
+        printf("%5zu %016" PRIx64 " %12.2f", s,
+            ctx->deltas[s - first_checked_step],
+            (double)sum_counts[s - 1] / ctx->num_keys);
+
+        if (sum_counts[s - 1] == 0) {
+            printf(" %9s\n", "-inf");
+        } else {
+            printf(" %9.2f\n", log2((double)sum_counts[s - 1] / num_pairs));
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_deltas(const std::vector<std::string>& values,
+                         std::vector<uint64_t>& deltas) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        uint64_t delta;
+
+        if (sscanf(values[i].c_str(), "%" SCNx64, &delta) != 1) {
+            throw std::invalid_argument("deltas must be hexadecimal");
+        }
+
+        deltas.push_back(delta);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Rotational-XOR Test");
+    parser.helpString("Counts the pairs (P, rot(P) ^ <alpha>) under the keys (K, rot(K) ^ <key_offset>) that follow the RX-differences <delta> over <s> steps of SPARX-64, where rot rotates each 16-bit word by <gamma> bits, for <t> pairs under each of <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-a", "--alpha", 1, false);
+    parser.addArgument("-d", "--deltas", '+', false);
+    parser.addArgument("-s", "--num_steps", 1, false);
+    parser.addArgument("-t", "--num_pairs", 1, false);
+    parser.addArgument("-g", "--gamma", 1);
+    parser.addArgument("-o", "--key_offset", 1);
+    parser.addArgument("--rotate_subkeys", 0);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+        ctx->alpha = strtoull(
+            parser.retrieve<std::string>("alpha").c_str(), NULL, 16);
+        parse_deltas(parser.retrieve<std::vector<std::string> >("deltas"),
+            ctx->deltas);
+        ctx->num_steps = parser.retrieveAsInt("num_steps");
+        ctx->num_pairs_per_key = parser.retrieveAsLong("num_pairs");
+
+        if (parser.count("gamma")) {
+            ctx->gamma = parser.retrieveAsInt("gamma");
+        }
+
+        if (parser.count("key_offset")) {
+            uint8_t key_offset[SPARX64_KEY_LENGTH];
+            parser.retrieveUint8ArrayFromHexString("o", key_offset,
+                SPARX64_KEY_LENGTH);
+            to_uint16(ctx->key_offset, key_offset, SPARX64_KEY_LENGTH);
+        }
+
+        ctx->rotate_subkeys = parser.count("rotate_subkeys") > 0;
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_steps == 0) || (ctx->num_steps > SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->deltas.size() != 1) && (ctx->deltas.size() != ctx->num_steps)) {
+        fprintf(stderr, "Give one RX-difference or one per step\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs_per_key == 0) {
+        fprintf(stderr, "Number of pairs must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->gamma >= 16) {
+        fprintf(stderr, "Rotation must be in [0, 15]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key %8zu\n", ctx->num_pairs_per_key);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("Gamma      %8zu\n", ctx->gamma);
+    printf("Alpha      %016" PRIx64 "\n", ctx->alpha);
+    printf("Subkeys    %s\n", ctx->rotate_subkeys ? "rotated" : "key schedule");
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
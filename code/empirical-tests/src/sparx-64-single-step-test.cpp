@@ -2,7 +2,7 @@
  * Encrypts <#pairs> of random texts with the given XOR difference <delta_l,
  * delta_r> with 1-step SPARX-64 under <#keys> random keys each, and counts and
  * outputs how many pairs have a zero difference on the left side after the
- * first step.
+ * first step. Rotational-XOR pairs are tested by sparx-64-rx-test.
  * 
  * @author eik list
  * @copyright see license.txt
@@ -34,7 +34,6 @@ typedef struct {
     size_t   num_keys = 0;
     size_t   num_texts_per_key = 0;
     uint64_t num_collisions = 0;
-    bool     use_rotated_differences = 0;
     size_t   num_steps = 1;
 } experiment_ctx_t;
 
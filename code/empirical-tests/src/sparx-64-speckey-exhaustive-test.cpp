@@ -0,0 +1,315 @@
+/**
+ * Evaluates differentials of a single branch of SPARX-64 exactly by
+ * encrypting all 2^32 inputs of the branch under each of <#keys> random keys.
+ *
+ * With <alpha> and <delta>, counts the right inputs of the differential over
+ * <r> rounds. With <alpha> only, prints the <n> most likely output
+ * differences among those with a probability of at least 2^{-<w>}. With
+ * --input, evaluates the differential (alpha -> delta) of every
+ * characteristic in a CryptoSMT result file of SPECKEY-32, e.g., in
+ * results/speckey_differentials/, and compares it to the weight of the
+ * characteristic.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/speckey32_exhaustive.h"
+#include "ciphers/speckey32_trail.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define DEFAULT_MAX_WEIGHT 24
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    size_t      num_keys = 0;
+    size_t      num_rounds = 0;
+    size_t      branch = 0;
+    bool        has_alpha = false;
+    uint32_t    alpha = 0;
+    bool        has_delta = false;
+    uint32_t    delta = 0;
+    size_t      max_num_results = 20;
+    int         max_weight = DEFAULT_MAX_WEIGHT;
+    std::string trails_path;
+    std::vector<sparx64_context_t> keys;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static void print_log2_probability(const double count) {
+    if (count == 0) {
+        printf("%-10s", "0");
+    } else {
+        printf("2^%-8.2f", log2(count / SPECKEY32_EXHAUSTIVE_NUM_TEXTS));
+    }
+}
+
+// ---------------------------------------------------------
+
+static void generate_keys(experiment_ctx_t* ctx) {
+    uint8_t key[SPARX64_KEY_LENGTH];
+    ctx->keys.resize(ctx->num_keys);
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        get_random(key, SPARX64_KEY_LENGTH);
+        sparx_key_schedule(&ctx->keys[i], key);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the average number of right inputs of (alpha -> delta) over all
+ * keys.
+ */
+static double count_differential(const experiment_ctx_t* ctx,
+                                 ThreadPool& pool,
+                                 const size_t num_rounds,
+                                 const uint32_t alpha,
+                                 const uint32_t delta,
+                                 const bool print_keys) {
+    double total = 0;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        const uint64_t count = speckey_count_differential(&ctx->keys[i],
+            ctx->branch, num_rounds, alpha, delta, pool);
+        total += (double)count;
+
+        if (print_keys) {
+            printf("Key %4zu: %12" PRIu64 " ", i, count);
+            print_log2_probability((double)count);
+            printf("\n");
+        }
+    }
+
+    return total / ctx->num_keys;
+}
+
+// ---------------------------------------------------------
+// Experiments
+// ---------------------------------------------------------
+
+static void run_differential(const experiment_ctx_t* ctx, ThreadPool& pool) {
+    const double count = count_differential(ctx, pool, ctx->num_rounds,
+        ctx->alpha, ctx->delta, true);
+
+    printf("Average:  %12.1f ", count);
+    print_log2_probability(count);
+    printf("\n");
+}
+
+// ---------------------------------------------------------
+
+static void run_distribution(const experiment_ctx_t* ctx, ThreadPool& pool) {
+    std::vector<speckey32_count_t> counts;
+    const uint64_t min_count = 1ULL << (32 - ctx->max_weight);
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        speckey_count_output_differences(&ctx->keys[i], ctx->branch,
+            ctx->num_rounds, ctx->alpha, min_count, pool, counts);
+
+        const size_t num_results =
+            std::min(counts.size(), ctx->max_num_results);
+        std::partial_sort(counts.begin(), counts.begin() + num_results,
+            counts.end(),
+            [](const speckey32_count_t& a, const speckey32_count_t& b) {
+                return a.count > b.count;
+            });
+
+        printf("Key %4zu: %zu output differences with weight <= %d\n", i,
+            counts.size(), ctx->max_weight);
+
+        for (size_t j = 0; j < num_results; ++j) {
+            printf("  %08x %12" PRIu64 " ", counts[j].difference,
+                counts[j].count);
+            print_log2_probability((double)counts[j].count);
+            printf("\n");
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_trails(const experiment_ctx_t* ctx, ThreadPool& pool) {
+    std::vector<speckey32_trail_t> trails;
+
+    if (!speckey_read_trails(ctx->trails_path.c_str(), trails)) {
+        fprintf(stderr, "Could not read %s\n", ctx->trails_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%4s %6s %-8s    %-8s %6s  %-s\n",
+        "#", "Rounds", "Alpha", "Delta", "Weight", "Probability");
+
+    for (size_t i = 0; i < trails.size(); ++i) {
+        const speckey32_trail_t& trail = trails[i];
+        const size_t num_rounds = speckey_get_num_trail_rounds(trail);
+        const uint16_t* first = trail.rows.front().difference;
+        const uint16_t* last = trail.rows.back().difference;
+        const uint32_t alpha = ((uint32_t)first[0] << 16) | first[1];
+        const uint32_t delta = ((uint32_t)last[0] << 16) | last[1];
+
+        if ((alpha == 0) || (num_rounds == 0)
+            || (num_rounds > SPARX64_NUM_ROUNDS)) {
+            printf("%4zu skipped\n", i);
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const double count = count_differential(ctx, pool, num_rounds,
+            alpha, delta, false);
+        const auto end = std::chrono::steady_clock::now();
+
+        printf("%4zu %6zu %08x -> %08x %6d  ", i, num_rounds, alpha, delta,
+            trail.weight);
+        print_log2_probability(count);
+        printf(" %.2f s\n", std::chrono::duration<double>(end - start).count());
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiment(experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    generate_keys(ctx);
+
+    if (!ctx->trails_path.empty()) {
+        run_trails(ctx, pool);
+    } else if (ctx->has_delta) {
+        run_differential(ctx, pool);
+    } else {
+        run_distribution(ctx, pool);
+    }
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("SPECKEY-Exhaustive-Test");
+    parser.helpString("Evaluates differentials of a single branch of SPARX-64 exactly over all 2^32 inputs under <#keys> random keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-r", "--num_rounds", 1);
+    parser.addArgument("-a", "--alpha", 1);
+    parser.addArgument("-d", "--delta", 1);
+    parser.addArgument("-b", "--branch", 1);
+    parser.addArgument("-n", "--max_num_results", 1);
+    parser.addArgument("-w", "--max_weight", 1);
+    parser.addArgument("-i", "--input", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+
+        if (parser.count("num_rounds")) {
+            ctx->num_rounds = parser.retrieveAsInt("num_rounds");
+        }
+
+        if (parser.count("alpha")) {
+            ctx->has_alpha = true;
+            ctx->alpha = (uint32_t)strtoul(
+                parser.retrieve<std::string>("alpha").c_str(), NULL, 16);
+        }
+
+        if (parser.count("delta")) {
+            ctx->has_delta = true;
+            ctx->delta = (uint32_t)strtoul(
+                parser.retrieve<std::string>("delta").c_str(), NULL, 16);
+        }
+
+        if (parser.count("branch")) {
+            ctx->branch = parser.retrieveAsInt("branch");
+        }
+
+        if (parser.count("max_num_results")) {
+            ctx->max_num_results = parser.retrieveAsInt("max_num_results");
+        }
+
+        if (parser.count("max_weight")) {
+            ctx->max_weight = parser.retrieveAsInt("max_weight");
+        }
+
+        if (parser.count("input")) {
+            ctx->trails_path = parser.retrieve<std::string>("input");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->branch >= SPARX64_NUM_BRANCHES) {
+        fprintf(stderr, "Branch must be in [0, %d]\n",
+            SPARX64_NUM_BRANCHES - 1);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!ctx->trails_path.empty()) {
+        return;
+    }
+
+    if ((ctx->max_weight < 0) || (ctx->max_weight > 32)) {
+        fprintf(stderr, "Maximal weight must be in [0, 32]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_rounds == 0) || (ctx->num_rounds > SPARX64_NUM_ROUNDS)) {
+        fprintf(stderr, "Number of rounds must be in [1, %d]\n",
+            SPARX64_NUM_ROUNDS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!ctx->has_alpha || (ctx->alpha == 0)) {
+        fprintf(stderr, "Alpha must be given and not be zero\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys   %8zu\n", ctx->num_keys);
+    printf("#Rounds %8zu\n", ctx->num_rounds);
+    printf("Branch  %8zu\n", ctx->branch);
+    printf("Alpha   %08x\n", ctx->alpha);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiment(&ctx);
+    return 0;
+}
@@ -6,14 +6,29 @@
  * @last-modified 2018-04
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include "ciphers/sparx64.h"
+#include "ciphers/sparx64_brute_force.h"
+#include "ciphers/sparx64_conforming.h"
+#include "ciphers/sparx64_linear_recovery.h"
+#include "ciphers/sparx64_related_key.h"
+#include "ciphers/sparx64_rx.h"
+#include "ciphers/sparx64_xdp.h"
+#include "ciphers/speckey32_exhaustive.h"
+#include "utils/BiasProfile.h"
 #include "utils/convert.h"
 #include "utils/printing.h"
+#include "utils/StateIterator.h"
+#include "utils/ThreadPool.h"
+#include "utils/WalshHadamard.h"
+#include "utils/xorshift1024.h"
 
 // ---------------------------------------------------------
 // Constants
@@ -121,7 +136,595 @@ static bool test_sparx_64() {
 
 // ---------------------------------------------------------
 
+static bool test_sparx_64_batch() {
+    uint16_t x[SPARX64_STATE_LENGTH];
+    uint16_t c[SPARX64_STATE_LENGTH];
+    uint16_t master_key[SPARX64_KEY_LENGTH];
+    uint64_t states[SPARX64_BATCH_SIZE];
+    bool     all_tests_passed = true;
+
+    initialize_test_vectors(x, master_key);
+
+    sparx64_context_t ctx;
+    sparx_key_schedule(&ctx, master_key);
+
+    // Lane j encrypts the test vector with its lowest word xored with j
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint8_t p[SPARX64_STATE_LENGTH];
+        utils::to_uint8(p, x, SPARX64_STATE_LENGTH);
+        states[j] = utils::to_uint64(p) ^ j;
+    }
+
+    sparx64_batch_t batch;
+    sparx_load_batch(&batch, states);
+    sparx_encrypt_steps_batch(&ctx, &batch, 1, SPARX64_NUM_STEPS);
+    sparx_store_batch(&batch, states);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint16_t p[SPARX64_NUM_STATE_WORDS];
+        memcpy(p, x, SPARX64_STATE_LENGTH);
+        p[3] ^= (uint16_t)j;
+        sparx_encrypt(&ctx, p, c);
+
+        uint8_t expected[SPARX64_STATE_LENGTH];
+        utils::to_uint8(expected, c, SPARX64_STATE_LENGTH);
+        all_tests_passed &= (utils::to_uint64(expected) == states[j]);
+    }
+
+    sparx_load_batch(&batch, states);
+    sparx_decrypt_steps_batch(&ctx, &batch, 1, SPARX64_NUM_STEPS);
+    sparx_store_batch(&batch, states);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint8_t p[SPARX64_STATE_LENGTH];
+        utils::to_uint8(p, x, SPARX64_STATE_LENGTH);
+        all_tests_passed &= ((utils::to_uint64(p) ^ j) == states[j]);
+    }
+
+    puts(all_tests_passed ? "Batch: Passed" : "Batch: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_transpose_64x64() {
+    uint64_t matrix[64];
+    uint64_t transposed[64];
+
+    for (size_t i = 0; i < 64; ++i) {
+        matrix[i] = 0x9E3779B97F4A7C15ULL * (i + 1);
+        matrix[i] ^= matrix[i] >> 29;
+    }
+
+    memcpy(transposed, matrix, sizeof(matrix));
+    utils::transpose_64x64(transposed);
+    bool all_tests_passed = true;
+
+    // Bit positions are counted from the most significant bit
+    for (size_t i = 0; i < 64; ++i) {
+        for (size_t j = 0; j < 64; ++j) {
+            all_tests_passed &= ((transposed[i] >> (63 - j)) & 1)
+                == ((matrix[j] >> (63 - i)) & 1);
+        }
+    }
+
+    puts(all_tests_passed ? "Transpose: Passed" : "Transpose: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_xdp_add() {
+    bool all_tests_passed = true;
+
+    // For any input differences, the probabilities of all output differences
+    // sum up to one
+    const uint16_t inputs[][2] = {
+        {0x0000, 0x0000}, {0x8000, 0x0000}, {0x0211, 0x0A04}, {0x7FFF, 0x1234}
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        double sum = 0.0;
+
+        for (uint32_t gamma = 0; gamma <= 0xFFFF; ++gamma) {
+            const int weight = 
+                xdp_add_weight(inputs[i][0], inputs[i][1], (uint16_t)gamma);
+
+            if (weight != XDP_ADD_IMPOSSIBLE) {
+                sum += 1.0 / (1 << weight);
+            }
+        }
+
+        all_tests_passed &= (sum == 1.0);
+    }
+
+    // First rounds of the 6-round characteristics of weight 13
+    const uint16_t in[2] = {0x0211, 0x0A04};
+    const uint16_t out[2] = {0x2800, 0x0010};
+    const uint16_t in_msb[2] = {0x0040, 0x0000};
+    const uint16_t out_msb[2] = {0x8000, 0x8000};
+    const uint16_t out_invalid[2] = {0x2800, 0x0011};
+    all_tests_passed &= (sparx_arx_box_weight(in, out) == 4);
+    all_tests_passed &= (sparx_arx_box_weight(in_msb, out_msb) == 0);
+    all_tests_passed &= (xdp_add_weight_with_msb(0x8000, 0x0000, 0x8000) == 1);
+    all_tests_passed &= (xdp_add_weight_with_msb(0x8000, 0x8000, 0x0000) == 1);
+
+    // Equal differences in the most significant bit add nothing
+    all_tests_passed &= (xdp_add_weight_with_msb(0x0000, 0x0000, 0x0000) == 0);
+    all_tests_passed &= (xdp_add_weight_with_msb(0xD002, 0xF080, 0xC082) == 4);
+    all_tests_passed &= (xdp_add_weight(0xD002, 0xF080, 0xC082) == 4);
+    all_tests_passed &= 
+        (sparx_arx_box_weight(in, out_invalid) == XDP_ADD_IMPOSSIBLE);
+    all_tests_passed &= 
+        (xdp_add_weight(0x0000, 0x0000, 0x0001) == XDP_ADD_IMPOSSIBLE);
+
+    puts(all_tests_passed ? "XDP+: Passed" : "XDP+: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_speckey_exhaustive() {
+    uint16_t x[SPARX64_STATE_LENGTH];
+    uint16_t master_key[SPARX64_KEY_LENGTH];
+    initialize_test_vectors(x, master_key);
+
+    sparx64_context_t ctx;
+    sparx_key_schedule(&ctx, master_key);
+    utils::ThreadPool pool(2);
+
+    // Over a single round, the key does not change the probabilities of the
+    // characteristics, i.e., the counts are exactly 2^{32 - weight}
+    bool all_tests_passed = 
+        (speckey_count_differential(&ctx, 0, 1, 0x02110A04, 0x28000010, pool)
+            == (1ULL << 28));
+    all_tests_passed &= 
+        (speckey_count_differential(&ctx, 1, 1, 0x00400000, 0x80008000, pool)
+            == SPECKEY32_EXHAUSTIVE_NUM_TEXTS);
+    all_tests_passed &= 
+        (speckey_count_differential(&ctx, 0, 1, 0x02110A04, 0x28000011, pool)
+            == 0);
+
+    // Over a single round, the inverse maps gamma = 80008000 deterministically
+    // to 00400000, s.t. all quartets return
+    all_tests_passed &= 
+        (speckey_count_boomerang(&ctx, 0, 1, 0x02110A04, 0x80008000, pool)
+            == SPECKEY32_EXHAUSTIVE_NUM_TEXTS);
+
+    puts(all_tests_passed ? "SPECKEY exhaustive: Passed" 
+        : "SPECKEY exhaustive: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_brute_force() {
+    uint16_t x[SPARX64_STATE_LENGTH];
+    uint16_t c[SPARX64_STATE_LENGTH];
+    uint16_t master_key[SPARX64_KEY_LENGTH];
+    bool     all_tests_passed = true;
+    initialize_test_vectors(x, master_key);
+
+    sparx64_context_t ctx;
+    sparx_key_schedule(&ctx, master_key);
+
+    for (size_t row = 0; row <= SPARX64_NUM_BRANCHES * SPARX64_NUM_STEPS; ++row) {
+        uint16_t key_state[SPARX64_NUM_KEY_WORDS];
+        uint16_t inverted_key[SPARX64_NUM_KEY_WORDS];
+        sparx_get_key_state(&ctx, row, key_state);
+        sparx_invert_key_schedule(key_state, row, inverted_key);
+        all_tests_passed &= !memcmp(inverted_key, master_key, SPARX64_KEY_LENGTH);
+    }
+
+    // Twelve unknown bits of the key state after the fifth step; two pairs
+    // leave only the correct key
+    sparx64_brute_force_problem_t problem;
+    problem.row = 10;
+    sparx_get_key_state(&ctx, problem.row, problem.key_state);
+    memset(problem.unknown_mask, 0, SPARX64_KEY_LENGTH);
+    problem.unknown_mask[1] = 0x0F0F;
+    problem.unknown_mask[6] = 0x8001;
+    problem.unknown_mask[7] = 0x0300;
+
+    for (size_t i = 0; i < 2; ++i) {
+        uint8_t bytes[SPARX64_STATE_LENGTH];
+        x[3] ^= (uint16_t)i;
+        utils::to_uint8(bytes, x, SPARX64_STATE_LENGTH);
+        problem.plaintexts.push_back(utils::to_uint64(bytes));
+        sparx_encrypt(&ctx, x, c);
+        utils::to_uint8(bytes, c, SPARX64_STATE_LENGTH);
+        problem.ciphertexts.push_back(utils::to_uint64(bytes));
+    }
+
+    utils::ThreadPool pool(2);
+    std::vector<sparx64_master_key_t> keys;
+    all_tests_passed &= sparx_get_num_unknown_bits(&problem) == 12;
+    all_tests_passed &= sparx_brute_force(&problem, pool, keys) == (1 << 12);
+    all_tests_passed &= (keys.size() == 1) 
+        && !memcmp(keys[0].words, master_key, SPARX64_KEY_LENGTH);
+
+    puts(all_tests_passed ? "Brute force: Passed" : "Brute force: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_walsh_hadamard() {
+    const size_t num_bits = 14;
+    const size_t num_values = 1 << num_bits;
+    std::vector<int64_t> values(num_values);
+    std::vector<int64_t> transformed(num_values);
+    utils::ThreadPool pool(2);
+
+    for (size_t x = 0; x < num_values; ++x) {
+        values[x] = (int64_t)((x * 2654435761UL) % 1001) - 500;
+        transformed[x] = values[x];
+    }
+
+    utils::walsh_hadamard_transform(transformed.data(), num_bits, pool);
+    bool all_tests_passed = true;
+
+    // Spot checks against the definition
+    for (size_t s = 0; s < num_values; s += 257) {
+        int64_t expected = 0;
+
+        for (size_t x = 0; x < num_values; ++x) {
+            expected += __builtin_parityll(s & x) ? -values[x] : values[x];
+        }
+
+        all_tests_passed &= (transformed[s] == expected);
+    }
+
+    // The correlations of all key guesses equal the direct sums
+    sparx64_linear_counter_t counter;
+    all_tests_passed &= sparx_linear_init_counter(&counter, 0, 0, 0x01000001);
+    const size_t num_guesses = counter.counts.size();
+
+    for (size_t z = 0; z < num_guesses; ++z) {
+        counter.counts[z] = (int64_t)((z * 40503) % 17) - 8;
+    }
+
+    std::vector<sparx64_linear_guess_t> ranking;
+    sparx_linear_rank_guesses(&counter, 1, pool, ranking);
+    all_tests_passed &= (ranking.size() == num_guesses);
+
+    for (size_t i = 0; i < ranking.size(); ++i) {
+        const uint32_t k = ranking[i].guess;
+        int64_t expected = 0;
+
+        for (size_t z = 0; z < num_guesses; ++z) {
+            uint32_t w = 0;
+
+            // Decompresses z ^ k onto the active bits
+            for (size_t bit = 0, j = 0; bit < 32; ++bit) {
+                if ((counter.active_mask >> bit) & 1) {
+                    w |= (uint32_t)(((z ^ k) >> j++) & 1) << bit;
+                }
+            }
+
+            const uint16_t l = (uint16_t)(w >> 16);
+            const uint16_t d = (uint16_t)(l ^ w);
+            const uint16_t y = (uint16_t)((d >> 2) | (d << 14));
+            const uint16_t e = (uint16_t)(l - y);
+            const uint16_t x = (uint16_t)((e << 7) | (e >> 9));
+            const uint32_t parity = __builtin_parity(
+                counter.output_mask & (((uint32_t)x << 16) | y));
+            expected += parity ? -counter.counts[z] : counter.counts[z];
+        }
+
+        all_tests_passed &= (fabs(ranking[i].correlation - expected) < 1e-9);
+    }
+
+    puts(all_tests_passed ? "Walsh-Hadamard: Passed" : "Walsh-Hadamard: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_state_iterator() {
+    const uint8_t mask[8] = { 0x80, 0x00, 0x00, 0x0f, 0x00, 0x41, 0x00, 0x03 };
+    utils::StateIterator iterator(mask, 8);
+    utils::StateIterator gray_iterator(mask, 8, true);
+    const size_t num_states = iterator.get_num_states();
+    bool all_tests_passed = (num_states == 1 << 9);
+
+    std::vector<uint64_t> states;
+    std::vector<uint64_t> gray_states;
+    uint64_t state_batch[SPARX64_BATCH_SIZE];
+    uint8_t state[8];
+
+    while (iterator.has_next()) {
+        iterator.next(state);
+        states.push_back(utils::to_uint64(state));
+    }
+
+    // Index i takes the bits of i in the active bits from the lowest one
+    all_tests_passed &= (states.size() == num_states);
+    all_tests_passed &= (states[1] == 0x01ULL);
+    all_tests_passed &= (states[4] == 0x010000ULL);
+    all_tests_passed &= (states[num_states - 1] == 0x8000000f00410003ULL);
+
+    for (size_t i = 0; i < num_states; ++i) {
+        all_tests_passed &= (iterator.get_state(i) == states[i]);
+    }
+
+    // Gray-code mode enumerates the same states, one bit apart, also from the
+    // middle of a range
+    for (size_t part = 0; part < 3; ++part) {
+        uint64_t batch[SPARX64_BATCH_SIZE];
+        size_t num_batch_states;
+        gray_iterator.split(part, 3);
+
+        while ((num_batch_states = gray_iterator.next_batch(batch,
+                SPARX64_BATCH_SIZE)) > 0) {
+            gray_states.insert(gray_states.end(), batch,
+                batch + num_batch_states);
+        }
+    }
+
+    all_tests_passed &= (gray_states.size() == num_states);
+
+    for (size_t i = 1; i < gray_states.size(); ++i) {
+        all_tests_passed &=
+            (__builtin_popcountll(gray_states[i] ^ gray_states[i - 1]) == 1);
+        all_tests_passed &= (gray_iterator.get_state(i) == gray_states[i]);
+    }
+
+    std::sort(gray_states.begin(), gray_states.end());
+    std::sort(states.begin(), states.end());
+    all_tests_passed &= (gray_states == states);
+
+    // Indices beyond the states wrap around; empty or missing parts are safe
+    all_tests_passed &= (iterator.get_state(num_states + 4) == 0x010000ULL);
+    gray_iterator.split(3, 3);
+    all_tests_passed &= !gray_iterator.has_next();
+    gray_iterator.split(0, 0);
+    all_tests_passed &=
+        (gray_iterator.next_batch(state_batch, SPARX64_BATCH_SIZE) > 0);
+
+    puts(all_tests_passed ? "State iterator: Passed" : "State iterator: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_rx() {
+    uint64_t states[SPARX64_BATCH_SIZE];
+    uint64_t differences[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t rotated_batch;
+    bool all_tests_passed =
+        (sparx_rx_rotate(0x8001000212344000ULL, 1) == 0x0003000424688000ULL);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        states[j] = utils::splitmix64(j);
+    }
+
+    // The linear layer commutes with the rotation of all words
+    for (size_t gamma = 0; gamma < 16; ++gamma) {
+        sparx_load_batch(&batch, states);
+        sparx_load_batch(&rotated_batch, states);
+        sparx_rx_rotate_batch(&rotated_batch, gamma);
+        sparx_linear_layer_batch(&batch);
+        sparx_linear_layer_batch(&rotated_batch);
+        sparx_rx_get_differences_batch(&batch, &rotated_batch, gamma,
+            differences);
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            all_tests_passed &= (differences[j] == 0);
+        }
+    }
+
+    puts(all_tests_passed ? "RX: Passed" : "RX: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_related_key() {
+    uint16_t key[SPARX64_NUM_KEY_WORDS];
+    uint16_t key_difference[SPARX64_NUM_KEY_WORDS] = { 0 };
+    uint16_t differences[SPARX64_NUM_SUBKEY_ROWS][SPARX64_NUM_SUBKEY_WORDS];
+    sparx64_context_t ctx;
+    sparx64_context_t related;
+    bool all_tests_passed = true;
+
+    for (size_t i = 0; i < SPARX64_NUM_KEY_WORDS; ++i) {
+        key[i] = (uint16_t)utils::splitmix64(i);
+    }
+
+    sparx_key_schedule(&ctx, key);
+
+    // A zero key difference gives zero differences in all subkeys
+    sparx_related_key_schedule(&related, key, key_difference);
+    sparx_get_subkey_differences(&ctx, &related, differences);
+
+    for (size_t row = 0; row < SPARX64_NUM_SUBKEY_ROWS; ++row) {
+        for (size_t i = 0; i < SPARX64_NUM_SUBKEY_WORDS; ++i) {
+            all_tests_passed &= (differences[row][i] == 0);
+        }
+    }
+
+    // The last key word is not used by row 0 (step 1, branch 0), but enters
+    // row 1 through the permutation, after the addition of the counter
+    key_difference[SPARX64_NUM_KEY_WORDS - 1] = 0x0001;
+    sparx_related_key_schedule(&related, key, key_difference);
+    sparx_get_subkey_differences(&ctx, &related, differences);
+
+    for (size_t i = 0; i < SPARX64_NUM_SUBKEY_WORDS; ++i) {
+        all_tests_passed &= (differences[0][i] == 0);
+    }
+
+    all_tests_passed &= (differences[1][0] == 0) && (differences[1][1] != 0);
+
+    puts(all_tests_passed ? "Related keys: Passed" : "Related keys: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static bool test_conforming() {
+    // First step of the best 6-round trail; row 3 follows the linear layer
+    static const uint16_t DIFFERENCES[4][SPARX64_NUM_STATE_WORDS] = {
+        { 0x0000, 0x0000, 0x0211, 0x0A04 },
+        { 0x0000, 0x0000, 0x2800, 0x0010 },
+        { 0x0000, 0x0000, 0x0040, 0x0000 },
+        { 0x8000, 0x8000, 0x0000, 0x0000 }
+    };
+    sparx64_trail_t trail;
+    trail.rows.resize(4);
+
+    for (size_t r = 0; r < 4; ++r) {
+        memcpy(trail.rows[r].difference, DIFFERENCES[r],
+            sizeof(DIFFERENCES[r]));
+    }
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+
+    for (size_t i = 0; i < SPARX64_KEY_LENGTH; ++i) {
+        key[i] = (uint8_t)(17 * i + 3);
+    }
+
+    sparx64_context_t ctx;
+    sparx64_conforming_generator_t generator;
+    sparx_key_schedule(&ctx, key);
+
+    if (!sparx_conforming_init(&generator, &ctx, trail, 3)) {
+        puts("Conforming pairs: Failed");
+        return false;
+    }
+
+    const uint64_t alpha = sparx_conforming_get_alpha(&generator);
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    uint64_t seed = 0;
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+    bool all_tests_passed = (alpha == 0x0000000002110A04ULL)
+        && (generator.weights[0] == 0) && (generator.weights[1] == 6);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        all_tests_passed &= sparx_conforming_next(&generator, &seed, &p[j]);
+        p_[j] = p[j] ^ alpha;
+        all_tests_passed &= sparx_conforming_check(&generator, p[j]);
+    }
+
+    sparx_load_batch(&batch, p);
+    sparx_load_batch(&batch_, p_);
+    sparx_encrypt_steps_batch(&ctx, &batch, 1, 1);
+    sparx_encrypt_steps_batch(&ctx, &batch_, 1, 1);
+    sparx_store_batch(&batch, p);
+    sparx_store_batch(&batch_, p_);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        all_tests_passed &= ((p[j] ^ p_[j]) == 0x8000800000000000ULL);
+    }
+
+    puts(all_tests_passed ? "Conforming pairs: Passed"
+        : "Conforming pairs: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
+static void encrypt_steps_round_wise(const sparx64_context_t* ctx,
+                                     uint64_t states[SPARX64_BATCH_SIZE],
+                                     const size_t num_steps) {
+    sparx64_batch_t batch;
+    sparx_load_batch(&batch, states);
+
+    for (size_t s = 0; s < num_steps; ++s) {
+        for (size_t r = 1; r <= SPARX64_NUM_ROUNDS_PER_STEP; ++r) {
+            sparx_encrypt_round_batch(ctx, &batch,
+                s * SPARX64_NUM_ROUNDS_PER_STEP + r);
+        }
+
+        sparx_linear_layer_batch(&batch);
+    }
+
+    sparx_store_batch(&batch, states);
+}
+
+// ---------------------------------------------------------
+
+static bool test_branch_memoization() {
+    const uint64_t alpha = 0x000000000A604205ULL;
+    const size_t num_steps = 2;
+    uint64_t p[SPARX64_BATCH_SIZE];
+    uint64_t p_[SPARX64_BATCH_SIZE];
+    uint64_t expected[SPARX64_BATCH_SIZE];
+    uint64_t expected_[SPARX64_BATCH_SIZE];
+    uint8_t key[SPARX64_KEY_LENGTH];
+    sparx64_context_t ctx;
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+    bool all_tests_passed = (sparx_get_inactive_branches(alpha) == 1)
+        && (sparx_get_inactive_branches(0xFFFF000000000000ULL) == 2);
+
+    for (size_t i = 0; i < SPARX64_KEY_LENGTH; ++i) {
+        key[i] = (uint8_t)(31 * i + 7);
+    }
+
+    sparx_key_schedule(&ctx, key);
+
+    // Structure with a constant left branch
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        p[j] = 0x0123456700000000ULL | (utils::splitmix64(j) & 0xFFFFFFFFULL);
+        expected[j] = p[j];
+    }
+
+    encrypt_steps_round_wise(&ctx, expected, num_steps);
+
+    sparx_load_batch(&batch, p);
+    sparx_encrypt_steps_structure_batch(&ctx, &batch,
+        sparx_get_inactive_branches(0x00000000FFFFFFFFULL), 1, num_steps);
+    sparx_store_batch(&batch, p);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        all_tests_passed &= (p[j] == expected[j]);
+    }
+
+    // Pairs (P, P ^ alpha) with random, but inactive left branches
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        p[j] = utils::splitmix64(SPARX64_BATCH_SIZE + j);
+        p_[j] = p[j] ^ alpha;
+        expected[j] = p[j];
+        expected_[j] = p_[j];
+    }
+
+    encrypt_steps_round_wise(&ctx, expected, num_steps);
+    encrypt_steps_round_wise(&ctx, expected_, num_steps);
+
+    sparx_load_batch(&batch, p);
+    sparx_load_batch(&batch_, p_);
+    sparx_encrypt_steps_pair_batch(&ctx, &batch, &batch_,
+        sparx_get_inactive_branches(alpha), 1, num_steps);
+    sparx_store_batch(&batch, p);
+    sparx_store_batch(&batch_, p_);
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        all_tests_passed &= (p[j] == expected[j]) && (p_[j] == expected_[j]);
+    }
+
+    puts(all_tests_passed ? "Branch memoization: Passed"
+        : "Branch memoization: Failed");
+    return all_tests_passed;
+}
+
+// ---------------------------------------------------------
+
 int main() {
-    const bool all_tests_passed = test_sparx_64();
+    bool all_tests_passed = test_sparx_64();
+    all_tests_passed &= test_sparx_64_batch();
+    all_tests_passed &= test_transpose_64x64();
+    all_tests_passed &= test_xdp_add();
+    all_tests_passed &= test_speckey_exhaustive();
+    all_tests_passed &= test_brute_force();
+    all_tests_passed &= test_walsh_hadamard();
+    all_tests_passed &= test_state_iterator();
+    all_tests_passed &= test_rx();
+    all_tests_passed &= test_related_key();
+    all_tests_passed &= test_conforming();
+    all_tests_passed &= test_branch_memoization();
     return !all_tests_passed;
 }
@@ -0,0 +1,93 @@
+/**
+ * Imports the CryptoSMT results for SPARX-64 and SPECKEY-32, e.g., all files
+ * below results/, into a binary trail store that sparx-64-trail-query can
+ * search without parsing the text files again.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "utils/argparse.h"
+#include "utils/TrailStore.h"
+
+using utils::TrailStoreBuilder;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    std::vector<std::string> input_paths;
+    std::string output_path;
+} import_ctx_t;
+
+// ---------------------------------------------------------
+// Import
+// ---------------------------------------------------------
+
+static void run_import(const import_ctx_t* ctx) {
+    TrailStoreBuilder builder;
+    size_t num_files = 0;
+
+    for (size_t i = 0; i < ctx->input_paths.size(); ++i) {
+        const char* path = ctx->input_paths[i].c_str();
+        size_t num_trails;
+
+        if (!builder.add_file(path, &num_trails)) {
+            fprintf(stderr, "Skipping %s: could not be parsed\n", path);
+            continue;
+        }
+
+        if (num_trails > 0) {
+            printf("%6zu %s\n", num_trails, path);
+            num_files++;
+        }
+    }
+
+    if (!builder.write(ctx->output_path.c_str())) {
+        fprintf(stderr, "Could not write %s\n", ctx->output_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Imported %zu trails from %zu files into %s\n",
+        builder.get_num_trails(), num_files, ctx->output_path.c_str());
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(import_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Trail-Import");
+    parser.helpString("Imports CryptoSMT characteristics of SPARX-64 and SPECKEY-32 into a binary trail store.");
+    parser.addArgument("-i", "--inputs", '+', false);
+    parser.addArgument("-o", "--output", 1, false);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->input_paths =
+            parser.retrieve<std::vector<std::string> >("inputs");
+        ctx->output_path = parser.retrieve<std::string>("output");
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    import_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_import(&ctx);
+    return 0;
+}
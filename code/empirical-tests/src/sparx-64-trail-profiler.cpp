@@ -0,0 +1,429 @@
+/**
+ * Profiles how many pairs follow a differential characteristic of SPARX-64
+ * round by round. Reads a characteristic from a CryptoSMT result file, e.g.,
+ * from results/sparx64_differentials/, and encrypts <t> random pairs with its
+ * input difference for each of <k> random keys.
+ *
+ * For every round and branch, counts the pairs that followed the trail in
+ * all previous rounds and still follow it after the ARX-box of this round.
+ * The ratio of both is the empirical probability of the transition, which is
+ * reported as weight next to the weight predicted in the file (wl/wr). Pairs
+ * that left the trail are not encrypted further.
+ *
+ * The characteristic is assumed to start at the first round of a step, as
+ * in the sparxround model.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+#include "utils/argparse.h"
+#include "utils/convert.h"
+#include "utils/printing.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random_from_dev_urandom;
+using utils::print_hex;
+using utils::splitmix64;
+using utils::ThreadPool;
+using utils::xorshift_prng_ctx_t;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 1024
+#define KEY_CHUNK_INDEX 0xFFFFFFFFL
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+/**
+ * num_followed[r][b]: #pairs that followed the trail until round r and
+ * whose branch b follows it after round r. num_followed[r][NUM_BRANCHES]
+ * counts the pairs where both branches do.
+ */
+typedef struct {
+    uint64_t num_followed[SPARX64_NUM_ROUNDS][SPARX64_NUM_BRANCHES + 1];
+} round_statistics_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string     trail_path;
+    size_t          trail_index = 0;
+    sparx64_trail_t trail;
+    size_t          num_rounds = 0;
+    uint64_t        alpha = 0;
+    // Expected differences after the ARX-boxes, before the linear layer
+    uint16_t        expected[SPARX64_NUM_ROUNDS][SPARX64_NUM_STATE_WORDS];
+    size_t          num_keys = 0;
+    size_t          num_texts_per_key = 0;
+    size_t          num_batches_per_key = 0;
+    uint64_t        seed = 0;
+    bool            has_seed = false;
+    round_statistics_t total;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint64_t derive_seed(const uint64_t seed,
+                            const size_t key_index,
+                            const size_t chunk_index) {
+    return splitmix64(
+        seed ^ splitmix64(((uint64_t)key_index << 32) | chunk_index)
+    );
+}
+
+// ---------------------------------------------------------
+
+static uint64_t to_state(const uint16_t words[SPARX64_NUM_STATE_WORDS]) {
+    uint64_t state = 0;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        state = (state << 16) | words[i];
+    }
+
+    return state;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * The trail stores the differences at the start of each round. After every
+ * third round, the expected difference after the ARX-boxes is the one
+ * before the linear layer.
+ */
+static void compute_expected_differences(experiment_ctx_t* ctx) {
+    for (size_t r = 0; r < ctx->num_rounds; ++r) {
+        const uint16_t* next = ctx->trail.rows[r + 1].difference;
+
+        if (((r + 1) % SPARX64_NUM_ROUNDS_PER_STEP) != 0) {
+            memcpy(ctx->expected[r], next, SPARX64_STATE_LENGTH);
+            continue;
+        }
+
+        uint8_t after_linear_layer[SPARX64_STATE_LENGTH];
+        uint8_t before_linear_layer[SPARX64_STATE_LENGTH];
+        utils::to_uint8(after_linear_layer, next, SPARX64_STATE_LENGTH);
+        sparx_invert_linear_layer(after_linear_layer, before_linear_layer);
+        utils::to_uint16(ctx->expected[r], before_linear_layer,
+            SPARX64_STATE_LENGTH);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns a mask with bit j set iff the j-th pair in the batches has the
+ * expected difference in the given branch.
+ */
+static uint64_t get_matching_pairs(const sparx64_batch_t* batch,
+                                   const sparx64_batch_t* batch_,
+                                   const uint16_t* expected,
+                                   const size_t branch) {
+    const uint16_t* l  = batch->words[2 * branch];
+    const uint16_t* r  = batch->words[2 * branch + 1];
+    const uint16_t* l_ = batch_->words[2 * branch];
+    const uint16_t* r_ = batch_->words[2 * branch + 1];
+    const uint16_t expected_l = expected[2 * branch];
+    const uint16_t expected_r = expected[2 * branch + 1];
+    uint64_t mask = 0;
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        const uint64_t is_matching =
+            ((l[j] ^ l_[j]) == expected_l) & ((r[j] ^ r_[j]) == expected_r);
+        mask |= is_matching << j;
+    }
+
+    return mask;
+}
+
+// ---------------------------------------------------------
+
+static void print_weight(const uint64_t numerator, const uint64_t denominator) {
+    if ((numerator == 0) || (denominator == 0)) {
+        printf(" %7s", "-");
+        return;
+    }
+
+    printf(" %7.2f", log2((double)denominator) - log2((double)numerator));
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+static void process_batches(const experiment_ctx_t* ctx,
+                            const sparx64_context_t* sparx_ctx,
+                            round_statistics_t* statistics,
+                            const size_t key_index,
+                            const size_t from,
+                            const size_t to) {
+    uint64_t p[SPARX64_BATCH_SIZE];
+    sparx64_batch_t batch;
+    sparx64_batch_t batch_;
+
+    xorshift_prng_ctx_t xorshift_ctx;
+    xorshift1024_init(
+        &xorshift_ctx, derive_seed(ctx->seed, key_index, from)
+    );
+
+    for (size_t i = from; i < to; ++i) {
+        // P = random, P' = P xor alpha
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] = xorshift1024_next(&xorshift_ctx);
+        }
+
+        sparx_load_batch(&batch, p);
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            p[j] ^= ctx->alpha;
+        }
+
+        sparx_load_batch(&batch_, p);
+        uint64_t is_following = ~0ULL;
+
+        for (size_t r = 0; r < ctx->num_rounds; ++r) {
+            sparx_encrypt_round_batch(sparx_ctx, &batch,  r + 1);
+            sparx_encrypt_round_batch(sparx_ctx, &batch_, r + 1);
+
+            uint64_t is_following_all = ~0ULL;
+
+            for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+                const uint64_t is_following_branch = is_following
+                    & get_matching_pairs(&batch, &batch_, ctx->expected[r], b);
+                statistics->num_followed[r][b] +=
+                    __builtin_popcountll(is_following_branch);
+                is_following_all &= is_following_branch;
+            }
+
+            is_following = is_following_all;
+            statistics->num_followed[r][SPARX64_NUM_BRANCHES] +=
+                __builtin_popcountll(is_following);
+
+            if (is_following == 0) {
+                break;
+            }
+
+            if (((r + 1) % SPARX64_NUM_ROUNDS_PER_STEP) == 0) {
+                sparx_linear_layer_batch(&batch);
+                sparx_linear_layer_batch(&batch_);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiment(experiment_ctx_t* ctx,
+                           ThreadPool& pool,
+                           const size_t key_index) {
+    // ---------------------------------------------------------
+    // Initialize cipher context with the key of this index
+    // ---------------------------------------------------------
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    xorshift_prng_ctx_t xorshift_ctx;
+    xorshift1024_init(
+        &xorshift_ctx, derive_seed(ctx->seed, key_index, KEY_CHUNK_INDEX)
+    );
+    utils::get_random(&xorshift_ctx, key, SPARX64_KEY_LENGTH);
+    print_hex("key", key, SPARX64_KEY_LENGTH);
+
+    sparx64_context_t sparx_ctx;
+    sparx_key_schedule(&sparx_ctx, key);
+
+    // Per-thread statistics avoid any synchronization between the threads
+    std::vector<round_statistics_t> statistics(pool.get_num_threads());
+    memset(statistics.data(), 0,
+        statistics.size() * sizeof(round_statistics_t));
+
+    pool.parallel_for(ctx->num_batches_per_key, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            process_batches(ctx, &sparx_ctx, &(statistics[thread_index]),
+                key_index, from, to);
+        }
+    );
+
+    for (size_t i = 0; i < statistics.size(); ++i) {
+        for (size_t r = 0; r < ctx->num_rounds; ++r) {
+            for (size_t b = 0; b <= SPARX64_NUM_BRANCHES; ++b) {
+                ctx->total.num_followed[r][b] +=
+                    statistics[i].num_followed[r][b];
+            }
+        }
+    }
+
+    uint64_t num_right_pairs = 0;
+
+    for (size_t i = 0; i < statistics.size(); ++i) {
+        num_right_pairs +=
+            statistics[i].num_followed[ctx->num_rounds-1][SPARX64_NUM_BRANCHES];
+    }
+
+    printf("%" PRIu64 "\n", num_right_pairs);
+    fflush(stdout);
+}
+
+// ---------------------------------------------------------
+
+static void print_profile(const experiment_ctx_t* ctx) {
+    const uint64_t num_pairs =
+        (uint64_t)ctx->num_keys * ctx->num_batches_per_key * SPARX64_BATCH_SIZE;
+    uint64_t num_previous = num_pairs;
+    int predicted_total = 0;
+
+    printf("\n%5s %4s  %-19s %12s %7s %7s %7s %7s %7s %7s\n",
+        "Round", "Step", "Difference", "#Pairs", "Left", "wl",
+        "Right", "wr", "Total", "Pred.");
+
+    for (size_t r = 0; r < ctx->num_rounds; ++r) {
+        const sparx64_trail_row_t& row = ctx->trail.rows[r];
+        const uint64_t* num_followed = ctx->total.num_followed[r];
+
+        printf("%5zu %4zu  %04x%04x %04x%04x %12" PRIu64,
+            r + 1,
+            r / SPARX64_NUM_ROUNDS_PER_STEP + 1,
+            row.difference[0], row.difference[1],
+            row.difference[2], row.difference[3],
+            num_followed[SPARX64_NUM_BRANCHES]);
+
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            print_weight(num_followed[b], num_previous);
+
+            if (row.weights[b] == SPARX64_TRAIL_NO_WEIGHT) {
+                printf(" %7s", "-");
+            } else {
+                printf(" %7d", row.weights[b]);
+                predicted_total += row.weights[b];
+            }
+        }
+
+        print_weight(num_followed[SPARX64_NUM_BRANCHES], num_pairs);
+        printf(" %7d\n", predicted_total);
+        num_previous = num_followed[SPARX64_NUM_BRANCHES];
+    }
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    memset(&(ctx->total), 0, sizeof(round_statistics_t));
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        run_experiment(ctx, pool, i);
+    }
+
+    print_profile(ctx);
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void load_trail(experiment_ctx_t* ctx) {
+    std::vector<sparx64_trail_t> trails;
+
+    if (!sparx_read_trails(ctx->trail_path.c_str(), trails)) {
+        fprintf(stderr, "Could not read trails from %s\n",
+            ctx->trail_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->trail_index >= trails.size()) {
+        fprintf(stderr, "%s contains only %zu trails\n",
+            ctx->trail_path.c_str(), trails.size());
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->trail = trails[ctx->trail_index];
+    ctx->num_rounds = sparx_get_num_trail_rounds(ctx->trail);
+
+    if ((ctx->num_rounds == 0) || (ctx->num_rounds > SPARX64_NUM_ROUNDS)) {
+        fprintf(stderr, "Trail %zu has %zu rounds\n",
+            ctx->trail_index, ctx->num_rounds);
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->alpha = to_state(ctx->trail.rows[0].difference);
+    compute_expected_differences(ctx);
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Trail-Profiler");
+    parser.helpString("Counts for <k> random keys and <t> random pairs how many pairs follow a CryptoSMT characteristic of SPARX-64/128 after each round and branch.");
+    parser.addArgument("-i", "--input", 1, false);
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-t", "--num_texts", 1, false);
+    parser.addArgument("-n", "--trail_index", 1);
+    parser.addArgument("--seed", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->trail_path = parser.retrieve<std::string>("input");
+        ctx->num_keys = parser.retrieveAsInt("k");
+        ctx->num_texts_per_key = parser.retrieveAsLong("t");
+
+        if (parser.count("trail_index")) {
+            ctx->trail_index = parser.retrieveAsInt("trail_index");
+        }
+
+        if (parser.count("seed")) {
+            ctx->seed = strtoull(
+                parser.retrieve<std::string>("seed").c_str(), NULL, 16
+            );
+            ctx->has_seed = true;
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (!ctx->has_seed) {
+        get_random_from_dev_urandom((uint8_t*)&(ctx->seed), sizeof(uint64_t));
+    }
+
+    ctx->num_batches_per_key =
+        (ctx->num_texts_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+    load_trail(ctx);
+
+    printf("Trail      %s #%zu\n", ctx->trail_path.c_str(), ctx->trail_index);
+    printf("Seed       %016" PRIx64 "\n", ctx->seed);
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs/Key %8zu\n", ctx->num_batches_per_key * SPARX64_BATCH_SIZE);
+    printf("#Rounds    %8zu\n", ctx->num_rounds);
+    printf("Weight     %8d\n", ctx->trail.weight);
+    printf("Alpha      %016" PRIx64 "\n", ctx->alpha);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * Searches a trail store, as written by sparx-64-trail-import, for all 
+ * characteristics of SPARX-64 or SPECKEY-32 with the given number of rounds,
+ * input difference <alpha>, output difference <delta>, and weight range. 
+ * All conditions are optional.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "utils/argparse.h"
+#include "utils/TrailStore.h"
+
+using utils::trail_query_t;
+using utils::trail_store_entry_t;
+using utils::trail_store_row_t;
+using utils::TrailStore;
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string   store_path;
+    trail_query_t query;
+    size_t        max_num_results = 20;
+    bool          print_rows = false;
+} query_ctx_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static void print_difference(const query_ctx_t* ctx, const uint64_t difference) {
+    if (ctx->query.cipher == utils::TRAIL_STORE_SPARX64) {
+        printf("%016" PRIx64, difference);
+    } else {
+        printf("%08" PRIx64, difference);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_trail(const query_ctx_t* ctx, 
+                        const TrailStore& store, 
+                        const trail_store_entry_t& trail) {
+    printf("%6u %6u  ", trail.num_rounds, trail.weight);
+    print_difference(ctx, trail.alpha);
+    printf(" -> ");
+    print_difference(ctx, trail.delta);
+    printf("  %s #%u\n", store.get_source(trail), trail.index_in_source);
+
+    if (!ctx->print_rows) {
+        return;
+    }
+
+    const trail_store_row_t* rows = store.get_rows(trail);
+
+    for (size_t r = 0; r <= trail.num_rounds; ++r) {
+        printf("       %4zu  ", r);
+        print_difference(ctx, rows[r].difference);
+
+        for (size_t b = 0; b < 2; ++b) {
+            if (rows[r].weights[b] != TRAIL_STORE_NO_WEIGHT) {
+                printf(" %3d", rows[r].weights[b]);
+            }
+        }
+
+        printf("\n");
+    }
+}
+
+// ---------------------------------------------------------
+// Query
+// ---------------------------------------------------------
+
+static void run_query(const query_ctx_t* ctx) {
+    TrailStore store;
+
+    if (!store.open(ctx->store_path.c_str())) {
+        fprintf(stderr, "Could not open trail store %s\n", 
+            ctx->store_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<size_t> results;
+    const auto start = std::chrono::steady_clock::now();
+    store.find(ctx->query, results);
+    const auto end = std::chrono::steady_clock::now();
+    const double milliseconds = 
+        std::chrono::duration<double, std::milli>(end - start).count();
+
+    printf("%6s %6s  %-s\n", "Rounds", "Weight", "Trail");
+
+    for (size_t i = 0; (i < results.size()) && (i < ctx->max_num_results); ++i) {
+        print_trail(ctx, store, store.get_trail(results[i]));
+    }
+
+    printf("Found %zu of %zu trails in %.3f ms\n", 
+        results.size(), store.get_num_trails(), milliseconds);
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(query_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Trail-Query");
+    parser.helpString("Searches a trail store for characteristics of SPARX-64 or SPECKEY-32.");
+    parser.addArgument("-i", "--input", 1, false);
+    parser.addArgument("-c", "--cipher", 1);
+    parser.addArgument("-r", "--num_rounds", 1);
+    parser.addArgument("-a", "--alpha", 1);
+    parser.addArgument("-d", "--delta", 1);
+    parser.addArgument("--min_weight", 1);
+    parser.addArgument("--max_weight", 1);
+    parser.addArgument("-n", "--max_num_results", 1);
+    parser.addArgument("--print_rows", 0);
+
+    trail_query_t& query = ctx->query;
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->store_path = parser.retrieve<std::string>("input");
+        ctx->print_rows = parser.retrieveAsFlag("print_rows");
+
+        if (parser.count("cipher")) {
+            const std::string cipher = parser.retrieve<std::string>("cipher");
+
+            if (cipher == "speckey") {
+                query.cipher = utils::TRAIL_STORE_SPECKEY32;
+            } else if (cipher != "sparx") {
+                throw std::invalid_argument("cipher");
+            }
+        }
+
+        if (parser.count("num_rounds")) {
+            query.num_rounds = parser.retrieveAsInt("num_rounds");
+        }
+
+        if (parser.count("alpha")) {
+            query.alpha = strtoull(
+                parser.retrieve<std::string>("alpha").c_str(), NULL, 16);
+            query.has_alpha = true;
+        }
+
+        if (parser.count("delta")) {
+            query.delta = strtoull(
+                parser.retrieve<std::string>("delta").c_str(), NULL, 16);
+            query.has_delta = true;
+        }
+
+        if (parser.count("min_weight")) {
+            query.min_weight = parser.retrieveAsInt("min_weight");
+        }
+
+        if (parser.count("max_weight")) {
+            query.max_weight = parser.retrieveAsInt("max_weight");
+        }
+
+        if (parser.count("max_num_results")) {
+            ctx->max_num_results = parser.retrieveAsInt("max_num_results");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    query_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_query(&ctx);
+    return 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * Searches differential characteristics of SPARX-64 (sparxround model) or
+ * SPECKEY-32 (speckey model) with a multithreaded branch-and-bound search,
+ * as a native alternative to CryptoSMT. Like CryptoSMT, starts at the given
+ * weight and increases it until characteristics are found; with --all,
+ * continues until the maximal weight and prints all characteristics.
+ *
+ * Words can be fixed with the names of the fixedVariables in the YAML files
+ * of CryptoSMT, e.g., --fixed X00=0x0000 X10=0x0000 Y00=0x0211 Y10=0x0A04 for
+ * SPARX-64, or --fixed x0=0x2800 y0=0x0010 for SPECKEY-32. The output has the
+ * format of CryptoSMT, s.t. it can be read by the other tools.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono> // NOLINT(build/c++11)
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_search.h"
+#include "ciphers/sparx64_trail.h"
+#include "utils/argparse.h"
+#include "utils/WorkStealingPool.h"
+
+using utils::WorkStealingPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define DEFAULT_MAX_WEIGHT 64
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    trail_search_problem_t problem;
+    int    min_weight = 0;
+    int    max_weight = DEFAULT_MAX_WEIGHT;
+    // Maximal number of characteristics per weight; 0 = all
+    size_t max_num_trails = 1;
+    bool   find_all = false;
+} search_ctx_t;
+
+// ---------------------------------------------------------
+// Printing
+// ---------------------------------------------------------
+
+static void print_weight(const int weight) {
+    if (weight == SPARX64_TRAIL_NO_WEIGHT) {
+        printf("none    ");
+    } else {
+        printf("-%-7d", weight);
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * X0L, X1L are the left branch after the linear layer, before it is added
+ * to the right one, i.e., L of the right branch of the next row.
+ */
+static void print_sparx_trail(const sparx64_trail_t& trail) {
+    const size_t num_rounds = sparx_get_num_trail_rounds(trail);
+
+    printf("Characteristic for sparxround - Rounds %zu - Wordsize 16 - Weight %d\n",
+        num_rounds, trail.weight);
+    printf("Rounds\tX0      X1      Y0      Y1      X0L     X1L     wl      wr      \n");
+    printf("-----------------------------------------------------------------------\n");
+
+    for (size_t r = 0; r <= num_rounds; ++r) {
+        const sparx64_trail_row_t& row = trail.rows[r];
+        printf("%zu\t0x%04X  0x%04X  0x%04X  0x%04X  ", r,
+            row.difference[0], row.difference[1],
+            row.difference[2], row.difference[3]);
+
+        if ((r < num_rounds) && (((r + 1) % SPARX64_NUM_ROUNDS_PER_STEP) == 0)) {
+            const uint16_t* next = trail.rows[r + 1].difference;
+            const uint16_t t = (uint16_t)(next[2] ^ next[3]);
+            const uint16_t rotated = (uint16_t)((t << 8) | (t >> 8));
+            printf("0x%04X  0x%04X  ", next[2] ^ rotated, next[3] ^ rotated);
+        } else {
+            printf("none    none    ");
+        }
+
+        print_weight(row.weights[0]);
+        print_weight(row.weights[1]);
+        printf("\n");
+    }
+
+    printf("\nWeight: %d\n", trail.weight);
+}
+
+// ---------------------------------------------------------
+
+static void print_speckey_trail(const sparx64_trail_t& trail) {
+    const size_t num_rounds = sparx_get_num_trail_rounds(trail);
+
+    printf("Characteristic for speckey - Rounds %zu - Wordsize 16 - Weight %d\n",
+        num_rounds, trail.weight);
+    printf("Rounds\tx       y       whex    \n");
+    printf("-------------------------------\n");
+
+    for (size_t r = 0; r <= num_rounds; ++r) {
+        const sparx64_trail_row_t& row = trail.rows[r];
+        printf("%zu\t0x%04X  0x%04X  ", r, row.difference[0], row.difference[1]);
+        print_weight(row.weights[0]);
+        printf("\n");
+    }
+
+    printf("\nWeight: %d\n", trail.weight);
+}
+
+// ---------------------------------------------------------
+
+static bool is_before(const sparx64_trail_t& a, const sparx64_trail_t& b) {
+    for (size_t r = 0; r < a.rows.size(); ++r) {
+        const int result = memcmp(a.rows[r].difference, b.rows[r].difference,
+            sizeof(a.rows[r].difference));
+
+        if (result != 0) {
+            return result < 0;
+        }
+    }
+
+    return false;
+}
+
+// ---------------------------------------------------------
+// Search
+// ---------------------------------------------------------
+
+static void run_search(const search_ctx_t* ctx) {
+    WorkStealingPool pool(NUM_THREADS);
+    std::vector<sparx64_trail_t> trails;
+    std::mutex mutex;
+    size_t num_trails = 0;
+
+    const trail_search_callback_t on_trail = [&](const sparx64_trail_t& trail) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if ((ctx->max_num_trails != 0)
+            && (trails.size() >= ctx->max_num_trails)) {
+            return false;
+        }
+
+        trails.push_back(trail);
+        return (ctx->max_num_trails == 0)
+            || (trails.size() < ctx->max_num_trails);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int weight = ctx->min_weight; weight <= ctx->max_weight; ++weight) {
+        trails.clear();
+        trail_search_run(ctx->problem, weight, pool, on_trail);
+
+        const auto end = std::chrono::steady_clock::now();
+        printf("Weight: %d Time: %.2fs\n", weight,
+            std::chrono::duration<double>(end - start).count());
+
+        // The order of the threads is not deterministic
+        std::sort(trails.begin(), trails.end(), is_before);
+
+        for (size_t i = 0; i < trails.size(); ++i) {
+            if (ctx->problem.cipher == TRAIL_SEARCH_SPECKEY32) {
+                print_speckey_trail(trails[i]);
+            } else {
+                print_sparx_trail(trails[i]);
+            }
+        }
+
+        fflush(stdout);
+        num_trails += trails.size();
+
+        if (!trails.empty() && !ctx->find_all) {
+            break;
+        }
+    }
+
+    printf("Found %zu characteristics\n", num_trails);
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+/**
+ * Parses a fixed variable <name><round>=<value>, e.g., X03=0x8000, where the
+ * names are X0, X1, Y0, Y1 for SPARX-64 and x, y for SPECKEY-32.
+ */
+static bool parse_fixed_word(trail_search_problem_t* problem,
+                             const std::string& assignment) {
+    static const char* SPARX_NAMES[] = { "X0", "X1", "Y0", "Y1" };
+    static const char* SPECKEY_NAMES[] = { "x", "y" };
+    const bool is_speckey = (problem->cipher == TRAIL_SEARCH_SPECKEY32);
+    const char** names = is_speckey ? SPECKEY_NAMES : SPARX_NAMES;
+    const size_t num_names = is_speckey ? 2 : 4;
+    const size_t separator = assignment.find('=');
+
+    if (separator == std::string::npos) {
+        return false;
+    }
+
+    for (size_t i = 0; i < num_names; ++i) {
+        const size_t length = strlen(names[i]);
+
+        if (assignment.compare(0, length, names[i]) != 0) {
+            continue;
+        }
+
+        char* end;
+        const unsigned long r = strtoul(assignment.c_str() + length, &end, 10);
+
+        if ((end != assignment.c_str() + separator)
+            || (r > problem->num_rounds)) {
+            return false;
+        }
+
+        const unsigned long value = strtoul(
+            assignment.c_str() + separator + 1, &end, 16);
+
+        if ((*end != '\0') || (value > 0xFFFF)) {
+            return false;
+        }
+
+        trail_search_fix_word(problem, r, i, (uint16_t)value);
+        return true;
+    }
+
+    return false;
+}
+
+// ---------------------------------------------------------
+
+static void parse_args(search_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Trail-Search");
+    parser.helpString("Searches differential characteristics of SPARX-64 or SPECKEY-32 with a multithreaded branch-and-bound search.");
+    parser.addArgument("-r", "--num_rounds", 1, false);
+    parser.addArgument("-c", "--cipher", 1);
+    parser.addArgument("-f", "--fixed", '+');
+    parser.addArgument("-w", "--min_weight", 1);
+    parser.addArgument("--max_weight", 1);
+    parser.addArgument("-n", "--max_num_trails", 1);
+    parser.addArgument("--all", 0);
+
+    std::vector<std::string> fixed_words;
+    trail_search_cipher_t cipher = TRAIL_SEARCH_SPARX64;
+    size_t num_rounds = 0;
+
+    try {
+        parser.parse(argc, argv);
+
+        num_rounds = parser.retrieveAsInt("num_rounds");
+        ctx->find_all = parser.retrieveAsFlag("all");
+
+        if (parser.count("cipher")) {
+            const std::string name = parser.retrieve<std::string>("cipher");
+
+            if (name == "speckey") {
+                cipher = TRAIL_SEARCH_SPECKEY32;
+            } else if (name != "sparx") {
+                throw std::invalid_argument("cipher");
+            }
+        }
+
+        if (parser.count("fixed")) {
+            fixed_words = parser.retrieve<std::vector<std::string> >("fixed");
+        }
+
+        if (parser.count("min_weight")) {
+            ctx->min_weight = parser.retrieveAsInt("min_weight");
+        }
+
+        if (parser.count("max_weight")) {
+            ctx->max_weight = parser.retrieveAsInt("max_weight");
+        }
+
+        // By default, all characteristics of the final weight with --all
+        ctx->max_num_trails = ctx->find_all ? 0 : 1;
+
+        if (parser.count("max_num_trails")) {
+            ctx->max_num_trails = parser.retrieveAsInt("max_num_trails");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if ((num_rounds == 0) || (num_rounds > TRAIL_SEARCH_MAX_NUM_ROUNDS)) {
+        fprintf(stderr, "Number of rounds must be in [1, %d]\n",
+            TRAIL_SEARCH_MAX_NUM_ROUNDS);
+        exit(EXIT_FAILURE);
+    }
+
+    trail_search_init(&(ctx->problem), cipher, num_rounds);
+
+    for (size_t i = 0; i < fixed_words.size(); ++i) {
+        if (!parse_fixed_word(&(ctx->problem), fixed_words[i])) {
+            fprintf(stderr, "Invalid fixed word %s\n", fixed_words[i].c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    search_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_search(&ctx);
+    return 0;
+}
@@ -0,0 +1,359 @@
+/**
+ * Verifies the characteristics in CryptoSMT result files of SPARX-64 
+ * (sparxround model) and SPECKEY-32 (speckey model) against the exact 
+ * differential probabilities of the ARX-boxes. For every characteristic, 
+ * propagates the differences through A and the linear layer L2 of the cipher,
+ * computes the weight of every ARX-box with the formulas of Lipmaa and Moriai,
+ * and compares them with the weights wl/wr resp. whex of the file.
+ *
+ * The files are verified in parallel. Reports per file the number of 
+ * characteristics that are valid, those whose weights per round only differ 
+ * since the file also counts the free most significant bit, those that are 
+ * impossible, those whose weights per round differ from the exact ones, and 
+ * those whose total weight differs.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <inttypes.h>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "ciphers/sparx64_trail.h"
+#include "ciphers/sparx64_xdp.h"
+#include "ciphers/speckey32_trail.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef enum {
+    TRAIL_VALID = 0,
+    TRAIL_MSB_COUNTED = 1,
+    TRAIL_IMPOSSIBLE = 2,
+    TRAIL_ROUND_WEIGHT_MISMATCH = 3,
+    TRAIL_WEIGHT_MISMATCH = 4,
+    NUM_TRAIL_STATUSES = 5
+} trail_status_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    std::string path;
+    bool        is_readable = true;
+    std::vector<sparx64_trail_t>   sparx_trails;
+    std::vector<speckey32_trail_t> speckey_trails;
+    std::vector<trail_status_t>    statuses;
+    size_t      num_trails_per_status[NUM_TRAIL_STATUSES] = {0};
+} file_result_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    std::vector<file_result_t> results;
+    bool print_mismatches = false;
+} verify_ctx_t;
+
+// ---------------------------------------------------------
+// Verification
+// ---------------------------------------------------------
+
+/**
+ * Returns the worse of the current status and that of a round with the 
+ * exact weight, the weight with the most significant bit, and the weight of
+ * the file.
+ */
+static trail_status_t verify_round(const trail_status_t status, 
+                                   const int weight, 
+                                   const int weight_with_msb, 
+                                   const int trail_weight) {
+    if (weight == trail_weight) {
+        return status;
+    }
+
+    if ((weight_with_msb == trail_weight) && (status == TRAIL_VALID)) {
+        return TRAIL_MSB_COUNTED;
+    }
+
+    return (weight_with_msb == trail_weight) 
+        ? status : TRAIL_ROUND_WEIGHT_MISMATCH;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Trails without a weight line are only checked round by round.
+ */
+static trail_status_t verify_trail(const sparx64_trail_t& trail) {
+    std::vector<sparx64_xdp_round_t> rounds;
+    const int weight = sparx_get_exact_trail_weights(trail, rounds);
+
+    if (weight == XDP_ADD_IMPOSSIBLE) {
+        return TRAIL_IMPOSSIBLE;
+    }
+
+    if ((trail.weight != SPARX64_TRAIL_NO_WEIGHT) && (weight != trail.weight)) {
+        return TRAIL_WEIGHT_MISMATCH;
+    }
+
+    trail_status_t status = TRAIL_VALID;
+
+    for (size_t r = 0; r < rounds.size(); ++r) {
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            status = verify_round(status, rounds[r].weights[b], 
+                rounds[r].weights_with_msb[b], trail.rows[r].weights[b]);
+        }
+    }
+
+    return status;
+}
+
+// ---------------------------------------------------------
+
+static trail_status_t verify_trail(const speckey32_trail_t& trail) {
+    std::vector<speckey32_xdp_round_t> rounds;
+    const int weight = speckey_get_exact_trail_weights(trail, rounds);
+
+    if (weight == XDP_ADD_IMPOSSIBLE) {
+        return TRAIL_IMPOSSIBLE;
+    }
+
+    if ((trail.weight != SPECKEY32_TRAIL_NO_WEIGHT) && (weight != trail.weight)) {
+        return TRAIL_WEIGHT_MISMATCH;
+    }
+
+    trail_status_t status = TRAIL_VALID;
+
+    for (size_t r = 0; r < rounds.size(); ++r) {
+        status = verify_round(status, rounds[r].weight, 
+            rounds[r].weight_with_msb, trail.rows[r].weight);
+    }
+
+    return status;
+}
+
+// ---------------------------------------------------------
+
+static void count_status(file_result_t* result, const trail_status_t status) {
+    result->statuses.push_back(status);
+    result->num_trails_per_status[status]++;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * A file contains either SPARX-64 or SPECKEY-32 characteristics.
+ */
+static void verify_file(file_result_t* result) {
+    const char* path = result->path.c_str();
+
+    if (!sparx_read_trails(path, result->sparx_trails)
+        || !speckey_read_trails(path, result->speckey_trails)) {
+        result->is_readable = false;
+        return;
+    }
+
+    for (size_t i = 0; i < result->sparx_trails.size(); ++i) {
+        count_status(result, verify_trail(result->sparx_trails[i]));
+    }
+
+    for (size_t i = 0; i < result->speckey_trails.size(); ++i) {
+        count_status(result, verify_trail(result->speckey_trails[i]));
+    }
+}
+
+// ---------------------------------------------------------
+// Printing
+// ---------------------------------------------------------
+
+static void print_weight(const int weight) {
+    if (weight == XDP_ADD_IMPOSSIBLE) {
+        printf(" %5s", "-");
+    } else {
+        printf(" %5d", weight);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_mismatch(const sparx64_trail_t& trail, const size_t index) {
+    std::vector<sparx64_xdp_round_t> rounds;
+    const int weight = sparx_get_exact_trail_weights(trail, rounds);
+
+    printf("  #%zu: weight %d, exact", index, trail.weight);
+    print_weight(weight);
+    printf("\n  %5s  %-19s %5s %5s %5s %5s\n", 
+        "Round", "Difference", "wl", "Exact", "wr", "Exact");
+
+    for (size_t r = 0; r < rounds.size(); ++r) {
+        const sparx64_trail_row_t& row = trail.rows[r];
+        printf("  %5zu  %04x%04x %04x%04x", r, 
+            row.difference[0], row.difference[1], 
+            row.difference[2], row.difference[3]);
+
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            printf(" %5d", row.weights[b]);
+            print_weight(rounds[r].weights[b]);
+        }
+
+        printf("\n");
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_mismatch(const speckey32_trail_t& trail, const size_t index) {
+    std::vector<speckey32_xdp_round_t> rounds;
+    const int weight = speckey_get_exact_trail_weights(trail, rounds);
+
+    printf("  #%zu: weight %d, exact", index, trail.weight);
+    print_weight(weight);
+    printf("\n  %5s  %-9s %5s %5s\n", "Round", "Difference", "w", "Exact");
+
+    for (size_t r = 0; r < rounds.size(); ++r) {
+        const speckey32_trail_row_t& row = trail.rows[r];
+        printf("  %5zu  %04x%04x %5d", r, 
+            row.difference[0], row.difference[1], row.weight);
+        print_weight(rounds[r].weight);
+        printf("\n");
+    }
+}
+
+// ---------------------------------------------------------
+
+static void print_results(const verify_ctx_t* ctx) {
+    printf("%8s %8s %8s %8s %8s %8s  %s\n", 
+        "#Trails", "Valid", "MSB", "Imposs.", "Rounds", "Total", "File");
+
+    for (size_t i = 0; i < ctx->results.size(); ++i) {
+        const file_result_t& result = ctx->results[i];
+
+        if (!result.is_readable) {
+            printf("%8s %8s %8s %8s %8s %8s  %s\n", 
+                "-", "-", "-", "-", "-", "-", result.path.c_str());
+            continue;
+        }
+
+        if (result.statuses.empty()) {
+            continue;
+        }
+
+        printf("%8zu", result.statuses.size());
+
+        for (size_t j = 0; j < NUM_TRAIL_STATUSES; ++j) {
+            printf(" %8zu", result.num_trails_per_status[j]);
+        }
+
+        printf("  %s\n", result.path.c_str());
+
+        if (!ctx->print_mismatches) {
+            continue;
+        }
+
+        // Trails that only count the most significant bit are not printed
+        for (size_t j = 0; j < result.sparx_trails.size(); ++j) {
+            if (result.statuses[j] > TRAIL_MSB_COUNTED) {
+                print_mismatch(result.sparx_trails[j], j);
+            }
+        }
+
+        const size_t offset = result.sparx_trails.size();
+
+        for (size_t j = 0; j < result.speckey_trails.size(); ++j) {
+            if (result.statuses[offset + j] > TRAIL_MSB_COUNTED) {
+                print_mismatch(result.speckey_trails[j], j);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static size_t run_verification(verify_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    const auto start = std::chrono::steady_clock::now();
+
+    pool.parallel_for(ctx->results.size(), 1,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            (void)thread_index;
+
+            for (size_t i = from; i < to; ++i) {
+                verify_file(&(ctx->results[i]));
+            }
+        }
+    );
+
+    const auto end = std::chrono::steady_clock::now();
+    print_results(ctx);
+
+    size_t num_trails = 0;
+    size_t num_impossible = 0;
+
+    for (size_t i = 0; i < ctx->results.size(); ++i) {
+        num_trails += ctx->results[i].statuses.size();
+        num_impossible += 
+            ctx->results[i].num_trails_per_status[TRAIL_IMPOSSIBLE];
+    }
+
+    printf("Verified %zu trails in %.3f s\n", num_trails, 
+        std::chrono::duration<double>(end - start).count());
+    return num_impossible;
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(verify_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Trail-Verify");
+    parser.helpString("Verifies the weights of CryptoSMT characteristics of SPARX-64 and SPECKEY-32 with the exact differential probabilities of their ARX-boxes.");
+    parser.addArgument("-i", "--inputs", '+', false);
+    parser.addArgument("--print_mismatches", 0);
+
+    try {
+        parser.parse(argc, argv);
+
+        const std::vector<std::string> paths =
+            parser.retrieve<std::vector<std::string> >("inputs");
+        ctx->print_mismatches = parser.retrieveAsFlag("print_mismatches");
+        ctx->results.resize(paths.size());
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            ctx->results[i].path = paths[i];
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    verify_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+
+    if (run_verification(&ctx) > 0) {
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -1,6 +1,16 @@
 /**
  * Truncated-Differential Attack on n-Step SPARX-647128
  * 
+ * Keys and texts are derived deterministically from a 64-bit seed. The texts
+ * of each key are processed in chunks; with --checkpoint, the state of the
+ * experiment is periodically stored to a file, and --resume continues an
+ * interrupted run from that file.
+ * 
+ * With --shard i/n, the process only handles every n-th (key, chunk) pair,
+ * starting from the i-th, and stores its partial result in its checkpoint. 
+ * The partial results of all shards are combined with 
+ * sparx-64-merge-results.
+ * 
  * @author Ralph Ankele, Eik List
  * @copyright see license.txt
  * @last-modified 2018-04
@@ -10,19 +20,28 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
+#include <inttypes.h>
 #include <atomic>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
 #include <thread> // NOLINT(build/c++11)
 #include <vector>
 
 #include "ciphers/sparx64.h"
 #include "utils/argparse.h"
+#include "utils/checkpoint.h"
 #include "utils/convert.h"
 #include "utils/printing.h"
 #include "utils/xorshift1024.h"
 #include "utils/xor.h"
 
+using utils::checkpoint_key_t;
+using utils::checkpoint_t;
 using utils::get_random;
+using utils::get_random_from_dev_urandom;
 using utils::print_hex;
+using utils::splitmix64;
 using utils::to_uint16;
 using utils::to_uint64;
 using utils::xor_difference;
@@ -33,8 +52,9 @@ using utils::xorshift_prng_ctx_t;
 // ---------------------------------------------------------
 
 #define NUM_THREADS 8
-#define ROTL16(x, n) (((x) << n) | ((x) >> (16 - (n))))
-#define ROTR16(x, n) (((x) >> n) | ((x) << (16 - (n))))
+#define NUM_TEXTS_PER_CHUNK (1L << 24)
+#define KEY_CHUNK_INDEX 0xFFFFFFFFL
+#define EXPERIMENT_NAME "sparx-64-truncated-diff-cpa"
 #define SWAP(x, y) tmp = x; x = y; y = tmp
 
 // ---------------------------------------------------------
@@ -49,11 +69,20 @@ typedef struct {
     const uint64_t delta_mask          = 0x00000000FFFFFFFFL;
     // The bits that are one in our mask must have the following difference:
     const uint64_t delta               = 0x0000000000000000L;
-    const size_t   num_texts_per_key   = 1L << 32;
+    size_t         num_texts_per_key   = 1L << 32;
     const size_t   num_rounds_inverted = 2;
     const size_t   num_steps           = 5;
     size_t         num_keys            = 0;
     size_t         num_collisions      = 0;
+    uint64_t       seed                = 0;
+    bool           has_seed            = false;
+    bool           resume              = false;
+    std::string    checkpoint_path;
+    size_t         checkpoint_interval = 60;
+    size_t         shard_index         = 0;
+    size_t         num_shards          = 1;
+    time_t         last_checkpoint_time = 0;
+    checkpoint_t   checkpoint;
 } experiment_ctx_t;
 
 // ---------------------------------------------------------
@@ -74,6 +103,38 @@ static void L2_inverse(uint16_t* state) {
 
 // ---------------------------------------------------------
 
+/**
+ * Derives the seed of the PRNG for the texts of the given chunk of the given
+ * key from the master seed. The key itself is derived with the chunk index
+ * KEY_CHUNK_INDEX.
+ */
+static uint64_t derive_seed(const uint64_t seed,
+                            const size_t key_index,
+                            const size_t chunk_index) {
+    return splitmix64(
+        seed ^ splitmix64(((uint64_t)key_index << 32) | chunk_index)
+    );
+}
+
+// ---------------------------------------------------------
+
+static void store_checkpoint(experiment_ctx_t* ctx) {
+    if (ctx->checkpoint_path.empty()) {
+        return;
+    }
+
+    if (!utils::write_checkpoint(&(ctx->checkpoint),
+                                 ctx->checkpoint_path.c_str())) {
+        fprintf(stderr, "Could not write checkpoint %s\n",
+            ctx->checkpoint_path.c_str());
+        return;
+    }
+
+    ctx->last_checkpoint_time = time(NULL);
+}
+
+// ---------------------------------------------------------
+
 static bool has_correct_difference(const uint64_t delta_c, 
                                    const uint64_t desired_delta, 
                                    const uint64_t delta_mask) {
@@ -86,11 +147,10 @@ static bool has_correct_difference(const uint64_t delta_c,
 // Experiment
 // ---------------------------------------------------------
 
-static void experiment_thread(experiment_ctx_t* ctx, 
-                              const sparx64_context_t* sparx_ctx, 
-                              std::atomic<size_t>& counter, 
-                              const size_t from, 
-                              const size_t to) {
+static size_t process_chunk(const experiment_ctx_t* ctx, 
+                            const sparx64_context_t* sparx_ctx, 
+                            const size_t key_index, 
+                            const size_t chunk_index) {
     size_t num_collisions = 0;
 
     uint8_t internalstate1[SPARX64_STATE_LENGTH];
@@ -110,9 +170,19 @@ static void experiment_thread(experiment_ctx_t* ctx,
     memset(ciphertext1, 0, SPARX64_STATE_LENGTH);
     memset(ciphertext2, 0, SPARX64_STATE_LENGTH);
 
-    // use xorshift generator for random numbers
+    // use xorshift generator for random numbers, seeded per chunk s.t. the 
+    // chunk can be recomputed after an interruption
     xorshift_prng_ctx_t xorshift_ctx;
-    xorshift1024_init(&xorshift_ctx);
+    xorshift1024_init(
+        &xorshift_ctx, derive_seed(ctx->seed, key_index, chunk_index)
+    );
+
+    const size_t from = chunk_index * NUM_TEXTS_PER_CHUNK;
+    size_t to = from + NUM_TEXTS_PER_CHUNK;
+
+    if (to > ctx->num_texts_per_key) {
+        to = ctx->num_texts_per_key;
+    }
 
     for (size_t j = from; j < to; ++j) {
         // Generate 2^32 random pairs
@@ -146,71 +216,184 @@ static void experiment_thread(experiment_ctx_t* ctx,
         }
     }
     
-    counter += num_collisions;
+    return num_collisions;
+}
+
+// ---------------------------------------------------------
+
+static void experiment_thread(experiment_ctx_t* ctx, 
+                              const sparx64_context_t* sparx_ctx, 
+                              const size_t key_index, 
+                              std::atomic<size_t>& next_chunk_index, 
+                              std::mutex& mutex) {
+    checkpoint_key_t& key_state = ctx->checkpoint.keys[key_index];
+    const size_t num_chunks = key_state.chunk_counts.size();
+
+    while (true) {
+        const size_t chunk_index = next_chunk_index++;
+
+        if (chunk_index >= num_chunks) {
+            break;
+        }
+
+        // Chunks are claimed by exactly one thread, so only this thread 
+        // can change the entry
+        if ((key_state.chunk_counts[chunk_index] 
+             != utils::CHECKPOINT_CHUNK_PENDING)
+            || !utils::is_in_shard(ctx->checkpoint, key_index, chunk_index)) {
+            continue;
+        }
+
+        const size_t num_collisions = 
+            process_chunk(ctx, sparx_ctx, key_index, chunk_index);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        key_state.chunk_counts[chunk_index] = num_collisions;
+
+        if (time(NULL) - ctx->last_checkpoint_time 
+            >= (time_t)ctx->checkpoint_interval) {
+            store_checkpoint(ctx);
+        }
+    }
 }
 
 // ---------------------------------------------------------------------
 
 static void experiment_threading(experiment_ctx_t* ctx, 
-                                 sparx64_context_t* sparx_ctx) {
+                                 sparx64_context_t* sparx_ctx, 
+                                 const size_t key_index) {
 
     // ---------------------------------------------------------------------
-    // For all key candidates
+    // Threads claim the pending chunks of the key one after another
     // ---------------------------------------------------------------------
 
     std::vector<std::thread> threads;
     threads.reserve(NUM_THREADS);
-    std::atomic<std::size_t> num_collisions(0);
-
-    const size_t offset = ctx->num_texts_per_key / NUM_THREADS;
+    std::atomic<std::size_t> next_chunk_index(0);
+    std::mutex mutex;
 
     for (size_t i = 0; i < NUM_THREADS; ++i) {
-        size_t from = i * offset;
-        size_t to = (i+1) * offset;
-
-        if (i+1 == NUM_THREADS) {
-            to = ctx->num_texts_per_key;
-        }
-
         threads.emplace_back(experiment_thread, 
-            std::ref(ctx), 
-            std::ref(sparx_ctx), 
-            std::ref(num_collisions),
-            from, 
-            to
+            ctx, 
+            sparx_ctx, 
+            key_index,
+            std::ref(next_chunk_index),
+            std::ref(mutex)
         );
     }
 
     for (auto& thread : threads) {
         thread.join();
     }
-
-    printf("%zu\n", num_collisions.load());
-    ctx->num_collisions += num_collisions.load();
 }
 
 // ---------------------------------------------------------------------
 
-static void run_experiment(experiment_ctx_t* ctx) {
+static void run_experiment(experiment_ctx_t* ctx, const size_t key_index) {
 
     // ---------------------------------------------------------
-    // Initialize cipher context with random key
+    // Initialize cipher context with the key of the checkpoint
     // ---------------------------------------------------------
 
-    uint8_t key[SPARX64_KEY_LENGTH];
-    get_random(key, SPARX64_KEY_LENGTH);
-    print_hex("key", key, SPARX64_KEY_LENGTH);
+    const checkpoint_key_t& key_state = ctx->checkpoint.keys[key_index];
+    print_hex("key", key_state.key.data(), SPARX64_KEY_LENGTH);
 
-    sparx64_context_t sparx_ctx;
-    sparx_key_schedule(&sparx_ctx, key);
-    experiment_threading(ctx, &sparx_ctx);
+    if (!utils::is_shard_finished(ctx->checkpoint, key_index)) {
+        sparx64_context_t sparx_ctx;
+        sparx_key_schedule(&sparx_ctx, key_state.key.data());
+        experiment_threading(ctx, &sparx_ctx, key_index);
+        store_checkpoint(ctx);
+    }
+
+    const size_t num_collisions = utils::get_total_count(key_state);
+    printf("%zu\n", num_collisions);
+    fflush(stdout);
+    ctx->num_collisions += num_collisions;
+}
+
+// ---------------------------------------------------------
+
+static void create_checkpoint(experiment_ctx_t* ctx) {
+    checkpoint_t& checkpoint = ctx->checkpoint;
+
+    if (!ctx->has_seed) {
+        get_random_from_dev_urandom((uint8_t*)&(ctx->seed), sizeof(uint64_t));
+    }
+
+    checkpoint.experiment = EXPERIMENT_NAME;
+    checkpoint.seed = ctx->seed;
+    checkpoint.num_keys = ctx->num_keys;
+    checkpoint.num_texts_per_key = ctx->num_texts_per_key;
+    checkpoint.num_chunks_per_key = 
+        (ctx->num_texts_per_key + NUM_TEXTS_PER_CHUNK - 1) / NUM_TEXTS_PER_CHUNK;
+    checkpoint.shard_index = ctx->shard_index;
+    checkpoint.num_shards = ctx->num_shards;
+    checkpoint.keys.resize(ctx->num_keys);
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        checkpoint_key_t& key_state = checkpoint.keys[i];
+        key_state.key_index = i;
+        key_state.key.resize(SPARX64_KEY_LENGTH);
+        key_state.chunk_counts.assign(
+            checkpoint.num_chunks_per_key, utils::CHECKPOINT_CHUNK_PENDING
+        );
+
+        xorshift_prng_ctx_t xorshift_ctx;
+        xorshift1024_init(
+            &xorshift_ctx, derive_seed(ctx->seed, i, KEY_CHUNK_INDEX)
+        );
+        get_random(&xorshift_ctx, key_state.key.data(), SPARX64_KEY_LENGTH);
+    }
+}
+
+// ---------------------------------------------------------
+
+static void load_checkpoint(experiment_ctx_t* ctx) {
+    checkpoint_t& checkpoint = ctx->checkpoint;
+
+    if (!utils::read_checkpoint(&checkpoint, ctx->checkpoint_path.c_str())) {
+        fprintf(stderr, "Could not read checkpoint %s\n", 
+            ctx->checkpoint_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if ((checkpoint.experiment != EXPERIMENT_NAME) 
+        || (checkpoint.num_keys != ctx->num_keys)
+        || (checkpoint.num_texts_per_key != ctx->num_texts_per_key)
+        || (checkpoint.keys.size() != ctx->num_keys)
+        || (checkpoint.shard_index != ctx->shard_index)
+        || (checkpoint.num_shards != ctx->num_shards)) {
+        fprintf(stderr, "Checkpoint %s does not match the parameters\n", 
+            ctx->checkpoint_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->seed = checkpoint.seed;
 }
 
 // ---------------------------------------------------------
 
 static void run_experiments(experiment_ctx_t* ctx) {
+    if (ctx->resume) {
+        load_checkpoint(ctx);
+    } else {
+        create_checkpoint(ctx);
+        store_checkpoint(ctx);
+    }
+
+    printf("Seed       %016" PRIx64 "\n", ctx->seed);
+
+    if (ctx->num_shards > 1) {
+        printf("Shard      %8zu/%zu\n", ctx->shard_index, ctx->num_shards);
+    }
+
     for (size_t i = 0; i < ctx->num_keys; ++i) {
-        run_experiment(ctx);
+        run_experiment(ctx, i);
+    }
+
+    if (ctx->num_shards > 1) {
+        printf("Partial result stored in %s\n", ctx->checkpoint_path.c_str());
+        return;
     }
 
     const double average_num_collisions = (double)ctx->num_collisions / ctx->num_keys;
@@ -225,16 +408,69 @@ static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
     ArgumentParser parser;
     parser.appName("Truncated-Differential-CPA");
     parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-t", "--num_texts", 1);
+    parser.addArgument("--seed", 1);
+    parser.addArgument("--checkpoint", 1);
+    parser.addArgument("--checkpoint_interval", 1);
+    parser.addArgument("--resume", 0);
+    parser.addArgument("--shard", 1);
 
     try {
         parser.parse(argc, argv);
 
         ctx->num_keys = parser.retrieveAsInt("k");
+
+        if (parser.count("t")) {
+            ctx->num_texts_per_key = parser.retrieveAsLong("t");
+        }
+
+        if (parser.count("seed")) {
+            ctx->seed = strtoull(
+                parser.retrieve<std::string>("seed").c_str(), NULL, 16
+            );
+            ctx->has_seed = true;
+        }
+
+        if (parser.count("checkpoint")) {
+            ctx->checkpoint_path = parser.retrieve<std::string>("checkpoint");
+        }
+
+        if (parser.count("checkpoint_interval")) {
+            ctx->checkpoint_interval = parser.retrieveAsLong("checkpoint_interval");
+        }
+
+        ctx->resume = parser.retrieveAsFlag("resume");
+
+        if (parser.count("shard")) {
+            const std::string shard = parser.retrieve<std::string>("shard");
+
+            if ((sscanf(shard.c_str(), "%zu/%zu", 
+                        &(ctx->shard_index), &(ctx->num_shards)) != 2)
+                || (ctx->shard_index >= ctx->num_shards)) {
+                throw std::invalid_argument("shard must be i/n with i < n");
+            }
+        }
     } catch( ... ) { 
         fprintf(stderr, "%s\n", parser.usage().c_str());
         exit(EXIT_FAILURE);
     }
 
+    if (ctx->resume && ctx->checkpoint_path.empty()) {
+        fprintf(stderr, "--resume needs a --checkpoint file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_shards > 1) && !ctx->has_seed && !ctx->resume) {
+        fprintf(stderr, "--shard needs the same --seed for all shards\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_shards > 1) && ctx->checkpoint_path.empty()) {
+        ctx->checkpoint_path = std::string(EXPERIMENT_NAME) 
+            + "-shard-" + std::to_string(ctx->shard_index) 
+            + "-of-" + std::to_string(ctx->num_shards) + ".jsonl";
+    }
+
     printf("#Keys      %8zu\n", ctx->num_keys);
     printf("#Pairs     %8zu\n", ctx->num_texts_per_key);
 }
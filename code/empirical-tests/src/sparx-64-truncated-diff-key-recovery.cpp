@@ -0,0 +1,601 @@
+/**
+ * Key recovery with the truncated differential of sparx-64-truncated-diff-cpa
+ * over <s> steps of SPARX-64, extended by two rounds of step <s> + 1.
+ *
+ * The distinguisher demands a zero difference in the right branch at the end
+ * of the ARX-boxes of step <s>. After the linear layer, this is a 32-bit
+ * condition on the input difference (L, R) of step <s> + 1: L = R ^ L'(R),
+ * where L' is the Feistel function of the linear layer. The ciphertexts are
+ * taken after the second round of step <s> + 1:
+ *
+ * - Inverting the A of the final round needs no key.
+ * - Inverting the A before it needs the 32-bit key of the final round per
+ *   branch. The difference of the right word y of each branch after this
+ *   inversion does not depend on the key.
+ *
+ * From both y-differences, the 32-bit condition predicts the difference of
+ * the left word x of both branches; a key guess of a branch is consistent
+ * with a pair if it yields the predicted x-difference. A guess of both
+ * branches is counted for every pair that is consistent with both, s.t.
+ * right pairs vote for the correct key with probability one and random
+ * pairs for any key with probability about 2^{-32}.
+ * Each thread counts into its own array of counters, which are added per
+ * key.
+ *
+ * Guessing all 64 key bits is not practical for experiments; only the
+ * lowest <g> + 1 bits of the 32-bit final-round key of each branch but bit
+ * 1 are guessed, and the remaining bits are set to their correct values.
+ * Bit 1 of k1 is rotated into the MSB of y and only flips the MSBs of both
+ * x, which cancel in their difference; both values of it are equivalent.
+ * Per key, the tool reports the counter of the correct guess, its rank
+ * among all 2^{2g} guesses, where only guesses with a higher count are
+ * ranked before it, and the number of other guesses with the same count.
+ * A key counts as a success only if its guess is ranked first without ties.
+ *
+ * The chosen plaintexts are derived as in sparx-64-truncated-diff-cpa: pairs
+ * with difference alpha are chosen after the first two rounds and decrypted
+ * with the key, which models the plaintext structures of the attack.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono> // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64.h"
+#include "utils/argparse.h"
+#include "utils/ThreadPool.h"
+#include "utils/xorshift1024.h"
+
+using utils::get_random;
+using utils::splitmix64;
+using utils::ThreadPool;
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+#define NUM_THREADS 8
+#define NUM_BATCHES_PER_CHUNK 256
+#define NUM_ROUNDS_INVERTED 2
+#define MAX_NUM_KEY_BITS 12
+#define DEFAULT_NUM_KEY_BITS 8
+
+// Bit 1 of k1 becomes the MSB of y, which cancels in the x-differences
+#define EQUIVALENT_KEY_BIT 1
+
+// ---------------------------------------------------------
+// Types
+// ---------------------------------------------------------
+
+typedef struct {
+    uint64_t alpha = 0x000000000a604205ULL;
+    size_t   num_keys = 0;
+    size_t   num_pairs_per_key = 1ULL << 32;
+    size_t   num_steps = 5;
+    size_t   num_key_bits = DEFAULT_NUM_KEY_BITS;
+} experiment_ctx_t;
+
+// ---------------------------------------------------------
+
+/**
+ * The texts of a batch of pairs after the keyless inversion of the final A:
+ * words[b][0] and words[b][1] are the left and right words of branch b.
+ */
+typedef struct {
+    uint16_t words[SPARX64_NUM_BRANCHES][2][SPARX64_BATCH_SIZE];
+} inverted_batch_t;
+
+// ---------------------------------------------------------
+
+typedef struct {
+    const experiment_ctx_t* ctx;
+    sparx64_context_t cipher_ctx;
+    uint64_t seed;
+
+    // The correct final-round keys (k0 << 16) | k1 of both branches
+    uint32_t final_keys[SPARX64_NUM_BRANCHES];
+} key_ctx_t;
+
+// ---------------------------------------------------------
+
+/**
+ * The buffers of a thread. masks[b][g] has bit j set iff guess g of branch b
+ * is consistent with pair j of the current batch. counters holds the counts
+ * of all guesses (g0 << num_key_bits) | g1 from the pairs of this thread,
+ * s.t. threads never share a cache line of counters.
+ */
+typedef struct {
+    std::vector<uint64_t> masks[SPARX64_NUM_BRANCHES];
+    std::vector<uint32_t> guesses[SPARX64_NUM_BRANCHES][SPARX64_BATCH_SIZE];
+    std::vector<uint32_t> counters;
+} thread_buffers_t;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint32_t get_final_key(const experiment_ctx_t* ctx,
+                              const sparx64_context_t* cipher_ctx,
+                              const size_t branch) {
+    const uint16_t* subkeys =
+        cipher_ctx->subkeys[ctx->num_steps * SPARX64_NUM_BRANCHES + branch];
+    return ((uint32_t)subkeys[2] << 16) | subkeys[3];
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the key bits of guess g, i.e., g deposited into the lowest bits
+ * of the final-round key but the equivalent bit.
+ */
+static uint32_t get_guessed_key_bits(const uint32_t g) {
+    const uint32_t low_mask = (1U << EQUIVALENT_KEY_BIT) - 1;
+    return (g & low_mask) | ((g & ~low_mask) << 1);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the guess of the key bits of a final-round key, the inverse of
+ * get_guessed_key_bits().
+ */
+static size_t get_guess(const experiment_ctx_t* ctx, const uint32_t key) {
+    const uint32_t low_mask = (1U << EQUIVALENT_KEY_BIT) - 1;
+    const uint32_t guess = (key & low_mask) | ((key >> 1) & ~low_mask);
+    return guess & (uint32_t)((1ULL << ctx->num_key_bits) - 1);
+}
+
+// ---------------------------------------------------------
+
+static void to_words(uint16_t words[SPARX64_NUM_STATE_WORDS],
+                     const uint64_t state) {
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        words[i] = (uint16_t)(state >> (16 * (SPARX64_NUM_STATE_WORDS - 1 - i)));
+    }
+}
+
+// ---------------------------------------------------------
+
+static uint64_t from_words(const uint16_t words[SPARX64_NUM_STATE_WORDS]) {
+    uint64_t state = 0;
+
+    for (size_t i = 0; i < SPARX64_NUM_STATE_WORDS; ++i) {
+        state = (state << 16) | words[i];
+    }
+
+    return state;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Decrypts the chosen internal state over the first rounds to a plaintext.
+ */
+static uint64_t get_plaintext(const key_ctx_t* key_ctx, const uint64_t state) {
+    uint16_t words[SPARX64_NUM_STATE_WORDS];
+    uint16_t plaintext[SPARX64_NUM_STATE_WORDS];
+    to_words(words, state);
+    sparx_decrypt_rounds(&key_ctx->cipher_ctx, words, plaintext,
+        NUM_ROUNDS_INVERTED);
+    return from_words(plaintext);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Encrypts the plaintexts over the attacked rounds and inverts the A of the
+ * final round.
+ */
+static void encrypt_batch(const key_ctx_t* key_ctx,
+                          const uint64_t plaintexts[SPARX64_BATCH_SIZE],
+                          uint16_t words[SPARX64_NUM_BRANCHES][2][SPARX64_BATCH_SIZE]) {
+    const size_t num_steps = key_ctx->ctx->num_steps;
+    sparx64_batch_t batch;
+    sparx_load_batch(&batch, plaintexts);
+    sparx_encrypt_steps_batch(&key_ctx->cipher_ctx, &batch, 1, num_steps);
+
+    for (size_t r = 1; r <= NUM_ROUNDS_INVERTED; ++r) {
+        sparx_encrypt_round_batch(&key_ctx->cipher_ctx, &batch,
+            num_steps * SPARX64_NUM_ROUNDS_PER_STEP + r);
+    }
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        const uint16_t* l = batch.words[2 * b];
+        const uint16_t* r = batch.words[2 * b + 1];
+
+        // The key is added before A and cancels in the differences
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            uint16_t x = l[j];
+            uint16_t y = r[j];
+            sparx_A_inverse(&x, &y);
+            words[b][0][j] = x;
+            words[b][1][j] = y;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Stores into predicted[b] the x-difference of branch b after the keyed
+ * inversion that a right pair must have.
+ */
+static void predict_differences(const inverted_batch_t* texts,
+                                const inverted_batch_t* texts_,
+                                uint16_t predicted[SPARX64_NUM_BRANCHES][SPARX64_BATCH_SIZE]) {
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        uint16_t delta_y[SPARX64_NUM_BRANCHES];
+
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            delta_y[b] = ROTR16((uint16_t)(
+                texts->words[b][0][j] ^ texts->words[b][1][j]
+                ^ texts_->words[b][0][j] ^ texts_->words[b][1][j]), 2);
+        }
+
+        // L = R ^ L'(R) with L'(r0, r1) = (t, t) and t = (r0 ^ r1) <<< 8
+        const uint16_t left_xor_right = (uint16_t)(delta_y[0] ^ delta_y[1]);
+        predicted[1][j] = delta_y[1] ^ ROTR16(left_xor_right, 8);
+        predicted[0][j] = predicted[1][j] ^ left_xor_right;
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Sets masks[g] to the pairs of the batch that are consistent with guess g
+ * of the final-round key of branch.
+ */
+static void match_guesses(const key_ctx_t* key_ctx,
+                          const size_t branch,
+                          const inverted_batch_t* texts,
+                          const inverted_batch_t* texts_,
+                          const uint16_t predicted[SPARX64_BATCH_SIZE],
+                          const uint64_t valid_mask,
+                          std::vector<uint64_t>& masks) {
+    const size_t num_guesses = (size_t)1 << key_ctx->ctx->num_key_bits;
+    const uint32_t fixed_key = key_ctx->final_keys[branch]
+        & ~get_guessed_key_bits((uint32_t)(num_guesses - 1));
+    const uint16_t* l = texts->words[branch][0];
+    const uint16_t* r = texts->words[branch][1];
+    const uint16_t* l_ = texts_->words[branch][0];
+    const uint16_t* r_ = texts_->words[branch][1];
+
+    for (size_t g = 0; g < num_guesses; ++g) {
+        const uint32_t key = fixed_key | get_guessed_key_bits((uint32_t)g);
+        const uint16_t k0 = (uint16_t)(key >> 16);
+        const uint16_t k1 = (uint16_t)key;
+        uint8_t is_match[SPARX64_BATCH_SIZE];
+
+        // Inverts A on both texts and the key addition of x; that of y
+        // cancels in the differences
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            uint16_t x = l[j] ^ k0;
+            uint16_t y = r[j] ^ k1;
+            uint16_t x_ = l_[j] ^ k0;
+            uint16_t y_ = r_[j] ^ k1;
+            sparx_A_inverse(&x, &y);
+            sparx_A_inverse(&x_, &y_);
+            is_match[j] = (uint16_t)(x ^ x_) == predicted[j];
+        }
+
+        uint64_t mask = 0;
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            mask |= (uint64_t)is_match[j] << j;
+        }
+
+        masks[g] = mask & valid_mask;
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Increments the thread's counters of all guesses of both branches that are
+ * consistent with the same pair. The guesses of each branch are collected in
+ * ascending order, s.t. the increments of a pair walk through the rows of
+ * its left guesses in ascending addresses.
+ */
+static void update_counters(const key_ctx_t* key_ctx,
+                            thread_buffers_t* buffers) {
+    const size_t num_key_bits = key_ctx->ctx->num_key_bits;
+    const size_t num_guesses = (size_t)1 << num_key_bits;
+    uint32_t* counters = buffers->counters.data();
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            buffers->guesses[b][j].clear();
+        }
+
+        for (size_t g = 0; g < num_guesses; ++g) {
+            uint64_t mask = buffers->masks[b][g];
+
+            while (mask != 0) {
+                buffers->guesses[b][__builtin_ctzll(mask)].push_back(
+                    (uint32_t)g);
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+        const std::vector<uint32_t>& left = buffers->guesses[0][j];
+        const std::vector<uint32_t>& right = buffers->guesses[1][j];
+
+        for (size_t i = 0; i < left.size(); ++i) {
+            uint32_t* row = counters + ((size_t)left[i] << num_key_bits);
+
+            for (size_t k = 0; k < right.size(); ++k) {
+                row[right[k]]++;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+static void process_batches(const key_ctx_t* key_ctx,
+                            const size_t from,
+                            const size_t to,
+                            thread_buffers_t* buffers) {
+    const experiment_ctx_t* ctx = key_ctx->ctx;
+    uint64_t plaintexts[SPARX64_BATCH_SIZE];
+    uint64_t plaintexts_[SPARX64_BATCH_SIZE];
+    inverted_batch_t texts;
+    inverted_batch_t texts_;
+    uint16_t predicted[SPARX64_NUM_BRANCHES][SPARX64_BATCH_SIZE];
+
+    for (size_t batch = from; batch < to; ++batch) {
+        const size_t first = batch * SPARX64_BATCH_SIZE;
+        uint64_t valid_mask = ~0ULL;
+
+        if (first + SPARX64_BATCH_SIZE > ctx->num_pairs_per_key) {
+            valid_mask = (1ULL << (ctx->num_pairs_per_key - first)) - 1;
+        }
+
+        for (size_t j = 0; j < SPARX64_BATCH_SIZE; ++j) {
+            const uint64_t state = splitmix64(key_ctx->seed + first + j);
+            plaintexts[j] = get_plaintext(key_ctx, state);
+            plaintexts_[j] = get_plaintext(key_ctx, state ^ ctx->alpha);
+        }
+
+        encrypt_batch(key_ctx, plaintexts, texts.words);
+        encrypt_batch(key_ctx, plaintexts_, texts_.words);
+        predict_differences(&texts, &texts_, predicted);
+
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            match_guesses(key_ctx, b, &texts, &texts_, predicted[b],
+                valid_mask, buffers->masks[b]);
+        }
+
+        update_counters(key_ctx, buffers);
+    }
+}
+
+// ---------------------------------------------------------
+// Experiment
+// ---------------------------------------------------------
+
+/**
+ * Returns the rank of the correct guess, counted from one; only guesses
+ * with a higher count are ranked before it, and the other guesses with the
+ * same count are stored into num_ties.
+ */
+static size_t get_rank(const std::vector<uint32_t>& counters,
+                       const size_t correct_index,
+                       size_t* num_ties) {
+    const uint32_t correct_count = counters[correct_index];
+    size_t rank = 1;
+    *num_ties = 0;
+
+    for (size_t i = 0; i < counters.size(); ++i) {
+        if (counters[i] > correct_count) {
+            rank++;
+        } else if ((counters[i] == correct_count) && (i != correct_index)) {
+            (*num_ties)++;
+        }
+    }
+
+    return rank;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Sets counters to the sum of the counters of all threads.
+ */
+static void merge_counters(const std::vector<thread_buffers_t>& buffers,
+                           std::vector<uint32_t>& counters) {
+    std::fill(counters.begin(), counters.end(), 0);
+
+    for (size_t t = 0; t < buffers.size(); ++t) {
+        const uint32_t* thread_counters = buffers[t].counters.data();
+
+        for (size_t i = 0; i < counters.size(); ++i) {
+            counters[i] += thread_counters[i];
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the rank of the correct guess and stores the number of other
+ * guesses with the same count into num_ties.
+ */
+static size_t run_key(const experiment_ctx_t* ctx,
+                      ThreadPool& pool,
+                      std::vector<thread_buffers_t>& buffers,
+                      std::vector<uint32_t>& counters,
+                      size_t* num_ties) {
+    key_ctx_t key_ctx;
+    key_ctx.ctx = ctx;
+
+    uint8_t key[SPARX64_KEY_LENGTH];
+    get_random(key, SPARX64_KEY_LENGTH);
+    sparx_key_schedule(&key_ctx.cipher_ctx, key);
+    get_random((uint8_t*)&key_ctx.seed, sizeof(key_ctx.seed));
+
+    for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+        key_ctx.final_keys[b] = get_final_key(ctx, &key_ctx.cipher_ctx, b);
+    }
+
+    for (size_t t = 0; t < buffers.size(); ++t) {
+        std::fill(buffers[t].counters.begin(), buffers[t].counters.end(), 0);
+    }
+
+    const size_t num_batches =
+        (ctx->num_pairs_per_key + SPARX64_BATCH_SIZE - 1) / SPARX64_BATCH_SIZE;
+
+    pool.parallel_for(num_batches, NUM_BATCHES_PER_CHUNK,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            process_batches(&key_ctx, from, to, &buffers[thread_index]);
+        });
+
+    merge_counters(buffers, counters);
+
+    const size_t correct_index =
+        (get_guess(ctx, key_ctx.final_keys[0]) << ctx->num_key_bits)
+        | get_guess(ctx, key_ctx.final_keys[1]);
+    uint32_t max_count = 0;
+
+    for (size_t i = 0; i < counters.size(); ++i) {
+        if (counters[i] > max_count) {
+            max_count = counters[i];
+        }
+    }
+
+    const size_t rank = get_rank(counters, correct_index, num_ties);
+    printf("Correct count %6" PRIu32 ", max count %6" PRIu32 ", rank %8zu, "
+        "ties %8zu", counters[correct_index], max_count, rank, *num_ties);
+    return rank;
+}
+
+// ---------------------------------------------------------
+
+static void run_experiments(const experiment_ctx_t* ctx) {
+    ThreadPool pool(NUM_THREADS);
+    const size_t num_guesses = (size_t)1 << ctx->num_key_bits;
+    std::vector<thread_buffers_t> buffers(pool.get_num_threads());
+
+    for (size_t t = 0; t < buffers.size(); ++t) {
+        for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+            buffers[t].masks[b].resize(num_guesses);
+        }
+
+        buffers[t].counters.resize(num_guesses * num_guesses);
+    }
+
+    std::vector<uint32_t> counters(num_guesses * num_guesses);
+
+    size_t num_successes = 0;
+    double sum_log2_ranks = 0;
+    double total_seconds = 0;
+
+    for (size_t i = 0; i < ctx->num_keys; ++i) {
+        printf("Key %4zu: ", i);
+        const auto start = std::chrono::steady_clock::now();
+        size_t num_ties;
+        const size_t rank = run_key(ctx, pool, buffers, counters, &num_ties);
+        const auto end = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(end - start).count();
+
+        printf(" in %.2f s\n", seconds);
+        fflush(stdout);
+
+        num_successes += (rank == 1) && (num_ties == 0);
+        sum_log2_ranks += log2((double)rank);
+        total_seconds += seconds;
+    }
+
+    printf("Success rate:   %.4f (%zu/%zu)\n",
+        (double)num_successes / ctx->num_keys, num_successes, ctx->num_keys);
+    printf("Avg log2(rank): %.2f of %zu bits\n",
+        sum_log2_ranks / ctx->num_keys, 2 * ctx->num_key_bits);
+    printf("Avg time/key:   %.2f s\n", total_seconds / ctx->num_keys);
+    printf("Counters:       %zu bytes (%zu threads and the merged ones)\n",
+        (buffers.size() + 1) * counters.size() * sizeof(uint32_t),
+        buffers.size());
+}
+
+// ---------------------------------------------------------
+// Argument parsing
+// ---------------------------------------------------------
+
+static void parse_args(experiment_ctx_t* ctx, int argc, const char** argv) {
+    ArgumentParser parser;
+    parser.appName("Truncated-Differential Key Recovery");
+    parser.helpString("Recovers <g> bits of the final-round key of each branch with the truncated differential over <s> steps and two more rounds of SPARX-64 for <k> keys.");
+    parser.addArgument("-k", "--num_keys", 1, false);
+    parser.addArgument("-t", "--num_texts", 1);
+    parser.addArgument("-s", "--num_steps", 1);
+    parser.addArgument("-g", "--num_key_bits", 1);
+
+    try {
+        parser.parse(argc, argv);
+
+        ctx->num_keys = parser.retrieveAsInt("num_keys");
+
+        if (parser.count("num_texts")) {
+            ctx->num_pairs_per_key = parser.retrieveAsLong("num_texts");
+        }
+
+        if (parser.count("num_steps")) {
+            ctx->num_steps = parser.retrieveAsInt("num_steps");
+        }
+
+        if (parser.count("num_key_bits")) {
+            ctx->num_key_bits = parser.retrieveAsInt("num_key_bits");
+        }
+    } catch( ... ) {
+        fprintf(stderr, "%s\n", parser.usage().c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_keys == 0) {
+        fprintf(stderr, "Number of keys must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Two rounds of the following step must remain
+    if ((ctx->num_steps == 0) || (ctx->num_steps >= SPARX64_NUM_STEPS)) {
+        fprintf(stderr, "Number of steps must be in [1, %d]\n",
+            SPARX64_NUM_STEPS - 1);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((ctx->num_key_bits == 0) || (ctx->num_key_bits > MAX_NUM_KEY_BITS)) {
+        fprintf(stderr, "Number of key bits must be in [1, %d]\n",
+            MAX_NUM_KEY_BITS);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctx->num_pairs_per_key == 0) {
+        fprintf(stderr, "Number of texts must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("#Keys      %8zu\n", ctx->num_keys);
+    printf("#Pairs     %8zu\n", ctx->num_pairs_per_key);
+    printf("#Steps     %8zu\n", ctx->num_steps);
+    printf("#Key bits  %8zu per branch\n", ctx->num_key_bits);
+}
+
+// ---------------------------------------------------------
+
+int main(int argc, const char** argv) {
+    experiment_ctx_t ctx;
+    parse_args(&ctx, argc, argv);
+    run_experiments(&ctx);
+    return 0;
+}
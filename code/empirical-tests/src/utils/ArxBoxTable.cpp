@@ -0,0 +1,344 @@
+/**
+ * A precomputed table of the differential transitions of the ARX-box A of
+ * SPARX-64 over up to three rounds.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ciphers/sparx64_search.h"
+#include "utils/ArxBoxTable.h"
+#include "utils/MappedFile.h"
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const char ARX_BOX_TABLE_MAGIC[8] = {
+    'S', 'P', 'X', 'A', 'R', 'X', 'B', 'X'
+};
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool is_before_by_difference(const arx_box_table_transition_t& a,
+                                    const arx_box_table_transition_t& b) {
+    return a.difference < b.difference;
+}
+
+// ---------------------------------------------------------
+
+static bool write_section(FILE* file, const void* data, const size_t length) {
+    return (length == 0) || (fwrite(data, 1, length, file) == length);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns true if num_items items of item_size bytes from offset lie within
+ * a file of file_size bytes, without overflows for corrupt headers.
+ */
+static bool is_section_in_file(const uint64_t offset,
+                               const uint64_t num_items,
+                               const uint64_t item_size,
+                               const uint64_t file_size) {
+    return (offset <= file_size)
+        && (num_items <= (file_size - offset) / item_size);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Appends the transitions over num_rounds rounds from input, sorted by
+ * output difference, and returns their minimal weight.
+ */
+static int add_transitions(const uint32_t input,
+                           const size_t num_rounds,
+                           const int max_weight,
+                           std::vector<arx_box_table_transition_t>& list) {
+    std::unordered_map<uint32_t, arx_box_table_transition_t> transitions;
+    const uint16_t words[2] = { (uint16_t)(input >> 16), (uint16_t)input };
+
+    trail_search_enumerate_branch(words, num_rounds, max_weight,
+        [&](const uint16_t out[2], const int weight) {
+            const uint32_t difference = ((uint32_t)out[0] << 16) | out[1];
+            const auto it = transitions.find(difference);
+
+            if (it == transitions.end()) {
+                arx_box_table_transition_t& transition =
+                    transitions[difference];
+                transition.difference = difference;
+                transition.weight = weight;
+                transition.probability = pow(2, -weight);
+                return;
+            }
+
+            it->second.weight = std::min(it->second.weight, weight);
+            it->second.probability += pow(2, -weight);
+        });
+
+    const size_t first = list.size();
+    int min_weight = ARX_BOX_TABLE_NO_WEIGHT;
+
+    for (const auto& entry : transitions) {
+        list.push_back(entry.second);
+
+        if ((min_weight == ARX_BOX_TABLE_NO_WEIGHT)
+            || (entry.second.weight < min_weight)) {
+            min_weight = entry.second.weight;
+        }
+    }
+
+    std::sort(list.begin() + first, list.end(), is_before_by_difference);
+    return min_weight;
+}
+
+// ---------------------------------------------------------
+// ArxBoxTableBuilder
+// ---------------------------------------------------------
+
+void ArxBoxTableBuilder::add_input(const uint32_t difference) {
+    arx_box_table_input_t input;
+    memset(&input, 0, sizeof(input));
+    input.difference = difference;
+    inputs.push_back(input);
+}
+
+// ---------------------------------------------------------
+
+void ArxBoxTableBuilder::compute(ThreadPool& pool) {
+    std::sort(inputs.begin(), inputs.end(),
+        [](const arx_box_table_input_t& a, const arx_box_table_input_t& b) {
+            return a.difference < b.difference;
+        });
+    inputs.erase(std::unique(inputs.begin(), inputs.end(),
+        [](const arx_box_table_input_t& a, const arx_box_table_input_t& b) {
+            return a.difference == b.difference;
+        }), inputs.end());
+
+    transitions.assign(inputs.size(),
+        std::vector<arx_box_table_transition_t>());
+
+    pool.parallel_for(inputs.size(), 1,
+        [this](const size_t thread_index, const size_t from, const size_t to) {
+            (void)thread_index;
+
+            for (size_t i = from; i < to; ++i) {
+                arx_box_table_input_t& input = inputs[i];
+                std::vector<arx_box_table_transition_t>& list = transitions[i];
+
+                for (size_t r = 0; r < ARX_BOX_TABLE_MAX_NUM_ROUNDS; ++r) {
+                    input.first_transitions[r] = list.size();
+                    input.min_weights[r] = (int16_t)add_transitions(
+                        input.difference, r + 1, max_weight, list);
+                }
+
+                input.first_transitions[ARX_BOX_TABLE_MAX_NUM_ROUNDS] =
+                    list.size();
+            }
+        });
+}
+
+// ---------------------------------------------------------
+
+size_t ArxBoxTableBuilder::get_num_transitions() const {
+    size_t num_transitions = 0;
+
+    for (size_t i = 0; i < transitions.size(); ++i) {
+        num_transitions += transitions[i].size();
+    }
+
+    return num_transitions;
+}
+
+// ---------------------------------------------------------
+
+bool ArxBoxTableBuilder::write(const char* path) {
+    // The offsets of the inputs were relative to their own transitions
+    std::vector<arx_box_table_input_t> table_inputs(inputs);
+    uint64_t offset = 0;
+
+    for (size_t i = 0; i < table_inputs.size(); ++i) {
+        for (size_t r = 0; r <= ARX_BOX_TABLE_MAX_NUM_ROUNDS; ++r) {
+            table_inputs[i].first_transitions[r] += offset;
+        }
+
+        offset += transitions[i].size();
+    }
+
+    arx_box_table_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARX_BOX_TABLE_MAGIC, sizeof(ARX_BOX_TABLE_MAGIC));
+    header.version = ARX_BOX_TABLE_VERSION;
+    header.max_weight = max_weight;
+    header.num_inputs = table_inputs.size();
+    header.num_transitions = offset;
+    header.inputs_offset = sizeof(header);
+    header.transitions_offset = header.inputs_offset
+        + table_inputs.size() * sizeof(arx_box_table_input_t);
+
+    const std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    bool is_written = write_section(file, &header, sizeof(header))
+        && write_section(file, table_inputs.data(),
+            table_inputs.size() * sizeof(arx_box_table_input_t));
+
+    for (size_t i = 0; is_written && (i < transitions.size()); ++i) {
+        is_written = write_section(file, transitions[i].data(),
+            transitions[i].size() * sizeof(arx_box_table_transition_t));
+    }
+
+    if ((fclose(file) != 0) || !is_written) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return rename(temp_path.c_str(), path) == 0;
+}
+
+// ---------------------------------------------------------
+// ArxBoxTable
+// ---------------------------------------------------------
+
+bool ArxBoxTable::open(const char* path) {
+    header = NULL;
+
+    if (!file.open(path)
+        || (file.get_size() < sizeof(arx_box_table_header_t))) {
+        return false;
+    }
+
+    const uint8_t* data = file.get_data();
+    const arx_box_table_header_t* candidate =
+        (const arx_box_table_header_t*)data;
+
+    if (memcmp(candidate->magic, ARX_BOX_TABLE_MAGIC,
+            sizeof(ARX_BOX_TABLE_MAGIC))
+        || (candidate->version != ARX_BOX_TABLE_VERSION)
+        || !is_section_in_file(candidate->inputs_offset,
+            candidate->num_inputs, sizeof(arx_box_table_input_t),
+            file.get_size())
+        || !is_section_in_file(candidate->transitions_offset,
+            candidate->num_transitions, sizeof(arx_box_table_transition_t),
+            file.get_size())
+        || (candidate->transitions_offset + candidate->num_transitions
+            * sizeof(arx_box_table_transition_t) != file.get_size())) {
+        file.close();
+        return false;
+    }
+
+    const arx_box_table_input_t* candidate_inputs =
+        (const arx_box_table_input_t*)(data + candidate->inputs_offset);
+
+    // The ranges of transitions are used without further checks, and
+    // find_input() needs strictly ascending differences
+    for (size_t i = 0; i < candidate->num_inputs; ++i) {
+        const uint64_t* first = candidate_inputs[i].first_transitions;
+
+        if ((i > 0) && (candidate_inputs[i - 1].difference
+                >= candidate_inputs[i].difference)) {
+            file.close();
+            return false;
+        }
+
+        for (size_t r = 0; r < ARX_BOX_TABLE_MAX_NUM_ROUNDS; ++r) {
+            if ((first[r] > first[r + 1])
+                || (first[r + 1] > candidate->num_transitions)) {
+                file.close();
+                return false;
+            }
+        }
+    }
+
+    header = candidate;
+    inputs = candidate_inputs;
+    transitions = (const arx_box_table_transition_t*)(
+        data + header->transitions_offset);
+    return true;
+}
+
+// ---------------------------------------------------------
+
+const arx_box_table_input_t* ArxBoxTable::find_input(
+    const uint32_t difference) const {
+    const arx_box_table_input_t* end = inputs + header->num_inputs;
+    const arx_box_table_input_t* it = std::lower_bound(inputs, end,
+        difference,
+        [](const arx_box_table_input_t& input, const uint32_t value) {
+            return input.difference < value;
+        });
+
+    if ((it == end) || (it->difference != difference)) {
+        return NULL;
+    }
+
+    return it;
+}
+
+// ---------------------------------------------------------
+
+const arx_box_table_transition_t* ArxBoxTable::get_transitions(
+    const arx_box_table_input_t& input,
+    const size_t num_rounds,
+    size_t* num_transitions) const {
+    if ((num_rounds == 0) || (num_rounds > ARX_BOX_TABLE_MAX_NUM_ROUNDS)) {
+        *num_transitions = 0;
+        return NULL;
+    }
+
+    const uint64_t first = input.first_transitions[num_rounds - 1];
+    *num_transitions = (size_t)(input.first_transitions[num_rounds] - first);
+    return transitions + first;
+}
+
+// ---------------------------------------------------------
+
+const arx_box_table_transition_t* ArxBoxTable::find_transition(
+    const arx_box_table_input_t& input,
+    const size_t num_rounds,
+    const uint32_t difference) const {
+    size_t num_transitions;
+    const arx_box_table_transition_t* begin =
+        get_transitions(input, num_rounds, &num_transitions);
+    const arx_box_table_transition_t* end = begin + num_transitions;
+
+    arx_box_table_transition_t key;
+    memset(&key, 0, sizeof(key));
+    key.difference = difference;
+
+    const arx_box_table_transition_t* it =
+        std::lower_bound(begin, end, key, is_before_by_difference);
+
+    if ((it == end) || (it->difference != difference)) {
+        return NULL;
+    }
+
+    return it;
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,303 @@
+/**
+ * Collects per-bit and per-word statistics of 64-bit differences.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "utils/BiasProfile.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const size_t NUM_BITS_PER_WORD = 16;
+
+// Correlations below this many standard deviations are considered noise
+static const double SIGNIFICANCE_THRESHOLD = 4.0;
+
+// Thresholds for the probability of the most likely bit difference
+static const double MASK_THRESHOLDS[] = { 1.0, 0.99, 0.9, 0.75 };
+static const size_t NUM_MASK_THRESHOLDS = 4;
+
+// Masks with less advantage over random are not suggested
+static const double MIN_ADVANTAGE = 1.0;
+
+// Word-level probabilities from fewer pairs are too noisy to rank masks
+static const uint64_t MIN_NUM_OCCURRENCES = 10;
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+/**
+ * Returns the bit of the 64-bit difference that is printed at position i, 
+ * counted from the left.
+ */
+static uint64_t get_bit_at_position(const size_t i) {
+    return 1ULL << (BIAS_PROFILE_NUM_BITS - 1 - i);
+}
+
+// ---------------------------------------------------------
+
+static size_t get_zero_pattern(const uint64_t difference) {
+    size_t pattern = 0;
+
+    for (size_t w = 0; w < BIAS_PROFILE_NUM_WORDS; ++w) {
+        const size_t shift = 
+            NUM_BITS_PER_WORD * (BIAS_PROFILE_NUM_WORDS - 1 - w);
+
+        if (((difference >> shift) & 0xFFFF) == 0) {
+            pattern |= 1 << w;
+        }
+    }
+
+    return pattern;
+}
+
+// ---------------------------------------------------------
+
+static uint64_t get_word_mask(const size_t word_mask) {
+    uint64_t mask = 0;
+
+    for (size_t w = 0; w < BIAS_PROFILE_NUM_WORDS; ++w) {
+        if (word_mask & (1 << w)) {
+            mask |= 0xFFFFULL 
+                << (NUM_BITS_PER_WORD * (BIAS_PROFILE_NUM_WORDS - 1 - w));
+        }
+    }
+
+    return mask;
+}
+
+// ---------------------------------------------------------
+
+static char get_heat_map_symbol(const uint64_t num_ones, 
+                                const uint64_t num_differences) {
+    if ((num_ones == 0) || (num_ones == num_differences)) {
+        return '#';
+    }
+
+    const double p = (double)num_ones / (double)num_differences;
+    const double correlation = fabs(2 * p - 1);
+
+    if (correlation * sqrt((double)num_differences) < SIGNIFICANCE_THRESHOLD) {
+        return '.';
+    }
+
+    const int weight = (int)floor(-log2(correlation));
+    return (char)('0' + std::min(weight, 9));
+}
+
+// ---------------------------------------------------------
+// Functions
+// ---------------------------------------------------------
+
+void transpose_64x64(uint64_t matrix[64]) {
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+
+    // Swaps the off-diagonal blocks of size j x j
+    for (size_t j = 32; j != 0; j >>= 1, mask ^= (mask << j)) {
+        for (size_t k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            const uint64_t t = (matrix[k] ^ (matrix[k | j] >> j)) & mask;
+            matrix[k] ^= t;
+            matrix[k | j] ^= t << j;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// BiasProfile
+// ---------------------------------------------------------
+
+BiasProfile::BiasProfile(const size_t num_steps) : steps(num_steps) {
+    for (size_t s = 0; s < num_steps; ++s) {
+        memset(steps[s].num_ones, 0, sizeof(steps[s].num_ones));
+        memset(steps[s].num_zero_patterns, 0, 
+            sizeof(steps[s].num_zero_patterns));
+    }
+}
+
+// ---------------------------------------------------------
+
+void BiasProfile::add(const size_t step_index, 
+                      const uint64_t* differences, 
+                      const size_t num_differences) {
+    step_profile_t& step = steps[step_index];
+    uint64_t matrix[BIAS_PROFILE_NUM_BITS];
+
+    memcpy(matrix, differences, num_differences * sizeof(uint64_t));
+    memset(matrix + num_differences, 0, 
+        (BIAS_PROFILE_NUM_BITS - num_differences) * sizeof(uint64_t));
+
+    for (size_t i = 0; i < num_differences; ++i) {
+        step.num_zero_patterns[get_zero_pattern(differences[i])]++;
+    }
+
+    // Row i now holds the bit at position i of all differences
+    transpose_64x64(matrix);
+
+    for (size_t i = 0; i < BIAS_PROFILE_NUM_BITS; ++i) {
+        step.num_ones[i] += __builtin_popcountll(matrix[i]);
+    }
+
+    step.num_differences += num_differences;
+}
+
+// ---------------------------------------------------------
+
+void BiasProfile::merge(const BiasProfile& other) {
+    for (size_t s = 0; s < steps.size(); ++s) {
+        step_profile_t& step = steps[s];
+        const step_profile_t& other_step = other.steps[s];
+
+        for (size_t i = 0; i < BIAS_PROFILE_NUM_BITS; ++i) {
+            step.num_ones[i] += other_step.num_ones[i];
+        }
+
+        for (size_t i = 0; i < BIAS_PROFILE_NUM_PATTERNS; ++i) {
+            step.num_zero_patterns[i] += other_step.num_zero_patterns[i];
+        }
+
+        step.num_differences += other_step.num_differences;
+    }
+}
+
+// ---------------------------------------------------------
+
+double BiasProfile::get_probability_of_zero_words(
+    const step_profile_t& step, const size_t word_mask) const {
+    uint64_t num_zero = 0;
+
+    for (size_t pattern = 0; pattern < BIAS_PROFILE_NUM_PATTERNS; ++pattern) {
+        if ((pattern & word_mask) == word_mask) {
+            num_zero += step.num_zero_patterns[pattern];
+        }
+    }
+
+    return (double)num_zero / (double)step.num_differences;
+}
+
+// ---------------------------------------------------------
+
+void BiasProfile::print_heat_map() const {
+    puts("Bias heat map ('#' constant, d: correlation ~2^{-d}, "
+        "'.' not significant)");
+
+    for (size_t s = 0; s < steps.size(); ++s) {
+        const step_profile_t& step = steps[s];
+        printf("Step %2zu: ", s + 1);
+
+        for (size_t i = 0; i < BIAS_PROFILE_NUM_BITS; ++i) {
+            if ((i > 0) && ((i % NUM_BITS_PER_WORD) == 0)) {
+                putchar(' ');
+            }
+
+            putchar(get_heat_map_symbol(step.num_ones[i], step.num_differences));
+        }
+
+        putchar('\n');
+    }
+}
+
+// ---------------------------------------------------------
+
+void BiasProfile::print_suggested_masks(const size_t num_masks) const {
+    for (size_t s = 0; s < steps.size(); ++s) {
+        const step_profile_t& step = steps[s];
+
+        if (step.num_differences == 0) {
+            continue;
+        }
+
+        printf("Step %2zu:  %-16s %-16s %5s %8s %9s\n", 
+            s + 1, "Mask", "Delta", "#Bits", "log2(p)", "Advantage");
+
+        // Word-level masks with delta zero; exact probabilities
+        std::vector<std::pair<double, size_t> > word_masks;
+
+        for (size_t w = 1; w < BIAS_PROFILE_NUM_PATTERNS; ++w) {
+            const double p = get_probability_of_zero_words(step, w);
+
+            if (p * step.num_differences >= MIN_NUM_OCCURRENCES) {
+                const double advantage = 
+                    NUM_BITS_PER_WORD * __builtin_popcount(w) + log2(p);
+                word_masks.push_back(std::make_pair(advantage, w));
+            }
+        }
+
+        std::sort(word_masks.rbegin(), word_masks.rend());
+
+        for (size_t i = 0; (i < num_masks) && (i < word_masks.size()); ++i) {
+            const size_t w = word_masks[i].second;
+
+            if (word_masks[i].first < MIN_ADVANTAGE) {
+                break;
+            }
+
+            printf("  words:  %016" PRIx64 " %016" PRIx64 " %5d %8.2f %9.2f\n",
+                get_word_mask(w), (uint64_t)0, 
+                (int)NUM_BITS_PER_WORD * __builtin_popcount(w),
+                word_masks[i].first - NUM_BITS_PER_WORD * __builtin_popcount(w),
+                word_masks[i].first);
+        }
+
+        // Bit-level masks; the probability assumes independent bits
+        uint64_t previous_mask = 0;
+
+        for (size_t t = 0; t < NUM_MASK_THRESHOLDS; ++t) {
+            uint64_t mask = 0;
+            uint64_t delta = 0;
+            double log_probability = 0;
+
+            for (size_t i = 0; i < BIAS_PROFILE_NUM_BITS; ++i) {
+                const double p_one = 
+                    (double)step.num_ones[i] / (double)step.num_differences;
+                const double p_max = std::max(p_one, 1 - p_one);
+
+                if (p_max < MASK_THRESHOLDS[t]) {
+                    continue;
+                }
+
+                mask |= get_bit_at_position(i);
+                log_probability += log2(p_max);
+
+                if (p_one > 0.5) {
+                    delta |= get_bit_at_position(i);
+                }
+            }
+
+            const int num_bits = __builtin_popcountll(mask);
+
+            if ((mask == previous_mask) 
+                || (num_bits + log_probability < MIN_ADVANTAGE)) {
+                continue;
+            }
+
+            previous_mask = mask;
+
+            printf("  p>=%.2f %016" PRIx64 " %016" PRIx64 " %5d %8.2f %9.2f\n",
+                MASK_THRESHOLDS[t], mask, delta, num_bits, log_probability, 
+                num_bits + log_probability);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,145 @@
+/**
+ * A disk cache of boomerang connectivity table entries of a branch of
+ * SPARX-64.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "utils/BoomerangCache.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const char* ENTRY_FORMAT_READ =
+    "{\"num_rounds\":%zu,\"beta\":\"%8" SCNx32 "\",\"gamma\":\"%8" SCNx32
+    "\",\"num_keys\":%zu,\"count\":%" SCNu64 "}";
+
+static const char* ENTRY_FORMAT_WRITE =
+    "{\"num_rounds\":%zu,\"beta\":\"%08" PRIx32 "\",\"gamma\":\"%08" PRIx32
+    "\",\"num_keys\":%zu,\"count\":%" PRIu64 "}\n";
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool read_line(FILE* file, std::string& line) {
+    line.clear();
+    int c;
+
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+
+        line.push_back((char)c);
+    }
+
+    return !line.empty();
+}
+
+// ---------------------------------------------------------
+// BoomerangCache
+// ---------------------------------------------------------
+
+bool BoomerangCache::read(const char* path) {
+    entries.clear();
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        return true;
+    }
+
+    std::string line;
+    bool is_valid = true;
+
+    while (is_valid && read_line(file, line)) {
+        boomerang_cache_entry_t entry;
+        is_valid = sscanf(line.c_str(), ENTRY_FORMAT_READ, &entry.num_rounds,
+            &entry.beta, &entry.gamma, &entry.num_keys, &entry.count) == 5;
+
+        if (is_valid) {
+            add(entry);
+        }
+    }
+
+    fclose(file);
+    return is_valid;
+}
+
+// ---------------------------------------------------------
+
+bool BoomerangCache::write(const char* path) const {
+    const std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "w");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const boomerang_cache_entry_t& entry = entries[i];
+        fprintf(file, ENTRY_FORMAT_WRITE, entry.num_rounds, entry.beta,
+            entry.gamma, entry.num_keys, entry.count);
+    }
+
+    const bool is_written = !ferror(file);
+
+    if ((fclose(file) != 0) || !is_written) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return rename(temp_path.c_str(), path) == 0;
+}
+
+// ---------------------------------------------------------
+
+const boomerang_cache_entry_t* BoomerangCache::find(
+    const size_t num_rounds,
+    const uint32_t beta,
+    const uint32_t gamma) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if ((entries[i].num_rounds == num_rounds)
+            && (entries[i].beta == beta)
+            && (entries[i].gamma == gamma)) {
+            return &entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+// ---------------------------------------------------------
+
+void BoomerangCache::add(const boomerang_cache_entry_t& entry) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if ((entries[i].num_rounds == entry.num_rounds)
+            && (entries[i].beta == entry.beta)
+            && (entries[i].gamma == entry.gamma)) {
+            entries[i].num_keys += entry.num_keys;
+            entries[i].count += entry.count;
+            return;
+        }
+    }
+
+    entries.push_back(entry);
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
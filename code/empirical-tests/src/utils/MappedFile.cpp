@@ -0,0 +1,74 @@
+/**
+ * A read-only memory mapping of a file.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/MappedFile.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+// ---------------------------------------------------------
+
+bool MappedFile::open(const char* path) {
+    close();
+    const int file = ::open(path, O_RDONLY);
+
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat status;
+
+    if ((fstat(file, &status) != 0) || (status.st_size <= 0)) {
+        ::close(file);
+        return false;
+    }
+
+    void* mapping = mmap(
+        NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, file, 0
+    );
+
+    // The mapping stays valid after closing the descriptor
+    ::close(file);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    data = (const uint8_t*)mapping;
+    size = (size_t)status.st_size;
+    return true;
+}
+
+// ---------------------------------------------------------
+
+void MappedFile::close() {
+    if (data != NULL) {
+        munmap((void*)data, size);
+    }
+
+    data = NULL;
+    size = 0;
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
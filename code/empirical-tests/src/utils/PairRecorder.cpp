@@ -0,0 +1,144 @@
+/**
+ * Records right pairs or quartets of an experiment into a binary file
+ * without serializing the threads that find them.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono> // NOLINT(build/c++11)
+#include <memory>
+#include <thread> // NOLINT(build/c++11)
+#include <vector>
+
+#include "utils/PairRecorder.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const char   PAIR_RECORDER_MAGIC[8] = {
+    'S', 'P', 'X', 'P', 'A', 'I', 'R', 'S'
+};
+static const size_t WRITER_SLEEP_MICROSECONDS = 1000;
+
+// ---------------------------------------------------------
+// Methods
+// ---------------------------------------------------------
+
+PairRecorder::PairRecorder(const char* path, const size_t num_threads) {
+    is_running = true;
+    file = fopen(path, "wb");
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        std::unique_ptr<RingBuffer> buffer(new RingBuffer());
+        buffer->head = 0;
+        buffer->tail = 0;
+        buffers.push_back(std::move(buffer));
+    }
+
+    if (file == NULL) {
+        return;
+    }
+
+    const uint32_t version = PAIR_RECORDER_VERSION;
+    const uint32_t record_length = sizeof(pair_record_t);
+    fwrite(PAIR_RECORDER_MAGIC, 1, sizeof(PAIR_RECORDER_MAGIC), file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&record_length, sizeof(record_length), 1, file);
+
+    writer = std::thread(&PairRecorder::run_writer, this);
+}
+
+// ---------------------------------------------------------
+
+PairRecorder::~PairRecorder() {
+    if (file == NULL) {
+        return;
+    }
+
+    is_running = false;
+    writer.join();
+
+    // Records may have been added after the last round of the writer
+    drain();
+    fclose(file);
+}
+
+// ---------------------------------------------------------
+
+void PairRecorder::record(const size_t thread_index, 
+                          const pair_record_t& record) {
+    if (file == NULL) {
+        return;
+    }
+
+    RingBuffer* buffer = buffers[thread_index].get();
+    const size_t head = buffer->head.load(std::memory_order_relaxed);
+
+    // Only wait if the writer is behind by a full buffer
+    while (head - buffer->tail.load(std::memory_order_acquire) 
+           >= BUFFER_CAPACITY) {
+        std::this_thread::yield();
+    }
+
+    buffer->records[head % BUFFER_CAPACITY] = record;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+// ---------------------------------------------------------
+
+size_t PairRecorder::drain() {
+    size_t num_drained = 0;
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        RingBuffer* buffer = buffers[i].get();
+        const size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t tail = buffer->tail.load(std::memory_order_relaxed);
+
+        while (tail != head) {
+            // Write contiguous parts of the ring at once
+            const size_t from = tail % BUFFER_CAPACITY;
+            size_t length = head - tail;
+
+            if (from + length > BUFFER_CAPACITY) {
+                length = BUFFER_CAPACITY - from;
+            }
+
+            fwrite(buffer->records + from, sizeof(pair_record_t), length, file);
+            tail += length;
+            num_drained += length;
+        }
+
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+
+    num_records += num_drained;
+    return num_drained;
+}
+
+// ---------------------------------------------------------
+
+void PairRecorder::run_writer() {
+    while (is_running) {
+        if (drain() == 0) {
+            std::this_thread::sleep_for(
+                std::chrono::microseconds(WRITER_SLEEP_MICROSECONDS)
+            );
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
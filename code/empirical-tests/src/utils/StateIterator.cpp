@@ -20,6 +20,10 @@
 #include <string.h>
 #include <stdio.h>
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #include "utils/convert.h"
 #include "utils/StateIterator.h"
 
@@ -79,55 +83,150 @@ static void find_shift_indices(const uint8_t* states_mask,
     }
 }
 
+// ---------------------------------------------------------
+
+/**
+ * Deposits the lowest bits of value into the active bits of the mask.
+ */
+static uint64_t deposit(const uint64_t value,
+                        const uint64_t mask,
+                        const std::vector<uint8_t>& shift_indices) {
+#ifdef __BMI2__
+    (void)shift_indices;
+    return _pdep_u64(value, mask);
+#else
+    (void)mask;
+    uint64_t result = 0;
+    uint64_t remaining = value;
+
+    while (remaining != 0) {
+        result |= 1ULL << shift_indices[__builtin_ctzll(remaining)];
+        remaining &= remaining - 1;
+    }
+
+    return result;
+#endif
+}
+
 // ---------------------------------------------------------
 // Methods
 // ---------------------------------------------------------
 
-StateIterator::StateIterator(const uint8_t* states_mask, const size_t num_bytes) {
-    this->states_mask = (uint8_t*)malloc(num_bytes);
-    memcpy(this->states_mask, states_mask, num_bytes);
+StateIterator::StateIterator(const uint8_t* states_mask,
+                             const size_t num_bytes,
+                             const bool use_gray_code) {
+    this->states_mask.assign(states_mask, states_mask + num_bytes);
+    this->use_gray_code = use_gray_code;
 
     num_state_bytes = num_bytes;
     num_active_bits = find_hamming_weight(states_mask, num_bytes);
     num_states = ((size_t)1L) << num_active_bits;
 
     find_shift_indices(states_mask, num_bytes, shift_indices);
-    reset();
+
+    for (size_t i = 0; i < shift_indices.size(); ++i) {
+        mask |= 1ULL << shift_indices[i];
+    }
+
+    set_range(0, num_states);
 }
 
 // ---------------------------------------------------------
 
 StateIterator::~StateIterator() {
-    free(states_mask);
 }
 
 // ---------------------------------------------------------
 
 void StateIterator::reset() {
-    current_state_index = 0;
+    seek(range_from);
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Continues with the state at the given index, s.t. threads can enumerate
+ * disjoint index ranges of the same structure.
+ */
+void StateIterator::seek(const size_t index) {
+    current_state_index = index;
+    is_current_state_valid = false;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Restricts the iterator to the indices [from, to) and resets it.
+ */
+void StateIterator::set_range(const size_t from, const size_t to) {
+    range_from = (from < num_states) ? from : num_states;
+    range_to = (to < num_states) ? to : num_states;
+    reset();
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Restricts the iterator to the part-th of num_parts consecutive ranges of
+ * almost equal sizes of all indices, for part in [0, num_parts). A part
+ * beyond them is empty, and num_parts = 0 is treated as a single part.
+ */
+void StateIterator::split(const size_t part, const size_t num_parts) {
+    if (num_parts == 0) {
+        set_range(0, num_states);
+        return;
+    }
+
+    if (part >= num_parts) {
+        set_range(num_states, num_states);
+        return;
+    }
+
+    const size_t size = num_states / num_parts;
+    const size_t remainder = num_states % num_parts;
+    const size_t from = part * size + ((part < remainder) ? part : remainder);
+    set_range(from, from + size + ((part < remainder) ? 1 : 0));
 }
 
 // ---------------------------------------------------------
 
 bool StateIterator::has_next() {
-    return num_states > current_state_index;
+    return range_to > current_state_index;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns the state at index in [0, num_states). Larger indices are taken
+ * modulo num_states, s.t. the deposit never exceeds the active bits.
+ */
+uint64_t StateIterator::get_state(const size_t index) const {
+    const size_t valid_index = index & (num_states - 1);
+
+    if (use_gray_code) {
+        return deposit(valid_index ^ (valid_index >> 1), mask, shift_indices);
+    }
+
+    return deposit(valid_index, mask, shift_indices);
 }
 
 // ---------------------------------------------------------
 
 uint64_t StateIterator::internal_next_as_uint64() {
-    uint64_t next_value = 0L;
-    size_t mask = 1L;
+    if (!use_gray_code) {
+        return get_state(current_state_index);
+    }
 
-    for (size_t i = 0; i < num_active_bits; ++i) {
-        if ((current_state_index & mask) != 0) {
-            next_value |= 1L << shift_indices[i];
-        }
-        
-        mask <<= 1;
+    // The Gray codes of i - 1 and i differ only in the lowest set bit of i
+    if (is_current_state_valid) {
+        current_state ^=
+            1ULL << shift_indices[__builtin_ctzll(current_state_index)];
+    } else {
+        current_state = get_state(current_state_index);
+        is_current_state_valid = true;
     }
 
-    return next_value;
+    return current_state;
 }
 
 // ---------------------------------------------------------
@@ -140,6 +239,32 @@ uint64_t StateIterator::next_as_uint64() {
 
 // ---------------------------------------------------------
 
+/**
+ * Stores up to max_num_states next states into states, e.g., a batch, and
+ * returns their number.
+ */
+size_t StateIterator::next_batch(uint64_t* states,
+                                 const size_t max_num_states) {
+    if (!has_next()) {
+        return 0;
+    }
+
+    size_t num_states_left = range_to - current_state_index;
+
+    if (num_states_left > max_num_states) {
+        num_states_left = max_num_states;
+    }
+
+    for (size_t j = 0; j < num_states_left; ++j) {
+        states[j] = internal_next_as_uint64();
+        current_state_index++;
+    }
+
+    return num_states_left;
+}
+
+// ---------------------------------------------------------
+
 void StateIterator::next(uint8_t* state) {
     const uint64_t next_value = internal_next_as_uint64();
     current_state_index++;
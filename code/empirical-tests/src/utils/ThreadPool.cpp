@@ -0,0 +1,109 @@
+/**
+ * A fixed set of worker threads that process ranges of items in parallel.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable> // NOLINT(build/c++11)
+#include <mutex>              // NOLINT(build/c++11)
+#include <thread>             // NOLINT(build/c++11)
+#include <vector>
+
+#include "utils/ThreadPool.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+
+ThreadPool::ThreadPool(const size_t num_threads) {
+    next_item = 0;
+    threads.reserve(num_threads);
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back(&ThreadPool::run_worker, this, i);
+    }
+}
+
+// ---------------------------------------------------------
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+
+    start_condition.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// ---------------------------------------------------------
+
+void ThreadPool::parallel_for(const size_t num_items, 
+                              const size_t chunk_size, 
+                              const task_t& task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    this->current_task = &task;
+    this->num_items = num_items;
+    this->chunk_size = (chunk_size == 0) ? 1 : chunk_size;
+    next_item = 0;
+    num_active_threads = threads.size();
+    generation++;
+
+    start_condition.notify_all();
+    done_condition.wait(lock, [this] { return num_active_threads == 0; });
+    current_task = NULL;
+}
+
+// ---------------------------------------------------------
+
+void ThreadPool::run_worker(const size_t thread_index) {
+    size_t last_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_condition.wait(lock, [this, last_generation] { 
+                return is_stopping || (generation != last_generation); 
+            });
+
+            if (is_stopping) {
+                return;
+            }
+
+            last_generation = generation;
+        }
+
+        while (true) {
+            const size_t from = next_item.fetch_add(chunk_size);
+
+            if (from >= num_items) {
+                break;
+            }
+
+            const size_t to = 
+                (from + chunk_size > num_items) ? num_items : from + chunk_size;
+            (*current_task)(thread_index, from, to);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (--num_active_threads == 0) {
+            done_condition.notify_one();
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
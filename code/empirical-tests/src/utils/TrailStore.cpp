@@ -0,0 +1,463 @@
+/**
+ * A compact binary store of differential characteristics of SPARX-64 and
+ * SPECKEY-32.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ciphers/sparx64_trail.h"
+#include "ciphers/speckey32_trail.h"
+#include "utils/MappedFile.h"
+#include "utils/TrailStore.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+static const char TRAIL_STORE_MAGIC[8] = {
+    'S', 'P', 'X', 'T', 'R', 'A', 'I', 'L'
+};
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static uint64_t to_difference(const uint16_t* words, const size_t num_words) {
+    uint64_t difference = 0;
+
+    for (size_t i = 0; i < num_words; ++i) {
+        difference = (difference << 16) | words[i];
+    }
+
+    return difference;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Order of the entries in the file.
+ */
+static bool is_before_by_alpha(const trail_store_entry_t& a,
+                               const trail_store_entry_t& b) {
+    if (a.cipher != b.cipher) return a.cipher < b.cipher;
+    if (a.num_rounds != b.num_rounds) return a.num_rounds < b.num_rounds;
+    if (a.alpha != b.alpha) return a.alpha < b.alpha;
+    if (a.weight != b.weight) return a.weight < b.weight;
+    if (a.delta != b.delta) return a.delta < b.delta;
+    if (a.source_index != b.source_index) {
+        return a.source_index < b.source_index;
+    }
+
+    return a.index_in_source < b.index_in_source;
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Prefixes of the order of the entries, for searching them.
+ */
+static bool is_before_by_rounds(const trail_store_entry_t& a,
+                                const trail_store_entry_t& b) {
+    if (a.cipher != b.cipher) return a.cipher < b.cipher;
+    return a.num_rounds < b.num_rounds;
+}
+
+// ---------------------------------------------------------
+
+static bool is_before_by_alpha_and_weight(const trail_store_entry_t& a,
+                                          const trail_store_entry_t& b) {
+    if (a.cipher != b.cipher) return a.cipher < b.cipher;
+    if (a.num_rounds != b.num_rounds) return a.num_rounds < b.num_rounds;
+    if (a.alpha != b.alpha) return a.alpha < b.alpha;
+    return a.weight < b.weight;
+}
+
+// ---------------------------------------------------------
+
+static bool is_before_by_delta(const trail_store_entry_t& a,
+                               const trail_store_entry_t& b) {
+    if (a.cipher != b.cipher) return a.cipher < b.cipher;
+    if (a.num_rounds != b.num_rounds) return a.num_rounds < b.num_rounds;
+    if (a.delta != b.delta) return a.delta < b.delta;
+    return a.weight < b.weight;
+}
+
+// ---------------------------------------------------------
+
+static bool is_before_by_weight(const trail_store_entry_t& a,
+                                const trail_store_entry_t& b) {
+    if (a.cipher != b.cipher) return a.cipher < b.cipher;
+    if (a.num_rounds != b.num_rounds) return a.num_rounds < b.num_rounds;
+    return a.weight < b.weight;
+}
+
+// ---------------------------------------------------------
+
+static bool is_matching(const trail_query_t& query,
+                        const trail_store_entry_t& trail) {
+    return (trail.weight >= query.min_weight)
+        && (trail.weight <= query.max_weight)
+        && (!query.has_alpha || (trail.alpha == query.alpha))
+        && (!query.has_delta || (trail.delta == query.delta));
+}
+
+// ---------------------------------------------------------
+
+static bool write_section(FILE* file, const void* data, const size_t length) {
+    return (length == 0) || (fwrite(data, 1, length, file) == length);
+}
+
+// ---------------------------------------------------------
+// TrailStoreBuilder
+// ---------------------------------------------------------
+
+bool TrailStoreBuilder::add_file(const char* path, size_t* num_trails) {
+    std::vector<sparx64_trail_t> sparx_trails;
+    std::vector<speckey32_trail_t> speckey_trails;
+    *num_trails = 0;
+
+    if ((strlen(path) >= TRAIL_STORE_MAX_PATH_LENGTH)
+        || !sparx_read_trails(path, sparx_trails)
+        || !speckey_read_trails(path, speckey_trails)) {
+        return false;
+    }
+
+    const uint32_t source_index = (uint32_t)sources.size();
+    sources.push_back(path);
+
+    for (size_t i = 0; i < sparx_trails.size(); ++i) {
+        const sparx64_trail_t& trail = sparx_trails[i];
+        const size_t num_rounds = sparx_get_num_trail_rounds(trail);
+
+        if (num_rounds == 0) {
+            continue;
+        }
+
+        trail_store_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.cipher = TRAIL_STORE_SPARX64;
+        entry.num_rounds = (uint16_t)num_rounds;
+        entry.source_index = source_index;
+        entry.index_in_source = (uint32_t)i;
+        entry.alpha = to_difference(
+            trail.rows.front().difference, SPARX64_NUM_STATE_WORDS);
+        entry.delta = to_difference(
+            trail.rows.back().difference, SPARX64_NUM_STATE_WORDS);
+        entry.first_row = rows.size();
+        uint32_t weight = 0;
+
+        for (size_t r = 0; r < trail.rows.size(); ++r) {
+            trail_store_row_t row;
+            memset(&row, 0, sizeof(row));
+            row.difference = to_difference(
+                trail.rows[r].difference, SPARX64_NUM_STATE_WORDS);
+
+            for (size_t b = 0; b < SPARX64_NUM_BRANCHES; ++b) {
+                row.weights[b] = (int16_t)trail.rows[r].weights[b];
+
+                if (row.weights[b] > 0) {
+                    weight += row.weights[b];
+                }
+            }
+
+            rows.push_back(row);
+        }
+
+        // The per-round weights also count the free most significant bits
+        entry.weight = (trail.weight == SPARX64_TRAIL_NO_WEIGHT)
+            ? weight : (uint32_t)trail.weight;
+        entries.push_back(entry);
+    }
+
+    for (size_t i = 0; i < speckey_trails.size(); ++i) {
+        const speckey32_trail_t& trail = speckey_trails[i];
+        const size_t num_rounds = speckey_get_num_trail_rounds(trail);
+
+        if (num_rounds == 0) {
+            continue;
+        }
+
+        trail_store_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.cipher = TRAIL_STORE_SPECKEY32;
+        entry.num_rounds = (uint16_t)num_rounds;
+        entry.source_index = source_index;
+        entry.index_in_source = (uint32_t)i;
+        entry.alpha = to_difference(
+            trail.rows.front().difference, SPECKEY32_NUM_STATE_WORDS);
+        entry.delta = to_difference(
+            trail.rows.back().difference, SPECKEY32_NUM_STATE_WORDS);
+        entry.first_row = rows.size();
+        uint32_t weight = 0;
+
+        for (size_t r = 0; r < trail.rows.size(); ++r) {
+            trail_store_row_t row;
+            memset(&row, 0, sizeof(row));
+            row.difference = to_difference(
+                trail.rows[r].difference, SPECKEY32_NUM_STATE_WORDS);
+            row.weights[0] = (int16_t)trail.rows[r].weight;
+            row.weights[1] = TRAIL_STORE_NO_WEIGHT;
+
+            if (row.weights[0] > 0) {
+                weight += row.weights[0];
+            }
+
+            rows.push_back(row);
+        }
+
+        entry.weight = (trail.weight == SPECKEY32_TRAIL_NO_WEIGHT)
+            ? weight : (uint32_t)trail.weight;
+        entries.push_back(entry);
+    }
+
+    *num_trails = sparx_trails.size() + speckey_trails.size();
+    return true;
+}
+
+// ---------------------------------------------------------
+
+bool TrailStoreBuilder::write(const char* path) {
+    const size_t num_trails = entries.size();
+    std::vector<uint32_t> order(num_trails);
+
+    for (size_t i = 0; i < num_trails; ++i) {
+        order[i] = (uint32_t)i;
+    }
+
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return is_before_by_alpha(entries[a], entries[b]);
+    });
+
+    // Lay out the rows in the order of the sorted entries
+    std::vector<trail_store_entry_t> sorted_entries(num_trails);
+    std::vector<trail_store_row_t> sorted_rows;
+    sorted_rows.reserve(rows.size());
+
+    for (size_t i = 0; i < num_trails; ++i) {
+        trail_store_entry_t entry = entries[order[i]];
+        const size_t num_rows = entry.num_rounds + 1;
+
+        sorted_rows.insert(sorted_rows.end(),
+            rows.begin() + entry.first_row,
+            rows.begin() + entry.first_row + num_rows);
+        entry.first_row = sorted_rows.size() - num_rows;
+        sorted_entries[i] = entry;
+    }
+
+    std::vector<uint32_t> delta_index(num_trails);
+    std::vector<uint32_t> weight_index(num_trails);
+
+    for (size_t i = 0; i < num_trails; ++i) {
+        delta_index[i] = (uint32_t)i;
+        weight_index[i] = (uint32_t)i;
+    }
+
+    std::stable_sort(delta_index.begin(), delta_index.end(),
+        [&sorted_entries](uint32_t a, uint32_t b) {
+            return is_before_by_delta(sorted_entries[a], sorted_entries[b]);
+        });
+    std::stable_sort(weight_index.begin(), weight_index.end(),
+        [&sorted_entries](uint32_t a, uint32_t b) {
+            return is_before_by_weight(sorted_entries[a], sorted_entries[b]);
+        });
+
+    std::vector<trail_store_source_t> sources_table(sources.size());
+    memset(sources_table.data(), 0,
+        sources_table.size() * sizeof(trail_store_source_t));
+
+    for (size_t i = 0; i < sources.size(); ++i) {
+        strncpy(sources_table[i].path, sources[i].c_str(),
+            TRAIL_STORE_MAX_PATH_LENGTH - 1);
+    }
+
+    trail_store_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRAIL_STORE_MAGIC, sizeof(TRAIL_STORE_MAGIC));
+    header.version = TRAIL_STORE_VERSION;
+    header.num_sources = (uint32_t)sources.size();
+    header.num_trails = num_trails;
+    header.num_rows = sorted_rows.size();
+    header.sources_offset = sizeof(header);
+    header.trails_offset = header.sources_offset
+        + sources_table.size() * sizeof(trail_store_source_t);
+    header.rows_offset = header.trails_offset
+        + num_trails * sizeof(trail_store_entry_t);
+    header.delta_index_offset = header.rows_offset
+        + sorted_rows.size() * sizeof(trail_store_row_t);
+    header.weight_index_offset = header.delta_index_offset
+        + num_trails * sizeof(uint32_t);
+
+    const std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    const bool is_written = write_section(file, &header, sizeof(header))
+        && write_section(file, sources_table.data(),
+            sources_table.size() * sizeof(trail_store_source_t))
+        && write_section(file, sorted_entries.data(),
+            num_trails * sizeof(trail_store_entry_t))
+        && write_section(file, sorted_rows.data(),
+            sorted_rows.size() * sizeof(trail_store_row_t))
+        && write_section(file, delta_index.data(),
+            num_trails * sizeof(uint32_t))
+        && write_section(file, weight_index.data(),
+            num_trails * sizeof(uint32_t));
+
+    if ((fclose(file) != 0) || !is_written) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return rename(temp_path.c_str(), path) == 0;
+}
+
+// ---------------------------------------------------------
+// TrailStore
+// ---------------------------------------------------------
+
+bool TrailStore::open(const char* path) {
+    header = NULL;
+
+    if (!file.open(path) || (file.get_size() < sizeof(trail_store_header_t))) {
+        return false;
+    }
+
+    const uint8_t* data = file.get_data();
+    const trail_store_header_t* candidate = (const trail_store_header_t*)data;
+
+    if (memcmp(candidate->magic, TRAIL_STORE_MAGIC, sizeof(TRAIL_STORE_MAGIC))
+        || (candidate->version != TRAIL_STORE_VERSION)
+        || (candidate->weight_index_offset
+            + candidate->num_trails * sizeof(uint32_t) != file.get_size())) {
+        file.close();
+        return false;
+    }
+
+    header = candidate;
+    sources = (const trail_store_source_t*)(data + header->sources_offset);
+    trails = (const trail_store_entry_t*)(data + header->trails_offset);
+    rows = (const trail_store_row_t*)(data + header->rows_offset);
+    delta_index = (const uint32_t*)(data + header->delta_index_offset);
+    weight_index = (const uint32_t*)(data + header->weight_index_offset);
+    return true;
+}
+
+// ---------------------------------------------------------
+
+void TrailStore::find_rounds(const trail_query_t& query,
+                             const size_t num_rounds,
+                             std::vector<size_t>& results) const {
+    trail_store_entry_t key;
+    memset(&key, 0, sizeof(key));
+    key.cipher = (uint16_t)query.cipher;
+    key.num_rounds = (uint16_t)num_rounds;
+    key.alpha = query.alpha;
+    key.delta = query.delta;
+    key.weight = query.min_weight;
+
+    const trail_store_entry_t* end = trails + header->num_trails;
+
+    if (query.has_alpha) {
+        // Entries with this alpha are sorted by weight
+        const trail_store_entry_t* it = 
+            std::lower_bound(trails, end, key, is_before_by_alpha_and_weight);
+
+        for (; (it != end) && (it->cipher == key.cipher)
+            && (it->num_rounds == key.num_rounds)
+            && (it->alpha == key.alpha); ++it) {
+            if (it->weight > query.max_weight) {
+                break;
+            }
+
+            if (is_matching(query, *it)) {
+                results.push_back(it - trails);
+            }
+        }
+
+        return;
+    }
+
+    const uint32_t* index = query.has_delta ? delta_index : weight_index;
+    const uint32_t* index_end = index + header->num_trails;
+    const uint32_t* it;
+
+    if (query.has_delta) {
+        it = std::lower_bound(index, index_end, key,
+            [this](const uint32_t a, const trail_store_entry_t& b) {
+                return is_before_by_delta(trails[a], b);
+            });
+    } else {
+        it = std::lower_bound(index, index_end, key,
+            [this](const uint32_t a, const trail_store_entry_t& b) {
+                return is_before_by_weight(trails[a], b);
+            });
+    }
+
+    for (; it != index_end; ++it) {
+        const trail_store_entry_t& trail = trails[*it];
+
+        if ((trail.cipher != key.cipher)
+            || (trail.num_rounds != key.num_rounds)
+            || (query.has_delta && (trail.delta != key.delta))
+            || (trail.weight > query.max_weight)) {
+            break;
+        }
+
+        if (is_matching(query, trail)) {
+            results.push_back(*it);
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+void TrailStore::find(const trail_query_t& query,
+                      std::vector<size_t>& results) const {
+    results.clear();
+
+    if (query.num_rounds > 0) {
+        find_rounds(query, query.num_rounds, results);
+        return;
+    }
+
+    // Jump from one number of rounds to the next in the sorted entries
+    const trail_store_entry_t* end = trails + header->num_trails;
+    trail_store_entry_t key;
+    memset(&key, 0, sizeof(key));
+    key.cipher = (uint16_t)query.cipher;
+    key.num_rounds = 1;
+
+    while (true) {
+        const trail_store_entry_t* it =
+            std::lower_bound(trails, end, key, is_before_by_rounds);
+
+        if ((it == end) || (it->cipher != key.cipher)) {
+            return;
+        }
+
+        find_rounds(query, it->num_rounds, results);
+        key.num_rounds = it->num_rounds + 1;
+    }
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,121 @@
+/**
+ * In-place fast Walsh-Hadamard transform.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "utils/ThreadPool.h"
+#include "utils/WalshHadamard.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Constants
+// ---------------------------------------------------------
+
+// The stages with butterflies within blocks of 2^12 values are run block by
+// block, s.t. a block stays in the L1 or L2 cache
+#define NUM_BLOCK_BITS 12
+
+// Number of butterflies per item of the thread pool in the later stages
+#define NUM_BUTTERFLIES_PER_ITEM (1UL << 12)
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+/**
+ * Runs the butterflies of distance h on the values [from, from + 2h).
+ */
+template<typename T>
+static void butterflies(T* values, const size_t from, const size_t h) {
+    T* a = values + from;
+    T* b = values + from + h;
+
+    for (size_t j = 0; j < h; ++j) {
+        const T x = a[j];
+        const T y = b[j];
+        a[j] = x + y;
+        b[j] = x - y;
+    }
+}
+
+// ---------------------------------------------------------
+
+template<typename T>
+static void transform(T* values, const size_t num_bits, ThreadPool& pool) {
+    const size_t num_values = (size_t)1 << num_bits;
+    const size_t num_block_bits =
+        (num_bits < NUM_BLOCK_BITS) ? num_bits : NUM_BLOCK_BITS;
+    const size_t block_size = (size_t)1 << num_block_bits;
+
+    pool.parallel_for(num_values / block_size, 1,
+        [&](const size_t thread_index, const size_t from, const size_t to) {
+            (void)thread_index;
+
+            for (size_t block = from; block < to; ++block) {
+                for (size_t h = 1; h < block_size; h <<= 1) {
+                    for (size_t i = block * block_size;
+                         i < (block + 1) * block_size; i += 2 * h) {
+                        butterflies(values, i, h);
+                    }
+                }
+            }
+        });
+
+    // The butterflies of the later stages are split into ranges of
+    // NUM_BUTTERFLIES_PER_ITEM consecutive ones, which never cross a pair of
+    // halves since both are powers of two
+    for (size_t h = block_size; h < num_values; h <<= 1) {
+        const size_t num_items = (num_values / 2) / NUM_BUTTERFLIES_PER_ITEM;
+
+        pool.parallel_for(num_items, 1,
+            [&](const size_t thread_index, const size_t from, const size_t to) {
+                (void)thread_index;
+
+                for (size_t item = from; item < to; ++item) {
+                    const size_t first = item * NUM_BUTTERFLIES_PER_ITEM;
+                    const size_t pair = first / h;
+                    const size_t offset = first % h;
+                    T* a = values + 2 * h * pair + offset;
+                    T* b = a + h;
+
+                    for (size_t j = 0; j < NUM_BUTTERFLIES_PER_ITEM; ++j) {
+                        const T x = a[j];
+                        const T y = b[j];
+                        a[j] = x + y;
+                        b[j] = x - y;
+                    }
+                }
+            });
+    }
+}
+
+// ---------------------------------------------------------
+// Functions
+// ---------------------------------------------------------
+
+void walsh_hadamard_transform(int64_t* values,
+                              const size_t num_bits,
+                              ThreadPool& pool) {
+    transform(values, num_bits, pool);
+}
+
+// ---------------------------------------------------------
+
+void walsh_hadamard_transform(double* values,
+                              const size_t num_bits,
+                              ThreadPool& pool) {
+    transform(values, num_bits, pool);
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
@@ -0,0 +1,161 @@
+/**
+ * A fixed set of worker threads that process a tree of tasks with work 
+ * stealing.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable> // NOLINT(build/c++11)
+#include <deque>
+#include <memory>
+#include <mutex>              // NOLINT(build/c++11)
+#include <thread>             // NOLINT(build/c++11)
+#include <vector>
+
+#include "utils/WorkStealingPool.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+
+WorkStealingPool::WorkStealingPool(const size_t num_threads) {
+    num_pending_tasks = 0;
+    threads.reserve(num_threads);
+    queues.reserve(num_threads);
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        queues.emplace_back(new Queue());
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back(&WorkStealingPool::run_worker, this, i);
+    }
+}
+
+// ---------------------------------------------------------
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+
+    start_condition.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// ---------------------------------------------------------
+
+void WorkStealingPool::run(const task_t& task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    num_pending_tasks = 1;
+
+    {
+        std::lock_guard<std::mutex> queue_lock(queues[0]->mutex);
+        queues[0]->tasks.push_back(task);
+    }
+
+    num_active_threads = threads.size();
+    generation++;
+
+    start_condition.notify_all();
+    done_condition.wait(lock, [this] { return num_active_threads == 0; });
+}
+
+// ---------------------------------------------------------
+
+void WorkStealingPool::spawn(const size_t thread_index, const task_t& task) {
+    // Count the task before it can be stolen, s.t. the counter cannot reach
+    // zero while the spawning task is still running
+    num_pending_tasks++;
+    Queue& queue = *(queues[thread_index]);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+}
+
+// ---------------------------------------------------------
+
+bool WorkStealingPool::pop(const size_t thread_index, task_t* task) {
+    Queue& queue = *(queues[thread_index]);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+// ---------------------------------------------------------
+
+bool WorkStealingPool::steal(const size_t thread_index, task_t* task) {
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& queue = *(queues[(thread_index + i) % queues.size()]);
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        *task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+// ---------------------------------------------------------
+
+void WorkStealingPool::run_worker(const size_t thread_index) {
+    size_t last_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_condition.wait(lock, [this, last_generation] { 
+                return is_stopping || (generation != last_generation); 
+            });
+
+            if (is_stopping) {
+                return;
+            }
+
+            last_generation = generation;
+        }
+
+        task_t task;
+
+        while (num_pending_tasks > 0) {
+            if (pop(thread_index, &task) || steal(thread_index, &task)) {
+                task(thread_index);
+                num_pending_tasks--;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (--num_active_threads == 0) {
+            done_condition.notify_one();
+        }
+    }
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils
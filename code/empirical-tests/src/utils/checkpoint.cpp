@@ -0,0 +1,375 @@
+/**
+ * Checkpoints for long-running experiments.
+ *
+ * @author eik list
+ * @copyright see license.txt
+ * @last-modified 2018-04
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "utils/checkpoint.h"
+
+// ---------------------------------------------------------
+
+namespace utils {
+
+// ---------------------------------------------------------
+// Helper functions
+// ---------------------------------------------------------
+
+static bool read_line(FILE* file, std::string& line) {
+    line.clear();
+    int c;
+
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+
+        line.push_back((char)c);
+    }
+
+    return !line.empty();
+}
+
+// ---------------------------------------------------------
+
+/**
+ * Returns a pointer to the first character after "<name>": in line, or NULL
+ * if the line does not contain the field.
+ */
+static const char* find_field(const std::string& line, const char* name) {
+    const std::string pattern = std::string("\"") + name + "\":";
+    const size_t position = line.find(pattern);
+
+    if (position == std::string::npos) {
+        return NULL;
+    }
+
+    return line.c_str() + position + pattern.size();
+}
+
+// ---------------------------------------------------------
+
+static bool parse_string(const std::string& line,
+                         const char* name,
+                         std::string& value) {
+    const char* begin = find_field(line, name);
+
+    if ((begin == NULL) || (*begin != '"')) {
+        return false;
+    }
+
+    begin++;
+    const char* end = strchr(begin, '"');
+
+    if (end == NULL) {
+        return false;
+    }
+
+    value.assign(begin, end - begin);
+    return true;
+}
+
+// ---------------------------------------------------------
+
+static bool parse_size(const std::string& line,
+                       const char* name,
+                       size_t* value) {
+    const char* begin = find_field(line, name);
+
+    if (begin == NULL) {
+        return false;
+    }
+
+    char* end;
+    *value = strtoull(begin, &end, 10);
+    return end != begin;
+}
+
+// ---------------------------------------------------------
+
+static bool parse_counts(const std::string& line,
+                         const char* name,
+                         std::vector<int64_t>& counts) {
+    const char* current = find_field(line, name);
+    counts.clear();
+
+    if ((current == NULL) || (*current != '[')) {
+        return false;
+    }
+
+    current++;
+
+    while (*current != ']') {
+        char* end;
+        const int64_t count = strtoll(current, &end, 10);
+
+        if (end == current) {
+            return false;
+        }
+
+        counts.push_back(count);
+        current = end;
+
+        if (*current == ',') {
+            current++;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+static bool parse_hex(const std::string& hex, std::vector<uint8_t>& bytes) {
+    if ((hex.size() % 2) != 0) {
+        return false;
+    }
+
+    bytes.resize(hex.size() / 2);
+
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        const std::string byte_string = hex.substr(2 * i, 2);
+        char* end;
+        bytes[i] = (uint8_t)strtoul(byte_string.c_str(), &end, 16);
+
+        if (*end != '\0') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+static void write_hex(FILE* file, const std::vector<uint8_t>& bytes) {
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        fprintf(file, "%02x", bytes[i]);
+    }
+}
+
+// ---------------------------------------------------------
+
+static bool parse_shard(checkpoint_t* checkpoint, const std::string& line) {
+    std::string shard;
+
+    // Checkpoints of unsharded runs have no shard
+    if (!parse_string(line, "shard", shard)) {
+        checkpoint->shard_index = 0;
+        checkpoint->num_shards = 1;
+        return true;
+    }
+
+    return (sscanf(shard.c_str(), "%zu/%zu", 
+                   &(checkpoint->shard_index), 
+                   &(checkpoint->num_shards)) == 2)
+        && (checkpoint->shard_index < checkpoint->num_shards);
+}
+
+// ---------------------------------------------------------
+
+static bool parse_header(checkpoint_t* checkpoint, const std::string& line) {
+    std::string seed;
+
+    if (!parse_string(line, "experiment", checkpoint->experiment)
+        || !parse_string(line, "seed", seed)
+        || !parse_size(line, "num_keys", &(checkpoint->num_keys))
+        || !parse_size(line, "num_texts", &(checkpoint->num_texts_per_key))
+        || !parse_size(line, "num_chunks", &(checkpoint->num_chunks_per_key))
+        || !parse_shard(checkpoint, line)) {
+        return false;
+    }
+
+    char* end;
+    checkpoint->seed = strtoull(seed.c_str(), &end, 16);
+    return *end == '\0';
+}
+
+// ---------------------------------------------------------
+
+static bool parse_key(checkpoint_key_t* key_state, const std::string& line) {
+    std::string key;
+
+    return parse_size(line, "key_index", &(key_state->key_index))
+        && parse_string(line, "key", key)
+        && parse_hex(key, key_state->key)
+        && parse_counts(line, "counts", key_state->chunk_counts);
+}
+
+// ---------------------------------------------------------
+// API
+// ---------------------------------------------------------
+
+bool is_finished(const checkpoint_key_t& key_state) {
+    for (size_t i = 0; i < key_state.chunk_counts.size(); ++i) {
+        if (key_state.chunk_counts[i] == CHECKPOINT_CHUNK_PENDING) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+int64_t get_total_count(const checkpoint_key_t& key_state) {
+    int64_t total = 0;
+
+    for (size_t i = 0; i < key_state.chunk_counts.size(); ++i) {
+        if (key_state.chunk_counts[i] != CHECKPOINT_CHUNK_PENDING) {
+            total += key_state.chunk_counts[i];
+        }
+    }
+
+    return total;
+}
+
+// ---------------------------------------------------------
+
+bool is_in_shard(const checkpoint_t& checkpoint,
+                 const size_t key_index,
+                 const size_t chunk_index) {
+    const size_t unit_index = 
+        key_index * checkpoint.num_chunks_per_key + chunk_index;
+    return (unit_index % checkpoint.num_shards) == checkpoint.shard_index;
+}
+
+// ---------------------------------------------------------
+
+bool is_shard_finished(const checkpoint_t& checkpoint, const size_t key_index) {
+    const checkpoint_key_t& key_state = checkpoint.keys[key_index];
+
+    for (size_t i = 0; i < key_state.chunk_counts.size(); ++i) {
+        if (is_in_shard(checkpoint, key_index, i)
+            && (key_state.chunk_counts[i] == CHECKPOINT_CHUNK_PENDING)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+bool merge_checkpoint(checkpoint_t* target, const checkpoint_t& source) {
+    if ((target->experiment != source.experiment)
+        || (target->seed != source.seed)
+        || (target->num_keys != source.num_keys)
+        || (target->num_texts_per_key != source.num_texts_per_key)
+        || (target->num_chunks_per_key != source.num_chunks_per_key)
+        || (target->keys.size() != source.keys.size())) {
+        return false;
+    }
+
+    for (size_t i = 0; i < target->keys.size(); ++i) {
+        checkpoint_key_t& target_key = target->keys[i];
+        const checkpoint_key_t& source_key = source.keys[i];
+
+        if ((target_key.key_index != source_key.key_index)
+            || (target_key.key != source_key.key)) {
+            return false;
+        }
+
+        for (size_t j = 0; j < target_key.chunk_counts.size(); ++j) {
+            const int64_t count = source_key.chunk_counts[j];
+
+            if (count == CHECKPOINT_CHUNK_PENDING) {
+                continue;
+            }
+
+            if ((target_key.chunk_counts[j] != CHECKPOINT_CHUNK_PENDING)
+                && (target_key.chunk_counts[j] != count)) {
+                return false;
+            }
+
+            target_key.chunk_counts[j] = count;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------
+
+bool read_checkpoint(checkpoint_t* checkpoint, const char* path) {
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    std::string line;
+    bool is_valid = read_line(file, line) && parse_header(checkpoint, line);
+    checkpoint->keys.clear();
+
+    while (is_valid && read_line(file, line)) {
+        checkpoint_key_t key_state;
+        is_valid = parse_key(&key_state, line)
+            && (key_state.chunk_counts.size() == checkpoint->num_chunks_per_key);
+        checkpoint->keys.push_back(key_state);
+    }
+
+    fclose(file);
+    return is_valid;
+}
+
+// ---------------------------------------------------------
+
+bool write_checkpoint(const checkpoint_t* checkpoint, const char* path) {
+    const std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "w");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file,
+        "{\"experiment\":\"%s\",\"seed\":\"%016" PRIx64 "\","
+        "\"num_keys\":%zu,\"num_texts\":%zu,\"num_chunks\":%zu,"
+        "\"shard\":\"%zu/%zu\"}\n",
+        checkpoint->experiment.c_str(),
+        checkpoint->seed,
+        checkpoint->num_keys,
+        checkpoint->num_texts_per_key,
+        checkpoint->num_chunks_per_key,
+        checkpoint->shard_index,
+        checkpoint->num_shards
+    );
+
+    for (size_t i = 0; i < checkpoint->keys.size(); ++i) {
+        const checkpoint_key_t& key_state = checkpoint->keys[i];
+        fprintf(file, "{\"key_index\":%zu,\"key\":\"", key_state.key_index);
+        write_hex(file, key_state.key);
+        fprintf(file, "\",\"counts\":[");
+
+        for (size_t j = 0; j < key_state.chunk_counts.size(); ++j) {
+            fprintf(file, (j == 0) ? "%" PRId64 : ",%" PRId64,
+                key_state.chunk_counts[j]);
+        }
+
+        fprintf(file, "]}\n");
+    }
+
+    const bool is_written = !ferror(file);
+
+    if ((fclose(file) != 0) || !is_written) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return rename(temp_path.c_str(), path) == 0;
+}
+
+// ---------------------------------------------------------
+
+} // namespace utils